@@ -438,6 +438,19 @@ static void TF_Run_Setup(int noutputs, TF_Tensor** c_outputs,
   }
 }
 
+// Converts 'src' to '*dst'. The buffer of 'src' is shared, except for
+// TF_STRING tensors which are copied.
+static bool TF_TensorToTensor(TF_Tensor* src, Tensor* dst, TF_Status* status) {
+  if (src->dtype != TF_STRING) {
+    *dst = tensorflow::TensorCApi::MakeTensor(src->dtype, src->shape,
+                                              src->buffer);
+    return true;
+  }
+  // TF_STRING tensors require copying since Tensor class expects
+  // a sequence of string objects.
+  return tensorflow::TF_Tensor_DecodeStrings(src, dst, status);
+}
+
 static bool TF_Run_Inputs(
     TF_Tensor* const* c_inputs,
     std::vector<std::pair<tensorflow::string, Tensor>>* input_pairs,
@@ -446,24 +459,36 @@ static bool TF_Run_Inputs(
   bool ok = true;
   for (int i = 0; i < ninputs; ++i) {
     TF_Tensor* src = c_inputs[i];
-    if (ok) {
-      if (c_inputs[i]->dtype != TF_STRING) {
-        (*input_pairs)[i].second = tensorflow::TensorCApi::MakeTensor(
-            src->dtype, src->shape, src->buffer);
-      } else {
-        // TF_STRING tensors require copying since Tensor class expects
-        // a sequence of string objects.
-        ok = tensorflow::TF_Tensor_DecodeStrings(src, &(*input_pairs)[i].second,
-                                                 status);
-        // Must keep looping through all c_inputs even if there is an error
-        // so that TF_DeleteTensor() is called unconditionally on all c_inputs.
-      }
-    }
+    // Must keep looping through all c_inputs even if there is an error
+    // so that TF_DeleteTensor() is called unconditionally on all c_inputs.
+    if (ok) ok = TF_TensorToTensor(src, &(*input_pairs)[i].second, status);
     TF_DeleteTensor(src);
   }
   return ok;
 }
 
+// Stores 'outputs' in c_outputs[].
+static void TF_Run_Outputs(const std::vector<Tensor>& outputs,
+                           TF_Tensor** c_outputs) {
+  for (int i = 0; i < outputs.size(); ++i) {
+    const Tensor& src = outputs[i];
+    if (!src.IsInitialized() || src.NumElements() == 0) {
+      c_outputs[i] = tensorflow::EmptyTensor(
+          static_cast<TF_DataType>(src.dtype()), src.shape());
+      continue;
+    }
+    if (src.dtype() != tensorflow::DT_STRING) {
+      // Share the underlying buffer.
+      TensorBuffer* buf = tensorflow::TensorCApi::Buffer(src);
+      buf->Ref();
+      c_outputs[i] = new TF_Tensor{static_cast<TF_DataType>(src.dtype()),
+                                   src.shape(), buf};
+    } else {
+      c_outputs[i] = tensorflow::TF_Tensor_EncodeStrings(src);
+    }
+  }
+}
+
 static void TF_Run_Helper(
     Session* session, const char* handle, const TF_Buffer* run_options,
     // Input tensors
@@ -511,23 +536,7 @@ static void TF_Run_Helper(
   }
 
   // Store results in c_outputs[]
-  for (int i = 0; i < noutputs; ++i) {
-    const Tensor& src = outputs[i];
-    if (!src.IsInitialized() || src.NumElements() == 0) {
-      c_outputs[i] = tensorflow::EmptyTensor(
-          static_cast<TF_DataType>(src.dtype()), src.shape());
-      continue;
-    }
-    if (src.dtype() != tensorflow::DT_STRING) {
-      // Share the underlying buffer.
-      TensorBuffer* buf = tensorflow::TensorCApi::Buffer(src);
-      buf->Ref();
-      c_outputs[i] = new TF_Tensor{static_cast<TF_DataType>(src.dtype()),
-                                   src.shape(), buf};
-    } else {
-      c_outputs[i] = tensorflow::TF_Tensor_EncodeStrings(src);
-    }
-  }
+  TF_Run_Outputs(outputs, c_outputs);
 }
 
 extern "C" {
@@ -1804,4 +1813,66 @@ void TF_SessionPRun(TF_SessionWithGraph* session, const char* handle,
                 output_values, target_names, nullptr, status);
 }
 
+void TF_SessionMakeCallable(TF_SessionWithGraph* session, const TF_Port* inputs,
+                            int ninputs, const TF_Port* outputs, int noutputs,
+                            const TF_Operation* const* target_opers,
+                            int ntargets, int64_t* handle, TF_Status* status) {
+  if (!ExtendSessionGraphHelper(session, status)) {
+    return;
+  }
+
+  std::vector<tensorflow::string> input_names(ninputs);
+  for (int i = 0; i < ninputs; ++i) {
+    input_names[i] = PortName(inputs[i]);
+  }
+
+  std::vector<tensorflow::string> output_names(noutputs);
+  for (int i = 0; i < noutputs; ++i) {
+    output_names[i] = PortName(outputs[i]);
+  }
+
+  std::vector<tensorflow::string> target_names(ntargets);
+  for (int i = 0; i < ntargets; ++i) {
+    target_names[i] = target_opers[i]->node.name();
+  }
+
+  Session::CallableHandle new_handle;
+  status->status = session->session->MakeCallable(input_names, output_names,
+                                                  target_names, &new_handle);
+  if (status->status.ok()) {
+    *handle = new_handle;
+  }
+}
+
+void TF_SessionRunCallable(TF_SessionWithGraph* session, int64_t handle,
+                           TF_Tensor* const* input_values, int ninputs,
+                           TF_Tensor** output_values, int noutputs,
+                           TF_Status* status) {
+  TF_Run_Setup(noutputs, output_values, status);
+
+  std::vector<Tensor> inputs(ninputs);
+  bool ok = true;
+  for (int i = 0; i < ninputs; ++i) {
+    // Every input is deleted, even after a failed conversion.
+    if (ok) ok = TF_TensorToTensor(input_values[i], &inputs[i], status);
+    TF_DeleteTensor(input_values[i]);
+  }
+  if (!ok) return;
+
+  std::vector<Tensor> outputs;
+  status->status = session->session->RunCallable(handle, inputs, &outputs);
+  if (!status->status.ok()) return;
+  if (outputs.size() != noutputs) {
+    status->status = InvalidArgument("Expected ", outputs.size(),
+                                     " output tensors, but got ", noutputs);
+    return;
+  }
+  TF_Run_Outputs(outputs, output_values);
+}
+
+void TF_SessionReleaseCallable(TF_SessionWithGraph* session, int64_t handle,
+                               TF_Status* status) {
+  status->status = session->session->ReleaseCallable(handle);
+}
+
 }  // end extern "C"
@@ -885,6 +885,44 @@ extern void TF_SessionPRun(TF_SessionWithGraph*, const char* handle,
                            // Output status
                            TF_Status*);
 
+// Register the intended feeds (inputs), fetches (outputs) and targets of
+// the session's graph, so that they can be run repeatedly by
+// TF_SessionRunCallable() without looking them up by name on every run.
+//
+// On success, *handle identifies the registered signature until it is
+// passed to TF_SessionReleaseCallable().
+// NOTE: This is EXPERIMENTAL and subject to change.
+extern void TF_SessionMakeCallable(TF_SessionWithGraph*,
+                                   // Input names
+                                   const TF_Port* inputs, int ninputs,
+                                   // Output names
+                                   const TF_Port* outputs, int noutputs,
+                                   // Target operations
+                                   const TF_Operation* const* target_opers,
+                                   int ntargets,
+                                   // Output handle
+                                   int64_t* handle,
+                                   // Output status
+                                   TF_Status*);
+
+// Run the signature registered as `handle`, feeding input_values[i] to the
+// i-th input given to TF_SessionMakeCallable(). Ownership of input_values
+// and output_values is as for TF_SessionRun(); on success output_values[i]
+// holds the value of the i-th registered output.
+// NOTE: This is EXPERIMENTAL and subject to change.
+extern void TF_SessionRunCallable(TF_SessionWithGraph*, int64_t handle,
+                                  // Input tensors
+                                  TF_Tensor* const* input_values, int ninputs,
+                                  // Output tensors
+                                  TF_Tensor** output_values, int noutputs,
+                                  // Output status
+                                  TF_Status*);
+
+// Release the signature registered as `handle`.
+// NOTE: This is EXPERIMENTAL and subject to change.
+extern void TF_SessionReleaseCallable(TF_SessionWithGraph*, int64_t handle,
+                                      TF_Status*);
+
 // --------------------------------------------------------------------------
 // The deprecated session API.  Please switch to the above instead of
 // TF_ExtendGraph().  TF_DeprecatedSession manages a single graph and execution.
@@ -847,6 +847,56 @@ TEST(CAPI, SessionWithGraph) {
   TF_DeleteStatus(s);
 }
 
+TEST(CAPI, SessionRunCallable) {
+  TF_Status* s = TF_NewStatus();
+  TF_Graph* graph = TF_NewGraph();
+  TF_Operation* feed = Placeholder(graph, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_Operation* two = ScalarConst(2, graph, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_Operation* add = Add(feed, two, graph, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+
+  TF_SessionOptions* opts = TF_NewSessionOptions();
+  TF_SessionWithGraph* session = TF_NewSessionWithGraph(graph, opts, s);
+  TF_DeleteSessionOptions(opts);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+
+  TF_Port input{feed, 0};
+  TF_Port output{add, 0};
+  int64_t handle;
+  TF_SessionMakeCallable(session, &input, 1, &output, 1, nullptr, 0, &handle,
+                         s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+
+  for (int i = 0; i < 3; ++i) {
+    TF_Tensor* input_value = Int32Tensor(i);
+    TF_Tensor* output_value = nullptr;
+    TF_SessionRunCallable(session, handle, &input_value, 1, &output_value, 1,
+                          s);
+    ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+    ASSERT_TRUE(output_value != nullptr);
+    EXPECT_EQ(TF_INT32, TF_TensorType(output_value));
+    EXPECT_EQ(i + 2, *static_cast<int32*>(TF_TensorData(output_value)));
+    TF_DeleteTensor(output_value);
+  }
+
+  TF_SessionReleaseCallable(session, handle, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_Tensor* input_value = Int32Tensor(1);
+  TF_Tensor* output_value = nullptr;
+  TF_SessionRunCallable(session, handle, &input_value, 1, &output_value, 1, s);
+  EXPECT_EQ(TF_INVALID_ARGUMENT, TF_GetCode(s));
+  EXPECT_TRUE(output_value == nullptr);
+
+  TF_CloseSessionWithGraph(session, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_DeleteSessionWithGraph(session, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_DeleteGraph(graph);
+  TF_DeleteStatus(s);
+}
+
 TEST(CAPI, ColocateWith) {
   TF_Status* s = TF_NewStatus();
   TF_Graph* graph = TF_NewGraph();
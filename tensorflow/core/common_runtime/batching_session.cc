@@ -0,0 +1,408 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/batching_session.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+
+namespace {
+
+typedef std::vector<std::pair<string, Tensor>> NamedTensorList;
+
+// Returns true iff tensors of "dtype" can be concatenated and split by
+// tensor::Concat() and tensor::Split().
+bool CanBatch(DataType dtype) {
+  return DataTypeCanUseMemcpy(dtype) || dtype == DT_STRING;
+}
+
+// Sets "*size" to the number of examples in a request with "inputs"
+// and returns true, or returns false if the request cannot be batched.
+bool GetBatchSize(const NamedTensorList& inputs, int64* size) {
+  if (inputs.empty()) return false;
+  for (const auto& input : inputs) {
+    const Tensor& t = input.second;
+    if (t.dims() == 0 || !CanBatch(t.dtype())) return false;
+    if (t.dim_size(0) != inputs[0].second.dim_size(0)) return false;
+  }
+  *size = inputs[0].second.dim_size(0);
+  return *size > 0;
+}
+
+const Tensor* FindInput(const NamedTensorList& inputs, const string& name) {
+  for (const auto& input : inputs) {
+    if (input.first == name) return &input.second;
+  }
+  return nullptr;
+}
+
+// Returns true iff "a" and "b" have the same type and the same shape
+// except for dimension 0.
+bool SameExampleShape(const Tensor& a, const Tensor& b) {
+  if (a.dtype() != b.dtype() || a.dims() != b.dims()) return false;
+  for (int d = 1; d < a.dims(); ++d) {
+    if (a.dim_size(d) != b.dim_size(d)) return false;
+  }
+  return true;
+}
+
+class BatchingSession : public Session {
+ public:
+  BatchingSession(const BatchingSessionOptions& options,
+                  std::unique_ptr<Session> wrapped)
+      : options_(options), wrapped_(std::move(wrapped)) {}
+
+  Status Create(const GraphDef& graph) override {
+    return wrapped_->Create(graph);
+  }
+  Status Extend(const GraphDef& graph) override {
+    return wrapped_->Extend(graph);
+  }
+  Status Close() override { return wrapped_->Close(); }
+
+  Status Run(const NamedTensorList& inputs,
+             const std::vector<string>& output_names,
+             const std::vector<string>& target_nodes,
+             std::vector<Tensor>* outputs) override {
+    return Run(RunOptions(), inputs, output_names, target_nodes, outputs,
+               nullptr);
+  }
+
+  Status Run(const RunOptions& run_options, const NamedTensorList& inputs,
+             const std::vector<string>& output_names,
+             const std::vector<string>& target_nodes,
+             std::vector<Tensor>* outputs, RunMetadata* run_metadata) override;
+
+  Status PRunSetup(const std::vector<string>& input_names,
+                   const std::vector<string>& output_names,
+                   const std::vector<string>& target_nodes,
+                   string* handle) override {
+    return wrapped_->PRunSetup(input_names, output_names, target_nodes,
+                               handle);
+  }
+
+  Status PRun(const string& handle, const NamedTensorList& inputs,
+              const std::vector<string>& output_names,
+              std::vector<Tensor>* outputs) override {
+    return wrapped_->PRun(handle, inputs, output_names, outputs);
+  }
+
+ private:
+  // One Run() call waiting for its batch.
+  struct Task {
+    const NamedTensorList* inputs;
+    int64 size;
+    std::vector<Tensor>* outputs;
+    Status status;
+    Notification done;
+  };
+
+  // The requests run together. The first task's caller (the "leader")
+  // owns the batch: it waits for the batch to fill up, runs it, and
+  // notifies the other tasks.
+  struct Batch {
+    std::vector<Task*> tasks;
+    int64 size = 0;
+    bool closed = false;
+    condition_variable cv;  // Notified when the batch becomes closed.
+  };
+
+  int64 max_batch_size() const { return options_.allowed_batch_sizes.back(); }
+
+  // Returns the smallest allowed batch size >= "size".
+  int64 PaddedBatchSize(int64 size) const {
+    return *std::lower_bound(options_.allowed_batch_sizes.begin(),
+                             options_.allowed_batch_sizes.end(), size);
+  }
+
+  // Runs the tasks of "batch", whose signature is "key", and sets their
+  // status and outputs.
+  void ProcessBatch(const string& key, const RunOptions& run_options,
+                    const std::vector<string>& output_names,
+                    const std::vector<string>& target_nodes,
+                    const Batch& batch);
+
+  // Runs each task of "batch" on its own.
+  void RunOneByOne(const RunOptions& run_options,
+                   const std::vector<string>& output_names,
+                   const std::vector<string>& target_nodes,
+                   const Batch& batch);
+
+  // Concatenates the feeds of the tasks of "batch", padded to
+  // "padded_size" examples. Returns an error if the feeds of the
+  // tasks do not have matching types and shapes.
+  Status MergeInputs(const Batch& batch, int64 padded_size,
+                     NamedTensorList* merged);
+
+  // Splits the fetched "outputs" of a batch between its tasks. Returns
+  // false, and leaves the tasks alone, if some output does not have one
+  // row per example.
+  bool SplitOutputs(const std::vector<string>& output_names,
+                    const Batch& batch, int64 padded_size,
+                    const std::vector<Tensor>& outputs);
+
+  const BatchingSessionOptions options_;
+  const std::unique_ptr<Session> wrapped_;
+
+  mutex mu_;
+  // The batch accepting new tasks for each signature, if any.
+  std::unordered_map<string, Batch*> open_batches_ GUARDED_BY(mu_);
+  // The signatures with a fetch that cannot be split between examples,
+  // whose requests are passed through.
+  std::unordered_set<string> unbatchable_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(BatchingSession);
+};
+
+Status BatchingSession::Run(const RunOptions& run_options,
+                            const NamedTensorList& inputs,
+                            const std::vector<string>& output_names,
+                            const std::vector<string>& target_nodes,
+                            std::vector<Tensor>* outputs,
+                            RunMetadata* run_metadata) {
+  // Targets are run for their side effects, which would be repeated for
+  // the padding of a batch.
+  Task task;
+  if (run_options.trace_level() != RunOptions::NO_TRACE ||
+      !target_nodes.empty() || !GetBatchSize(inputs, &task.size) ||
+      task.size > max_batch_size()) {
+    return wrapped_->Run(run_options, inputs, output_names, target_nodes,
+                         outputs, run_metadata);
+  }
+  task.inputs = &inputs;
+  task.outputs = outputs;
+
+  std::vector<string> input_names;
+  input_names.reserve(inputs.size());
+  for (const auto& input : inputs) input_names.push_back(input.first);
+  std::sort(input_names.begin(), input_names.end());
+  const string key = strings::StrCat(str_util::Join(input_names, ","), "->",
+                                     str_util::Join(output_names, ","));
+
+  bool batchable;
+  {
+    mutex_lock l(mu_);
+    batchable = unbatchable_.count(key) == 0;
+  }
+  if (!batchable) {
+    return wrapped_->Run(run_options, inputs, output_names, target_nodes,
+                         outputs, run_metadata);
+  }
+
+  Batch* batch;
+  bool leader = false;
+  {
+    mutex_lock l(mu_);
+    Batch*& open = open_batches_[key];
+    if (open != nullptr && open->size + task.size > max_batch_size()) {
+      // This task does not fit: run the open batch as it is.
+      open->closed = true;
+      open->cv.notify_one();
+      open = nullptr;
+    }
+    if (open == nullptr) {
+      open = new Batch;
+      leader = true;
+    }
+    batch = open;
+    batch->tasks.push_back(&task);
+    batch->size += task.size;
+    if (batch->size == max_batch_size()) {
+      batch->closed = true;
+      batch->cv.notify_one();
+      open = nullptr;
+    }
+
+    if (leader) {
+      const uint64 deadline =
+          Env::Default()->NowMicros() + options_.batch_timeout_micros;
+      while (!batch->closed) {
+        const uint64 now = Env::Default()->NowMicros();
+        if (now >= deadline) break;
+        batch->cv.wait_for(l, std::chrono::microseconds(deadline - now));
+      }
+      if (!batch->closed) {
+        batch->closed = true;
+        open_batches_.erase(key);
+      }
+    }
+  }
+
+  if (!leader) {
+    task.done.WaitForNotification();
+    return task.status;
+  }
+  ProcessBatch(key, run_options, output_names, target_nodes, *batch);
+  for (Task* t : batch->tasks) {
+    if (t != &task) t->done.Notify();
+  }
+  delete batch;
+  return task.status;
+}
+
+void BatchingSession::ProcessBatch(const string& key,
+                                   const RunOptions& run_options,
+                                   const std::vector<string>& output_names,
+                                   const std::vector<string>& target_nodes,
+                                   const Batch& batch) {
+  const int64 padded_size = PaddedBatchSize(batch.size);
+  if (batch.tasks.size() == 1 && padded_size == batch.size) {
+    Task* task = batch.tasks[0];
+    task->status = wrapped_->Run(run_options, *task->inputs, output_names,
+                                 target_nodes, task->outputs, nullptr);
+    return;
+  }
+
+  NamedTensorList merged;
+  Status s = MergeInputs(batch, padded_size, &merged);
+  if (!s.ok()) {
+    // Requests that disagree on the shape of an example cannot be run
+    // together.
+    VLOG(1) << "Running batch of " << batch.tasks.size()
+            << " requests one by one: " << s;
+    RunOneByOne(run_options, output_names, target_nodes, batch);
+    return;
+  }
+
+  std::vector<Tensor> outputs;
+  s = wrapped_->Run(run_options, merged, output_names, target_nodes, &outputs,
+                    nullptr);
+  if (!s.ok()) {
+    for (Task* task : batch.tasks) {
+      task->status = s;
+      task->outputs->clear();
+    }
+    return;
+  }
+  if (!SplitOutputs(output_names, batch, padded_size, outputs)) {
+    // Some fetch, such as a scalar loss, is not computed per example.
+    // Later requests with the same signature are not batched either.
+    {
+      mutex_lock l(mu_);
+      unbatchable_.insert(key);
+    }
+    RunOneByOne(run_options, output_names, target_nodes, batch);
+  }
+}
+
+void BatchingSession::RunOneByOne(const RunOptions& run_options,
+                                  const std::vector<string>& output_names,
+                                  const std::vector<string>& target_nodes,
+                                  const Batch& batch) {
+  for (Task* task : batch.tasks) {
+    task->status = wrapped_->Run(run_options, *task->inputs, output_names,
+                                 target_nodes, task->outputs, nullptr);
+  }
+}
+
+Status BatchingSession::MergeInputs(const Batch& batch, int64 padded_size,
+                                    NamedTensorList* merged) {
+  const NamedTensorList& first = *batch.tasks[0]->inputs;
+  const int64 padding = padded_size - batch.size;
+  merged->reserve(first.size());
+  for (const auto& input : first) {
+    std::vector<Tensor> parts;
+    parts.reserve(batch.tasks.size() + padding);
+    for (const Task* task : batch.tasks) {
+      const Tensor* t = FindInput(*task->inputs, input.first);
+      if (t == nullptr || !SameExampleShape(*t, input.second)) {
+        return errors::InvalidArgument("Mismatched examples for feed ",
+                                       input.first);
+      }
+      parts.push_back(*t);
+    }
+    // Pad with copies of the first example.
+    for (int64 i = 0; i < padding; ++i) {
+      parts.push_back(input.second.Slice(0, 1));
+    }
+    merged->emplace_back(input.first, tensor::Concat(parts));
+  }
+  return Status::OK();
+}
+
+bool BatchingSession::SplitOutputs(const std::vector<string>& output_names,
+                                   const Batch& batch, int64 padded_size,
+                                   const std::vector<Tensor>& outputs) {
+  for (int i = 0; i < outputs.size(); ++i) {
+    const Tensor& output = outputs[i];
+    if (output.dims() == 0 || output.dim_size(0) != padded_size ||
+        !CanBatch(output.dtype())) {
+      VLOG(1) << "Fetch " << output_names[i] << " of shape "
+              << output.shape().DebugString()
+              << " cannot be split between the examples of a batch of size "
+              << padded_size;
+      return false;
+    }
+  }
+
+  std::vector<int64> sizes;
+  sizes.reserve(batch.tasks.size() + 1);
+  for (const Task* task : batch.tasks) sizes.push_back(task->size);
+  if (padded_size > batch.size) sizes.push_back(padded_size - batch.size);
+
+  for (Task* task : batch.tasks) {
+    task->outputs->clear();
+    task->outputs->reserve(outputs.size());
+  }
+  for (const Tensor& output : outputs) {
+    std::vector<Tensor> pieces = tensor::Split(output, sizes);
+    for (int t = 0; t < batch.tasks.size(); ++t) {
+      batch.tasks[t]->outputs->push_back(std::move(pieces[t]));
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+Status NewBatchingSession(const BatchingSessionOptions& options,
+                          std::unique_ptr<Session> wrapped,
+                          std::unique_ptr<Session>* result) {
+  const std::vector<int>& sizes = options.allowed_batch_sizes;
+  if (sizes.empty()) {
+    return errors::InvalidArgument("allowed_batch_sizes must not be empty");
+  }
+  for (int i = 0; i < sizes.size(); ++i) {
+    if (sizes[i] <= 0 || (i > 0 && sizes[i] <= sizes[i - 1])) {
+      return errors::InvalidArgument(
+          "allowed_batch_sizes must be positive and increasing, got ",
+          str_util::Join(sizes, ","));
+    }
+  }
+  if (options.batch_timeout_micros < 0) {
+    return errors::InvalidArgument("batch_timeout_micros must be >= 0");
+  }
+  result->reset(new BatchingSession(options, std::move(wrapped)));
+  return Status::OK();
+}
+
+}  // namespace tensorflow
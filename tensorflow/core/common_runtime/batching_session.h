@@ -0,0 +1,67 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMMON_RUNTIME_BATCHING_SESSION_H_
+#define TENSORFLOW_COMMON_RUNTIME_BATCHING_SESSION_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+
+struct BatchingSessionOptions {
+  // The sizes a batch may have, in increasing order. A batch of n
+  // examples is padded up to the smallest allowed size >= n, so that
+  // the wrapped session only ever sees these few shapes. The last
+  // entry is the maximum batch size.
+  std::vector<int> allowed_batch_sizes = {1, 2, 4, 8, 16, 32};
+
+  // How long the first request of a batch waits for more requests
+  // before the batch is run even though it is not full.
+  int64 batch_timeout_micros = 1000;
+};
+
+// Creates a session that runs "wrapped" on batches of concurrent
+// requests.
+//
+// Concurrent Run() calls with the same feed and fetch names are queued
+// together. Their feeds are concatenated along
+// dimension 0, the wrapped session is run once on the batch, and the
+// fetched tensors are split back along dimension 0. Every feed of a
+// request must therefore have the request's number of examples as its
+// 0th dimension, and every fetch must have one row per example. The
+// batch is run as soon as it reaches the maximum batch size, or when
+// its first request has waited batch_timeout_micros. The RunOptions of
+// the first request of a batch apply to the whole batch.
+//
+// Requests that cannot be batched -- without feeds, with feeds that
+// disagree on dimension 0, larger than the maximum batch size, with
+// target nodes, whose side effects would be repeated for the padding of
+// a batch, or with tracing enabled -- and partial runs are passed to
+// "wrapped" as is. So are the requests whose fetches turn out not to
+// have one row per example, such as a scalar loss: the first batch
+// with such a fetch is rerun request by request, and later requests
+// with the same feeds and fetches are not batched.
+Status NewBatchingSession(const BatchingSessionOptions& options,
+                          std::unique_ptr<Session> wrapped,
+                          std::unique_ptr<Session>* result);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMMON_RUNTIME_BATCHING_SESSION_H_
@@ -0,0 +1,223 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/batching_session.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace {
+
+// Fetches "y" = 2 * "x" and "z" = a scalar, and records the number of
+// rows it was run on.
+class FakeSession : public Session {
+ public:
+  Status Create(const GraphDef& graph) override { return Status::OK(); }
+  Status Extend(const GraphDef& graph) override { return Status::OK(); }
+  Status Close() override { return Status::OK(); }
+
+  Status Run(const std::vector<std::pair<string, Tensor>>& inputs,
+             const std::vector<string>& output_names,
+             const std::vector<string>& target_nodes,
+             std::vector<Tensor>* outputs) override {
+    return Run(RunOptions(), inputs, output_names, target_nodes, outputs,
+               nullptr);
+  }
+
+  Status Run(const RunOptions& run_options,
+             const std::vector<std::pair<string, Tensor>>& inputs,
+             const std::vector<string>& output_names,
+             const std::vector<string>& target_nodes,
+             std::vector<Tensor>* outputs, RunMetadata* run_metadata) override {
+    const Tensor* x = nullptr;
+    for (const auto& input : inputs) {
+      if (input.first == "x") x = &input.second;
+    }
+    if (x == nullptr) return errors::InvalidArgument("x must be fed");
+    {
+      mutex_lock l(mu_);
+      batch_sizes_.push_back(x->dim_size(0));
+    }
+    outputs->clear();
+    for (const string& name : output_names) {
+      if (name == "y") {
+        Tensor y(DT_FLOAT, x->shape());
+        for (int i = 0; i < x->NumElements(); ++i) {
+          y.flat<float>()(i) = 2 * x->flat<float>()(i);
+        }
+        outputs->push_back(y);
+      } else if (name == "z") {
+        outputs->push_back(test::AsScalar<float>(1));
+      } else {
+        return errors::NotFound(name);
+      }
+    }
+    return Status::OK();
+  }
+
+  std::vector<int64> batch_sizes() {
+    mutex_lock l(mu_);
+    return batch_sizes_;
+  }
+
+ private:
+  mutex mu_;
+  std::vector<int64> batch_sizes_ GUARDED_BY(mu_);
+};
+
+class BatchingSessionTest : public ::testing::Test {
+ protected:
+  void Init(const BatchingSessionOptions& options) {
+    fake_ = new FakeSession;
+    TF_ASSERT_OK(NewBatchingSession(
+        options, std::unique_ptr<Session>(fake_), &session_));
+  }
+
+  // Runs the requests, feeding "x" with rows [rows[i], rows[i+1]) of a
+  // ramp, concurrently, and checks that each gets twice its feed back.
+  void RunConcurrently(const std::vector<int>& rows) {
+    thread::ThreadPool pool(Env::Default(), "test", rows.size());
+    for (int i = 0; i + 1 < rows.size(); ++i) {
+      pool.Schedule([this, &rows, i]() {
+        const int n = rows[i + 1] - rows[i];
+        Tensor x(DT_FLOAT, TensorShape({n, 2}));
+        Tensor expected(DT_FLOAT, TensorShape({n, 2}));
+        for (int j = 0; j < 2 * n; ++j) {
+          x.flat<float>()(j) = 2 * rows[i] + j;
+          expected.flat<float>()(j) = 2 * x.flat<float>()(j);
+        }
+        std::vector<Tensor> outputs;
+        TF_ASSERT_OK(session_->Run({{"x", x}}, {"y"}, {}, &outputs));
+        ASSERT_EQ(1, outputs.size());
+        test::ExpectTensorEqual<float>(expected, outputs[0]);
+      });
+    }
+  }
+
+  FakeSession* fake_ = nullptr;  // Owned by session_.
+  std::unique_ptr<Session> session_;
+};
+
+TEST_F(BatchingSessionTest, InvalidOptions) {
+  std::unique_ptr<Session> session;
+  BatchingSessionOptions options;
+  options.allowed_batch_sizes = {};
+  EXPECT_FALSE(
+      NewBatchingSession(options, std::unique_ptr<Session>(new FakeSession),
+                         &session)
+          .ok());
+  options.allowed_batch_sizes = {4, 2};
+  EXPECT_FALSE(
+      NewBatchingSession(options, std::unique_ptr<Session>(new FakeSession),
+                         &session)
+          .ok());
+}
+
+TEST_F(BatchingSessionTest, SingleRequest) {
+  BatchingSessionOptions options;
+  options.batch_timeout_micros = 0;
+  Init(options);
+  RunConcurrently({0, 1});
+  EXPECT_EQ(std::vector<int64>({1}), fake_->batch_sizes());
+}
+
+TEST_F(BatchingSessionTest, FullBatchRunsOnce) {
+  BatchingSessionOptions options;
+  options.allowed_batch_sizes = {1, 2, 4, 8};
+  // The batch must be run because it is full, not because of a timeout.
+  options.batch_timeout_micros = 100 * 1000 * 1000;
+  Init(options);
+  // Four requests with 1, 2, 3 and 2 examples.
+  RunConcurrently({0, 1, 3, 6, 8});
+  EXPECT_EQ(std::vector<int64>({8}), fake_->batch_sizes());
+}
+
+TEST_F(BatchingSessionTest, TimeoutRunsPaddedBatch) {
+  BatchingSessionOptions options;
+  options.allowed_batch_sizes = {4, 16};
+  options.batch_timeout_micros = 100 * 1000;
+  Init(options);
+  RunConcurrently({0, 1, 2, 3});
+  // Three examples are padded up to four, in one or more batches.
+  for (int64 size : fake_->batch_sizes()) {
+    EXPECT_EQ(4, size);
+  }
+}
+
+TEST_F(BatchingSessionTest, LargeRequestPassesThrough) {
+  BatchingSessionOptions options;
+  options.allowed_batch_sizes = {1, 2};
+  Init(options);
+  RunConcurrently({0, 5});
+  EXPECT_EQ(std::vector<int64>({5}), fake_->batch_sizes());
+}
+
+TEST_F(BatchingSessionTest, FetchWithoutBatchDimension) {
+  BatchingSessionOptions options;
+  options.allowed_batch_sizes = {2};
+  options.batch_timeout_micros = 0;
+  Init(options);
+  for (int i = 0; i < 2; ++i) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session_->Run(
+        {{"x", test::AsTensor<float>({1, 2}, TensorShape({1, 2}))}},
+        {"y", "z"}, {}, &outputs));
+    ASSERT_EQ(2, outputs.size());
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>({2, 4}, TensorShape({1, 2})), outputs[0]);
+    test::ExpectTensorEqual<float>(test::AsScalar<float>(1), outputs[1]);
+  }
+  // The padded batch is rerun without padding, and the second request is
+  // not batched.
+  EXPECT_EQ(std::vector<int64>({2, 1, 1}), fake_->batch_sizes());
+}
+
+TEST_F(BatchingSessionTest, RequestWithTargetsPassesThrough) {
+  BatchingSessionOptions options;
+  options.allowed_batch_sizes = {2};
+  options.batch_timeout_micros = 100 * 1000 * 1000;
+  Init(options);
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session_->Run({{"x", Tensor(DT_FLOAT, TensorShape({1, 2}))}},
+                             {"y"}, {"train"}, &outputs));
+  EXPECT_EQ(std::vector<int64>({1}), fake_->batch_sizes());
+}
+
+TEST_F(BatchingSessionTest, TracedRequestPassesThrough) {
+  BatchingSessionOptions options;
+  options.allowed_batch_sizes = {2};
+  options.batch_timeout_micros = 100 * 1000 * 1000;
+  Init(options);
+  RunOptions run_options;
+  run_options.set_trace_level(RunOptions::FULL_TRACE);
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session_->Run(run_options,
+                             {{"x", Tensor(DT_FLOAT, TensorShape({1, 2}))}},
+                             {"y"}, {}, &outputs, nullptr));
+  EXPECT_EQ(std::vector<int64>({1}), fake_->batch_sizes());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,520 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/cpu_pool_allocator.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "tensorflow/core/lib/core/bits.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/numa.h"
+
+namespace tensorflow {
+
+constexpr size_t CPUPoolAllocator::kChunkAlignment;
+constexpr size_t CPUPoolAllocator::kMaxThreadCachedSize;
+
+namespace {
+
+// Size class i > 0 covers the requests in (s(i - 1), s(i)], where the
+// sizes s(i) are 64, 80, 96, 112, 128, 160, ...: four classes per power
+// of two, up to 2^kMaxClassLog2. Class 0 covers the requests of at most
+// 64 bytes. Larger requests, and requests for more than kChunkAlignment
+// alignment, are not pooled and have class kDirectClass.
+const int kMinClassLog2 = 6;
+const int kMaxClassLog2 = 40;
+const int kNumClasses = 1 + 4 * (kMaxClassLog2 - kMinClassLog2);
+const int kDirectClass = -1;
+
+int SizeClass(size_t num_bytes) {
+  if (num_bytes <= (1 << kMinClassLog2)) return 0;
+  const int lg = Log2Floor64(num_bytes - 1);
+  if (lg >= kMaxClassLog2) return kDirectClass;
+  const int quarter = (num_bytes - 1) >> (lg - 2);  // In [4, 8).
+  return 4 * (lg - kMinClassLog2) + quarter - 3;
+}
+
+size_t ClassSize(int size_class) {
+  if (size_class == 0) return 1 << kMinClassLog2;
+  const int lg = (size_class - 1) / 4 + kMinClassLog2;
+  const int quarter = (size_class - 1) % 4 + 4;
+  return static_cast<size_t>(quarter + 1) << (lg - 2);
+}
+
+const int kNumThreadCachedClasses =
+    SizeClass(CPUPoolAllocator::kMaxThreadCachedSize) + 1;
+
+// With a NUMA node, the chunks whose blocks take at most
+// kMaxSlabBlockBytes are carved from slabs of kSlabBytes, which are bound
+// to the node as a whole. Larger chunks are mapped on their own.
+const size_t kSlabBytes = 4 << 20;
+const size_t kMaxSlabBlockBytes = kSlabBytes / 16;
+
+// Returns the bytes a chunk of "size_class" and its header take in a
+// slab, which keeps the next chunk aligned.
+size_t SlabBlockBytes(int size_class) {
+  const size_t a = CPUPoolAllocator::kChunkAlignment;
+  return (a + ClassSize(size_class) + a - 1) / a * a;
+}
+
+int NumSlabClasses(int numa_node) {
+  if (numa_node == port::kNUMANoAffinity) return 0;
+  int num_classes = 0;
+  while (num_classes < kNumClasses &&
+         SlabBlockBytes(num_classes) <= kMaxSlabBlockBytes) {
+    ++num_classes;
+  }
+  return num_classes;
+}
+
+// A thread caches up to kThreadCacheClassBytes, and at least 2 and at
+// most kMaxThreadCacheChunks chunks, of each class, and flushes all its
+// chunks once they exceed kMaxThreadCacheBytes in total.
+const size_t kThreadCacheClassBytes = 1 << 20;
+const size_t kMaxThreadCacheChunks = 32;
+const size_t kMaxThreadCacheBytes = 8 << 20;
+
+size_t ThreadCacheCapacity(int size_class) {
+  return std::min(kMaxThreadCacheChunks,
+                  std::max<size_t>(2, kThreadCacheClassBytes /
+                                          ClassSize(size_class)));
+}
+
+// Every chunk is preceded by a header of kChunkAlignment bytes, so that
+// the user pointer stays aligned. For direct chunks the header is at the
+// end of the first "alignment" bytes of the block.
+struct ChunkHeader {
+  // Start of the block obtained from the system, or nullptr if the chunk
+  // was carved from a slab.
+  void* base;
+  size_t block_bytes;  // Size of that block.
+  size_t requested;    // Size of the last request served by the chunk.
+  size_t allocated;    // Usable size of the chunk.
+  int size_class;
+};
+static_assert(sizeof(ChunkHeader) <= CPUPoolAllocator::kChunkAlignment,
+              "ChunkHeader does not fit in kChunkAlignment bytes");
+
+ChunkHeader* Header(void* ptr) {
+  return reinterpret_cast<ChunkHeader*>(static_cast<char*>(ptr) -
+                                        CPUPoolAllocator::kChunkAlignment);
+}
+
+void UpdateMax(std::atomic<int64>* max, int64 value) {
+  int64 current = max->load(std::memory_order_relaxed);
+  while (value > current &&
+         !max->compare_exchange_weak(current, value,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+std::atomic<int64> next_allocator_id(0);
+
+}  // namespace
+
+struct CPUPoolAllocator::ThreadCache {
+  explicit ThreadCache(CPUPoolAllocator* a)
+      : free_lists(kNumThreadCachedClasses), owner(a) {}
+
+  // Only used by the owning thread, or by the destructor of "owner".
+  std::vector<std::vector<void*>> free_lists;
+  size_t cached_bytes = 0;
+
+  // Orders the exit of the owning thread with the destruction of
+  // "owner", which is reset to nullptr by the latter.
+  mutex mu;
+  CPUPoolAllocator* owner GUARDED_BY(mu);
+};
+
+// The caches of a thread, one per CPUPoolAllocator it has used. On thread
+// exit their chunks go back to the shared free lists of their allocators.
+struct CPUPoolAllocator::ThreadCacheList {
+  ~ThreadCacheList() {
+    for (const auto& entry : caches) {
+      ThreadCache* cache = entry.second.get();
+      mutex_lock l(cache->mu);
+      if (cache->owner != nullptr) cache->owner->RetireThreadCache(cache);
+    }
+  }
+
+  std::vector<std::pair<int64, std::shared_ptr<ThreadCache>>> caches;
+};
+
+CPUPoolAllocator::CPUPoolAllocator(const string& name, int numa_node,
+                                   size_t max_cached_bytes)
+    : name_(name),
+      numa_node_(numa_node),
+      num_slab_classes_(NumSlabClasses(numa_node)),
+      max_cached_bytes_(max_cached_bytes),
+      id_(next_allocator_id.fetch_add(1)),
+      free_lists_(kNumClasses),
+      num_allocs_(0),
+      num_pool_hits_(0),
+      bytes_in_use_(0),
+      max_bytes_in_use_(0),
+      max_alloc_size_(0),
+      bytes_reserved_(0),
+      allocation_begun_(false) {}
+
+CPUPoolAllocator::~CPUPoolAllocator() {
+  std::vector<std::shared_ptr<ThreadCache>> caches;
+  {
+    mutex_lock l(mu_);
+    caches.swap(thread_caches_);
+  }
+  std::vector<void*> to_free;
+  for (const auto& cache : caches) {
+    mutex_lock l(cache->mu);
+    for (auto& list : cache->free_lists) {
+      to_free.insert(to_free.end(), list.begin(), list.end());
+      list.clear();
+    }
+    cache->cached_bytes = 0;
+    cache->owner = nullptr;
+  }
+  {
+    mutex_lock l(mu_);
+    for (auto& list : free_lists_) {
+      to_free.insert(to_free.end(), list.begin(), list.end());
+      list.clear();
+    }
+    cached_bytes_ = 0;
+  }
+  ReleaseChunks(to_free);
+  if (bytes_in_use_ != 0) {
+    // The slabs are leaked, since they may hold chunks in use.
+    LOG(WARNING) << name_ << " destroyed with " << bytes_in_use_
+                 << " bytes in use";
+    return;
+  }
+  mutex_lock l(mu_);
+  for (void* slab : slabs_) ReleaseBlock(slab, kSlabBytes);
+  slabs_.clear();
+}
+
+size_t CPUPoolAllocator::RoundedSize(size_t num_bytes) {
+  const int size_class = SizeClass(num_bytes);
+  return size_class == kDirectClass ? num_bytes : ClassSize(size_class);
+}
+
+CPUPoolAllocator::ThreadCache* CPUPoolAllocator::GetThreadCache() {
+  static thread_local ThreadCacheList thread_cache_list;
+  auto* caches = &thread_cache_list.caches;
+  for (const auto& entry : *caches) {
+    if (entry.first == id_) return entry.second.get();
+  }
+  // Forget the caches of allocators that have been destroyed.
+  caches->erase(
+      std::remove_if(caches->begin(), caches->end(),
+                     [](const std::pair<int64, std::shared_ptr<ThreadCache>>&
+                            entry) {
+                       mutex_lock l(entry.second->mu);
+                       return entry.second->owner == nullptr;
+                     }),
+      caches->end());
+  std::shared_ptr<ThreadCache> cache(new ThreadCache(this));
+  {
+    mutex_lock l(mu_);
+    thread_caches_.push_back(cache);
+  }
+  caches->emplace_back(id_, cache);
+  return cache.get();
+}
+
+void* CPUPoolAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  if (!allocation_begun_) allocation_begun_ = true;
+  const int size_class =
+      alignment > kChunkAlignment ? kDirectClass : SizeClass(num_bytes);
+  void* ptr = nullptr;
+  if (size_class != kDirectClass && size_class < kNumThreadCachedClasses) {
+    ThreadCache* cache = GetThreadCache();
+    std::vector<void*>& list = cache->free_lists[size_class];
+    if (list.empty()) {
+      // Refill the cache with up to half its capacity.
+      mutex_lock l(mu_);
+      std::vector<void*>& shared = free_lists_[size_class];
+      const size_t n = std::min(
+          shared.size(), std::max<size_t>(1, ThreadCacheCapacity(size_class) / 2));
+      list.insert(list.end(), shared.end() - n, shared.end());
+      shared.resize(shared.size() - n);
+      cached_bytes_ -= n * ClassSize(size_class);
+      cache->cached_bytes += n * ClassSize(size_class);
+    }
+    if (!list.empty()) {
+      ptr = list.back();
+      list.pop_back();
+      cache->cached_bytes -= ClassSize(size_class);
+    }
+  } else if (size_class != kDirectClass) {
+    mutex_lock l(mu_);
+    std::vector<void*>& shared = free_lists_[size_class];
+    if (!shared.empty()) {
+      ptr = shared.back();
+      shared.pop_back();
+      cached_bytes_ -= ClassSize(size_class);
+    }
+  }
+  if (ptr != nullptr) {
+    num_pool_hits_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    ptr = NewChunk(size_class, alignment, num_bytes);
+    if (ptr == nullptr) return nullptr;
+  }
+  ChunkHeader* header = Header(ptr);
+  header->requested = num_bytes;
+  num_allocs_.fetch_add(1, std::memory_order_relaxed);
+  const int64 in_use =
+      bytes_in_use_.fetch_add(header->allocated, std::memory_order_relaxed) +
+      header->allocated;
+  UpdateMax(&max_bytes_in_use_, in_use);
+  UpdateMax(&max_alloc_size_, header->allocated);
+  return ptr;
+}
+
+void CPUPoolAllocator::DeallocateRaw(void* ptr) {
+  if (ptr == nullptr) return;
+  ChunkHeader* header = Header(ptr);
+  const int size_class = header->size_class;
+  bytes_in_use_.fetch_sub(header->allocated, std::memory_order_relaxed);
+  if (size_class == kDirectClass) {
+    ReleaseBlock(header->base, header->block_bytes);
+    return;
+  }
+  if (size_class < kNumThreadCachedClasses) {
+    ThreadCache* cache = GetThreadCache();
+    std::vector<void*>& list = cache->free_lists[size_class];
+    list.push_back(ptr);
+    cache->cached_bytes += header->allocated;
+    if (list.size() > ThreadCacheCapacity(size_class)) {
+      FlushThreadCache(cache, size_class);
+    } else if (cache->cached_bytes > kMaxThreadCacheBytes) {
+      FlushThreadCache(cache, -1);
+    }
+    return;
+  }
+  std::vector<void*> to_free;
+  {
+    mutex_lock l(mu_);
+    free_lists_[size_class].push_back(ptr);
+    cached_bytes_ += header->allocated;
+    TrimLocked(&to_free);
+  }
+  ReleaseChunks(to_free);
+}
+
+void* CPUPoolAllocator::NewChunk(int size_class, size_t alignment,
+                                 size_t num_bytes) {
+  if (size_class != kDirectClass && size_class < num_slab_classes_) {
+    return NewSlabChunk(size_class);
+  }
+  const size_t offset = std::max(alignment, kChunkAlignment);
+  const size_t allocated =
+      size_class == kDirectClass ? num_bytes : ClassSize(size_class);
+  const size_t block_bytes = offset + allocated;
+  void* base = numa_node_ == port::kNUMANoAffinity
+                   ? port::aligned_malloc(block_bytes, offset)
+                   : port::NUMAMalloc(numa_node_, block_bytes, offset);
+  if (base == nullptr) return nullptr;
+  for (const auto& v : alloc_visitors_) {
+    v(base, block_bytes);
+  }
+  bytes_reserved_.fetch_add(block_bytes, std::memory_order_relaxed);
+  void* ptr = static_cast<char*>(base) + offset;
+  ChunkHeader* header = Header(ptr);
+  header->base = base;
+  header->block_bytes = block_bytes;
+  header->allocated = allocated;
+  header->size_class = size_class;
+  return ptr;
+}
+
+void* CPUPoolAllocator::NewSlabChunk(int size_class) {
+  const size_t block_bytes = SlabBlockBytes(size_class);
+  char* block;
+  {
+    mutex_lock l(mu_);
+    if (slab_left_ < block_bytes) {
+      // The rest of the current slab, if any, stays unused.
+      void* slab = port::NUMAMalloc(numa_node_, kSlabBytes, kChunkAlignment);
+      if (slab == nullptr) return nullptr;
+      for (const auto& v : alloc_visitors_) {
+        v(slab, kSlabBytes);
+      }
+      bytes_reserved_.fetch_add(kSlabBytes, std::memory_order_relaxed);
+      slabs_.push_back(slab);
+      slab_next_ = static_cast<char*>(slab);
+      slab_left_ = kSlabBytes;
+    }
+    block = slab_next_;
+    slab_next_ += block_bytes;
+    slab_left_ -= block_bytes;
+  }
+  void* ptr = block + kChunkAlignment;
+  ChunkHeader* header = Header(ptr);
+  header->base = nullptr;
+  header->block_bytes = block_bytes;
+  header->allocated = ClassSize(size_class);
+  header->size_class = size_class;
+  return ptr;
+}
+
+void CPUPoolAllocator::ReleaseBlock(void* base, size_t block_bytes) {
+  for (const auto& v : free_visitors_) {
+    v(base, block_bytes);
+  }
+  bytes_reserved_.fetch_sub(block_bytes, std::memory_order_relaxed);
+  if (numa_node_ == port::kNUMANoAffinity) {
+    port::aligned_free(base);
+  } else {
+    port::NUMAFree(base, block_bytes);
+  }
+}
+
+void CPUPoolAllocator::ReleaseChunks(const std::vector<void*>& to_free) {
+  for (void* ptr : to_free) {
+    ChunkHeader* header = Header(ptr);
+    // Chunks carved from a slab go back to the system with their slab.
+    if (header->base != nullptr) {
+      ReleaseBlock(header->base, header->block_bytes);
+    }
+  }
+}
+
+void CPUPoolAllocator::FlushThreadCache(ThreadCache* cache, int size_class) {
+  const int begin = size_class < 0 ? 0 : size_class;
+  const int end = size_class < 0 ? kNumThreadCachedClasses : size_class + 1;
+  std::vector<void*> to_free;
+  {
+    mutex_lock l(mu_);
+    for (int c = begin; c < end; ++c) {
+      std::vector<void*>& list = cache->free_lists[c];
+      const size_t keep = size_class < 0 ? 0 : ThreadCacheCapacity(c) / 2;
+      if (list.size() <= keep) continue;
+      // Keep the most recently freed chunks, which are likely still in
+      // the CPU caches.
+      const size_t n = list.size() - keep;
+      std::vector<void*>& shared = free_lists_[c];
+      shared.insert(shared.end(), list.begin(), list.begin() + n);
+      list.erase(list.begin(), list.begin() + n);
+      cache->cached_bytes -= n * ClassSize(c);
+      cached_bytes_ += n * ClassSize(c);
+    }
+    TrimLocked(&to_free);
+  }
+  ReleaseChunks(to_free);
+}
+
+void CPUPoolAllocator::RetireThreadCache(ThreadCache* cache) {
+  FlushThreadCache(cache, -1);
+  mutex_lock l(mu_);
+  for (auto it = thread_caches_.begin(); it != thread_caches_.end(); ++it) {
+    if (it->get() == cache) {
+      thread_caches_.erase(it);
+      break;
+    }
+  }
+}
+
+void CPUPoolAllocator::TrimLocked(std::vector<void*>* to_free) {
+  // Releasing the largest chunks first returns the most memory with the
+  // fewest calls to the system. Chunks carved from slabs cannot be
+  // released on their own and stay cached.
+  for (int c = kNumClasses - 1;
+       c >= num_slab_classes_ && cached_bytes_ > max_cached_bytes_; --c) {
+    std::vector<void*>& list = free_lists_[c];
+    while (!list.empty() && cached_bytes_ > max_cached_bytes_) {
+      to_free->push_back(list.back());
+      list.pop_back();
+      cached_bytes_ -= ClassSize(c);
+    }
+  }
+}
+
+void CPUPoolAllocator::ReleaseCachedMemory() {
+  FlushThreadCache(GetThreadCache(), -1);
+  std::vector<void*> to_free;
+  {
+    mutex_lock l(mu_);
+    for (int c = num_slab_classes_; c < kNumClasses; ++c) {
+      std::vector<void*>& list = free_lists_[c];
+      to_free.insert(to_free.end(), list.begin(), list.end());
+      cached_bytes_ -= list.size() * ClassSize(c);
+      list.clear();
+    }
+  }
+  ReleaseChunks(to_free);
+}
+
+void CPUPoolAllocator::AddAllocVisitor(Visitor visitor) {
+  mutex_lock l(mu_);
+  CHECK(!allocation_begun_)
+      << "AddAllocVisitor may not be called after allocation has begun.";
+  alloc_visitors_.push_back(visitor);
+}
+
+void CPUPoolAllocator::AddFreeVisitor(Visitor visitor) {
+  mutex_lock l(mu_);
+  CHECK(!allocation_begun_)
+      << "AddFreeVisitor may not be called after allocation has begun.";
+  free_visitors_.push_back(visitor);
+}
+
+size_t CPUPoolAllocator::RequestedSize(void* ptr) {
+  return Header(ptr)->requested;
+}
+
+size_t CPUPoolAllocator::AllocatedSize(void* ptr) {
+  return Header(ptr)->allocated;
+}
+
+void CPUPoolAllocator::GetStats(AllocatorStats* stats) {
+  stats->Clear();
+  stats->num_allocs = num_allocs_.load(std::memory_order_relaxed);
+  stats->num_pool_hits = num_pool_hits_.load(std::memory_order_relaxed);
+  stats->bytes_in_use = bytes_in_use_.load(std::memory_order_relaxed);
+  stats->max_bytes_in_use = max_bytes_in_use_.load(std::memory_order_relaxed);
+  stats->max_alloc_size = max_alloc_size_.load(std::memory_order_relaxed);
+  stats->bytes_reserved = bytes_reserved_.load(std::memory_order_relaxed);
+}
+
+// The shared free lists of a process-wide allocator hold at most this
+// many bytes.
+static const size_t kDefaultMaxCachedBytes = 1LL << 30;
+
+Allocator* cpu_pool_allocator(int numa_node) {
+  static const int num_nodes = port::NUMANumNodes();
+  if (numa_node < 0 || numa_node >= num_nodes || num_nodes == 1) {
+    numa_node = port::kNUMANoAffinity;
+  }
+  static mutex mu(LINKER_INITIALIZED);
+  // Indexed by numa_node + 1.
+  static std::vector<Allocator*>* allocators =
+      new std::vector<Allocator*>(num_nodes + 1, nullptr);
+  mutex_lock l(mu);
+  Allocator*& allocator = (*allocators)[numa_node + 1];
+  if (allocator == nullptr) {
+    const string name = numa_node == port::kNUMANoAffinity
+                            ? "cpu_pool"
+                            : strings::StrCat("cpu_pool_numa_", numa_node);
+    allocator =
+        new CPUPoolAllocator(name, numa_node, kDefaultMaxCachedBytes);
+  }
+  return allocator;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,166 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMMON_RUNTIME_CPU_POOL_ALLOCATOR_H_
+#define TENSORFLOW_COMMON_RUNTIME_CPU_POOL_ALLOCATOR_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/visitable_allocator.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// An allocator of CPU memory that keeps freed chunks for reuse instead
+// of returning them to the system.
+//
+// Requests are rounded up to a size class -- four classes per power of
+// two, so at most 25% of a chunk is wasted -- and a freed chunk can serve
+// any later request of its class. Each thread caches a few free chunks
+// of every class up to kMaxThreadCachedSize, so that most allocations
+// and deallocations of small and medium buffers take no lock. Chunks of
+// larger classes, and chunks that overflow a thread cache, are kept in
+// shared per-class free lists. Chunks are only returned to the system
+// when the shared free lists hold more than "max_cached_bytes", largest
+// classes first.
+//
+// Every chunk is aligned to kChunkAlignment bytes. Requests for a larger
+// alignment are served directly by the system.
+//
+// An allocator for a NUMA node maps its memory with port::NUMAMalloc(),
+// which binds whole mappings to the node. Small chunks are carved from
+// slabs of a few megabytes, which are kept until the allocator is
+// destroyed, and larger chunks are mapped on their own.
+class CPUPoolAllocator : public VisitableAllocator {
+ public:
+  static constexpr size_t kChunkAlignment = 64;
+  static constexpr size_t kMaxThreadCachedSize = 256 << 10;
+
+  // Memory is placed on NUMA node "numa_node", or obtained from
+  // port::aligned_malloc() if "numa_node" is port::kNUMANoAffinity.
+  CPUPoolAllocator(const string& name, int numa_node, size_t max_cached_bytes);
+
+  // REQUIRES: No thread is using the allocator.
+  ~CPUPoolAllocator() override;
+
+  string Name() override { return name_; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+
+  // REQUIRES: The following functions may only be called prior
+  // to the first Allocate*() call.
+  void AddAllocVisitor(Visitor visitor) override;
+  void AddFreeVisitor(Visitor visitor) override;
+
+  bool TracksAllocationSizes() override { return true; }
+  size_t RequestedSize(void* ptr) override;
+  size_t AllocatedSize(void* ptr) override;
+
+  // num_pool_hits counts the allocations served from a thread cache or a
+  // shared free list. bytes_in_use counts whole chunks, and
+  // bytes_reserved - bytes_in_use is the memory held for reuse or spent
+  // on chunk headers.
+  void GetStats(AllocatorStats* stats) override;
+
+  // Returns the chunks of the shared free lists and of the calling
+  // thread's cache to the system. Chunks cached by other threads, and
+  // chunks carved from slabs, are kept.
+  void ReleaseCachedMemory();
+
+  // Returns the size of the class a request of "num_bytes" is rounded up
+  // to. Exposed for testing.
+  static size_t RoundedSize(size_t num_bytes);
+
+ private:
+  struct ThreadCache;
+  struct ThreadCacheList;
+
+  // Returns the calling thread's cache, creating it if needed.
+  ThreadCache* GetThreadCache();
+
+  // Obtains a chunk of "size_class" for a request of "num_bytes" aligned
+  // to "alignment" from the system.
+  void* NewChunk(int size_class, size_t alignment, size_t num_bytes);
+
+  // Carves a chunk of "size_class" from the current slab, mapping a new
+  // slab if needed.
+  void* NewSlabChunk(int size_class);
+
+  // Returns the chunk with header at "base" and of "block_bytes" bytes
+  // to the system.
+  void ReleaseBlock(void* base, size_t block_bytes);
+
+  // Moves chunks of "cache" to the shared free lists: those of
+  // "size_class" down to half of the cache's capacity, or all of them if
+  // "size_class" is negative.
+  void FlushThreadCache(ThreadCache* cache, int size_class);
+
+  // Moves all chunks of "cache", which belongs to an exiting thread, to
+  // the shared free lists and forgets "cache".
+  void RetireThreadCache(ThreadCache* cache);
+
+  // Moves chunks from the shared free lists to the system until they
+  // hold at most max_cached_bytes_, appending them to "to_free".
+  void TrimLocked(std::vector<void*>* to_free) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Releases the chunks of "to_free", whose user pointers are given.
+  void ReleaseChunks(const std::vector<void*>& to_free);
+
+  const string name_;
+  const int numa_node_;
+  // The size classes below this one are carved from slabs.
+  const int num_slab_classes_;
+  const size_t max_cached_bytes_;
+  // Identifies this allocator in the threads' cache lists. Never reused.
+  const int64 id_;
+
+  mutex mu_;
+  std::vector<std::vector<void*>> free_lists_ GUARDED_BY(mu_);
+  size_t cached_bytes_ GUARDED_BY(mu_) = 0;
+  std::vector<std::shared_ptr<ThreadCache>> thread_caches_ GUARDED_BY(mu_);
+  std::vector<void*> slabs_ GUARDED_BY(mu_);
+  char* slab_next_ GUARDED_BY(mu_) = nullptr;
+  size_t slab_left_ GUARDED_BY(mu_) = 0;
+
+  std::atomic<int64> num_allocs_;
+  std::atomic<int64> num_pool_hits_;
+  std::atomic<int64> bytes_in_use_;
+  std::atomic<int64> max_bytes_in_use_;
+  std::atomic<int64> max_alloc_size_;
+  std::atomic<int64> bytes_reserved_;
+
+  // Write access to these is guarded by mu_, but not read access. They
+  // may only be modified prior to the first allocation.
+  std::vector<Visitor> alloc_visitors_;
+  std::vector<Visitor> free_visitors_;
+  std::atomic<bool> allocation_begun_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(CPUPoolAllocator);
+};
+
+// Returns the process-wide CPUPoolAllocator that places its memory on
+// NUMA node "numa_node", or anywhere if "numa_node" is
+// port::kNUMANoAffinity or out of range.
+Allocator* cpu_pool_allocator(int numa_node);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMMON_RUNTIME_CPU_POOL_ALLOCATOR_H_
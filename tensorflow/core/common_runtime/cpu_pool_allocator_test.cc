@@ -0,0 +1,226 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/cpu_pool_allocator.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+const size_t kNoLimit = ~size_t{0};
+
+TEST(CPUPoolAllocatorTest, RoundedSize) {
+  EXPECT_EQ(64, CPUPoolAllocator::RoundedSize(0));
+  EXPECT_EQ(64, CPUPoolAllocator::RoundedSize(1));
+  EXPECT_EQ(64, CPUPoolAllocator::RoundedSize(64));
+  EXPECT_EQ(80, CPUPoolAllocator::RoundedSize(65));
+  EXPECT_EQ(128, CPUPoolAllocator::RoundedSize(128));
+  EXPECT_EQ(160, CPUPoolAllocator::RoundedSize(129));
+  EXPECT_EQ(5 << 20, CPUPoolAllocator::RoundedSize((4 << 20) + 1));
+  for (size_t n = 1; n < (1 << 20); n = n * 3 / 2 + 1) {
+    const size_t rounded = CPUPoolAllocator::RoundedSize(n);
+    EXPECT_GE(rounded, n);
+    EXPECT_LE(rounded, std::max<size_t>(64, n + n / 4));
+    EXPECT_EQ(rounded, CPUPoolAllocator::RoundedSize(rounded));
+  }
+}
+
+TEST(CPUPoolAllocatorTest, AlignmentAndSizes) {
+  CPUPoolAllocator a("test", port::kNUMANoAffinity, kNoLimit);
+  EXPECT_TRUE(a.TracksAllocationSizes());
+  for (size_t n : {1, 63, 100, 4096, 300000, 3000000}) {
+    void* p = a.AllocateRaw(8, n);
+    ASSERT_NE(nullptr, p);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) % 64);
+    EXPECT_EQ(n, a.RequestedSize(p));
+    EXPECT_EQ(CPUPoolAllocator::RoundedSize(n), a.AllocatedSize(p));
+    memset(p, 0xab, n);
+    a.DeallocateRaw(p);
+  }
+  // Larger alignments are served directly.
+  void* p = a.AllocateRaw(4096, 1000);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) % 4096);
+  EXPECT_EQ(1000, a.AllocatedSize(p));
+  a.DeallocateRaw(p);
+  a.DeallocateRaw(nullptr);
+}
+
+TEST(CPUPoolAllocatorTest, ReusesFreedChunks) {
+  CPUPoolAllocator a("test", port::kNUMANoAffinity, kNoLimit);
+  // A small chunk, served from the thread cache, and a large one, served
+  // from the shared free lists.
+  for (size_t n : {1000, 64 << 20}) {
+    void* p = a.AllocateRaw(64, n);
+    AllocatorStats before;
+    a.GetStats(&before);
+    a.DeallocateRaw(p);
+    void* q = a.AllocateRaw(64, n - 1);
+    EXPECT_EQ(p, q);
+    AllocatorStats after;
+    a.GetStats(&after);
+    EXPECT_EQ(before.num_pool_hits + 1, after.num_pool_hits);
+    EXPECT_EQ(before.bytes_reserved, after.bytes_reserved);
+    EXPECT_EQ(before.num_allocs + 1, after.num_allocs);
+    a.DeallocateRaw(q);
+  }
+  AllocatorStats stats;
+  a.GetStats(&stats);
+  EXPECT_EQ(0, stats.bytes_in_use);
+  EXPECT_EQ(CPUPoolAllocator::RoundedSize(64 << 20), stats.max_bytes_in_use);
+  EXPECT_LT(0, stats.bytes_reserved);
+  LOG(INFO) << stats.DebugString();
+
+  a.ReleaseCachedMemory();
+  a.GetStats(&stats);
+  EXPECT_EQ(0, stats.bytes_reserved);
+}
+
+TEST(CPUPoolAllocatorTest, Visitors) {
+  int64 alloc_bytes = 0;
+  int64 free_bytes = 0;
+  {
+    // Keeps at most one 1MB chunk in its shared free lists.
+    CPUPoolAllocator a("test", port::kNUMANoAffinity, 1 << 20);
+    a.AddAllocVisitor([&alloc_bytes](void* ptr, size_t num_bytes) {
+      alloc_bytes += num_bytes;
+    });
+    a.AddFreeVisitor([&free_bytes](void* ptr, size_t num_bytes) {
+      free_bytes += num_bytes;
+    });
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 3; ++i) ptrs.push_back(a.AllocateRaw(64, 1 << 20));
+    EXPECT_EQ(0, free_bytes);
+    for (void* p : ptrs) a.DeallocateRaw(p);
+    EXPECT_EQ(alloc_bytes * 2 / 3, free_bytes);
+    AllocatorStats stats;
+    a.GetStats(&stats);
+    EXPECT_EQ(alloc_bytes - free_bytes, stats.bytes_reserved);
+  }
+  EXPECT_EQ(alloc_bytes, free_bytes);
+}
+
+TEST(CPUPoolAllocatorTest, NUMANodeSlabs) {
+  int num_maps = 0;
+  int num_unmaps = 0;
+  {
+    // Node 0 exists on every machine.
+    CPUPoolAllocator a("test", 0, kNoLimit);
+    a.AddAllocVisitor(
+        [&num_maps](void* ptr, size_t num_bytes) { ++num_maps; });
+    a.AddFreeVisitor(
+        [&num_unmaps](void* ptr, size_t num_bytes) { ++num_unmaps; });
+    // Small chunks are carved from a single slab.
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 1000; ++i) {
+      void* p = a.AllocateRaw(64, 1000);
+      ASSERT_NE(nullptr, p);
+      EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) % 64);
+      memset(p, i, 1000);
+      ptrs.push_back(p);
+    }
+    EXPECT_EQ(1, num_maps);
+    // A large chunk is mapped on its own.
+    ptrs.push_back(a.AllocateRaw(64, 16 << 20));
+    EXPECT_EQ(2, num_maps);
+    for (void* p : ptrs) a.DeallocateRaw(p);
+
+    // Only the large chunk can be returned to the system.
+    a.ReleaseCachedMemory();
+    EXPECT_EQ(1, num_unmaps);
+    AllocatorStats stats;
+    a.GetStats(&stats);
+    EXPECT_LT(0, stats.bytes_reserved);
+    void* p = a.AllocateRaw(64, 1000);
+    EXPECT_EQ(2, num_maps);
+    a.DeallocateRaw(p);
+  }
+  // The slab is unmapped with the allocator.
+  EXPECT_EQ(2, num_unmaps);
+}
+
+TEST(CPUPoolAllocatorTest, ManyThreads) {
+  int64 alloc_bytes = 0;
+  int64 free_bytes = 0;
+  mutex mu;
+  {
+    CPUPoolAllocator a("test", port::kNUMANoAffinity, 4 << 20);
+    a.AddAllocVisitor([&](void* ptr, size_t num_bytes) {
+      mutex_lock l(mu);
+      alloc_bytes += num_bytes;
+    });
+    a.AddFreeVisitor([&](void* ptr, size_t num_bytes) {
+      mutex_lock l(mu);
+      free_bytes += num_bytes;
+    });
+    {
+      // Chunks are often freed by another thread than the one that
+      // allocated them.
+      std::unique_ptr<thread::ThreadPool> pool(
+          new thread::ThreadPool(Env::Default(), "test", 8));
+      std::vector<void*> shared(64, nullptr);
+      mutex shared_mu;
+      for (int t = 0; t < 8; ++t) {
+        pool->Schedule([&a, &shared, &shared_mu, t]() {
+          random::PhiloxRandom philox(t, 17);
+          random::SimplePhilox rand(&philox);
+          for (int i = 0; i < 2000; ++i) {
+            const size_t n = 1 + rand.Uniform(1 << (4 + rand.Uniform(17)));
+            char* p = static_cast<char*>(a.AllocateRaw(64, n));
+            p[0] = p[n - 1] = static_cast<char>(t);
+            void* old;
+            {
+              mutex_lock l(shared_mu);
+              void*& slot = shared[rand.Uniform(shared.size())];
+              old = slot;
+              slot = p;
+            }
+            a.DeallocateRaw(old);
+          }
+        });
+      }
+      pool.reset();
+      for (void* p : shared) a.DeallocateRaw(p);
+    }
+    AllocatorStats stats;
+    a.GetStats(&stats);
+    EXPECT_EQ(0, stats.bytes_in_use);
+    EXPECT_EQ(8 * 2000, stats.num_allocs);
+    EXPECT_LT(8 * 1000, stats.num_pool_hits);
+  }
+  EXPECT_EQ(alloc_bytes, free_bytes);
+}
+
+static void BM_AllocateDeallocate(int iters, int num_bytes) {
+  testing::StopTiming();
+  CPUPoolAllocator a("bench", port::kNUMANoAffinity, kNoLimit);
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    a.DeallocateRaw(a.AllocateRaw(64, num_bytes));
+  }
+}
+BENCHMARK(BM_AllocateDeallocate)->Arg(256)->Arg(64 << 10)->Arg(16 << 20);
+
+}  // namespace
+}  // namespace tensorflow
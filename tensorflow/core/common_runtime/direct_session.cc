@@ -411,29 +411,58 @@ Status DirectSession::Run(const RunOptions& run_options,
   // Send inputs.
   TF_RETURN_IF_ERROR(SendInputs(inputs, executors_and_keys, run_state.rendez));
 
+  TF_RETURN_IF_ERROR(RunExecutors(run_options, executors_and_keys,
+                                  run_state_args.handle, pool, &run_state,
+                                  run_metadata));
+
+  // Receive outputs.
+  TF_RETURN_IF_ERROR(
+      RecvOutputs(output_names, executors_and_keys, &run_state, outputs));
+
+  // Save the output tensors of this run we choose to keep.
+  TF_RETURN_IF_ERROR(
+      run_state.tensor_store.SaveTensors(output_names, &session_state_));
+
+  return Status::OK();
+}
+
+Status DirectSession::RunExecutors(const RunOptions& run_options,
+                                   ExecutorsAndKeys* executors_and_keys,
+                                   const string& handle,
+                                   thread::ThreadPool* pool,
+                                   RunState* run_state,
+                                   RunMetadata* run_metadata) {
+  // The planned allocators are released, ending the step for the
+  // planners, when run_state is destroyed.
+  for (const auto& item : executors_and_keys->items) {
+    if (item.memory_planner) {
+      item.memory_planner->StartStep(&run_state->step_resource_manager);
+    }
+  }
+
   // Start parallel Executors.
   const int num_executors = executors_and_keys->items.size();
   ExecutorBarrier* barrier = new ExecutorBarrier(
-      num_executors, run_state.rendez, [&run_state](const Status& ret) {
+      num_executors, run_state->rendez, [run_state](const Status& ret) {
         {
-          mutex_lock l(run_state.mu_);
-          run_state.status.Update(ret);
+          mutex_lock l(run_state->mu_);
+          run_state->status.Update(ret);
         }
-        run_state.executors_done.Notify();
+        run_state->executors_done.Notify();
       });
 
   Executor::Args args;
   args.step_id = step_id_counter_.fetch_add(1);
-  args.rendezvous = run_state.rendez;
+  args.rendezvous = run_state->rendez;
   args.cancellation_manager = cancellation_manager_;
   args.runner = [this, pool](Executor::Args::Closure c) {
     SchedClosure(pool, std::move(c));
   };
   args.session_state = &session_state_;
-  args.tensor_store = &run_state.tensor_store;
-  args.step_resource_manager = &run_state.step_resource_manager;
+  args.tensor_store = &run_state->tensor_store;
+  args.step_resource_manager = &run_state->step_resource_manager;
   if (LogMemory::IsEnabled()) {
-    LogMemory::RecordStep(args.step_id, run_state_args.handle);
+    LogMemory::RecordStep(args.step_id, handle);
   }
 
   const bool do_trace = (run_options.trace_level() > RunOptions::NO_TRACE);
@@ -450,9 +479,9 @@ Status DirectSession::Run(const RunOptions& run_options,
          0);
   }
   if (do_trace || update_cost_model) {
-    run_state.collector.reset(
+    run_state->collector.reset(
         new StepStatsCollector(run_metadata->mutable_step_stats()));
-    args.stats_collector = run_state.collector.get();
+    args.stats_collector = run_state->collector.get();
   }
 
 #if GOOGLE_CUDA
@@ -468,9 +497,9 @@ Status DirectSession::Run(const RunOptions& run_options,
     item.executor->RunAsync(args, barrier->Get());
   }
 
-  WaitForNotification(&run_state, run_options.timeout_in_ms() > 0
-                                      ? run_options.timeout_in_ms()
-                                      : operation_timeout_in_ms_);
+  WaitForNotification(run_state, run_options.timeout_in_ms() > 0
+                                     ? run_options.timeout_in_ms()
+                                     : operation_timeout_in_ms_);
 
 #if GOOGLE_CUDA
   if (tracer) {
@@ -480,18 +509,10 @@ Status DirectSession::Run(const RunOptions& run_options,
 #endif  // GOOGLE_CUDA
 
   {
-    mutex_lock l(run_state.mu_);
-    TF_RETURN_IF_ERROR(run_state.status);
+    mutex_lock l(run_state->mu_);
+    TF_RETURN_IF_ERROR(run_state->status);
   }
 
-  // Receive outputs.
-  TF_RETURN_IF_ERROR(
-      RecvOutputs(output_names, executors_and_keys, &run_state, outputs));
-
-  // Save the output tensors of this run we choose to keep.
-  TF_RETURN_IF_ERROR(
-      run_state.tensor_store.SaveTensors(output_names, &session_state_));
-
   // Build and return the cost model as instructed.
   mutex_lock l(executor_lock_);
   ++executors_and_keys->step_count;
@@ -528,6 +549,114 @@ Status DirectSession::Run(const RunOptions& run_options,
   return Status::OK();
 }
 
+Status DirectSession::MakeCallable(const std::vector<string>& feed_names,
+                                   const std::vector<string>& fetch_names,
+                                   const std::vector<string>& target_nodes,
+                                   CallableHandle* handle) {
+  TF_RETURN_IF_ERROR(CheckNotClosed());
+  {
+    mutex_lock l(graph_def_lock_);
+    if (!graph_created_) {
+      return errors::InvalidArgument(
+          "Session was not created with a graph before MakeCallable()!");
+    }
+  }
+
+  ExecutorsAndKeys* executors_and_keys;
+  RunStateArgs run_state_args;
+  TF_RETURN_IF_ERROR(GetOrCreateExecutors(thread_pools_[0], feed_names,
+                                          fetch_names, target_nodes,
+                                          &executors_and_keys,
+                                          &run_state_args));
+
+  std::shared_ptr<Callable> callable(new Callable);
+  callable->executors_and_keys = executors_and_keys;
+  callable->handle = run_state_args.handle;
+  callable->fetch_names = fetch_names;
+  // input_keys and output_keys are not modified once the executors are
+  // published, so the pointers stay valid for the life of the session.
+  for (const string& feed : feed_names) {
+    callable->feed_keys.push_back(&executors_and_keys->input_keys.at(feed));
+  }
+  for (const string& fetch : fetch_names) {
+    callable->fetch_keys.push_back(&executors_and_keys->output_keys.at(fetch));
+  }
+
+  mutex_lock l(callables_lock_);
+  *handle = callables_.size();
+  callables_.push_back(std::move(callable));
+  return Status::OK();
+}
+
+Status DirectSession::RunCallable(CallableHandle handle,
+                                  const std::vector<Tensor>& feed_tensors,
+                                  std::vector<Tensor>* fetch_tensors) {
+  TF_RETURN_IF_ERROR(CheckNotClosed());
+  direct_session_runs->GetCell()->IncrementBy(1);
+  std::shared_ptr<const Callable> callable;
+  {
+    mutex_lock l(callables_lock_);
+    if (handle >= 0 && handle < callables_.size()) {
+      callable = callables_[handle];
+    }
+  }
+  if (callable == nullptr) {
+    return errors::InvalidArgument("No such callable handle: ", handle);
+  }
+  if (feed_tensors.size() != callable->feed_keys.size()) {
+    return errors::InvalidArgument("Expected ", callable->feed_keys.size(),
+                                   " feed tensors, but got ",
+                                   feed_tensors.size());
+  }
+
+  RunState run_state({}, {});
+  run_state.rendez = new IntraProcessRendezvous(device_mgr_.get());
+  for (size_t i = 0; i < feed_tensors.size(); ++i) {
+    Status s = run_state.rendez->Send(*callable->feed_keys[i],
+                                      Rendezvous::Args(), feed_tensors[i],
+                                      false);
+    if (!s.ok()) {
+      run_state.rendez->StartAbort(s);
+      return s;
+    }
+  }
+
+  RunMetadata run_metadata;
+  TF_RETURN_IF_ERROR(RunExecutors(RunOptions(), callable->executors_and_keys,
+                                  callable->handle, thread_pools_[0],
+                                  &run_state, &run_metadata));
+
+  fetch_tensors->resize(callable->fetch_keys.size());
+  for (size_t i = 0; i < callable->fetch_keys.size(); ++i) {
+    bool is_dead;
+    Status s =
+        run_state.rendez->Recv(*callable->fetch_keys[i], Rendezvous::Args(),
+                               &(*fetch_tensors)[i], &is_dead);
+    if (is_dead && s.ok()) {
+      s = errors::InvalidArgument("The tensor returned for ",
+                                  callable->fetch_names[i], " was not valid.");
+    }
+    if (!s.ok()) {
+      run_state.rendez->StartAbort(s);
+      fetch_tensors->clear();
+      return s;
+    }
+  }
+
+  return run_state.tensor_store.SaveTensors(callable->fetch_names,
+                                            &session_state_);
+}
+
+Status DirectSession::ReleaseCallable(CallableHandle handle) {
+  mutex_lock l(callables_lock_);
+  if (handle < 0 || handle >= callables_.size() ||
+      callables_[handle] == nullptr) {
+    return errors::InvalidArgument("No such callable handle: ", handle);
+  }
+  callables_[handle].reset();
+  return Status::OK();
+}
+
 Status DirectSession::PRunSetup(const std::vector<string>& input_names,
                                 const std::vector<string>& output_names,
                                 const std::vector<string>& target_nodes,
@@ -699,7 +828,6 @@ Status DirectSession::SendInputs(const NamedTensorList& inputs,
                                  const ExecutorsAndKeys* executors_and_keys,
                                  IntraProcessRendezvous* rendez) {
   Status s;
-  Rendezvous::ParsedKey parsed;
   // Insert the input tensors into the local rendezvous by their
   // rendezvous key.
   for (const auto& input : inputs) {
@@ -708,13 +836,7 @@ Status DirectSession::SendInputs(const NamedTensorList& inputs,
       return errors::InvalidArgument("'", input.first,
                                      "' is not a pre-defined feed!");
     }
-    const string& input_key = it->second;
-
-    s = Rendezvous::ParseKey(input_key, &parsed);
-    if (!s.ok()) {
-      rendez->StartAbort(s);
-      return s;
-    }
+    const Rendezvous::ParsedKey& parsed = it->second;
 
     s = rendez->Send(parsed, Rendezvous::Args(), input.second, false);
     if (!s.ok()) {
@@ -734,7 +856,6 @@ Status DirectSession::RecvOutputs(const std::vector<string>& output_names,
     outputs->resize(output_names.size());
   }
 
-  Rendezvous::ParsedKey parsed;
   // Get the outputs from the rendezvous
   for (size_t output_offset = 0; output_offset < output_names.size();
        ++output_offset) {
@@ -745,19 +866,16 @@ Status DirectSession::RecvOutputs(const std::vector<string>& output_names,
                                      "' was not defined as a fetch"
                                      " target in PRunSetup.");
     }
-    const string& output_key = it->second;
+    const Rendezvous::ParsedKey& parsed = it->second;
     Tensor output_tensor;
     bool is_dead;
     IntraProcessRendezvous* rendez = run_state->rendez;
 
-    s = Rendezvous::ParseKey(output_key, &parsed);
-    if (s.ok()) {
-      // Fetch data from the Rendezvous.
-      s = rendez->Recv(parsed, Rendezvous::Args(), &output_tensor, &is_dead);
-      if (is_dead && s.ok()) {
-        s = errors::InvalidArgument("The tensor returned for ", output_name,
-                                    " was not valid.");
-      }
+    // Fetch data from the Rendezvous.
+    s = rendez->Recv(parsed, Rendezvous::Args(), &output_tensor, &is_dead);
+    if (is_dead && s.ok()) {
+      s = errors::InvalidArgument("The tensor returned for ", output_name,
+                                  " was not valid.");
     }
     if (!s.ok()) {
       rendez->StartAbort(s);
@@ -945,6 +1063,13 @@ Status DirectSession::GetOrCreateExecutors(
       }
     };
     params.node_outputs_cb = node_outputs_callback_;
+    params.use_work_stealing =
+        options_.config.graph_options().use_work_stealing_executor();
+    params.max_workers = pool->NumThreads();
+    // The feeds of a partial run arrive while its executors run.
+    params.use_static_plan =
+        options_.config.graph_options().use_static_execution_plan() &&
+        !run_state_args->is_partial_run;
 
     partition_graph = iter->second.release();
     optimizer.Optimize(lib, options_.env, device, &partition_graph);
@@ -965,19 +1090,29 @@ Status DirectSession::GetOrCreateExecutors(
     TF_RETURN_IF_ERROR(
         NewLocalExecutor(params, iter->second.release(), &executor));
     item->executor.reset(executor);
+
+    if (options_.config.graph_options().plan_step_memory() &&
+        device->device_type() == DEVICE_CPU) {
+      item->memory_planner.reset(new StepMemoryPlanner(
+          device->name(), device->GetAllocator(AllocatorAttributes())));
+    }
   }
 
-  // Compute the rendezvous keys to avoid recomputing them every time.
+  // Compute and parse the rendezvous keys to avoid redoing it every time.
   //
   // We always use the first device as the device name portion of the
   // key, even if we're feeding another graph.
   for (const string& input : inputs) {
-    ek->input_keys[input] = GetRendezvousKey(
-        input, device_set_.client_device()->attributes(), FrameAndIter(0, 0));
+    TF_RETURN_IF_ERROR(Rendezvous::ParseKey(
+        GetRendezvousKey(input, device_set_.client_device()->attributes(),
+                         FrameAndIter(0, 0)),
+        &ek->input_keys[input]));
   }
   for (const string& output : outputs) {
-    ek->output_keys[output] = GetRendezvousKey(
-        output, device_set_.client_device()->attributes(), FrameAndIter(0, 0));
+    TF_RETURN_IF_ERROR(Rendezvous::ParseKey(
+        GetRendezvousKey(output, device_set_.client_device()->attributes(),
+                         FrameAndIter(0, 0)),
+        &ek->output_keys[output]));
   }
 
   // Reacquire the lock, try to insert into the map.
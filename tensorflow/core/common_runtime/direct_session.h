@@ -30,9 +30,11 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
 #include "tensorflow/core/common_runtime/session_factory.h"
 #include "tensorflow/core/common_runtime/simple_graph_execution_state.h"
+#include "tensorflow/core/common_runtime/step_memory_planner.h"
 #include "tensorflow/core/debug/debug_graph_utils.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/framework/session_state.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -91,6 +93,18 @@ class DirectSession : public Session {
                             const std::vector<string>& output_names,
                             std::vector<Tensor>* outputs) override;
 
+  // MakeCallable resolves the executors and rendezvous keys of the
+  // signature once, so that RunCallable neither builds the signature
+  // string nor looks it up in executors_.
+  ::tensorflow::Status MakeCallable(const std::vector<string>& feed_names,
+                                    const std::vector<string>& fetch_names,
+                                    const std::vector<string>& target_nodes,
+                                    CallableHandle* handle) override;
+  ::tensorflow::Status RunCallable(CallableHandle handle,
+                                   const std::vector<Tensor>& feed_tensors,
+                                   std::vector<Tensor>* fetch_tensors) override;
+  ::tensorflow::Status ReleaseCallable(CallableHandle handle) override;
+
   // Reset clears 'containers' from the device_mgr of the DirectSession.
   // If 'containers' is empty, then Reset clears the default container.
   ::tensorflow::Status Reset(const std::vector<string>& containers);
@@ -110,6 +124,8 @@ class DirectSession : public Session {
     Graph* graph = nullptr;
     std::unique_ptr<FunctionLibraryRuntime> flib;
     std::unique_ptr<Executor> executor;
+    // Plans the memory of the steps run by 'executor', if enabled.
+    std::unique_ptr<StepMemoryPlanner> memory_planner;
   };
 
   // An ExecutorsAndKeys is created for a given set of feeds/fetches.
@@ -118,8 +134,8 @@ class DirectSession : public Session {
   // maps node name to node. We keep 'graph' and 'name_to_node' only in
   // the case of partial runs. Each item in 'items' is the executor for
   // a partition of the graph bundled with its dependent library runtime.
-  // 'input_keys' are the rendezvous keys for the feeds and 'output_keys'
-  // are rendezvous keys for the fetches.
+  // 'input_keys' are the parsed rendezvous keys for the feeds and
+  // 'output_keys' are parsed rendezvous keys for the fetches.
   // 'flib_def' is the function library used by graphs in 'items'.
   // TODO(phawkins): currently partitions always share the same function
   // library. Consider giving each partition its own function library to enable
@@ -130,8 +146,8 @@ class DirectSession : public Session {
     NameNodeMap name_to_node;
     std::unique_ptr<FunctionLibraryDefinition> flib_def;
     std::vector<PerPartitionExecutorsAndLib> items;
-    std::unordered_map<string, string> input_keys;
-    std::unordered_map<string, string> output_keys;
+    std::unordered_map<string, Rendezvous::ParsedKey> input_keys;
+    std::unordered_map<string, Rendezvous::ParsedKey> output_keys;
   };
 
   // For each live partial execution, the session maintains a RunState.
@@ -155,6 +171,18 @@ class DirectSession : public Session {
     ~RunState();
   };
 
+  // A signature registered with MakeCallable. 'executors_and_keys' is
+  // owned by executors_. 'feed_keys' and 'fetch_keys' point into its
+  // input_keys and output_keys, in the order of the feeds and fetches
+  // passed to MakeCallable.
+  struct Callable {
+    ExecutorsAndKeys* executors_and_keys = nullptr;
+    string handle;
+    std::vector<string> fetch_names;
+    std::vector<const Rendezvous::ParsedKey*> feed_keys;
+    std::vector<const Rendezvous::ParsedKey*> fetch_keys;
+  };
+
   struct RunStateArgs {
     bool is_partial_run = false;
     string handle;
@@ -187,6 +215,16 @@ class DirectSession : public Session {
   ::tensorflow::Status ExtendLocked(const GraphDef& graph)
       EXCLUSIVE_LOCKS_REQUIRED(graph_def_lock_);
 
+  // Runs the executors of 'executors_and_keys' to completion, once the
+  // feeds have been sent to 'run_state->rendez', and updates the cost
+  // model and 'run_metadata' as requested by 'run_options'.
+  ::tensorflow::Status RunExecutors(const RunOptions& run_options,
+                                    ExecutorsAndKeys* executors_and_keys,
+                                    const string& handle,
+                                    thread::ThreadPool* pool,
+                                    RunState* run_state,
+                                    RunMetadata* run_metadata);
+
   // Feeds more inputs to the executors, triggering further execution.
   ::tensorflow::Status SendInputs(
       const std::vector<std::pair<string, Tensor>>& inputs,
@@ -248,6 +286,12 @@ class DirectSession : public Session {
   std::unordered_map<string, std::unique_ptr<RunState>> partial_runs_
       GUARDED_BY(executor_lock_);
 
+  mutex callables_lock_;
+  // Indexed by CallableHandle. Released callables are null; a running
+  // step keeps its callable alive.
+  std::vector<std::shared_ptr<const Callable>> callables_
+      GUARDED_BY(callables_lock_);
+
   // This holds all the tensors that are currently alive in the session.
   SessionState session_state_;
 
@@ -29,6 +29,7 @@ limitations under the License.
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/graph/costmodel.h"
 #include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -134,6 +135,43 @@ TEST_F(DirectSessionMinusAXTest, TestFeed) {
   EXPECT_FLOAT_EQ(39.0, mat(1, 0));
 }
 
+TEST_F(DirectSessionMinusAXTest, RunCallable) {
+  Initialize({1, 2, 3, 4});
+  std::unique_ptr<Session> session(CreateSession());
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  Session::CallableHandle handle;
+  TF_ASSERT_OK(
+      session->MakeCallable({x_}, {y_ + ":0", y_neg_ + ":0"}, {}, &handle));
+
+  for (int i = 0; i < 3; ++i) {
+    Tensor t(DT_FLOAT, TensorShape({2, 1}));
+    test::FillValues<float>(&t, {5, static_cast<float>(i)});
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->RunCallable(handle, {t}, &outputs));
+    ASSERT_EQ(2, outputs.size());
+    // Expect y to be 1*5 + 2*i, 3*5 + 4*i, and y_neg its negation.
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>({5.0f + 2 * i, 15.0f + 4 * i}, {2, 1}),
+        outputs[0]);
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>({-5.0f - 2 * i, -15.0f - 4 * i}, {2, 1}),
+        outputs[1]);
+  }
+
+  // The number of feeds must match the signature.
+  std::vector<Tensor> outputs;
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(session->RunCallable(handle, {}, &outputs)));
+
+  TF_ASSERT_OK(session->ReleaseCallable(handle));
+  Tensor t(DT_FLOAT, TensorShape({2, 1}));
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(session->RunCallable(handle, {t}, &outputs)));
+  EXPECT_TRUE(errors::IsInvalidArgument(session->ReleaseCallable(handle)));
+}
+
 TEST_F(DirectSessionMinusAXTest, TestConcurrency) {
   Initialize({1, 2, 3, 4});
   std::unique_ptr<Session> session(CreateSession());
@@ -203,6 +241,221 @@ TEST_F(DirectSessionMinusAXTest, TestPerSessionThreads) {
   delete tp;
 }
 
+TEST_F(DirectSessionMinusAXTest, TestWorkStealingExecutor) {
+  Initialize({1, 2, 3, 4});
+
+  SessionOptions options;
+  options.config.mutable_graph_options()->set_use_work_stealing_executor(true);
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  std::unique_ptr<Session> session(NewSession(options));
+
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  thread::ThreadPool* tp = new thread::ThreadPool(Env::Default(), "test", 4);
+
+  // Run the graph 1000 times in 4 different threads concurrently.
+  std::vector<string> output_names = {y_ + ":0"};
+  std::vector<string> target_nodes = {y_neg_};
+  auto fn = [&session, output_names, target_nodes]() {
+    for (int i = 0; i < 1000; ++i) {
+      std::vector<std::pair<string, Tensor>> inputs;
+      std::vector<Tensor> outputs;
+      // Run the graph
+      Status s = session->Run(inputs, output_names, target_nodes, &outputs);
+      TF_ASSERT_OK(s);
+      ASSERT_EQ(1, outputs.size());
+      auto mat = outputs[0].matrix<float>();
+      EXPECT_FLOAT_EQ(3.0, mat(0, 0));
+    }
+  };
+
+  for (int i = 0; i < 4; ++i) {
+    tp->Schedule(fn);
+  }
+
+  // Wait for the functions to finish.
+  delete tp;
+}
+
+TEST(DirectSessionTest, WorkStealingExecutorWideGraph) {
+  // Many independent chains, so that workers have something to steal.
+  Graph g(OpRegistry::Global());
+  Tensor one(DT_FLOAT, TensorShape({}));
+  one.scalar<float>()() = 1.0;
+  Node* c = test::graph::Constant(&g, one);
+  std::vector<string> output_names;
+  for (int i = 0; i < 64; ++i) {
+    Node* n = c;
+    for (int j = 0; j <= i % 8; ++j) {
+      n = test::graph::Add(&g, n, c);
+    }
+    output_names.push_back(strings::StrCat(n->name(), ":0"));
+  }
+  GraphDef def;
+  test::graph::ToGraphDef(&g, &def);
+
+  SessionOptions options;
+  options.config.mutable_graph_options()->set_use_work_stealing_executor(true);
+  options.config.set_use_per_session_threads(true);
+  options.config.set_inter_op_parallelism_threads(4);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def));
+
+  for (int step = 0; step < 100; ++step) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({}, output_names, {}, &outputs));
+    ASSERT_EQ(64, outputs.size());
+    for (int i = 0; i < 64; ++i) {
+      EXPECT_FLOAT_EQ(2.0 + i % 8, outputs[i].scalar<float>()());
+    }
+  }
+}
+
+TEST_F(DirectSessionMinusAXTest, TestStaticExecutionPlan) {
+  Initialize({1, 2, 3, 4});
+
+  SessionOptions options;
+  options.config.mutable_graph_options()->set_use_static_execution_plan(true);
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  // Feed x, which lives on the second device, and fetch y from the first.
+  Tensor t(DT_FLOAT, TensorShape({2, 1}));
+  t.matrix<float>()(0, 0) = 5;
+  t.matrix<float>()(1, 0) = 6;
+  std::vector<std::pair<string, Tensor>> inputs = {{x_, t}};
+  std::vector<string> output_names = {y_ + ":0", y_neg_ + ":0"};
+  for (int i = 0; i < 10; ++i) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run(inputs, output_names, {}, &outputs));
+    ASSERT_EQ(2, outputs.size());
+    auto mat = outputs[0].matrix<float>();
+    EXPECT_FLOAT_EQ(17.0, mat(0, 0));
+    EXPECT_FLOAT_EQ(39.0, mat(1, 0));
+    auto neg = outputs[1].matrix<float>();
+    EXPECT_FLOAT_EQ(-17.0, neg(0, 0));
+    EXPECT_FLOAT_EQ(-39.0, neg(1, 0));
+  }
+
+  // Without the feed, x is computed from its constant.
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({}, {y_ + ":0"}, {y_neg_}, &outputs));
+  ASSERT_EQ(1, outputs.size());
+  EXPECT_FLOAT_EQ(3.0, outputs[0].matrix<float>()(0, 0));
+}
+
+TEST_F(DirectSessionMinusAXTest, TestPlannedStepMemory) {
+  Initialize({1, 2, 3, 4});
+
+  SessionOptions options;
+  options.config.mutable_graph_options()->set_use_static_execution_plan(true);
+  options.config.mutable_graph_options()->set_plan_step_memory(true);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  // Changing the number of columns of x changes the size of every
+  // intermediate tensor, so the steps alternate between following the
+  // plan and falling back to the device allocator.
+  std::vector<string> output_names = {y_ + ":0", y_neg_ + ":0"};
+  for (int i = 0; i < 20; ++i) {
+    const int cols = (i / 5) % 2 + 1;
+    Tensor t(DT_FLOAT, TensorShape({2, cols}));
+    for (int c = 0; c < cols; ++c) {
+      t.matrix<float>()(0, c) = 5 + c;
+      t.matrix<float>()(1, c) = 6 + c;
+    }
+    std::vector<std::pair<string, Tensor>> inputs = {{x_, t}};
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run(inputs, output_names, {}, &outputs));
+    ASSERT_EQ(2, outputs.size());
+    for (int c = 0; c < cols; ++c) {
+      const float y0 = 1 * (5 + c) + 2 * (6 + c);
+      const float y1 = 3 * (5 + c) + 4 * (6 + c);
+      EXPECT_FLOAT_EQ(y0, outputs[0].matrix<float>()(0, c));
+      EXPECT_FLOAT_EQ(y1, outputs[0].matrix<float>()(1, c));
+      EXPECT_FLOAT_EQ(-y0, outputs[1].matrix<float>()(0, c));
+      EXPECT_FLOAT_EQ(-y1, outputs[1].matrix<float>()(1, c));
+    }
+  }
+}
+
+TEST(DirectSessionTest, FusesElementwiseOpsOnFedPlaceholder) {
+  // y = -|x + x|, on a batch of unknown size.
+  Graph g(OpRegistry::Global());
+  Node* x;
+  TF_ASSERT_OK(NodeBuilder("x", "Placeholder")
+                   .Attr("dtype", DT_FLOAT)
+                   .Attr("shape", PartialTensorShape({-1, 2}))
+                   .Finalize(&g, &x));
+  Node* add = test::graph::Binary(&g, "Add", x, x);
+  Node* abs = test::graph::Unary(&g, "Abs", add);
+  Node* y = test::graph::Unary(&g, "Neg", abs);
+  GraphDef def;
+  test::graph::ToGraphDef(&g, &def);
+
+  SessionOptions options;
+  options.config.mutable_graph_options()
+      ->mutable_optimizer_options()
+      ->set_do_elementwise_fusion(true);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def));
+
+  Tensor t(DT_FLOAT, TensorShape({3, 2}));
+  test::FillValues<float>(&t, {1, -2, 3, -4, 5, -6});
+  RunOptions run_options;
+  run_options.set_output_partition_graphs(true);
+  RunMetadata run_metadata;
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run(run_options, {{"x", t}}, {y->name() + ":0"}, {},
+                            &outputs, &run_metadata));
+  ASSERT_EQ(1, outputs.size());
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({-2, -4, -6, -8, -10, -12}, {3, 2}), outputs[0]);
+
+  int num_fused = 0;
+  for (const GraphDef& partition : run_metadata.partition_graphs()) {
+    for (const NodeDef& node : partition.node()) {
+      EXPECT_NE("Add", node.op());
+      if (node.op() == "_FusedElementwise") ++num_fused;
+    }
+  }
+  EXPECT_EQ(1, num_fused);
+}
+
+TEST(DirectSessionTest, StaticExecutionPlanWithControlFlow) {
+  // Graphs with control flow fall back to the default executor.
+  Graph g(OpRegistry::Global());
+  Tensor pred_tensor(DT_BOOL, TensorShape({}));
+  pred_tensor.scalar<bool>()() = true;
+  Tensor data_tensor(DT_FLOAT, TensorShape({}));
+  data_tensor.scalar<float>()() = 7.0;
+  Node* pred = test::graph::Constant(&g, pred_tensor);
+  Node* data = test::graph::Constant(&g, data_tensor);
+  Node* sw = test::graph::Switch(&g, data, pred);
+  Node* untaken = test::graph::Unary(&g, "Neg", sw, 0);
+  Node* taken = test::graph::Identity(&g, sw, 1);
+  Node* merge = test::graph::Merge(&g, untaken, taken);
+  GraphDef def;
+  test::graph::ToGraphDef(&g, &def);
+
+  SessionOptions options;
+  options.config.mutable_graph_options()->set_use_static_execution_plan(true);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def));
+
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({}, {merge->name() + ":0"}, {}, &outputs));
+  ASSERT_EQ(1, outputs.size());
+  EXPECT_FLOAT_EQ(7.0, outputs[0].scalar<float>()());
+}
+
 TEST_F(DirectSessionMinusAXTest, TwoCreateCallsFails) {
   Initialize({1, 2, 3, 4});
   std::unique_ptr<Session> session(CreateSession());
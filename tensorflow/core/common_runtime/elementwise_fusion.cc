@@ -0,0 +1,386 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/elementwise_fusion.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+#include "tensorflow/core/common_runtime/shape_refiner.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/device_name_utils.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Groups of more ops are split, which bounds the kernel's scratch memory.
+const int kMaxFusedOps = 64;
+
+// Returns the number of inputs of "op" if _FusedElementwise can evaluate
+// it, or 0. Must be kept in sync with kernels/fused_elementwise_op.cc.
+int NumFusibleOpInputs(const string& op) {
+  static const std::unordered_map<string, int>* fusible_ops =
+      new std::unordered_map<string, int>({{"Add", 2},
+                                           {"Sub", 2},
+                                           {"Mul", 2},
+                                           {"Div", 2},
+                                           {"RealDiv", 2},
+                                           {"Maximum", 2},
+                                           {"Minimum", 2},
+                                           {"SquaredDifference", 2},
+                                           {"Abs", 1},
+                                           {"Neg", 1},
+                                           {"Exp", 1},
+                                           {"Log", 1},
+                                           {"Sqrt", 1},
+                                           {"Rsqrt", 1},
+                                           {"Square", 1},
+                                           {"Inv", 1},
+                                           {"Reciprocal", 1},
+                                           {"Relu", 1},
+                                           {"Relu6", 1},
+                                           {"Sigmoid", 1},
+                                           {"Tanh", 1}});
+  auto it = fusible_ops->find(op);
+  return it == fusible_ops->end() ? 0 : it->second;
+}
+
+// Returns true if "n" has the op and type of a fusible op. Shapes and
+// placement are checked by FusionCandidates.
+bool HasFusibleOpAndType(const Node* n) {
+  if (!n->IsOp()) return false;
+  const int num_inputs = NumFusibleOpInputs(n->type_string());
+  if (num_inputs == 0 || num_inputs != n->num_inputs()) return false;
+  const DataType dtype = n->output_type(0);
+  return n->num_outputs() == 1 && (dtype == DT_FLOAT || dtype == DT_DOUBLE);
+}
+
+bool IsOnCPU(const Node* n) {
+  DeviceNameUtils::ParsedName parsed;
+  return DeviceNameUtils::ParseFullName(n->assigned_device_name(), &parsed) &&
+         parsed.has_type && parsed.type == DEVICE_CPU;
+}
+
+// Returns true if some fusible op has another one as an input, so that
+// running shape inference on "graph" may be worthwhile.
+bool MayHaveFusibleGroups(const Graph& graph) {
+  for (const Node* n : graph.nodes()) {
+    if (!HasFusibleOpAndType(n)) continue;
+    for (const Edge* e : n->in_edges()) {
+      if (!e->IsControlEdge() && HasFusibleOpAndType(e->src())) return true;
+    }
+  }
+  return false;
+}
+
+// Sets "*shape" to the shape "handle" of "c" and returns true if it is
+// fully defined.
+bool GetFullyDefinedShape(shape_inference::InferenceContext* c,
+                          shape_inference::ShapeHandle handle,
+                          TensorShape* shape) {
+  if (!c->FullyDefined(handle)) return false;
+  shape->Clear();
+  for (int d = 0; d < c->Rank(handle); ++d) {
+    shape->AddDim(c->Value(c->Dim(handle, d)));
+  }
+  return true;
+}
+
+// The statically known shape of a tensor. Fully defined shapes compare by
+// value. Other shapes compare by the tensor they come from, which fusible
+// ops pass on to their output, so that for instance a chain of ops on a
+// batch of unknown size still has a single shape.
+struct SymbolicShape {
+  bool fully_defined = false;
+  TensorShape shape;  // If fully_defined.
+  // Otherwise, the output the shape comes from.
+  const Node* node = nullptr;
+  int output = 0;
+
+  bool operator==(const SymbolicShape& other) const {
+    if (fully_defined != other.fully_defined) return false;
+    return fully_defined ? shape == other.shape
+                         : node == other.node && output == other.output;
+  }
+};
+
+// Sets the output shapes of "n" recorded in its "_output_shapes" attr, such
+// as the declared shape of a fed placeholder, on "refiner".
+Status SetRecordedShapes(const Node* n, ShapeRefiner* refiner) {
+  std::vector<TensorShapeProto> shape_attrs;
+  if (!GetNodeAttr(n->def(), "_output_shapes", &shape_attrs).ok()) {
+    return Status::OK();
+  }
+  shape_inference::InferenceContext* c = refiner->GetContext(n);
+  for (int i = 0; i < shape_attrs.size() && i < n->num_outputs(); ++i) {
+    shape_inference::ShapeHandle handle;
+    TF_RETURN_IF_ERROR(c->MakeShapeFromShapeProto(shape_attrs[i], &handle));
+    TF_RETURN_IF_ERROR(refiner->SetShape(n, i, handle));
+  }
+  return Status::OK();
+}
+
+// Returns the fusible ops of "graph" placed on a CPU device whose inputs
+// all have the same symbolic shape, with that shape.
+std::unordered_map<const Node*, SymbolicShape> FusionCandidates(
+    const Graph& graph) {
+  ShapeRefiner refiner(graph.op_registry());
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+  for (const Node* n : order) {
+    if (!n->IsOp()) continue;
+    // The shapes of nodes that fail, and of all nodes downstream of them,
+    // remain unknown.
+    Status s = refiner.AddNode(n);
+    if (s.ok()) s = SetRecordedShapes(n, &refiner);
+    if (!s.ok()) VLOG(2) << "No shapes for " << n->name() << ": " << s;
+  }
+  std::unordered_map<const Node*, std::vector<SymbolicShape>> output_shapes;
+  std::unordered_map<const Node*, SymbolicShape> candidates;
+  for (const Node* n : order) {
+    if (!n->IsOp()) continue;
+    std::vector<SymbolicShape>& outputs = output_shapes[n];
+    if (HasFusibleOpAndType(n) && IsOnCPU(n)) {
+      std::vector<const SymbolicShape*> inputs(n->num_inputs(), nullptr);
+      for (const Edge* e : n->in_edges()) {
+        if (e->IsControlEdge()) continue;
+        auto it = output_shapes.find(e->src());
+        if (it != output_shapes.end() && e->src_output() < it->second.size()) {
+          inputs[e->dst_input()] = &it->second[e->src_output()];
+        }
+      }
+      bool same_shapes = true;
+      for (const SymbolicShape* input : inputs) {
+        same_shapes = same_shapes && input != nullptr && *input == *inputs[0];
+      }
+      if (same_shapes) {
+        candidates.emplace(n, *inputs[0]);
+        outputs.push_back(*inputs[0]);
+        continue;
+      }
+    }
+    shape_inference::InferenceContext* c = refiner.GetContext(n);
+    for (int i = 0; i < n->num_outputs(); ++i) {
+      SymbolicShape shape;
+      shape.fully_defined =
+          c != nullptr && GetFullyDefinedShape(c, c->output(i), &shape.shape);
+      if (!shape.fully_defined) {
+        shape.node = n;
+        shape.output = i;
+      }
+      outputs.push_back(shape);
+    }
+  }
+  return candidates;
+}
+
+// A group of ops to fuse, and the program of the fused node.
+class FusionGroup {
+ public:
+  FusionGroup(const std::unordered_map<const Node*, SymbolicShape>& candidates,
+              std::unordered_set<const Node*>* fused)
+      : candidates_(candidates), fused_(fused) {}
+
+  // Adds "root" and the ops it can absorb to the group.
+  void Build(Node* root) {
+    root_ = root;
+    fused_->insert(root);
+    num_nodes_ = 1;
+    AddNode(root);
+    const int num_inputs = inputs_.size();
+    for (int i = 0; i < operands_.size(); ++i) {
+      // Op results were numbered from -1 down so far.
+      if (operands_[i] < -1) operands_[i] = num_inputs - operands_[i] - 2;
+    }
+  }
+
+  // Replaces the group by a _FusedElementwise node, which takes the name
+  // of the root. Returns true on success.
+  bool Fuse(Graph* graph) {
+    const DataType dtype = root_->output_type(0);
+    std::vector<NodeDefBuilder::NodeOut> inputs;
+    for (const auto& input : inputs_) {
+      inputs.emplace_back(input.first->name(), input.second, dtype);
+    }
+    NodeDefBuilder builder(root_->name(), "_FusedElementwise");
+    builder.Input(inputs)
+        .Attr("T", dtype)
+        .Attr("ops", ops_)
+        .Attr("operands", operands_)
+        .Device(root_->def().device());
+    std::vector<Node*> control_inputs;
+    std::unordered_set<Node*> seen;
+    for (Node* n : nodes_) {
+      for (const Edge* e : n->in_edges()) {
+        if (e->IsControlEdge() && seen.insert(e->src()).second) {
+          control_inputs.push_back(e->src());
+          builder.ControlInput(e->src()->name());
+        }
+      }
+    }
+    NodeDef def;
+    Status s = builder.Finalize(&def);
+    if (!s.ok()) {
+      LOG(WARNING) << "Could not fuse the elementwise ops ending at "
+                   << root_->name() << ": " << s;
+      return false;
+    }
+
+    std::vector<std::pair<Node*, int>> outputs;
+    for (const Edge* e : root_->out_edges()) {
+      outputs.emplace_back(e->dst(), e->dst_input());
+    }
+    const string assigned_device = root_->assigned_device_name();
+    for (Node* n : nodes_) graph->RemoveNode(n);
+    Node* fused_node = graph->AddNode(def, &s);
+    TF_CHECK_OK(s);
+    fused_node->set_assigned_device_name(assigned_device);
+    for (int i = 0; i < inputs_.size(); ++i) {
+      graph->AddEdge(inputs_[i].first, inputs_[i].second, fused_node, i);
+    }
+    for (Node* n : control_inputs) {
+      graph->AddControlEdge(n, fused_node);
+    }
+    for (const auto& output : outputs) {
+      graph->AddEdge(fused_node,
+                     output.second == Graph::kControlSlot ? Graph::kControlSlot
+                                                          : 0,
+                     output.first, output.second);
+    }
+    return true;
+  }
+
+  int num_nodes() const { return nodes_.size(); }
+
+ private:
+  // Returns true if "n" may join the group as the producer of an input of
+  // a node of the group.
+  bool CanAbsorb(const Node* n) const {
+    if (num_nodes_ >= kMaxFusedOps || fused_->count(n) > 0) return false;
+    auto it = candidates_.find(n);
+    // The group is only connected to the rest of the graph by the inputs
+    // of its nodes and the outputs of the root.
+    return it != candidates_.end() && n->out_edges().size() == 1 &&
+           it->second == candidates_.at(root_) &&
+           n->assigned_device_name() == root_->assigned_device_name() &&
+           n->output_type(0) == root_->output_type(0);
+  }
+
+  // Adds "n", and recursively the producers of its inputs it absorbs, to
+  // the program. Returns the value number of the result of "n".
+  int AddNode(Node* n) {
+    std::vector<const Edge*> edges(n->num_inputs(), nullptr);
+    for (const Edge* e : n->in_edges()) {
+      if (!e->IsControlEdge()) edges[e->dst_input()] = e;
+    }
+    int operands[2] = {-1, -1};
+    for (int i = 0; i < edges.size(); ++i) {
+      Node* src = edges[i]->src();
+      if (CanAbsorb(src)) {
+        fused_->insert(src);
+        ++num_nodes_;
+        operands[i] = AddNode(src);
+      } else {
+        operands[i] = InputNumber(src, edges[i]->src_output());
+      }
+    }
+    nodes_.push_back(n);
+    ops_.push_back(n->type_string());
+    operands_.push_back(operands[0]);
+    operands_.push_back(operands[1]);
+    // Numbered -2, -3, ... until the number of inputs is known.
+    return -1 - static_cast<int>(ops_.size());
+  }
+
+  int InputNumber(Node* src, int output) {
+    for (int i = 0; i < inputs_.size(); ++i) {
+      if (inputs_[i].first == src && inputs_[i].second == output) return i;
+    }
+    inputs_.emplace_back(src, output);
+    return inputs_.size() - 1;
+  }
+
+  const std::unordered_map<const Node*, SymbolicShape>& candidates_;
+  std::unordered_set<const Node*>* fused_;
+  Node* root_ = nullptr;
+  int num_nodes_ = 0;
+
+  std::vector<Node*> nodes_;  // In evaluation order.
+  std::vector<std::pair<Node*, int>> inputs_;
+  std::vector<string> ops_;
+  std::vector<int> operands_;
+};
+
+}  // namespace
+
+bool FuseElementwiseOps(Graph* graph) {
+  if (!MayHaveFusibleGroups(*graph)) return false;
+  const std::unordered_map<const Node*, SymbolicShape> candidates =
+      FusionCandidates(*graph);
+  // Consumers come before their producers, so that each group is rooted
+  // at its last op.
+  std::vector<Node*> order;
+  GetPostOrder(*graph, &order);
+  std::unordered_set<const Node*> fused;
+  std::vector<std::unique_ptr<FusionGroup>> groups;
+  for (Node* n : order) {
+    if (fused.count(n) > 0 || candidates.count(n) == 0) continue;
+    std::unique_ptr<FusionGroup> group(new FusionGroup(candidates, &fused));
+    group->Build(n);
+    if (group->num_nodes() > 1) groups.push_back(std::move(group));
+  }
+  bool changed = false;
+  for (const auto& group : groups) {
+    if (group->Fuse(graph)) changed = true;
+  }
+  return changed;
+}
+
+namespace {
+
+class ElementwiseFusionPass : public GraphOptimizationPass {
+ public:
+  Status Run(const GraphOptimizationPassOptions& options) override {
+    if (options.session_options == nullptr ||
+        !options.session_options->config.graph_options()
+             .optimizer_options()
+             .do_elementwise_fusion()) {
+      return Status::OK();
+    }
+    if (FuseElementwiseOps(options.graph->get())) {
+      VLOG(1) << "Fused elementwise ops";
+    }
+    return Status::OK();
+  }
+};
+
+REGISTER_OPTIMIZATION(OptimizationPassRegistry::POST_REWRITE_FOR_EXEC, 0,
+                      ElementwiseFusionPass);
+
+}  // namespace
+
+}  // namespace tensorflow
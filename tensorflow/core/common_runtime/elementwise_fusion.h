@@ -0,0 +1,42 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMMON_RUNTIME_ELEMENTWISE_FUSION_H_
+#define TENSORFLOW_COMMON_RUNTIME_ELEMENTWISE_FUSION_H_
+
+#include "tensorflow/core/graph/graph.h"
+
+namespace tensorflow {
+
+// Replaces each maximal group of connected elementwise float or double
+// ops in "*graph" by a single _FusedElementwise node, which evaluates the
+// group in one pass over its inputs. A group only contains ops that are
+// assigned to the same CPU device and whose inputs and output all have the
+// same statically inferred shape, and only ops whose output is used by
+// nothing but the next op of the group, other than the last op. Shapes
+// that are not fully defined are the same if they come from the same
+// tensor, such as a fed input with an unknown batch dimension. The fused
+// node takes the name of the last op, and checks the shapes of its inputs
+// when it runs.
+//
+// Returns true if and only if "graph" is mutated.
+//
+// This is run as a POST_REWRITE_FOR_EXEC optimization pass if
+// OptimizerOptions.do_elementwise_fusion is set.
+bool FuseElementwiseOps(Graph* graph);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMMON_RUNTIME_ELEMENTWISE_FUSION_H_
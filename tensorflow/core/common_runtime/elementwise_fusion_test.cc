@@ -0,0 +1,215 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/elementwise_fusion.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+const char* const kCPU = "/job:localhost/replica:0/task:0/cpu:0";
+
+class ElementwiseFusionTest : public ::testing::Test {
+ protected:
+  ElementwiseFusionTest() : g_(new Graph(OpRegistry::Global())) {}
+
+  Node* Input(const TensorShape& shape) {
+    return test::graph::Constant(g_.get(), Tensor(DT_FLOAT, shape));
+  }
+
+  // Places all nodes on "device" and runs the fusion.
+  bool Fuse(const string& device = kCPU) {
+    for (Node* n : g_->nodes()) {
+      if (n->IsOp()) n->set_assigned_device_name(device);
+    }
+    FixupSourceAndSinkEdges(g_.get());
+    return FuseElementwiseOps(g_.get());
+  }
+
+  Node* FindNode(const string& name) {
+    for (Node* n : g_->nodes()) {
+      if (n->name() == name) return n;
+    }
+    return nullptr;
+  }
+
+  int NumNodes(const string& op) {
+    int count = 0;
+    for (const Node* n : g_->nodes()) {
+      if (n->type_string() == op) ++count;
+    }
+    return count;
+  }
+
+  std::unique_ptr<Graph> g_;
+};
+
+TEST_F(ElementwiseFusionTest, FusesChain) {
+  Node* x = Input({2, 3});
+  Node* y = Input({2, 3});
+  Node* add = test::graph::Binary(g_.get(), "Add", x, y);
+  Node* relu = test::graph::Unary(g_.get(), "Relu", add);
+  Node* mul = test::graph::Binary(g_.get(), "Mul", relu, y);
+  Node* sigmoid = test::graph::Unary(g_.get(), "Sigmoid", mul);
+  const string name = sigmoid->name();
+  Node* out = test::graph::Identity(g_.get(), sigmoid);
+  Node* after = test::graph::NoOp(g_.get(), {sigmoid});
+
+  EXPECT_TRUE(Fuse());
+  EXPECT_EQ(0, NumNodes("Add") + NumNodes("Relu") + NumNodes("Mul") +
+                   NumNodes("Sigmoid"));
+  Node* fused = FindNode(name);
+  ASSERT_NE(nullptr, fused);
+  EXPECT_EQ("_FusedElementwise", fused->type_string());
+  EXPECT_EQ(kCPU, fused->assigned_device_name());
+  std::vector<string> ops;
+  TF_EXPECT_OK(GetNodeAttr(fused->def(), "ops", &ops));
+  EXPECT_EQ(std::vector<string>({"Add", "Relu", "Mul", "Sigmoid"}), ops);
+  std::vector<int32> operands;
+  TF_EXPECT_OK(GetNodeAttr(fused->def(), "operands", &operands));
+  EXPECT_EQ(std::vector<int32>({0, 1, 2, -1, 3, 1, 4, -1}), operands);
+
+  ASSERT_EQ(2, fused->num_inputs());
+  std::vector<const Node*> inputs(2);
+  for (const Edge* e : fused->in_edges()) inputs[e->dst_input()] = e->src();
+  EXPECT_EQ(x, inputs[0]);
+  EXPECT_EQ(y, inputs[1]);
+  int num_data_outputs = 0;
+  int num_control_outputs = 0;
+  for (const Edge* e : fused->out_edges()) {
+    if (e->IsControlEdge()) {
+      EXPECT_EQ(after, e->dst());
+      ++num_control_outputs;
+    } else {
+      EXPECT_EQ(out, e->dst());
+      ++num_data_outputs;
+    }
+  }
+  EXPECT_EQ(1, num_data_outputs);
+  EXPECT_EQ(1, num_control_outputs);
+}
+
+TEST_F(ElementwiseFusionTest, FusesTree) {
+  // (x + y) * (x - y)
+  Node* x = Input({4});
+  Node* y = Input({4});
+  Node* add = test::graph::Binary(g_.get(), "Add", x, y);
+  Node* sub = test::graph::Binary(g_.get(), "Sub", x, y);
+  Node* mul = test::graph::Binary(g_.get(), "Mul", add, sub);
+  test::graph::Identity(g_.get(), mul);
+
+  EXPECT_TRUE(Fuse());
+  Node* fused = FindNode(mul->name());
+  ASSERT_NE(nullptr, fused);
+  std::vector<string> ops;
+  TF_EXPECT_OK(GetNodeAttr(fused->def(), "ops", &ops));
+  EXPECT_EQ(std::vector<string>({"Add", "Sub", "Mul"}), ops);
+  std::vector<int32> operands;
+  TF_EXPECT_OK(GetNodeAttr(fused->def(), "operands", &operands));
+  EXPECT_EQ(std::vector<int32>({0, 1, 0, 1, 2, 3}), operands);
+}
+
+TEST_F(ElementwiseFusionTest, KeepsOpsWithOtherConsumers) {
+  Node* x = Input({2, 3});
+  Node* add = test::graph::Binary(g_.get(), "Add", x, x);
+  Node* relu = test::graph::Unary(g_.get(), "Relu", add);
+  test::graph::Identity(g_.get(), relu);
+  // The result of "add" is also needed on its own.
+  test::graph::Identity(g_.get(), add);
+
+  EXPECT_FALSE(Fuse());
+  EXPECT_EQ(1, NumNodes("Add"));
+  EXPECT_EQ(1, NumNodes("Relu"));
+}
+
+TEST_F(ElementwiseFusionTest, StopsAtBroadcast) {
+  Node* x = Input({2, 3});
+  Node* bias = Input({3});
+  Node* add = test::graph::Binary(g_.get(), "Add", x, bias);
+  Node* tanh = test::graph::Unary(g_.get(), "Tanh", add);
+  Node* relu = test::graph::Unary(g_.get(), "Relu", tanh);
+  test::graph::Identity(g_.get(), relu);
+
+  EXPECT_TRUE(Fuse());
+  EXPECT_EQ(1, NumNodes("Add"));
+  EXPECT_EQ(1, NumNodes("_FusedElementwise"));
+  std::vector<string> ops;
+  TF_EXPECT_OK(GetNodeAttr(FindNode(relu->name())->def(), "ops", &ops));
+  EXPECT_EQ(std::vector<string>({"Tanh", "Relu"}), ops);
+}
+
+TEST_F(ElementwiseFusionTest, FusesUnknownShapes) {
+  Node* x = test::graph::Recv(g_.get(), "x", "float", "sender", 0, "receiver");
+  Node* relu = test::graph::Unary(g_.get(), "Relu", x);
+  Node* add = test::graph::Binary(g_.get(), "Add", relu, x);
+  Node* tanh = test::graph::Unary(g_.get(), "Tanh", add);
+  test::graph::Identity(g_.get(), tanh);
+
+  EXPECT_TRUE(Fuse());
+  std::vector<string> ops;
+  TF_EXPECT_OK(GetNodeAttr(FindNode(tanh->name())->def(), "ops", &ops));
+  EXPECT_EQ(std::vector<string>({"Relu", "Add", "Tanh"}), ops);
+}
+
+TEST_F(ElementwiseFusionTest, RequiresSameShapes) {
+  // The unknown shapes of "x" and "y" may differ.
+  Node* x = test::graph::Recv(g_.get(), "x", "float", "sender", 0, "receiver");
+  Node* y = test::graph::Recv(g_.get(), "y", "float", "sender", 0, "receiver");
+  Node* add = test::graph::Binary(g_.get(), "Add", x, y);
+  Node* relu = test::graph::Unary(g_.get(), "Relu", add);
+  test::graph::Identity(g_.get(), relu);
+
+  EXPECT_FALSE(Fuse());
+}
+
+TEST_F(ElementwiseFusionTest, UsesRecordedShapes) {
+  // As recorded on the _Recv of a fed placeholder.
+  Node* x = test::graph::Recv(g_.get(), "x", "float", "sender", 0, "receiver");
+  x->AddAttr("_output_shapes",
+             std::vector<PartialTensorShape>({PartialTensorShape({2, 3})}));
+  Node* y = Input({2, 3});
+  Node* add = test::graph::Binary(g_.get(), "Add", x, y);
+  Node* relu = test::graph::Unary(g_.get(), "Relu", add);
+  test::graph::Identity(g_.get(), relu);
+
+  EXPECT_TRUE(Fuse());
+  std::vector<string> ops;
+  TF_EXPECT_OK(GetNodeAttr(FindNode(relu->name())->def(), "ops", &ops));
+  EXPECT_EQ(std::vector<string>({"Add", "Relu"}), ops);
+}
+
+TEST_F(ElementwiseFusionTest, OnlyFusesOnCPU) {
+  Node* x = Input({2, 3});
+  Node* relu = test::graph::Unary(g_.get(), "Relu", x);
+  Node* tanh = test::graph::Unary(g_.get(), "Tanh", relu);
+  test::graph::Identity(g_.get(), tanh);
+
+  EXPECT_FALSE(Fuse("/job:localhost/replica:0/task:0/gpu:0"));
+}
+
+}  // namespace
+}  // namespace tensorflow
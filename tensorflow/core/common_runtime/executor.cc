@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/executor.h"
 
+#include <algorithm>
 #include <atomic>
 #include <deque>
 #include <memory>
@@ -24,7 +25,9 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/costmodel_manager.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
+#include "tensorflow/core/common_runtime/step_memory_planner.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
+#include "tensorflow/core/common_runtime/work_stealing_queue.h"
 #include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
@@ -40,6 +43,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_reference.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/edgeset.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
@@ -53,6 +57,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/tracing.h"
@@ -203,6 +208,11 @@ struct NodeItem {
   // positional attribute for the 0th output of this node.
   int output_attr_start = 0;
 
+  // The weighted length of the longest path from this node to a sink.
+  // Only computed when the executor uses work stealing, where nodes
+  // with a higher priority are run first.
+  int64 priority = 0;
+
   DataType input_type(int i) const {
     DCHECK_LT(i, num_inputs);
     return (i < 4) ? inlined_input_type[i] : node->input_type(i);
@@ -247,9 +257,10 @@ class ExecutorImpl : public Executor {
   // connected to n by a single edge, but might be a downstream
   // consumer of n's output by reference.  *attr is updated with any
   // necessary attributes.
-  Status InferAllocAttr(const Node* n, const Node* dst,
-                        const DeviceNameUtils::ParsedName& local_dev_name,
-                        AllocatorAttributes* attr);
+  static Status InferAllocAttr(
+      const Node* n, const Node* dst,
+      const DeviceNameUtils::ParsedName& local_dev_name,
+      AllocatorAttributes* attr);
 
   // Process all Nodes in the current graph, attempting to infer the
   // memory allocation attributes to be used wherever they may allocate
@@ -296,6 +307,10 @@ class ExecutorImpl : public Executor {
                                      ControlFlowInfo* cf_info);
   void InitializePending(const Graph* graph, const ControlFlowInfo& cf_info);
 
+  // Computes nodes_[*].priority, the critical-path priority used by the
+  // work-stealing scheduler.
+  void InitializePriorities();
+
   FrameInfo* EnsureFrameInfo(const string& fname) {
     auto slot = &frame_info_[fname];
     if (*slot == nullptr) {
@@ -316,6 +331,10 @@ class ExecutorImpl : public Executor {
   // Root nodes (with no in edges) that should form the initial ready queue
   std::vector<const Node*> root_nodes_;
 
+  // The number of per-worker ready deques each ExecutorState creates.
+  // 0 iff the executor does not use work stealing.
+  int num_worker_queues_ = 0;
+
   std::vector<AllocatorAttributes> output_attrs_;
 
   // Mapping from frame name to static information about the frame.
@@ -408,9 +427,42 @@ Status ExecutorImpl::Initialize() {
   // Initialize PendingCounts only after frame_local_ids_ is initialized.
   InitializePending(graph_, cf_info);
 
+  if (params_.use_work_stealing) {
+    num_worker_queues_ = params_.max_workers > 0 ? params_.max_workers
+                                                 : port::NumSchedulableCPUs();
+    InitializePriorities();
+  }
+
   return SetAllocAttrs();
 }
 
+void ExecutorImpl::InitializePriorities() {
+  // An expensive node counts as this many inexpensive ones on a path.
+  static const int64 kExpensiveNodeWeight = 10;
+
+  // In post order every node comes after its successors, except for the
+  // targets of back edges (NextIteration -> Merge), which we skip so
+  // that loops contribute their body once.
+  std::vector<Node*> order;
+  GetPostOrder(*graph_, &order);
+  std::vector<int> position(graph_->num_node_ids(), -1);
+  for (size_t i = 0; i < order.size(); ++i) {
+    position[order[i]->id()] = i;
+  }
+  for (const Node* n : order) {
+    const int id = n->id();
+    int64 max_successor = 0;
+    for (const Edge* e : n->out_edges()) {
+      const int dst_id = e->dst()->id();
+      if (position[dst_id] > position[id]) continue;
+      max_successor = std::max(max_successor, nodes_[dst_id].priority);
+    }
+    NodeItem* item = &nodes_[id];
+    item->priority =
+        max_successor + (item->kernel_is_expensive ? kExpensiveNodeWeight : 1);
+  }
+}
+
 Status ExecutorImpl::SetAllocAttrs() {
   Status s;
   Device* device = params_.device;
@@ -815,6 +867,7 @@ class ExecutorState {
     int64 input_iter = -1;
     bool is_dead = false;
 
+    TaggedNode() {}
     TaggedNode(const Node* t_node, FrameState* in_frame, int64 in_iter,
                bool dead) {
       node = t_node;
@@ -861,6 +914,8 @@ class ExecutorState {
 
   struct AsyncState;
 
+  typedef WorkStealingQueue<TaggedNode> WorkerQueue;
+
   const bool vlog_;  // true if VLOG_IS_ON(1). Used to check vlog cheaply.
 
   // true if LogMemory::IsEnabled(). Used to check memory enabled cheaply.
@@ -873,6 +928,8 @@ class ExecutorState {
   TensorStore* tensor_store_;
   // Step-local resource manager.
   ResourceMgr* step_resource_manager_;
+  // The planned allocator of the step, or nullptr.
+  Allocator* step_allocator_;
   StepStatsCollector* stats_collector_;
   // QUESTION: Make it a checkpoint::TensorSliceReaderCacheWrapper
   // instead of a pointer?  (avoids having to delete).
@@ -896,6 +953,19 @@ class ExecutorState {
 
   std::atomic_int_fast32_t num_outstanding_ops_;
 
+  // Work-stealing state. Only used if impl_->num_worker_queues_ > 0.
+  //
+  // Every worker owns worker_queues_[i] for some i, runs nodes from it
+  // and, once it is empty, steals from the other queues.
+  // "num_active_workers_" counts the workers currently running;
+  // "num_worker_refs_" holds one reference for the step itself plus
+  // one for every started worker, and the step is finished when it
+  // drops to zero, so that no worker touches a deleted ExecutorState.
+  std::vector<std::unique_ptr<WorkerQueue>> worker_queues_;
+  std::atomic<int> next_worker_queue_;
+  std::atomic<int> num_active_workers_;
+  std::atomic<int> num_worker_refs_;
+
   mutex mu_;
   Status status_ GUARDED_BY(mu_);
 
@@ -934,8 +1004,10 @@ class ExecutorState {
   void CleanupFramesIterations(FrameState* frame, int64 iter,
                                TaggedNodeSeq* ready);
 
-  // Process a ready node in current thread.
-  void Process(TaggedNode node, int64 scheduled_usec);
+  // Process a ready node in current thread. "worker" is the index of
+  // the calling worker's queue when using work stealing, and -1
+  // otherwise.
+  void Process(TaggedNode node, int64 scheduled_usec, int worker);
 
   // Before invoking item->kernel, fills in its "inputs".
   Status PrepareInputs(const NodeItem& item, Entry* first_input,
@@ -955,12 +1027,51 @@ class ExecutorState {
   // "node" just finishes. Takes ownership of "stats". Returns true if
   // execution has completed.
   bool NodeDone(const Status& s, const Node* node, const TaggedNodeSeq& ready,
-                NodeExecStats* stats, TaggedNodeReadyQueue* inline_ready);
+                NodeExecStats* stats, TaggedNodeReadyQueue* inline_ready,
+                int worker);
 
   // Schedule all the expensive nodes in 'ready', and put all the inexpensive
   // nodes in 'ready' into 'inline_ready'.
   void ScheduleReady(const TaggedNodeSeq& ready,
-                     TaggedNodeReadyQueue* inline_ready);
+                     TaggedNodeReadyQueue* inline_ready, int worker);
+
+  // The work-stealing version of ScheduleReady(). Puts the ready node with
+  // the highest priority into 'inline_ready' (if it is not null), the rest
+  // into the queue of 'worker' (or some queue if 'worker' is -1), and
+  // starts idle workers to steal them.
+  void ScheduleReadyWorkStealing(const TaggedNodeSeq& ready,
+                                 TaggedNodeReadyQueue* inline_ready,
+                                 int worker, int64 scheduled_usec);
+
+  // Takes the next node from the queue of 'worker', or steals one from
+  // another worker. Returns false if all the queues are empty.
+  bool PopOrSteal(int worker, TaggedNode* node);
+
+  // Returns true if any worker queue is non-empty.
+  bool HasQueuedNodes() const;
+
+  // Reserves a slot for a new active worker. Returns false if
+  // impl_->num_worker_queues_ workers are already active.
+  bool ReserveWorker();
+
+  // Starts up to 'n' new workers, as long as there are idle slots.
+  void StartWorkers(int n, int64 scheduled_usec);
+
+  // The body of a work-stealing worker.
+  void RunWorker(int worker, int64 scheduled_usec);
+
+  // Drops a reference on num_worker_refs_, and calls Finish() when it
+  // was the last one.
+  void UnrefWorkers();
+
+  // Called when the last node of the step is done.
+  void StepCompleted() {
+    if (worker_queues_.empty()) {
+      Finish();
+    } else {
+      UnrefWorkers();
+    }
+  }
 
   // For debugging/logging only.
   inline void MaybeMarkCompleted(FrameState* frame, int64 iter, int64 id);
@@ -999,13 +1110,21 @@ ExecutorState::ExecutorState(const Executor::Args& args, ExecutorImpl* impl)
       session_state_(args.session_state),
       tensor_store_(args.tensor_store),
       step_resource_manager_(args.step_resource_manager),
+      step_allocator_(StepMemoryPlanner::LookupStepAllocator(
+          args.step_resource_manager, impl->params_.device->name())),
       stats_collector_(args.stats_collector),
       slice_reader_cache_(new checkpoint::TensorSliceReaderCacheWrapper),
       call_frame_(args.call_frame),
       impl_(impl),
       cancellation_manager_(args.cancellation_manager),
       runner_(args.runner),
-      num_outstanding_ops_(0) {
+      num_outstanding_ops_(0),
+      next_worker_queue_(0),
+      num_active_workers_(0),
+      num_worker_refs_(1) {
+  for (int i = 0; i < impl_->num_worker_queues_; ++i) {
+    worker_queues_.emplace_back(new WorkerQueue);
+  }
   // We start the entire execution in iteration 0 of the root frame
   // so let us create the root frame and the state for iteration 0.
   // We assume root_frame_->frame_name.empty().
@@ -1153,7 +1272,7 @@ void ExecutorState::RunAsync(Executor::DoneCallback done) {
     root_frame_->iterations[0]->outstanding_ops = ready.size();
     done_cb_ = done;
     // Schedule to run all the ready ops in thread pool.
-    ScheduleReady(ready, nullptr);
+    ScheduleReady(ready, nullptr, -1);
   }
 }
 
@@ -1202,7 +1321,8 @@ struct ExecutorState::AsyncState {
   }
 };
 
-void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
+void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec,
+                            int worker) {
   const NodeItem* nodes = impl_->nodes_;
   TaggedNodeSeq ready;
   TaggedNodeReadyQueue inline_ready;
@@ -1226,6 +1346,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
   params.function_library = impl_->params_.function_library;
   params.resource_manager = device->resource_manager();
   params.step_resource_manager = step_resource_manager_;
+  params.step_allocator = step_allocator_;
   params.slice_reader_cache = slice_reader_cache_;
   params.inputs = &inputs;
   params.input_device_contexts = &input_device_contexts;
@@ -1300,7 +1421,12 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
         }
         MaybeMarkCompleted(input_frame, input_iter, id);
         // Continue to process the nodes in 'inline_ready'.
-        completed = NodeDone(s, item.node, ready, stats, &inline_ready);
+        completed =
+            NodeDone(s, item.node, ready, stats, &inline_ready, worker);
+        if (inline_ready.empty() && worker >= 0 &&
+            PopOrSteal(worker, &tagged_node)) {
+          inline_ready.push_back(tagged_node);
+        }
         continue;
       }
 
@@ -1356,9 +1482,10 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
             device->ConsumeListOfAccessedTensors(state->ctx.op_device_context(),
                                                  accessed);
           }
-          bool completed = NodeDone(s, state->item.node, ready, stats, nullptr);
+          bool completed =
+              NodeDone(s, state->item.node, ready, stats, nullptr, -1);
           delete state;
-          if (completed) Finish();
+          if (completed) StepCompleted();
         };
         if (stats) nodestats::SetOpStart(stats);
         device->ComputeAsync(async, &state->ctx, done);
@@ -1400,12 +1527,22 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
         scheduled_usec = nodestats::NowInUsec();
       }
       // Postprocess.
-      completed = NodeDone(s, item.node, ready, stats, &inline_ready);
+      completed = NodeDone(s, item.node, ready, stats, &inline_ready, worker);
+    }
+
+    // A work-stealing worker keeps going with the next node in its own
+    // queue, or with one stolen from another worker.
+    if (inline_ready.empty() && worker >= 0 &&
+        PopOrSteal(worker, &tagged_node)) {
+      if (stats_collector_) {
+        scheduled_usec = nodestats::NowInUsec();
+      }
+      inline_ready.push_back(tagged_node);
     }
   }  // while !inline_ready.empty()
 
   // This thread of computation is done if completed = true.
-  if (completed) Finish();
+  if (completed) StepCompleted();
 }
 
 Status ExecutorState::PrepareInputs(const NodeItem& item, Entry* first_input,
@@ -1693,7 +1830,7 @@ void ExecutorState::PropagateOutputs(const TaggedNode& tagged_node,
 
 bool ExecutorState::NodeDone(const Status& s, const Node* node,
                              const TaggedNodeSeq& ready, NodeExecStats* stats,
-                             TaggedNodeReadyQueue* inline_ready) {
+                             TaggedNodeReadyQueue* inline_ready, int worker) {
   if (stats) {
     nodestats::SetAllEnd(stats);
     if (!SetTimelineLabel(node, stats)) {
@@ -1732,23 +1869,28 @@ bool ExecutorState::NodeDone(const Status& s, const Node* node,
 
   // Schedule the ready nodes in 'ready'.
   if (s.ok()) {
-    ScheduleReady(ready, inline_ready);
+    ScheduleReady(ready, inline_ready, worker);
   }
   return completed;
 }
 
 void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
-                                  TaggedNodeReadyQueue* inline_ready) {
+                                  TaggedNodeReadyQueue* inline_ready,
+                                  int worker) {
   if (ready.empty()) return;
 
   int64 scheduled_usec = 0;
   if (stats_collector_) {
     scheduled_usec = nodestats::NowInUsec();
   }
+  if (!worker_queues_.empty()) {
+    ScheduleReadyWorkStealing(ready, inline_ready, worker, scheduled_usec);
+    return;
+  }
   if (inline_ready == nullptr) {
     // Schedule to run all the ready ops in thread pool.
     for (auto& tagged_node : ready) {
-      runner_([=]() { Process(tagged_node, scheduled_usec); });
+      runner_([=]() { Process(tagged_node, scheduled_usec, -1); });
     }
     return;
   }
@@ -1764,7 +1906,7 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
         // Dispatch to another thread since there is plenty of work to
         // do for this thread.
         runner_(std::bind(&ExecutorState::Process, this, *curr_expensive_node,
-                          scheduled_usec));
+                          scheduled_usec, -1));
       }
       curr_expensive_node = &tagged_node;
     }
@@ -1777,11 +1919,103 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
       // There are inline nodes to run already. We dispatch this expensive
       // node to other thread.
       runner_(std::bind(&ExecutorState::Process, this, *curr_expensive_node,
-                        scheduled_usec));
+                        scheduled_usec, -1));
     }
   }
 }
 
+void ExecutorState::ScheduleReadyWorkStealing(
+    const TaggedNodeSeq& ready, TaggedNodeReadyQueue* inline_ready, int worker,
+    int64 scheduled_usec) {
+  const NodeItem* nodes = impl_->nodes_;
+  // Order by increasing priority: the most critical node is run next by
+  // this worker, and the least critical ones are stolen first.
+  TaggedNodeSeq sorted(ready);
+  std::sort(sorted.begin(), sorted.end(),
+            [nodes](const TaggedNode& a, const TaggedNode& b) {
+              return nodes[a.node->id()].priority <
+                     nodes[b.node->id()].priority;
+            });
+  if (inline_ready != nullptr && inline_ready->empty()) {
+    // Keep the successor on this core.
+    inline_ready->push_back(sorted.back());
+    sorted.pop_back();
+    if (sorted.empty()) return;
+  }
+  if (worker < 0) {
+    worker = next_worker_queue_.fetch_add(1, std::memory_order_relaxed) %
+             worker_queues_.size();
+  }
+  worker_queues_[worker]->PushBack(sorted.begin(), sorted.end());
+  // Wake up idle workers, if any, to steal the surplus. The push above
+  // happens before the check for idle workers in ReserveWorker(), which
+  // pairs with the re-check in RunWorker() after a worker goes idle.
+  StartWorkers(sorted.size(), scheduled_usec);
+}
+
+bool ExecutorState::PopOrSteal(int worker, TaggedNode* node) {
+  if (worker_queues_[worker]->PopBack(node)) return true;
+  const int num_queues = worker_queues_.size();
+  for (int i = 1; i < num_queues; ++i) {
+    if (worker_queues_[(worker + i) % num_queues]->Steal(node)) return true;
+  }
+  return false;
+}
+
+bool ExecutorState::HasQueuedNodes() const {
+  for (const auto& queue : worker_queues_) {
+    if (!queue->Empty()) return true;
+  }
+  return false;
+}
+
+bool ExecutorState::ReserveWorker() {
+  int active = num_active_workers_.load();
+  while (active < impl_->num_worker_queues_) {
+    if (num_active_workers_.compare_exchange_weak(active, active + 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ExecutorState::StartWorkers(int n, int64 scheduled_usec) {
+  for (int i = 0; i < n && ReserveWorker(); ++i) {
+    num_worker_refs_.fetch_add(1, std::memory_order_relaxed);
+    const int worker =
+        next_worker_queue_.fetch_add(1, std::memory_order_relaxed) %
+        worker_queues_.size();
+    runner_([this, worker, scheduled_usec]() {
+      RunWorker(worker, scheduled_usec);
+    });
+  }
+}
+
+void ExecutorState::RunWorker(int worker, int64 scheduled_usec) {
+  TaggedNode tagged_node;
+  while (true) {
+    if (PopOrSteal(worker, &tagged_node)) {
+      Process(tagged_node, scheduled_usec, worker);
+      if (stats_collector_) {
+        scheduled_usec = nodestats::NowInUsec();
+      }
+      continue;
+    }
+    num_active_workers_.fetch_sub(1);
+    // A node may have been queued after our last scan by a thread that
+    // still counted this worker as active, and therefore did not start a
+    // new one. Go back to work if so.
+    if (!HasQueuedNodes() || !ReserveWorker()) break;
+  }
+  UnrefWorkers();
+}
+
+void ExecutorState::UnrefWorkers() {
+  if (num_worker_refs_.fetch_sub(1) == 1) {
+    Finish();
+  }
+}
+
 inline void ExecutorState::MaybeMarkCompleted(FrameState* frame, int64 iter,
                                               int64 node_id) {
   // TODO(misard) Replace with a finer-grain enabling flag once we
@@ -2241,10 +2475,630 @@ void ExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
   (new ExecutorState(args, this))->RunAsync(done);
 }
 
+// An executor for graphs without control flow, whose only asynchronous
+// kernels are Recvs of values fed before the step starts.
+//
+// At Initialize() time the graph is linearized in topological order,
+// every input of every node is resolved to the output slot that
+// produces it, and the position of the last consumer of every output
+// is recorded. A step then runs the nodes one after another in that
+// order: there are no frames or iterations, no pending counts, and
+// inputs are read in place from the producer's output slot, which is
+// released right after its last consumer has run.
+//
+// Since the nodes of a step run sequentially, this executor trades
+// inter-op parallelism for lower per-node overhead. It is meant for
+// small graphs where that overhead dominates, e.g. small-batch
+// inference.
+//
+// A node that waits on another partition or on another step, e.g. a
+// Recv from another device, a queue Dequeue or an AllReduce, would
+// block every node after it in the plan, including the ones it waits
+// for. Such graphs are left to the default executor.
+class StaticPlanExecutor : public Executor {
+ public:
+  StaticPlanExecutor(const LocalExecutorParams& p, const Graph* g)
+      : params_(p), graph_(g) {
+    CHECK(p.create_kernel != nullptr);
+    CHECK(p.delete_kernel != nullptr);
+  }
+
+  ~StaticPlanExecutor() override {
+    for (const PlanNode& pn : plan_) {
+      params_.delete_kernel(pn.kernel);
+    }
+    delete graph_;
+  }
+
+  // Returns true iff "graph" may be run by a StaticPlanExecutor on
+  // "device". Initialize() then checks its kernels.
+  static bool CanRun(const Graph* graph, Device* device);
+
+  // Sets "*can_run" to false if a kernel of the graph is asynchronous
+  // and may wait on a node that runs after it.
+  Status Initialize(bool* can_run);
+
+  void RunAsync(const Args& args, DoneCallback done) override;
+
+  // Gives up the ownership of the graph.
+  void ReleaseGraph() { graph_ = nullptr; }
+
+ private:
+  friend class StaticPlanStep;
+
+  struct PlanNode {
+    const Node* node = nullptr;
+    OpKernel* kernel = nullptr;  // Owned, via params_.delete_kernel.
+    bool kernel_is_async = false;
+    bool is_transfer = false;
+    bool is_control_trigger = false;
+    int num_inputs = 0;
+    int num_outputs = 0;
+
+    // input_slots_[input_start + i] is the output slot read by the i-th
+    // input of this node.
+    int input_start = 0;
+
+    // control_inputs_[control_start, control_start + num_control_inputs)
+    // are the positions in plan_ of the control inputs of this node.
+    int control_start = 0;
+    int num_control_inputs = 0;
+
+    // The outputs of this node are in output slots [output_start,
+    // output_start + num_outputs). output_attrs_ is indexed the same way.
+    int output_start = 0;
+
+    // releases_[release_start, release_start + num_releases) are the
+    // output slots whose last consumer is this node.
+    int release_start = 0;
+    int num_releases = 0;
+  };
+
+  LocalExecutorParams params_;
+  const Graph* graph_;  // Owned.
+
+  std::vector<PlanNode> plan_;  // In topological order.
+  std::vector<int> input_slots_;
+  std::vector<int> control_inputs_;
+  std::vector<int> releases_;
+  std::vector<AllocatorAttributes> output_attrs_;
+  int num_output_slots_ = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StaticPlanExecutor);
+};
+
+// Returns true iff "n" receives a value fed by the client, which is in
+// the rendezvous before the step starts.
+static bool IsClientRecv(const Node* n) {
+  bool client_terminated = false;
+  return IsRecv(n) &&
+         GetNodeAttr(n->def(), "client_terminated", &client_terminated).ok() &&
+         client_terminated;
+}
+
+bool StaticPlanExecutor::CanRun(const Graph* graph, Device* device) {
+  if (device->RequiresRecordingAccessedTensors()) return false;
+  for (const Node* n : graph->nodes()) {
+    if (n->IsControlFlow()) return false;
+    if (IsRecv(n) && !IsClientRecv(n)) return false;
+  }
+  return true;
+}
+
+Status StaticPlanExecutor::Initialize(bool* can_run) {
+  *can_run = true;
+  std::vector<Node*> order;
+  GetReversePostOrder(*graph_, &order);
+
+  // Position in plan_ of every node id, or -1 for source/sink.
+  std::vector<int> position(graph_->num_node_ids(), -1);
+  for (const Node* n : order) {
+    if (!n->IsOp()) continue;
+    position[n->id()] = plan_.size();
+    PlanNode pn;
+    pn.node = n;
+    pn.num_inputs = n->num_inputs();
+    pn.num_outputs = n->num_outputs();
+    pn.output_start = num_output_slots_;
+    num_output_slots_ += pn.num_outputs;
+    pn.is_transfer = IsTransferNode(n);
+    pn.is_control_trigger = IsControlTrigger(n);
+    plan_.push_back(pn);
+  }
+  if (plan_.size() + 2 < static_cast<size_t>(graph_->num_nodes())) {
+    return errors::Internal("Static plan: graph has unreachable nodes");
+  }
+
+  // Resolve inputs and record the last consumer of every output slot.
+  std::vector<int> last_use(num_output_slots_, -1);
+  input_slots_.assign(graph_->num_edges(), -1);
+  int num_inputs = 0;
+  for (size_t i = 0; i < plan_.size(); ++i) {
+    PlanNode* pn = &plan_[i];
+    pn->input_start = num_inputs;
+    num_inputs += pn->num_inputs;
+    pn->control_start = control_inputs_.size();
+    for (const Edge* e : pn->node->in_edges()) {
+      const int src = position[e->src()->id()];
+      if (src < 0) continue;  // From the source node.
+      if (e->IsControlEdge()) {
+        control_inputs_.push_back(src);
+        continue;
+      }
+      const int slot = plan_[src].output_start + e->src_output();
+      input_slots_[pn->input_start + e->dst_input()] = slot;
+      last_use[slot] = i;
+    }
+    pn->num_control_inputs = control_inputs_.size() - pn->control_start;
+  }
+  input_slots_.resize(num_inputs);
+
+  // Outputs that are never consumed are released by their producer.
+  std::vector<std::vector<int>> released_by(plan_.size());
+  for (size_t i = 0; i < plan_.size(); ++i) {
+    const PlanNode& pn = plan_[i];
+    for (int o = 0; o < pn.num_outputs; ++o) {
+      const int slot = pn.output_start + o;
+      released_by[last_use[slot] < 0 ? i : last_use[slot]].push_back(slot);
+    }
+  }
+  for (size_t i = 0; i < plan_.size(); ++i) {
+    plan_[i].release_start = releases_.size();
+    plan_[i].num_releases = released_by[i].size();
+    releases_.insert(releases_.end(), released_by[i].begin(),
+                     released_by[i].end());
+  }
+
+  // Create the kernels and compute the allocator attributes of every
+  // output, as ExecutorImpl::SetAllocAttrs() does.
+  const DeviceNameUtils::ParsedName& local_dev_name =
+      params_.device->parsed_name();
+  output_attrs_.resize(num_output_slots_);
+  for (PlanNode& pn : plan_) {
+    const Node* n = pn.node;
+    Status s = params_.create_kernel(n->def(), &pn.kernel);
+    if (!s.ok()) {
+      pn.kernel = nullptr;
+      s = AttachDef(s, n->def());
+      LOG(ERROR) << "Executor failed to create kernel. " << s;
+      return s;
+    }
+    CHECK(pn.kernel);
+    pn.kernel_is_async = (pn.kernel->AsAsync() != nullptr);
+    if (pn.kernel_is_async && !IsClientRecv(n)) {
+      *can_run = false;
+      return Status::OK();
+    }
+
+    for (const Edge* e : n->out_edges()) {
+      AllocatorAttributes attr;
+      TF_RETURN_IF_ERROR(ExecutorImpl::InferAllocAttr(n, e->dst(),
+                                                      local_dev_name, &attr));
+      if (attr.value != 0 && !e->IsControlEdge()) {
+        output_attrs_[pn.output_start + e->src_output()].Merge(attr);
+      }
+    }
+    for (int out = 0; out < pn.num_outputs; ++out) {
+      AllocatorAttributes h;
+      h.set_on_host(pn.kernel->output_memory_types()[out] == HOST_MEMORY);
+      output_attrs_[pn.output_start + out].Merge(h);
+    }
+  }
+  return Status::OK();
+}
+
+// The state of one step of a StaticPlanExecutor. Deletes itself when
+// the step is done.
+class StaticPlanStep {
+ public:
+  StaticPlanStep(const Executor::Args& args, const StaticPlanExecutor* impl,
+                 Executor::DoneCallback done)
+      : impl_(impl),
+        step_id_(args.step_id),
+        rendezvous_(args.rendezvous),
+        stats_collector_(args.stats_collector),
+        call_frame_(args.call_frame),
+        cancellation_manager_(args.cancellation_manager),
+        session_state_(args.session_state),
+        tensor_store_(args.tensor_store),
+        step_resource_manager_(args.step_resource_manager),
+        step_allocator_(StepMemoryPlanner::LookupStepAllocator(
+            args.step_resource_manager, impl->params_.device->name())),
+        runner_(args.runner),
+        done_cb_(std::move(done)),
+        log_memory_(LogMemory::IsEnabled()),
+        slots_(impl->num_output_slots_),
+        dead_(impl->plan_.size(), false),
+        async_handoff_(0) {}
+
+  ~StaticPlanStep() {
+    for (auto it : device_context_map_) {
+      it->Unref();
+    }
+  }
+
+  void Start() {
+    Status s = impl_->params_.device->FillContextMap(impl_->graph_,
+                                                     &device_context_map_);
+    if (!s.ok()) {
+      done_cb_(s);
+      delete this;
+      return;
+    }
+    runner_([this]() { RunFrom(0); });
+  }
+
+ private:
+  // The value of an output slot: either a tensor or a tensor reference.
+  struct Slot {
+    Tensor val;
+    Tensor* ref = nullptr;
+    mutex* ref_mu = nullptr;
+    bool has_value = false;
+    AllocatorAttributes alloc_attr;
+    DeviceContext* device_context = nullptr;
+
+    void Clear() {
+      val = Tensor();
+      ref = nullptr;
+      ref_mu = nullptr;
+      has_value = false;
+    }
+  };
+
+  // State kept alive while an asynchronous kernel runs.
+  struct AsyncState {
+    AsyncState(const OpKernelContext::Params& p, int num_outputs,
+               NodeExecStats* s)
+        : params(p), ctx(&params, num_outputs), stats(s) {}
+    TensorValueVec inputs;
+    DeviceContextVec input_device_contexts;
+    AllocatorAttributeVec input_alloc_attrs;
+    gtl::InlinedVector<Tensor, 4> derefs;
+    OpKernelContext::Params params;
+    OpKernelContext ctx;
+    NodeExecStats* stats;
+  };
+
+  // Runs the plan starting at position "i" until it is done, an error
+  // occurs, or an asynchronous kernel has not completed inline.
+  void RunFrom(size_t i);
+
+  // Fills in the inputs of "pn". Sets "*is_input_dead" if any data or
+  // control input of the node is dead.
+  Status PrepareInputs(const StaticPlanExecutor::PlanNode& pn,
+                       TensorValueVec* inputs,
+                       DeviceContextVec* input_device_contexts,
+                       AllocatorAttributeVec* input_alloc_attrs,
+                       gtl::InlinedVector<Tensor, 4>* derefs,
+                       bool* is_input_dead);
+
+  // Moves the outputs of "ctx" into the output slots of "pn".
+  Status ProcessOutputs(const StaticPlanExecutor::PlanNode& pn,
+                        OpKernelContext* ctx, NodeExecStats* stats);
+
+  // Finishes the bookkeeping for plan_[i] after it ran with status "s".
+  void NodeDone(size_t i, const Status& s, NodeExecStats* stats);
+
+  void Finish();
+
+  const StaticPlanExecutor* const impl_;
+  const int64 step_id_;
+  Rendezvous* const rendezvous_;
+  StepStatsCollector* const stats_collector_;
+  FunctionCallFrame* const call_frame_;
+  CancellationManager* const cancellation_manager_;
+  SessionState* const session_state_;
+  TensorStore* const tensor_store_;
+  ResourceMgr* const step_resource_manager_;
+  Allocator* const step_allocator_;
+  Executor::Args::Runner runner_;
+  Executor::DoneCallback done_cb_;
+  const bool log_memory_;
+
+  checkpoint::TensorSliceReaderCacheWrapper slice_reader_cache_;
+  DeviceContextMap device_context_map_;
+
+  std::vector<Slot> slots_;
+  std::vector<bool> dead_;
+
+  // Set to 2 before an asynchronous kernel is launched. The launcher
+  // and the kernel's done callback each decrement it, and whichever
+  // gets there last continues the step. This avoids growing the stack
+  // when the callback runs inline.
+  std::atomic<int> async_handoff_;
+
+  // The first error of the step. Only accessed by the thread that is
+  // currently running the step.
+  Status status_;
+};
+
+void StaticPlanStep::RunFrom(size_t i) {
+  const auto& plan = impl_->plan_;
+  Device* device = impl_->params_.device;
+
+  TensorValueVec inputs;
+  DeviceContextVec input_device_contexts;
+  AllocatorAttributeVec input_alloc_attrs;
+  gtl::InlinedVector<Tensor, 4> derefs;
+
+  OpKernelContext::Params params;
+  params.step_id = step_id_;
+  params.device = device;
+  params.log_memory = log_memory_;
+  params.rendezvous = rendezvous_;
+  params.session_state = session_state_;
+  params.tensor_store = tensor_store_;
+  params.cancellation_manager = cancellation_manager_;
+  params.call_frame = call_frame_;
+  params.function_library = impl_->params_.function_library;
+  params.resource_manager = device->resource_manager();
+  params.step_resource_manager = step_resource_manager_;
+  params.step_allocator = step_allocator_;
+  params.slice_reader_cache = &slice_reader_cache_;
+  params.runner = &runner_;
+  params.frame_iter = FrameAndIter(0, 0);
+
+  for (; i < plan.size() && status_.ok(); ++i) {
+    const StaticPlanExecutor::PlanNode& pn = plan[i];
+    const int id = pn.node->id();
+
+    NodeExecStats* stats = nullptr;
+    if (stats_collector_) {
+      stats = new NodeExecStats;
+      stats->set_node_name(pn.node->name());
+      nodestats::SetScheduled(stats, nodestats::NowInUsec());
+      nodestats::SetAllStart(stats);
+    }
+
+    bool is_input_dead = false;
+    Status s = PrepareInputs(pn, &inputs, &input_device_contexts,
+                             &input_alloc_attrs, &derefs, &is_input_dead);
+    if (!s.ok() || (is_input_dead && !pn.is_transfer)) {
+      // A dead node propagates its deadness without running.
+      dead_[i] = s.ok();
+      NodeDone(i, s, stats);
+      continue;
+    }
+
+    params.op_kernel = pn.kernel;
+    params.op_device_context =
+        id < device_context_map_.size() ? device_context_map_[id] : nullptr;
+    params.is_input_dead = is_input_dead;
+    params.track_allocations = (stats != nullptr);
+    params.output_attr_array =
+        gtl::vector_as_array(&impl_->output_attrs_) + pn.output_start;
+
+    if (pn.kernel_is_async) {
+      AsyncState* state = new AsyncState(params, pn.num_outputs, stats);
+      state->inputs.swap(inputs);
+      state->input_device_contexts.swap(input_device_contexts);
+      state->input_alloc_attrs.swap(input_alloc_attrs);
+      state->derefs.swap(derefs);
+      state->params.inputs = &state->inputs;
+      state->params.input_device_contexts = &state->input_device_contexts;
+      state->params.input_alloc_attrs = &state->input_alloc_attrs;
+      async_handoff_ = 2;
+      auto done = [this, state, i]() {
+        if (state->stats) nodestats::SetOpEnd(state->stats);
+        Status s = ProcessOutputs(impl_->plan_[i], &state->ctx, state->stats);
+        if (state->stats) nodestats::SetMemory(state->stats, &state->ctx);
+        NodeExecStats* stats = state->stats;
+        delete state;
+        NodeDone(i, s, stats);
+        if (async_handoff_.fetch_sub(1) == 1) {
+          RunFrom(i + 1);
+        }
+      };
+      if (stats) nodestats::SetOpStart(stats);
+      device->ComputeAsync(pn.kernel->AsAsync(), &state->ctx, done);
+      if (async_handoff_.fetch_sub(1) != 1) {
+        // The kernel is still running: its done callback continues the
+        // step.
+        return;
+      }
+      continue;
+    }
+
+    params.inputs = &inputs;
+    params.input_device_contexts = &input_device_contexts;
+    params.input_alloc_attrs = &input_alloc_attrs;
+    OpKernelContext ctx(&params, pn.num_outputs);
+    if (stats) nodestats::SetOpStart(stats);
+    device->Compute(pn.kernel, &ctx);
+    if (stats) nodestats::SetOpEnd(stats);
+    s = ProcessOutputs(pn, &ctx, stats);
+    if (stats) nodestats::SetMemory(stats, &ctx);
+    NodeDone(i, s, stats);
+  }
+  Finish();
+}
+
+Status StaticPlanStep::PrepareInputs(const StaticPlanExecutor::PlanNode& pn,
+                                     TensorValueVec* inputs,
+                                     DeviceContextVec* input_device_contexts,
+                                     AllocatorAttributeVec* input_alloc_attrs,
+                                     gtl::InlinedVector<Tensor, 4>* derefs,
+                                     bool* is_input_dead) {
+  *is_input_dead = false;
+  for (int c = 0; c < pn.num_control_inputs; ++c) {
+    if (dead_[impl_->control_inputs_[pn.control_start + c]]) {
+      *is_input_dead = true;
+    }
+  }
+
+  inputs->clear();
+  inputs->resize(pn.num_inputs);
+  input_device_contexts->clear();
+  input_device_contexts->resize(pn.num_inputs);
+  input_alloc_attrs->clear();
+  input_alloc_attrs->resize(pn.num_inputs);
+  derefs->clear();
+  derefs->resize(pn.num_inputs);
+
+  for (int i = 0; i < pn.num_inputs; ++i) {
+    Slot* slot = &slots_[impl_->input_slots_[pn.input_start + i]];
+    (*input_device_contexts)[i] = slot->device_context;
+    (*input_alloc_attrs)[i] = slot->alloc_attr;
+    TensorValue* inp = &(*inputs)[i];
+    if (!slot->has_value) {
+      *is_input_dead = true;
+      inp->tensor = const_cast<Tensor*>(kEmptyTensor);
+      continue;
+    }
+    const bool expect_ref = IsRefType(pn.node->input_type(i));
+    if (slot->ref == nullptr) {
+      if (expect_ref) {
+        return AttachDef(
+            errors::InvalidArgument(i, "-th input expects a ref type"),
+            pn.kernel->def());
+      }
+      inp->tensor = &slot->val;
+    } else {
+      if (!slot->ref->IsInitialized() && !IsInitializationOp(pn.node)) {
+        return AttachDef(
+            errors::FailedPrecondition("Attempting to use uninitialized value ",
+                                       pn.kernel->def().input(i)),
+            pn.kernel->def());
+      }
+      if (expect_ref) {
+        inp->mutex_if_ref = slot->ref_mu;
+        inp->tensor = slot->ref;
+      } else {
+        // Dereference under the mutex. The slot may have other
+        // consumers, so the copy is local to this node.
+        mutex_lock l(*slot->ref_mu);
+        (*derefs)[i] = *slot->ref;
+        inp->tensor = &(*derefs)[i];
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status StaticPlanStep::ProcessOutputs(const StaticPlanExecutor::PlanNode& pn,
+                                      OpKernelContext* ctx,
+                                      NodeExecStats* stats) {
+  const Node* node = pn.node;
+  Status s = ctx->status();
+  if (!s.ok()) return AttachDef(s, pn.kernel->def());
+
+  const int id = node->id();
+  DeviceContext* device_context =
+      id < device_context_map_.size() ? device_context_map_[id] : nullptr;
+  const auto& node_outputs_cb = impl_->params_.node_outputs_cb;
+  if (pn.num_outputs == 0 && node_outputs_cb != nullptr) {
+    node_outputs_cb(node->name(), -1, nullptr, false, ctx);
+  }
+
+  for (int i = 0; i < pn.num_outputs; ++i) {
+    TensorValue val = ctx->release_output(i);
+    if (*ctx->is_output_dead() || val.tensor == nullptr) {
+      if (!IsRecv(node)) {
+        s.Update(errors::Internal("Missing ", i, "-th output from ",
+                                  SummarizeNodeDef(node->def())));
+      }
+    } else {
+      Slot* out = &slots_[pn.output_start + i];
+      out->device_context = device_context;
+      out->alloc_attr = ctx->output_alloc_attr(i);
+      DataType dtype = val->dtype();
+      if (val.is_ref()) dtype = MakeRefType(dtype);
+      if (dtype != node->output_type(i)) {
+        s.Update(errors::Internal("Output ", i, " of type ",
+                                  DataTypeString(dtype),
+                                  " does not match declared output type ",
+                                  DataTypeString(node->output_type(i)),
+                                  " for node ", SummarizeNodeDef(node->def())));
+      } else {
+        if (stats && val.tensor->IsInitialized()) {
+          nodestats::SetOutput(stats, i, val.tensor);
+        }
+        out->has_value = true;
+        if (val.is_ref()) {
+          out->ref = val.tensor;
+          out->ref_mu = val.mutex_if_ref;
+          if (node_outputs_cb != nullptr) {
+            node_outputs_cb(node->name(), i, out->ref, true, ctx);
+          }
+        } else {
+          out->val = std::move(*val.tensor);
+          if (log_memory_) {
+            LogMemory::RecordTensorOutput(ctx->op_kernel().name(),
+                                          ctx->step_id(), i, out->val);
+          }
+          if (node_outputs_cb != nullptr) {
+            node_outputs_cb(node->name(), i, &out->val, false, ctx);
+          }
+        }
+      }
+    }
+    if (!val.is_ref()) {
+      delete val.tensor;
+    }
+  }
+  return s;
+}
+
+void StaticPlanStep::NodeDone(size_t i, const Status& s, NodeExecStats* stats) {
+  const StaticPlanExecutor::PlanNode& pn = impl_->plan_[i];
+  // Release the output slots whose last consumer was this node.
+  for (int r = 0; r < pn.num_releases; ++r) {
+    slots_[impl_->releases_[pn.release_start + r]].Clear();
+  }
+  if (stats) {
+    nodestats::SetAllEnd(stats);
+    if (!SetTimelineLabel(pn.node, stats)) {
+      stats_collector_->Save(impl_->params_.device->name(), stats);
+    } else {
+      delete stats;
+    }
+  }
+  if (!s.ok() && status_.ok()) {
+    status_ = s;
+    if (rendezvous_) {
+      TRACEPRINTF("StartAbort: %s", s.ToString().c_str());
+      rendezvous_->StartAbort(s);
+    }
+  }
+}
+
+void StaticPlanStep::Finish() {
+  Status status = status_;
+  if (status.ok()) {
+    status = impl_->params_.device->Sync();
+  }
+  auto done_cb = std::move(done_cb_);
+  auto runner = std::move(runner_);
+  delete this;
+  runner([=]() { done_cb(status); });
+}
+
+void StaticPlanExecutor::RunAsync(const Args& args, DoneCallback done) {
+  (new StaticPlanStep(args, this, std::move(done)))->Start();
+}
+
 }  // end namespace
 
 Status NewLocalExecutor(const LocalExecutorParams& params, const Graph* graph,
                         Executor** executor) {
+  if (params.use_static_plan &&
+      StaticPlanExecutor::CanRun(graph, params.device)) {
+    StaticPlanExecutor* impl = new StaticPlanExecutor(params, graph);
+    bool can_run = false;
+    Status s = impl->Initialize(&can_run);
+    if (s.ok() && can_run) {
+      *executor = impl;
+      return s;
+    }
+    if (!s.ok()) {
+      delete impl;
+      return s;
+    }
+    // Leaves the graph to the default executor.
+    impl->ReleaseGraph();
+    delete impl;
+  }
   ExecutorImpl* impl = new ExecutorImpl(params, graph);
   Status s = impl->Initialize();
   if (s.ok()) {
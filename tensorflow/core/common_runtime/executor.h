@@ -138,6 +138,29 @@ struct LocalExecutorParams {
   std::function<void(OpKernel*)> delete_kernel;
 
   Executor::Args::NodeOutputsCallback node_outputs_cb;
+
+  // If true, ready nodes are kept in per-worker deques and idle workers
+  // steal from busy ones, instead of handing every expensive ready node
+  // to Args::runner as a separate closure. Nodes are ordered by the
+  // length of their longest path to a sink, computed once when the
+  // executor is created, so that long chains are started first.
+  bool use_work_stealing = false;
+
+  // The maximum number of workers a single step may run concurrently
+  // when "use_work_stealing" is true. Typically the size of the
+  // inter-op thread pool behind Args::runner. 0 means the number of
+  // schedulable CPUs.
+  int max_workers = 0;
+
+  // If true, the executor linearizes the graph once when it is created
+  // and runs each step as a single sequence of kernels, without frame
+  // bookkeeping or pending counts, releasing every tensor after its last
+  // consumer. Nodes of a step do not run in parallel with each other.
+  // Graphs with control flow, Recvs other than of values fed by the
+  // client, or other asynchronous kernels use the default executor. The
+  // values fed by the client must be sent before a step starts, so this
+  // must not be set for partial runs.
+  bool use_static_plan = false;
 };
 ::tensorflow::Status NewLocalExecutor(const LocalExecutorParams& params,
                                       const Graph* graph, Executor** executor);
@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/public/session_options.h"
 
@@ -30,17 +31,26 @@ namespace tensorflow {
 bool LocalDevice::use_global_threadpool_ = true;
 
 struct LocalDevice::EigenThreadPoolInfo {
-  EigenThreadPoolInfo(const SessionOptions& options) {
+  // The threads are restricted to the CPUs of NUMA node 'numa_node', if
+  // not port::kNUMANoAffinity.
+  EigenThreadPoolInfo(const SessionOptions& options, int numa_node) {
     int32 intra_op_parallelism_threads =
         options.config.intra_op_parallelism_threads();
+    if (intra_op_parallelism_threads == 0 &&
+        numa_node != port::kNUMANoAffinity) {
+      intra_op_parallelism_threads = port::NUMANumSchedulableCPUs(numa_node);
+    }
     if (intra_op_parallelism_threads == 0) {
       intra_op_parallelism_threads = port::NumSchedulableCPUs();
     }
     VLOG(1) << "Local device intra op parallelism threads: "
             << intra_op_parallelism_threads;
+    ThreadOptions thread_options;
+    thread_options.numa_node = numa_node;
     eigen_worker_threads_.num_threads = intra_op_parallelism_threads;
-    eigen_worker_threads_.workers = new thread::ThreadPool(
-        options.env, "Eigen", intra_op_parallelism_threads);
+    eigen_worker_threads_.workers =
+        new thread::ThreadPool(options.env, thread_options, "Eigen",
+                               intra_op_parallelism_threads);
     eigen_threadpool_wrapper_.reset(
         new EigenThreadPoolWrapper(eigen_worker_threads_.workers));
     eigen_device_.reset(new Eigen::ThreadPoolDevice(
@@ -64,16 +74,24 @@ LocalDevice::LocalDevice(const SessionOptions& options,
     : Device(options.env, attributes, device_allocator),
       owned_tp_info_(nullptr) {
   LocalDevice::EigenThreadPoolInfo* tp_info;
-  if (use_global_threadpool_) {
+  // DeviceLocality numbers NUMA nodes from 1.
+  const int numa_node = attributes.locality().numa_node() - 1;
+  if (numa_node != port::kNUMANoAffinity) {
+    // A device bound to a NUMA node computes on threads of that node.
+    owned_tp_info_.reset(
+        new LocalDevice::EigenThreadPoolInfo(options, numa_node));
+    tp_info = owned_tp_info_.get();
+  } else if (use_global_threadpool_) {
     // All ThreadPoolDevices in the process will use this single fixed
     // sized threadpool for numerical computations.
     static LocalDevice::EigenThreadPoolInfo* global_tp_info =
-        new LocalDevice::EigenThreadPoolInfo(options);
+        new LocalDevice::EigenThreadPoolInfo(options, port::kNUMANoAffinity);
     tp_info = global_tp_info;
   } else {
     // Each LocalDevice owns a separate ThreadPoolDevice for numerical
     // computations.
-    owned_tp_info_.reset(new LocalDevice::EigenThreadPoolInfo(options));
+    owned_tp_info_.reset(
+        new LocalDevice::EigenThreadPoolInfo(options, port::kNUMANoAffinity));
     tp_info = owned_tp_info_.get();
   }
   set_tensorflow_cpu_worker_threads(&tp_info->eigen_worker_threads_);
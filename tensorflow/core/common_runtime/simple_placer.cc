@@ -15,8 +15,11 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/simple_placer.h"
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 #include <set>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -256,6 +259,10 @@ class ColocationGraph {
     return members_[node_root].device_name;
   }
 
+  // Returns the id of the node that represents the colocation group of
+  // 'node'.
+  int ColocationGroupRoot(const Node& node) { return FindRoot(node.id()); }
+
   void SetDeviceForNode(Node* node, const DeviceNameUtils::ParsedName& device) {
     int node_root = FindRoot(node->id());
     members_[node_root].device_name = device;
@@ -601,6 +608,79 @@ bool IsGeneratorNode(const Node* node) {
          node->out_edges().size() == 1 && !IsRefType(node->output_type(0));
 }
 
+// Returns the NUMA-bound devices in 'devices' of the same type as the
+// first one, which is the type the placer would choose.
+std::vector<Device*> NumaDevices(const std::vector<Device*>& devices) {
+  std::vector<Device*> numa_devices;
+  for (Device* d : devices) {
+    if (d->device_type() == devices[0]->device_type() &&
+        d->attributes().locality().numa_node() > 0) {
+      numa_devices.push_back(d);
+    }
+  }
+  return numa_devices;
+}
+
+// Spreads the independent subgraphs of 'graph' over 'num_slots' slots:
+// the weakly connected components of the graph, joined with their
+// colocation groups, are given to the least loaded slot, largest first.
+// Sets (*slots)[id] to the slot of the node with that id.
+void AssignNumaSlots(const Graph& graph, ColocationGraph* colocation_graph,
+                     int num_slots, std::vector<int>* slots) {
+  std::vector<int> parent(graph.num_node_ids());
+  for (int i = 0; i < parent.size(); ++i) parent[i] = i;
+  std::function<int(int)> find = [&parent, &find](int i) {
+    if (parent[i] != i) parent[i] = find(parent[i]);
+    return parent[i];
+  };
+  auto join = [&parent, &find](int a, int b) { parent[find(a)] = find(b); };
+  for (Node* node : graph.nodes()) {
+    if (!node->IsOp()) continue;
+    join(node->id(), colocation_graph->ColocationGroupRoot(*node));
+    for (const Edge* edge : node->in_edges()) {
+      if (edge->src()->IsOp()) join(node->id(), edge->src()->id());
+    }
+  }
+
+  std::unordered_map<int, int> component_size;
+  for (Node* node : graph.nodes()) {
+    if (node->IsOp()) ++component_size[find(node->id())];
+  }
+  std::vector<std::pair<int, int>> components(component_size.begin(),
+                                              component_size.end());
+  std::sort(components.begin(), components.end(),
+            [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+              return a.second != b.second ? a.second > b.second
+                                          : a.first < b.first;
+            });
+  std::vector<int64> load(num_slots, 0);
+  std::unordered_map<int, int> component_slot;
+  for (const auto& component : components) {
+    const int slot = std::min_element(load.begin(), load.end()) - load.begin();
+    load[slot] += component.second;
+    component_slot[component.first] = slot;
+  }
+
+  slots->assign(graph.num_node_ids(), 0);
+  for (Node* node : graph.nodes()) {
+    if (node->IsOp()) (*slots)[node->id()] = component_slot[find(node->id())];
+  }
+}
+
+// Returns the device 'node' is placed on, among its possible 'devices',
+// when no heuristic applies: the first one, or the device of the node's
+// NUMA slot if 'numa_slots' is not empty.
+string DefaultDevice(const std::vector<Device*>& devices,
+                     const std::vector<int>& numa_slots, const Node& node) {
+  if (!numa_slots.empty()) {
+    const std::vector<Device*> numa_devices = NumaDevices(devices);
+    if (numa_devices.size() > 1) {
+      return numa_devices[numa_slots[node.id()] % numa_devices.size()]->name();
+    }
+  }
+  return devices[0]->name();
+}
+
 }  // namespace
 
 SimplePlacer::SimplePlacer(Graph* graph, const DeviceSet* devices,
@@ -700,6 +780,16 @@ Status SimplePlacer::Run() {
     }
   }
 
+  // With one CPU device per NUMA node, independent subgraphs that may
+  // run on any of them are spread over the nodes.
+  std::vector<int> numa_slots;
+  if (options_ != nullptr && options_->config.use_numa_cpu_devices()) {
+    const int num_slots = NumaDevices(devices_->devices()).size();
+    if (num_slots > 1) {
+      AssignNumaSlots(*graph_, &colocation_graph, num_slots, &numa_slots);
+    }
+  }
+
   // 3. For each node, assign a device based on the constraints in the
   // disjoint node set.
   std::vector<Device*> devices;
@@ -733,8 +823,8 @@ Status SimplePlacer::Run() {
           node->def());
     }
 
-    // Returns the first device in sorted devices list so we will always
-    // choose the same device.
+    // Chooses the first device in sorted devices list, or the device of
+    // the node's NUMA slot, so we will always choose the same device.
     //
     // TODO(vrv): Factor this assignment out into a pluggable
     // algorithm, so that SimplePlacer is responsible for enforcing
@@ -742,7 +832,7 @@ Status SimplePlacer::Run() {
     // given a choice of devices. Once we have a better idea of the
     // types of heuristics we want to use and the information needed
     // to perform good placement we can add an interface for this.
-    string assigned_device = devices[0]->name();
+    string assigned_device = DefaultDevice(devices, numa_slots, *node);
 
     // Heuristic B: If the node only operates on metadata, not data,
     // then it is desirable to place that metadata node with its
@@ -775,7 +865,7 @@ Status SimplePlacer::Run() {
           node->def());
     }
 
-    string assigned_device = devices[0]->name();
+    string assigned_device = DefaultDevice(devices, numa_slots, *node);
 
     // Heuristic A application.
     if (IsGeneratorNode(node)) {
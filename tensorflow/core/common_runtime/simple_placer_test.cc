@@ -79,6 +79,16 @@ class FakeDevice : public Device {
     return std::unique_ptr<Device>(new FakeDevice(device_attributes));
   }
 
+  // A CPU bound to NUMA node 'numa_node' (numbered from 1).
+  static std::unique_ptr<Device> MakeNumaCPU(const string& name,
+                                             int numa_node) {
+    DeviceAttributes device_attributes;
+    device_attributes.set_name(name);
+    device_attributes.set_device_type(DeviceType(DEVICE_CPU).type());
+    device_attributes.mutable_locality()->set_numa_node(numa_node);
+    return std::unique_ptr<Device>(new FakeDevice(device_attributes));
+  }
+
   static std::unique_ptr<Device> MakeGPU(const string& name) {
     DeviceAttributes device_attributes;
     device_attributes.set_name(name);
@@ -943,6 +953,63 @@ TEST_F(SimplePlacerTest, TestNoDevicesRegistered) {
   EXPECT_TRUE(StringPiece(s.error_message()).contains("device='GPU'"));
 }
 
+// Test that independent subgraphs are spread over NUMA CPU devices when
+// use_numa_cpu_devices is set, and kept together otherwise.
+TEST_F(SimplePlacerTest, TestNumaSpreadsIndependentSubgraphs) {
+  Graph g(OpRegistry::Global());
+  {  // Scope for temporary variables used to construct g.
+    GraphDefBuilder b(GraphDefBuilder::kFailImmediately);
+    Node* in1 = ops::SourceOp("TestInput", b.opts().WithName("in1"));
+    Node* n1 = ops::UnaryOp("TestRelu", ops::NodeOut(in1, 0),
+                            b.opts().WithName("n1"));
+    ops::UnaryOp("TestRelu", n1, b.opts().WithName("n2"));
+    Node* in2 = ops::SourceOp("TestInput", b.opts().WithName("in2"));
+    ops::UnaryOp("TestRelu", ops::NodeOut(in2, 0), b.opts().WithName("n3"));
+    TF_EXPECT_OK(BuildGraph(b, &g));
+  }
+
+  DeviceSet numa_cpus;
+  std::unique_ptr<Device> cpu0(
+      FakeDevice::MakeNumaCPU("/job:a/replica:0/task:0/cpu:0", 1));
+  std::unique_ptr<Device> cpu1(
+      FakeDevice::MakeNumaCPU("/job:a/replica:0/task:0/cpu:1", 2));
+  numa_cpus.AddDevice(cpu0.get());
+  numa_cpus.AddDevice(cpu1.get());
+
+  SessionOptions options;
+  options.config.set_use_numa_cpu_devices(true);
+  TF_EXPECT_OK(Place(&g, &numa_cpus, &options));
+  EXPECT_COLOCATED(g, "in1", "n1");
+  EXPECT_COLOCATED(g, "n1", "n2");
+  EXPECT_COLOCATED(g, "in2", "n3");
+  EXPECT_NOT_COLOCATED(g, "n1", "n3");
+  // The larger subgraph goes to the first node.
+  EXPECT_DEVICE_CONTAINS(g, "n1", "/cpu:0");
+}
+
+TEST_F(SimplePlacerTest, TestNumaSpreadingIsOptIn) {
+  Graph g(OpRegistry::Global());
+  {  // Scope for temporary variables used to construct g.
+    GraphDefBuilder b(GraphDefBuilder::kFailImmediately);
+    Node* in1 = ops::SourceOp("TestInput", b.opts().WithName("in1"));
+    ops::UnaryOp("TestRelu", ops::NodeOut(in1, 0), b.opts().WithName("n1"));
+    Node* in2 = ops::SourceOp("TestInput", b.opts().WithName("in2"));
+    ops::UnaryOp("TestRelu", ops::NodeOut(in2, 0), b.opts().WithName("n3"));
+    TF_EXPECT_OK(BuildGraph(b, &g));
+  }
+
+  DeviceSet numa_cpus;
+  std::unique_ptr<Device> cpu0(
+      FakeDevice::MakeNumaCPU("/job:a/replica:0/task:0/cpu:0", 1));
+  std::unique_ptr<Device> cpu1(
+      FakeDevice::MakeNumaCPU("/job:a/replica:0/task:0/cpu:1", 2));
+  numa_cpus.AddDevice(cpu0.get());
+  numa_cpus.AddDevice(cpu1.get());
+
+  TF_EXPECT_OK(Place(&g, &numa_cpus));
+  EXPECT_COLOCATED(g, "n1", "n3");
+}
+
 // Test that placement fails when a requested device is malformed.
 TEST_F(SimplePlacerTest, TestMalformedDeviceSpecification) {
   Graph g(OpRegistry::Global());
@@ -0,0 +1,448 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_memory_planner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Alignment of every block in the arena. At least
+// Allocator::kAllocatorAlignment, and a cache line so that tensors
+// written by different threads do not share one.
+const size_t kArenaAlignment = 64;
+
+// Allocations made by the same step are matched against the plan a
+// few times before planning is given up for a device.
+const int kMaxConsecutiveMismatches = 4;
+
+// Arena buffers kept around for reuse by later steps.
+const int kMaxCachedArenas = 4;
+
+const char kStepAllocatorContainer[] = "__step_memory_planner";
+
+const int64 kForever = std::numeric_limits<int64>::max();
+
+// Number of steps, over all planners, whose allocator is published.
+std::atomic<int64> num_active_steps(0);
+
+size_t RoundUp(size_t n) {
+  return (n + kArenaAlignment - 1) & ~(kArenaAlignment - 1);
+}
+
+// The recorded size and lifetime of one allocation. Times are
+// positions in the sequence of allocation and deallocation events of
+// the step.
+struct Lifetime {
+  size_t bytes;
+  int64 alloc_time;
+  int64 free_time;  // kForever if the allocation outlived the step.
+  bool pinned;      // If the allocation must not come from the arena.
+};
+
+}  // namespace
+
+// The layout computed from one recorded step. blocks[i] describes the
+// i-th allocation of the step.
+struct StepMemoryPlanner::Plan {
+  struct Block {
+    size_t bytes = 0;
+    int64 offset = -1;  // -1 if the allocation is not served by the arena.
+  };
+  std::vector<Block> blocks;
+  size_t arena_bytes = 0;
+};
+
+// Arena buffers of the size required by the current plan, kept for
+// reuse. Shared by the planner and its step allocators, since the
+// latter may outlive the former.
+class StepMemoryPlanner::ArenaCache {
+ public:
+  explicit ArenaCache(Allocator* base_allocator)
+      : base_allocator_(base_allocator) {}
+
+  ~ArenaCache() {
+    for (void* buf : free_) base_allocator_->DeallocateRaw(buf);
+  }
+
+  void* Get(size_t bytes) {
+    {
+      mutex_lock l(mu_);
+      if (bytes == bytes_ && !free_.empty()) {
+        void* buf = free_.back();
+        free_.pop_back();
+        return buf;
+      }
+    }
+    return base_allocator_->AllocateRaw(kArenaAlignment, bytes);
+  }
+
+  void Put(void* buf, size_t bytes) {
+    std::vector<void*> stale;
+    {
+      mutex_lock l(mu_);
+      if (bytes != bytes_) {
+        // The plan changed: buffers of the old size are of no use.
+        stale.swap(free_);
+        bytes_ = bytes;
+      }
+      if (free_.size() < kMaxCachedArenas) {
+        free_.push_back(buf);
+        buf = nullptr;
+      }
+    }
+    for (void* b : stale) base_allocator_->DeallocateRaw(b);
+    if (buf != nullptr) base_allocator_->DeallocateRaw(buf);
+  }
+
+ private:
+  Allocator* const base_allocator_;  // Not owned.
+  mutex mu_;
+  size_t bytes_ GUARDED_BY(mu_) = 0;
+  std::vector<void*> free_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ArenaCache);
+};
+
+// The allocator of one step. Records the step if it has no plan, and
+// serves it from an arena laid out by the plan otherwise.
+//
+// Like TrackingAllocator, it keeps a reference for each outstanding
+// allocation plus one for the step, and deletes itself once the step
+// is done and the last allocation has been returned.
+class StepMemoryPlanner::StepAllocator : public Allocator {
+ public:
+  StepAllocator(Allocator* base_allocator, std::shared_ptr<const Plan> plan,
+                std::shared_ptr<ArenaCache> arena_cache)
+      : base_allocator_(base_allocator),
+        plan_(std::move(plan)),
+        arena_cache_(std::move(arena_cache)) {
+    if (plan_ != nullptr && plan_->arena_bytes > 0) {
+      arena_ = static_cast<char*>(arena_cache_->Get(plan_->arena_bytes));
+    }
+  }
+
+  string Name() override { return "step_arena"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    if (plan_ == nullptr) return RecordAllocation(alignment, num_bytes);
+    {
+      mutex_lock l(mu_);
+      const int64 index = next_index_++;
+      if (index < plan_->blocks.size() && !step_done_) {
+        const Plan::Block& block = plan_->blocks[index];
+        if (RoundUp(num_bytes) != block.bytes) {
+          mismatch_ = true;
+        } else if (block.offset >= 0 && arena_ != nullptr &&
+                   alignment <= kArenaAlignment) {
+          if (IsFree(block.offset, block.bytes)) {
+            live_blocks_[block.offset] = block.offset + block.bytes;
+            ++ref_;
+            return arena_ + block.offset;
+          }
+          // The step runs in a different order than the recorded one.
+          mismatch_ = true;
+        }
+      } else {
+        mismatch_ = true;
+      }
+    }
+    void* ptr = base_allocator_->AllocateRaw(alignment, num_bytes);
+    if (ptr != nullptr) {
+      mutex_lock l(mu_);
+      ++ref_;
+    }
+    return ptr;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    if (ptr == nullptr) return;
+    char* p = static_cast<char*>(ptr);
+    const bool in_arena = arena_ != nullptr && p >= arena_ &&
+                          p < arena_ + plan_->arena_bytes;
+    bool should_delete;
+    {
+      mutex_lock l(mu_);
+      if (in_arena) {
+        live_blocks_.erase(p - arena_);
+      } else if (plan_ == nullptr) {
+        auto it = recorded_ptrs_.find(ptr);
+        if (it != recorded_ptrs_.end()) {
+          if (!step_done_) lifetimes_[it->second].free_time = clock_++;
+          recorded_ptrs_.erase(it);
+        }
+      }
+      should_delete = UnRef();
+    }
+    if (!in_arena) base_allocator_->DeallocateRaw(ptr);
+    if (should_delete) delete this;
+  }
+
+  // Called once all the step's kernels have run. Returns in "*recorded"
+  // the plan computed from the step if it was recorded, and in
+  // "*mismatch" whether the step deviated from its plan otherwise.
+  // Drops the step's reference: *this may be deleted on return.
+  void FinishStep(std::shared_ptr<const Plan>* recorded, bool* mismatch,
+                  std::shared_ptr<const Plan>* plan) {
+    std::vector<Lifetime> lifetimes;
+    bool should_delete;
+    {
+      mutex_lock l(mu_);
+      step_done_ = true;
+      *plan = plan_;
+      if (plan_ == nullptr) {
+        lifetimes.swap(lifetimes_);
+        recorded_ptrs_.clear();
+      } else {
+        // Arena blocks still alive at the end of the step, or missing
+        // allocations, also mean that the plan no longer fits.
+        *mismatch = mismatch_ || !live_blocks_.empty() ||
+                    next_index_ != plan_->blocks.size();
+      }
+      should_delete = UnRef();
+    }
+    if (should_delete) delete this;
+    if (*plan == nullptr) *recorded = ComputePlan(lifetimes);
+  }
+
+ private:
+  ~StepAllocator() override {
+    if (arena_ != nullptr) arena_cache_->Put(arena_, plan_->arena_bytes);
+  }
+
+  void* RecordAllocation(size_t alignment, size_t num_bytes) {
+    void* ptr = base_allocator_->AllocateRaw(alignment, num_bytes);
+    if (ptr == nullptr) return ptr;
+    mutex_lock l(mu_);
+    ++ref_;
+    if (!step_done_) {
+      recorded_ptrs_[ptr] = lifetimes_.size();
+      lifetimes_.push_back({RoundUp(num_bytes), clock_++, kForever,
+                            alignment > kArenaAlignment});
+    }
+    return ptr;
+  }
+
+  // Returns true iff no live arena block intersects [offset, offset+bytes).
+  // Since live blocks are disjoint, only the last one starting before
+  // the end of the range can intersect it.
+  bool IsFree(int64 offset, size_t bytes) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    auto it = live_blocks_.lower_bound(offset + bytes);
+    if (it == live_blocks_.begin()) return true;
+    --it;
+    return it->second <= offset;
+  }
+
+  // Assigns arena offsets greedily, largest allocation first: each block
+  // goes into the lowest gap left by the already placed blocks whose
+  // lifetimes intersect its own.
+  static std::shared_ptr<const Plan> ComputePlan(
+      const std::vector<Lifetime>& lifetimes) {
+    auto* plan = new Plan;
+    plan->blocks.resize(lifetimes.size());
+    std::vector<int> order;
+    for (int i = 0; i < lifetimes.size(); ++i) {
+      plan->blocks[i].bytes = lifetimes[i].bytes;
+      if (lifetimes[i].free_time != kForever && !lifetimes[i].pinned) {
+        order.push_back(i);
+      }
+    }
+    std::stable_sort(order.begin(), order.end(), [&lifetimes](int a, int b) {
+      return lifetimes[a].bytes > lifetimes[b].bytes;
+    });
+
+    std::vector<int> placed;
+    std::vector<int> live;
+    for (int i : order) {
+      const Lifetime& li = lifetimes[i];
+      live.clear();
+      for (int j : placed) {
+        const Lifetime& lj = lifetimes[j];
+        if (li.alloc_time < lj.free_time && lj.alloc_time < li.free_time) {
+          live.push_back(j);
+        }
+      }
+      std::sort(live.begin(), live.end(), [plan](int a, int b) {
+        return plan->blocks[a].offset < plan->blocks[b].offset;
+      });
+      int64 offset = 0;
+      for (int j : live) {
+        const Plan::Block& bj = plan->blocks[j];
+        if (offset + li.bytes <= bj.offset) break;
+        offset = std::max<int64>(offset, bj.offset + bj.bytes);
+      }
+      plan->blocks[i].offset = offset;
+      plan->arena_bytes = std::max<size_t>(plan->arena_bytes, offset + li.bytes);
+      placed.push_back(i);
+    }
+    return std::shared_ptr<const Plan>(plan);
+  }
+
+  bool UnRef() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    CHECK_GE(ref_, 1);
+    --ref_;
+    return ref_ == 0;
+  }
+
+  Allocator* const base_allocator_;  // Not owned.
+  const std::shared_ptr<const Plan> plan_;
+  const std::shared_ptr<ArenaCache> arena_cache_;
+  char* arena_ = nullptr;
+
+  mutex mu_;
+  int ref_ GUARDED_BY(mu_) = 1;
+  bool step_done_ GUARDED_BY(mu_) = false;
+
+  // Used when recording.
+  int64 clock_ GUARDED_BY(mu_) = 0;
+  std::vector<Lifetime> lifetimes_ GUARDED_BY(mu_);
+  std::unordered_map<void*, int> recorded_ptrs_ GUARDED_BY(mu_);
+
+  // Used when following a plan. "live_blocks_" maps the offset of each
+  // arena block in use to its end.
+  int64 next_index_ GUARDED_BY(mu_) = 0;
+  bool mismatch_ GUARDED_BY(mu_) = false;
+  std::map<int64, int64> live_blocks_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepAllocator);
+};
+
+// Publishes a StepAllocator in a step's ResourceMgr, and reports the
+// end of the step to the planner when the ResourceMgr releases it.
+class StepMemoryPlanner::StepAllocatorResource : public ResourceBase {
+ public:
+  StepAllocatorResource(StepMemoryPlanner* planner, StepAllocator* allocator)
+      : planner_(planner), allocator_(allocator) {
+    num_active_steps.fetch_add(1);
+  }
+
+  ~StepAllocatorResource() override {
+    planner_->FinishStep(allocator_);
+    num_active_steps.fetch_sub(1);
+  }
+
+  string DebugString() override {
+    return strings::StrCat("StepAllocator for ", planner_->device_name_);
+  }
+
+  Allocator* allocator() const { return allocator_; }
+
+ private:
+  StepMemoryPlanner* const planner_;  // Not owned.
+  StepAllocator* const allocator_;    // Deletes itself.
+};
+
+StepMemoryPlanner::StepMemoryPlanner(const string& device_name,
+                                     Allocator* base_allocator)
+    : device_name_(device_name),
+      base_allocator_(base_allocator),
+      arena_cache_(std::make_shared<ArenaCache>(base_allocator)) {}
+
+StepMemoryPlanner::~StepMemoryPlanner() {}
+
+void StepMemoryPlanner::StartStep(ResourceMgr* step_resource_manager) {
+  std::shared_ptr<const Plan> plan;
+  {
+    mutex_lock l(mu_);
+    if (disabled_) return;
+    if (plan_ == nullptr) {
+      // Only one step records at a time; concurrent steps use the base
+      // allocator directly.
+      if (recording_) return;
+      recording_ = true;
+    }
+    plan = plan_;
+  }
+  auto* resource = new StepAllocatorResource(
+      this, new StepAllocator(base_allocator_, plan, arena_cache_));
+  Status s = step_resource_manager->Create(kStepAllocatorContainer,
+                                           device_name_, resource);
+  if (!s.ok()) {
+    LOG(ERROR) << "Could not publish the step allocator for " << device_name_
+               << ": " << s;
+  }
+}
+
+void StepMemoryPlanner::FinishStep(StepAllocator* allocator) {
+  std::shared_ptr<const Plan> recorded;
+  std::shared_ptr<const Plan> plan;
+  bool mismatch = false;
+  allocator->FinishStep(&recorded, &mismatch, &plan);
+
+  mutex_lock l(mu_);
+  if (recorded != nullptr) {
+    recording_ = false;
+    if (!disabled_) plan_ = std::move(recorded);
+    return;
+  }
+  // Steps that started with an older plan tell nothing about this one.
+  if (plan != plan_) return;
+  if (!mismatch) {
+    num_consecutive_mismatches_ = 0;
+    ++num_planned_steps_;
+    return;
+  }
+  plan_.reset();
+  if (++num_consecutive_mismatches_ >= kMaxConsecutiveMismatches) {
+    VLOG(1) << "Steps on " << device_name_
+            << " keep deviating from their memory plan; planning disabled.";
+    disabled_ = true;
+  }
+}
+
+/* static */
+Allocator* StepMemoryPlanner::LookupStepAllocator(
+    ResourceMgr* step_resource_manager, const string& device_name) {
+  if (step_resource_manager == nullptr ||
+      num_active_steps.load(std::memory_order_relaxed) == 0) {
+    return nullptr;
+  }
+  StepAllocatorResource* resource;
+  if (!step_resource_manager
+           ->Lookup(kStepAllocatorContainer, device_name, &resource)
+           .ok()) {
+    return nullptr;
+  }
+  Allocator* allocator = resource->allocator();
+  resource->Unref();
+  return allocator;
+}
+
+bool StepMemoryPlanner::has_plan() {
+  mutex_lock l(mu_);
+  return plan_ != nullptr;
+}
+
+size_t StepMemoryPlanner::arena_bytes() {
+  mutex_lock l(mu_);
+  return plan_ == nullptr ? 0 : plan_->arena_bytes;
+}
+
+int64 StepMemoryPlanner::num_planned_steps() {
+  mutex_lock l(mu_);
+  return num_planned_steps_;
+}
+
+}  // namespace tensorflow
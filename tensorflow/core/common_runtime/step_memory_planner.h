@@ -0,0 +1,107 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMMON_RUNTIME_STEP_MEMORY_PLANNER_H_
+#define TENSORFLOW_COMMON_RUNTIME_STEP_MEMORY_PLANNER_H_
+
+#include <memory>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Plans the memory of the steps that repeatedly run the same graph
+// partition on one device.
+//
+// The first step is recorded: every allocation made through the step's
+// allocator is numbered in order, and its size and lifetime are
+// noted. From that recording the planner computes an offset-packed
+// layout in which allocations whose lifetimes do not overlap share
+// memory, and serves the n-th allocation of each later step from one
+// arena buffer laid out that way. Arena buffers are reused across
+// steps, so a planned step performs a single large allocation (or
+// none) instead of one per intermediate tensor.
+//
+// Allocations that outlived the recorded step (e.g. fetched tensors or
+// tensors stored in variables) are never placed in the arena. If a
+// later step deviates from the plan -- a different size, more
+// allocations, or an order that would make two live tensors overlap,
+// as happens when input shapes change -- the offending allocation is
+// served by the base allocator and the plan is recomputed on the next
+// step. Planning is abandoned for good after a few consecutive
+// mismatches. Allocations are therefore always correct; they are only
+// fast when the step is deterministic, which is the case when the
+// partition is run by the static-plan executor.
+//
+// A step's allocator is published through the step's ResourceMgr. The
+// executor finds it with LookupStepAllocator() when the step starts, and
+// passes it to the kernels in OpKernelContext::Params::step_allocator.
+class StepMemoryPlanner {
+ public:
+  // "base_allocator" must outlive *this and every tensor allocated
+  // through it.
+  StepMemoryPlanner(const string& device_name, Allocator* base_allocator);
+  ~StepMemoryPlanner();
+
+  // Publishes in "step_resource_manager" the allocator the device
+  // should use for the step. The step is considered done when
+  // "step_resource_manager" is destroyed or cleared, which must happen
+  // after all the step's kernels have run. Must be called before the
+  // step's executors are started. Does nothing if no planned allocator
+  // should be used for this step.
+  void StartStep(ResourceMgr* step_resource_manager);
+
+  // Returns the allocator published by a planner for "device_name" in
+  // "step_resource_manager", or nullptr if there is none. Cheap when no
+  // planned step is running in the process.
+  static Allocator* LookupStepAllocator(ResourceMgr* step_resource_manager,
+                                        const string& device_name);
+
+  // For testing.
+  bool has_plan();
+  size_t arena_bytes();
+  int64 num_planned_steps();
+
+ private:
+  struct Plan;
+  class ArenaCache;
+  class StepAllocator;
+  class StepAllocatorResource;
+
+  void FinishStep(StepAllocator* allocator);
+
+  const string device_name_;
+  Allocator* const base_allocator_;  // Not owned.
+  const std::shared_ptr<ArenaCache> arena_cache_;
+
+  mutex mu_;
+  // The plan used by new steps, or nullptr if the next step records.
+  std::shared_ptr<const Plan> plan_ GUARDED_BY(mu_);
+  bool recording_ GUARDED_BY(mu_) = false;
+  bool disabled_ GUARDED_BY(mu_) = false;
+  int num_consecutive_mismatches_ GUARDED_BY(mu_) = 0;
+  int64 num_planned_steps_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepMemoryPlanner);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMMON_RUNTIME_STEP_MEMORY_PLANNER_H_
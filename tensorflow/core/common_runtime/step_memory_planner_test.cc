@@ -0,0 +1,162 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_memory_planner.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Counts the calls made to the CPU allocator.
+class CountingAllocator : public Allocator {
+ public:
+  string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_allocations;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+  void DeallocateRaw(void* ptr) override {
+    ++num_deallocations;
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  int num_allocations = 0;
+  int num_deallocations = 0;
+};
+
+const char kDevice[] = "/job:a/replica:0/task:0/cpu:0";
+
+// A tensor that outlives its step, and the allocator it came from.
+typedef std::pair<Allocator*, void*> Escaped;
+
+// Runs a step that allocates "a" and "b", frees "a", allocates "c" and
+// frees "b" and "c". "d" is allocated and outlives the step: it is
+// appended to "*escaped". Returns the addresses of a, b, c and d.
+std::vector<void*> RunStep(StepMemoryPlanner* planner, size_t c_bytes,
+                           std::vector<Escaped>* escaped) {
+  ResourceMgr step_rm;
+  planner->StartStep(&step_rm);
+  Allocator* a = StepMemoryPlanner::LookupStepAllocator(&step_rm, kDevice);
+  EXPECT_NE(nullptr, a);
+  if (a == nullptr) return {};
+  void* pa = a->AllocateRaw(32, 1000);
+  void* pb = a->AllocateRaw(32, 1000);
+  a->DeallocateRaw(pa);
+  void* pc = a->AllocateRaw(32, c_bytes);
+  void* pd = a->AllocateRaw(32, 100);
+  a->DeallocateRaw(pb);
+  a->DeallocateRaw(pc);
+  escaped->push_back({a, pd});
+  // Destroying "step_rm" ends the step.
+  return {pa, pb, pc, pd};
+}
+
+void FreeEscaped(std::vector<Escaped>* escaped) {
+  for (const Escaped& e : *escaped) e.first->DeallocateRaw(e.second);
+  escaped->clear();
+}
+
+TEST(StepMemoryPlannerTest, NoStepAllocatorWithoutPlanner) {
+  ResourceMgr step_rm;
+  EXPECT_EQ(nullptr, StepMemoryPlanner::LookupStepAllocator(&step_rm, kDevice));
+  EXPECT_EQ(nullptr, StepMemoryPlanner::LookupStepAllocator(nullptr, kDevice));
+}
+
+TEST(StepMemoryPlannerTest, RecordsThenServesFromArena) {
+  CountingAllocator base;
+  std::vector<Escaped> escaped;
+  {
+    StepMemoryPlanner planner(kDevice, &base);
+    EXPECT_FALSE(planner.has_plan());
+
+    // The first step is recorded, and served by the base allocator.
+    RunStep(&planner, 1000, &escaped);
+    EXPECT_EQ(4, base.num_allocations);
+    EXPECT_TRUE(planner.has_plan());
+    // "a" and "c" share memory; "d" is not in the arena.
+    EXPECT_EQ(2 * 1024, planner.arena_bytes());
+    FreeEscaped(&escaped);
+
+    // Later steps only allocate the arena (once) and the escaping tensor.
+    base.num_allocations = 0;
+    base.num_deallocations = 0;
+    for (int step = 0; step < 3; ++step) {
+      std::vector<void*> ptrs = RunStep(&planner, 1000, &escaped);
+      ASSERT_EQ(4, ptrs.size());
+      EXPECT_EQ(ptrs[0], ptrs[2]);
+      EXPECT_NE(ptrs[0], ptrs[1]);
+      EXPECT_EQ(0, reinterpret_cast<uintptr_t>(ptrs[1]) % 64);
+      FreeEscaped(&escaped);
+    }
+    EXPECT_EQ(1 + 3, base.num_allocations);
+    EXPECT_EQ(3, planner.num_planned_steps());
+
+    // A tensor still alive when the planner goes away can still be freed.
+    RunStep(&planner, 1000, &escaped);
+  }
+  FreeEscaped(&escaped);
+  // Everything, including the cached arena, has been returned.
+  EXPECT_EQ(base.num_allocations, base.num_deallocations);
+}
+
+TEST(StepMemoryPlannerTest, ShapeChangeFallsBackAndReplans) {
+  CountingAllocator base;
+  std::vector<Escaped> escaped;
+  StepMemoryPlanner planner(kDevice, &base);
+  RunStep(&planner, 1000, &escaped);
+  EXPECT_EQ(2 * 1024, planner.arena_bytes());
+
+  // "c" grows: it is served by the base allocator and the plan is
+  // dropped.
+  base.num_allocations = 0;
+  std::vector<void*> ptrs = RunStep(&planner, 5000, &escaped);
+  ASSERT_EQ(4, ptrs.size());
+  EXPECT_NE(ptrs[0], ptrs[2]);
+  EXPECT_FALSE(planner.has_plan());
+  EXPECT_EQ(0, planner.num_planned_steps());
+
+  // The next step records the new shapes, and the one after follows them.
+  RunStep(&planner, 5000, &escaped);
+  EXPECT_EQ(1024 + 5056, planner.arena_bytes());
+  RunStep(&planner, 5000, &escaped);
+  EXPECT_EQ(1, planner.num_planned_steps());
+  FreeEscaped(&escaped);
+}
+
+TEST(StepMemoryPlannerTest, GivesUpAfterRepeatedMismatches) {
+  CountingAllocator base;
+  StepMemoryPlanner planner(kDevice, &base);
+  for (int step = 0; step < 20; ++step) {
+    ResourceMgr step_rm;
+    planner.StartStep(&step_rm);
+    Allocator* a = StepMemoryPlanner::LookupStepAllocator(&step_rm, kDevice);
+    if (a == nullptr) {
+      // Planning has been disabled.
+      EXPECT_GT(step, 1);
+      return;
+    }
+    void* p = a->AllocateRaw(32, 1000 * (step + 1));
+    a->DeallocateRaw(p);
+  }
+  FAIL() << "Planning was never disabled";
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -17,8 +17,10 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/threadpool_device.h"
 
 #include <vector>
+#include "tensorflow/core/common_runtime/cpu_pool_allocator.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
@@ -28,17 +30,36 @@ class ThreadPoolDeviceFactory : public DeviceFactory {
  public:
   Status CreateDevices(const SessionOptions& options, const string& name_prefix,
                        std::vector<Device*>* devices) override {
-    // TODO(zhifengc/tucker): Figure out the number of available CPUs
-    // and/or NUMA configuration.
+    // TODO(zhifengc/tucker): Figure out the number of available CPUs.
     int n = 1;
     auto iter = options.config.device_count().find("CPU");
-    if (iter != options.config.device_count().end()) {
+    const bool has_count = iter != options.config.device_count().end();
+    if (has_count) {
       n = iter->second;
     }
+    // With use_numa_cpu_devices, device i is bound to NUMA node
+    // i % num_numa_nodes.
+    int num_numa_nodes = 1;
+    if (options.config.use_numa_cpu_devices()) {
+      num_numa_nodes = port::NUMANumNodes();
+      if (!has_count) n = num_numa_nodes;
+    }
     for (int i = 0; i < n; i++) {
       string name = strings::StrCat(name_prefix, "/cpu:", i);
-      devices->push_back(new ThreadPoolDevice(
-          options, name, Bytes(256 << 20), DeviceLocality(), cpu_allocator()));
+      DeviceLocality locality;
+      int numa_node = port::kNUMANoAffinity;
+      if (num_numa_nodes > 1) {
+        numa_node = i % num_numa_nodes;
+        locality.set_numa_node(numa_node + 1);
+      }
+      // Node-local memory is mapped in large blocks, which only the pool
+      // allocator amortizes over many tensors.
+      Allocator* allocator = options.config.use_pooled_cpu_allocator() ||
+                                     numa_node != port::kNUMANoAffinity
+                                 ? cpu_pool_allocator(numa_node)
+                                 : cpu_allocator();
+      devices->push_back(new ThreadPoolDevice(options, name, Bytes(256 << 20),
+                                              locality, allocator));
     }
 
     return Status::OK();
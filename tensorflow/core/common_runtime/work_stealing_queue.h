@@ -0,0 +1,106 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMMON_RUNTIME_WORK_STEALING_QUEUE_H_
+#define TENSORFLOW_COMMON_RUNTIME_WORK_STEALING_QUEUE_H_
+
+#include <atomic>
+#include <deque>
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// A double-ended queue of work items owned by one worker.
+//
+// The owning worker pushes and pops at the back (LIFO), so that the
+// most recently produced item, whose inputs are most likely still in
+// the cache of the owner's core, runs next. Other workers steal from
+// the front (FIFO), taking the oldest items first.
+//
+// The queue is protected by a per-queue mutex. Since the owner is
+// nearly always the only thread touching its queue, the lock is almost
+// never contended; it only serializes the rare steal against the
+// owner.
+//
+// Size() may be called without holding any lock. It is updated with
+// sequentially-consistent ordering so that callers can implement a
+// "push, then check for idle workers" / "go idle, then check for
+// work" handshake without losing wakeups.
+template <typename T>
+class WorkStealingQueue {
+ public:
+  WorkStealingQueue() : size_(0) {}
+
+  // Pushes "item" at the back of the queue. Called by the owner.
+  void PushBack(const T& item) {
+    mutex_lock l(mu_);
+    items_.push_back(item);
+    size_.store(items_.size());
+  }
+
+  // Pushes the items in [begin, end) at the back of the queue, in
+  // order, so that *(end - 1) is returned first by PopBack(). Called by
+  // the owner.
+  template <typename Iter>
+  void PushBack(Iter begin, Iter end) {
+    if (begin == end) return;
+    mutex_lock l(mu_);
+    items_.insert(items_.end(), begin, end);
+    size_.store(items_.size());
+  }
+
+  // Pops the most recently pushed item. Called by the owner. Returns
+  // false iff the queue is empty.
+  bool PopBack(T* item) {
+    mutex_lock l(mu_);
+    if (items_.empty()) return false;
+    *item = items_.back();
+    items_.pop_back();
+    size_.store(items_.size());
+    return true;
+  }
+
+  // Removes the oldest item. Called by workers other than the owner.
+  // Returns false iff the queue is empty.
+  bool Steal(T* item) {
+    if (size_.load() == 0) return false;
+    mutex_lock l(mu_);
+    if (items_.empty()) return false;
+    *item = items_.front();
+    items_.pop_front();
+    size_.store(items_.size());
+    return true;
+  }
+
+  // Returns the number of items in the queue. The value may be stale
+  // by the time the caller uses it.
+  size_t Size() const { return size_.load(); }
+  bool Empty() const { return Size() == 0; }
+
+ private:
+  mutex mu_;
+  std::deque<T> items_ GUARDED_BY(mu_);
+  std::atomic<size_t> size_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(WorkStealingQueue);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMMON_RUNTIME_WORK_STEALING_QUEUE_H_
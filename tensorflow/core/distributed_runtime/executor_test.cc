@@ -24,7 +24,9 @@ limitations under the License.
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/graph_constructor.h"
+#include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/strcat.h"
@@ -55,8 +57,8 @@ class ExecutorTest : public ::testing::Test {
     delete device_;
   }
 
-  // Resets executor_ with a new executor based on a graph 'gdef'.
-  void Create(const Graph* graph) {
+  // Returns a new executor based on a graph 'gdef'.
+  Executor* NewExecutor(const Graph* graph, bool use_static_plan) {
     const int version = graph->versions().producer();
     LocalExecutorParams params;
     params.device = device_;
@@ -67,8 +69,16 @@ class ExecutorTest : public ::testing::Test {
     params.delete_kernel = [](OpKernel* kernel) {
       DeleteNonCachedKernel(kernel);
     };
+    params.use_static_plan = use_static_plan;
+    Executor* exec = nullptr;
+    TF_CHECK_OK(NewLocalExecutor(params, graph, &exec));
+    return exec;
+  }
+
+  // Resets executor_ with a new executor based on a graph 'gdef'.
+  void Create(const Graph* graph, bool use_static_plan = false) {
     delete exec_;
-    TF_CHECK_OK(NewLocalExecutor(params, graph, &exec_));
+    exec_ = NewExecutor(graph, use_static_plan);
     runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
     rendez_ = NewLocalRendezvous();
   }
@@ -192,6 +202,54 @@ TEST_F(ExecutorTest, SelfAdd) {
   EXPECT_EQ(1024.0, V(out));  // b=v10=2*v9=4*v8=...=1024*a=1024.0
 }
 
+TEST_F(ExecutorTest, StaticPlanRecvBeforeSend) {
+  // Two partitions which receive from each other. In ALICE's partition
+  // the Recv of "b" sorts before the Send of "a" which BOB waits for, so
+  // running its nodes one after another would never send "a".
+  Graph* alice = new Graph(OpRegistry::Global());
+  auto b = test::graph::Recv(alice, "b", "float", BOB, 1, ALICE);
+  test::graph::Send(alice, b, "c", ALICE, 1, BOB);
+  auto one = test::graph::Constant(alice, V(1.0));
+  test::graph::Send(alice, one, "a", ALICE, 1, BOB);
+  FixupSourceAndSinkEdges(alice);
+  Graph* bob = new Graph(OpRegistry::Global());
+  auto a = test::graph::Recv(bob, "a", "float", ALICE, 1, BOB);
+  test::graph::Send(bob, test::graph::Identity(bob, a), "b", BOB, 1, ALICE);
+  FixupSourceAndSinkEdges(bob);
+  Create(alice, true /* use_static_plan */);
+  std::unique_ptr<Executor> bob_exec(NewExecutor(bob, true));
+
+  Executor::Args args;
+  args.rendezvous = rendez_;
+  args.runner = runner_;
+  Notification alice_done, bob_done;
+  Status alice_status, bob_status;
+  exec_->RunAsync(args, [&alice_done, &alice_status](const Status& s) {
+    alice_status = s;
+    alice_done.Notify();
+  });
+  bob_exec->RunAsync(args, [&bob_done, &bob_status](const Status& s) {
+    bob_status = s;
+    bob_done.Notify();
+  });
+  const int64 kTimeoutMs = 10 * 1000;
+  if (!WaitForNotificationWithTimeout(&alice_done, kTimeoutMs) ||
+      !WaitForNotificationWithTimeout(&bob_done, kTimeoutMs)) {
+    ADD_FAILURE() << "The partitions did not finish";
+    rendez_->StartAbort(errors::DeadlineExceeded("Deadlocked"));
+    alice_done.WaitForNotification();
+    bob_done.WaitForNotification();
+  }
+  TF_ASSERT_OK(alice_status);
+  TF_ASSERT_OK(bob_status);
+  Rendezvous::Args rargs;
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(ALICE, kIncarnation, BOB, "c"), rargs, &out, &is_dead));
+  EXPECT_EQ(1.0, V(out));
+}
+
 // Builds a graph which adds N copies of one variable "in". I.e.,
 //     a + a + a + ... + a
 // The returned graph is parenthesized ramdonly. I.e.,
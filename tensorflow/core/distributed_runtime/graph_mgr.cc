@@ -139,6 +139,9 @@ Status GraphMgr::InitItem(const string& session, const GraphDef& gdef,
   }
 
   LocalExecutorParams params;
+  params.use_work_stealing = graph_options.use_work_stealing_executor();
+  params.max_workers = worker_env_->compute_pool->NumThreads();
+  params.use_static_plan = graph_options.use_static_execution_plan();
 
   Status s;
   item->units.reserve(partitions.size());
@@ -240,9 +243,34 @@ Status GraphMgr::Register(const string& session, const GraphDef& gdef,
   return Status::OK();
 }
 
+Status GraphMgr::RegisterStepSignature(const StepSignature& signature,
+                                       int64* handle) {
+  mutex_lock l(mu_);
+  if (table_.count(signature.graph_handle) == 0) {
+    return errors::Aborted("Graph handle is not found: ",
+                           signature.graph_handle);
+  }
+  *handle = ++next_id_;
+  step_signatures_.insert(
+      {*handle, std::make_shared<const StepSignature>(signature)});
+  return Status::OK();
+}
+
+Status GraphMgr::LookupStepSignature(
+    int64 handle, std::shared_ptr<const StepSignature>* signature) {
+  mutex_lock l(mu_);
+  auto iter = step_signatures_.find(handle);
+  if (iter == step_signatures_.end()) {
+    return errors::Aborted("Step signature is not found: ", handle,
+                           ". Possibly, this worker just restarted.");
+  }
+  *signature = iter->second;
+  return Status::OK();
+}
+
 Status GraphMgr::Deregister(const string& handle) {
   Item* item = nullptr;
-  // Removes one item from table_.
+  // Removes one item from table_, and the step signatures of its graph.
   {
     mutex_lock l(mu_);
     auto iter = table_.find(handle);
@@ -252,6 +280,13 @@ Status GraphMgr::Deregister(const string& handle) {
     }
     item = iter->second;
     table_.erase(iter);
+    for (auto sig = step_signatures_.begin(); sig != step_signatures_.end();) {
+      if (sig->second->graph_handle == handle) {
+        sig = step_signatures_.erase(sig);
+      } else {
+        ++sig;
+      }
+    }
   }
   item->Unref();
   return Status::OK();
@@ -266,6 +301,7 @@ Status GraphMgr::DeregisterAll() {
       items.push_back(entry.second);
     }
     table_.clear();
+    step_signatures_.clear();
   }
   for (auto item : items) {
     item->Unref();
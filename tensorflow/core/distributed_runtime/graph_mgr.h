@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_GRAPH_MGR_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_GRAPH_MGR_H_
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -82,6 +83,24 @@ class GraphMgr {
   Status SendInputs(const int64 step_id, const NamedTensors& in);
   Status RecvOutputs(const int64 step_id, NamedTensors* out);
 
+  // The keys of the inputs and outputs of the steps of a registered graph,
+  // which a caller running many steps with the same keys can register once
+  // and then refer to by a handle.
+  struct StepSignature {
+    string graph_handle;
+    std::vector<string> send_keys;
+    std::vector<string> recv_keys;
+  };
+
+  // Registers "signature" of the registered graph
+  // "signature.graph_handle". Fills in "handle", which is never 0. The
+  // signature is deregistered with its graph.
+  Status RegisterStepSignature(const StepSignature& signature, int64* handle);
+
+  // Looks up the signature registered under "handle".
+  Status LookupStepSignature(int64 handle,
+                             std::shared_ptr<const StepSignature>* signature);
+
   // Deregisters a graph.
   Status Deregister(const string& handle);
 
@@ -140,6 +159,10 @@ class GraphMgr {
   // mechanism to gc these graphs.
   std::unordered_map<string, Item*> table_;
 
+  // Table mapping step signature handles to registered step signatures.
+  std::unordered_map<int64, std::shared_ptr<const StepSignature>>
+      step_signatures_ GUARDED_BY(mu_);
+
   void StartParallelExecutors(const string& handle, Item* item,
                               Rendezvous* rendezvous,
                               StepStatsCollector* collector,
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/master_session.h"
 
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -66,7 +67,10 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
         client_graph_(std::move(cg)),
         bopts_(bopts),
         session_opts_(session_opts),
-        is_partial_(is_partial) {
+        is_partial_(is_partial),
+        cache_step_signatures_(
+            !is_partial &&
+            session_opts.config.rpc_options().cache_step_signatures()) {
     VLOG(1) << "Created ReffedClientGraph for node with "
             << client_graph_->graph.num_node_ids();
 
@@ -224,6 +228,7 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
   BuildGraphOptions bopts_;
   const SessionOptions session_opts_;
   const bool is_partial_;
+  const bool cache_step_signatures_;
   std::unordered_map<StringPiece, Node*, StringPiece::Hasher> name_to_node_;
 
   // Graph partitioned into per-location subgraphs.
@@ -235,6 +240,10 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
     GraphDef gdef;
 
     // Maps feed names to rendezvous keys. Empty most of the time.
+    //
+    // Both maps are not modified after registration, so the order in which
+    // they are iterated is the same for all the steps, which a cached step
+    // signature relies on.
     std::unordered_map<string, string> feed_key;
 
     // Maps rendezvous keys to fetch names. Empty most of the time.
@@ -266,6 +275,12 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
   // init_result_ remembers the initialization error if any.
   Status init_result_ GUARDED_BY(mu_);
 
+  // The step signature cached by the worker of each partition, 0 until a
+  // step returns it, or kCachingStepSignature while a step asks the worker
+  // to cache it. Only used if cache_step_signatures_.
+  static const int64 kCachingStepSignature = -1;
+  std::vector<int64> step_signatures_ GUARDED_BY(mu_);
+
   std::unique_ptr<StatsPublisherInterface> stats_publisher_;
 
   // Send/Recv nodes that are the result of client-added
@@ -302,6 +317,7 @@ Status MasterSession::ReffedClientGraph::RegisterPartitions(
       stats_publisher_->PublishGraphProto(graph_defs);
       mu_.lock();
       init_result_ = s;
+      step_signatures_.resize(partitions_.size());
       init_done_.Notify();
     } else {
       mu_.unlock();
@@ -414,6 +430,10 @@ Status MasterSession::ReffedClientGraph::DoRegisterPartitions(
     c->req.set_session_handle(session_handle_);
     *c->req.mutable_graph_def() = part.gdef;
     *c->req.mutable_graph_options() = session_opts_.config.graph_options();
+    if (is_partial_) {
+      // The feeds of a partial run arrive while its executors run.
+      c->req.mutable_graph_options()->set_use_static_execution_plan(false);
+    }
     VLOG(2) << "Register " << part.gdef.DebugString();
     auto cb = [c, &done](const Status& s) {
       c->status = s;
@@ -536,6 +556,12 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
   const int num = partitions_.size();
   RunManyGraphs calls(num);
 
+  std::vector<int64> step_signatures(num);
+  if (cache_step_signatures_) {
+    mutex_lock l(mu_);
+    step_signatures = step_signatures_;
+  }
+
   for (int i = 0; i < num; ++i) {
     const Part& part = partitions_[i];
     RunManyGraphs::Call* c = calls.get(i);
@@ -543,7 +569,14 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
       c->req.set_is_partial(is_partial_);
       c->req.set_is_last_partial_run(is_last_partial_run);
     }
-    c->req.set_graph_handle(part.graph_handle);
+    // Once the worker cached the step signature, the request only carries
+    // its handle and the values of the feeds.
+    const int64 step_signature = std::max<int64>(step_signatures[i], 0);
+    if (step_signature != 0) {
+      c->req.set_step_signature(step_signature);
+    } else {
+      c->req.set_graph_handle(part.graph_handle);
+    }
     c->req.set_step_id(step_id);
     *c->req.mutable_exec_opts() = exec_opts;
     // If any feeds are provided, send the feed values together
@@ -590,12 +623,26 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
                                          ", key=", key);
         }
         auto* send = c->req.add_send();
-        send->set_key(key);
+        if (step_signature == 0) send->set_key(key);
         *(send->mutable_val()) = *val;  // TODO(mrry): make it faster if needed.
       }
-      for (const auto& key_fetch : part.key_fetch) {
-        const string& key = key_fetch.first;
-        c->req.add_recv_key(key);
+      if (step_signature == 0) {
+        for (const auto& key_fetch : part.key_fetch) {
+          const string& key = key_fetch.first;
+          c->req.add_recv_key(key);
+        }
+      }
+    }
+  }
+
+  // Only one step at a time asks the worker of a partition to cache the step
+  // signature, so that the concurrent first steps do not register several.
+  if (cache_step_signatures_) {
+    mutex_lock l(mu_);
+    for (int i = 0; i < num; ++i) {
+      if (step_signatures_[i] == 0) {
+        step_signatures_[i] = kCachingStepSignature;
+        calls.get(i)->req.set_cache_step_signature(true);
       }
     }
   }
@@ -620,6 +667,19 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
   }
   calls.Wait();
   call_opts->ClearCancelCallback();
+
+  // Remembers the step signatures returned by the workers, even if another
+  // partition failed the step or it was cancelled after they were cached. A
+  // worker which did not return one is asked again by a later step.
+  if (cache_step_signatures_) {
+    mutex_lock l(mu_);
+    for (int i = 0; i < num; ++i) {
+      if (calls.get(i)->req.cache_step_signature()) {
+        step_signatures_[i] = calls.get(i)->resp.step_signature();
+      }
+    }
+  }
+
   if (success) {
     cm->DeregisterCallback(token);
   } else {
@@ -631,9 +691,22 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
   if (status.ok()) {
     for (int i = 0; i < num; ++i) {
       const Part& part = partitions_[i];
+      // With a step signature, the fetches come back without their keys, in
+      // the order of key_fetch.
+      const bool by_signature = calls.get(i)->req.step_signature() != 0;
+      const int num_recvs = calls.get(i)->resp.recv_size();
+      if (by_signature &&
+          static_cast<size_t>(num_recvs) != part.key_fetch.size()) {
+        status.Update(errors::Internal("Expected ", part.key_fetch.size(),
+                                       " fetches from ", part.name,
+                                       " but got ", num_recvs));
+        break;
+      }
+      auto next_key_fetch = part.key_fetch.begin();
       for (auto& recv : *(calls.get(i)->resp.mutable_recv())) {
         auto* ret = resp->add_tensor();
-        auto iter = part.key_fetch.find(recv.key());
+        auto iter = by_signature ? next_key_fetch++
+                                 : part.key_fetch.find(recv.key());
         if (iter == part.key_fetch.end()) {
           status.Update(errors::Internal("Unexpected fetch key: ", recv.key()));
           break;
@@ -642,7 +715,7 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
         ret->set_name(fetch);
         if (!CopyIfNeeded(recv.mutable_val(), ret->mutable_tensor())) {
           status.Update(
-              errors::Internal("Unexpected unparseable tensor: ", recv.key()));
+              errors::Internal("Unexpected unparseable tensor: ", iter->first));
           break;
         }
       }
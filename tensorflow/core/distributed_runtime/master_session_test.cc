@@ -0,0 +1,265 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/master_session.h"
+
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/distributed_runtime/call_options.h"
+#include "tensorflow/core/distributed_runtime/master_env.h"
+#include "tensorflow/core/distributed_runtime/worker_cache.h"
+#include "tensorflow/core/distributed_runtime/worker_interface.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+// The RunGraph requests received by the FakeWorkers of a FakeWorkerCache.
+struct FakeWorkerState {
+  mutex mu;
+  // The requests, by graph handle.
+  std::map<string, std::vector<RunGraphRequest>> requests GUARDED_BY(mu);
+  // The recv keys of the cached step signatures, and their graph handle.
+  std::map<int64, std::pair<string, std::vector<string>>> signatures
+      GUARDED_BY(mu);
+  int64 next_handle GUARDED_BY(mu) = 0;
+};
+
+// A worker which does not run the graphs: it records the RunGraph requests,
+// caches the step signatures like the real workers, and returns a scalar for
+// every fetch.
+class FakeWorker : public WorkerInterface {
+ public:
+  FakeWorker(const string& name, FakeWorkerState* state)
+      : name_(name), state_(state) {}
+
+  void GetStatusAsync(const GetStatusRequest* request,
+                      GetStatusResponse* response,
+                      StatusCallback done) override {
+    done(errors::Unimplemented("GetStatus"));
+  }
+
+  void RegisterGraphAsync(const RegisterGraphRequest* request,
+                          RegisterGraphResponse* response,
+                          StatusCallback done) override {
+    response->set_graph_handle(name_);
+    done(Status::OK());
+  }
+
+  void DeregisterGraphAsync(const DeregisterGraphRequest* request,
+                            DeregisterGraphResponse* response,
+                            StatusCallback done) override {
+    done(Status::OK());
+  }
+
+  void RunGraphAsync(CallOptions* opts, const RunGraphRequest* request,
+                     RunGraphResponse* response,
+                     StatusCallback done) override {
+    std::vector<string> recv_keys;
+    {
+      mutex_lock l(state_->mu);
+      if (request->step_signature() != 0) {
+        auto iter = state_->signatures.find(request->step_signature());
+        if (iter == state_->signatures.end()) {
+          done(errors::Aborted("Step signature is not found"));
+          return;
+        }
+        state_->requests[iter->second.first].push_back(*request);
+        recv_keys = iter->second.second;
+      } else {
+        state_->requests[request->graph_handle()].push_back(*request);
+        recv_keys.assign(request->recv_key().begin(),
+                         request->recv_key().end());
+        if (request->cache_step_signature()) {
+          const int64 handle = ++state_->next_handle;
+          state_->signatures[handle] = {request->graph_handle(), recv_keys};
+          response->set_step_signature(handle);
+        }
+      }
+    }
+    if (request->cache_step_signature()) {
+      // Keeps the first steps in flight together.
+      Env::Default()->SleepForMicroseconds(10000);
+    }
+    for (const string& key : recv_keys) {
+      NamedTensor* recv = response->add_recv();
+      if (request->step_signature() == 0) recv->set_key(key);
+      test::AsScalar<float>(1.0).AsProtoField(recv->mutable_val());
+    }
+    done(Status::OK());
+  }
+
+  void CleanupGraphAsync(const CleanupGraphRequest* request,
+                         CleanupGraphResponse* response,
+                         StatusCallback done) override {
+    done(Status::OK());
+  }
+
+  void CleanupAllAsync(const CleanupAllRequest* request,
+                       CleanupAllResponse* response,
+                       StatusCallback done) override {
+    done(Status::OK());
+  }
+
+  void RecvTensorAsync(CallOptions* opts, const RecvTensorRequest* request,
+                       TensorResponse* response, StatusCallback done) override {
+    done(errors::Unimplemented("RecvTensor"));
+  }
+
+  void LoggingAsync(const LoggingRequest* request, LoggingResponse* response,
+                    StatusCallback done) override {
+    done(Status::OK());
+  }
+
+  void TracingAsync(const TracingRequest* request, TracingResponse* response,
+                    StatusCallback done) override {
+    done(Status::OK());
+  }
+
+ private:
+  const string name_;
+  FakeWorkerState* const state_;
+};
+
+class FakeWorkerCache : public WorkerCacheInterface {
+ public:
+  void ListWorkers(std::vector<string>* workers) override {}
+  WorkerInterface* CreateWorker(const string& target) override {
+    return new FakeWorker(target, &state_);
+  }
+  bool GetDeviceLocalityNonBlocking(const string& device,
+                                    DeviceLocality* locality) override {
+    return false;
+  }
+  void GetDeviceLocalityAsync(const string& device, DeviceLocality* locality,
+                              StatusCallback done) override {
+    done(errors::Unimplemented("GetDeviceLocality"));
+  }
+
+  FakeWorkerState* state() { return &state_; }
+
+ private:
+  FakeWorkerState state_;
+};
+
+TEST(MasterSessionTest, StepSignatures) {
+  const string task0 = "/job:localhost/replica:0/task:0";
+  const string task1 = "/job:localhost/replica:0/task:1";
+  std::unique_ptr<Device> local_device(
+      DeviceFactory::NewDevice("CPU", SessionOptions(), task0));
+  std::vector<Device*> remote_devices = {
+      DeviceFactory::NewDevice("CPU", SessionOptions(), task1)};
+  FakeWorkerCache worker_cache;
+  MasterEnv env;
+  env.env = Env::Default();
+  env.worker_cache = &worker_cache;
+  env.ops = OpRegistry::Global();
+  env.local_devices = {local_device.get()};
+
+  // x is fed on task 0, and y = Identity(x) and z = Identity(y) are fetched
+  // from tasks 1 and 0.
+  Graph graph(OpRegistry::Global());
+  Tensor x_tensor = test::AsTensor<float>({1, 2});
+  Node* x = test::graph::Constant(&graph, x_tensor);
+  Node* y = test::graph::Identity(&graph, x);
+  Node* z = test::graph::Identity(&graph, y);
+  GraphDef def;
+  test::graph::ToGraphDef(&graph, &def);
+  for (NodeDef& node : *def.mutable_node()) {
+    node.set_device((node.name() == y->name() ? task1 : task0) + "/cpu:0");
+  }
+
+  SessionOptions options;
+  options.config.mutable_rpc_options()->set_cache_step_signatures(true);
+  MasterSession* session =
+      new MasterSession(options, &env, &remote_devices,
+                        CreateNoOpStatsPublisher);
+  TF_ASSERT_OK(session->Create(&def));
+
+  RunStepRequest req;
+  auto* feed = req.add_feed();
+  feed->set_name(x->name());
+  x_tensor.AsProtoTensorContent(feed->mutable_tensor());
+  req.add_fetch(y->name() + ":0");
+  req.add_fetch(z->name() + ":0");
+  auto run_step = [session, &req]() {
+    CallOptions opts;
+    RunStepResponse resp;
+    TF_EXPECT_OK(session->Run(&opts, &req, &resp));
+    std::set<string> fetched;
+    for (const auto& tensor : resp.tensor()) fetched.insert(tensor.name());
+    EXPECT_EQ(std::set<string>(req.fetch().begin(), req.fetch().end()),
+              fetched);
+  };
+  // Concurrent first steps, of which only one per partition asks its worker
+  // to cache the step signature, then steps which use them.
+  {
+    thread::ThreadPool pool(Env::Default(), "first_steps", 4);
+    for (int i = 0; i < 4; ++i) {
+      pool.Schedule(run_step);
+    }
+  }
+  for (int i = 0; i < 5; ++i) {
+    run_step();
+  }
+
+  {
+    mutex_lock l(worker_cache.state()->mu);
+    const auto& requests = worker_cache.state()->requests;
+    ASSERT_EQ(2, requests.size());
+    for (const auto& p : requests) {
+      int num_caching = 0;
+      const RunGraphRequest* full = nullptr;
+      for (const RunGraphRequest& r : p.second) {
+        if (r.cache_step_signature()) ++num_caching;
+        if (r.step_signature() == 0) full = &r;
+      }
+      EXPECT_EQ(1, num_caching) << p.first;
+      ASSERT_TRUE(full != nullptr);
+      // The later steps only sent the handle and the values.
+      for (int i = p.second.size() - 5; i < p.second.size(); ++i) {
+        const RunGraphRequest& r = p.second[i];
+        EXPECT_NE(0, r.step_signature()) << p.first;
+        EXPECT_TRUE(r.graph_handle().empty());
+        EXPECT_EQ(0, r.recv_key_size());
+        for (const NamedTensor& send : r.send()) {
+          EXPECT_TRUE(send.key().empty());
+        }
+        EXPECT_LT(r.ByteSize(), full->ByteSize());
+      }
+    }
+  }
+  TF_ASSERT_OK(session->Close());
+}
+
+}  // namespace
+}  // namespace tensorflow
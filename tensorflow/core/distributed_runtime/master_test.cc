@@ -35,6 +35,7 @@ limitations under the License.
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/master.pb.h"
 #include "tensorflow/core/protobuf/master_service.grpc.pb.h"
@@ -60,10 +61,12 @@ class MasterTest : public ::testing::Test {
   // rpc calls.
 
   Status CreateSession(const GraphDef& def, string* handle,
-                            int64* initial_version) {
+                            int64* initial_version,
+                            const ConfigProto& config = ConfigProto()) {
     ::grpc::ClientContext ctx;
     CreateSessionRequest req;
     *(req.mutable_graph_def()) = def;
+    *(req.mutable_config()) = config;
     // Invokes placement frequently.
     req.mutable_config()->set_placement_period(1);
     CreateSessionResponse resp;
@@ -420,4 +423,116 @@ TEST_F(MasterTest, EigenProblem) {
   TF_EXPECT_OK(CloseSession(handle));
 }
 
+// Builds a graph in which "x" is fed, "y" = x + x runs on "dev0", and
+// "z" = -x and "w" = z * z run on "dev1".
+static void BuildFeedFetchGraph(const string& dev0, const string& dev1,
+                                GraphDef* def, string names[4]) {
+  Graph graph(OpRegistry::Global());
+  Tensor x_tensor(DT_FLOAT, TensorShape({2}));
+  test::FillValues<float>(&x_tensor, {0, 0});
+  Node* x = test::graph::Constant(&graph, x_tensor);
+  Node* y = test::graph::Add(&graph, x, x);
+  Node* z = test::graph::Unary(&graph, "Neg", x);
+  Node* w = test::graph::Binary(&graph, "Mul", z, z);
+  test::graph::ToGraphDef(&graph, def);
+  for (int i = 0; i < def->node_size(); ++i) {
+    NodeDef* node = def->mutable_node(i);
+    node->set_device(node->name() == y->name() ? dev0 : dev1);
+  }
+  names[0] = x->name();
+  names[1] = y->name() + ":0";
+  names[2] = z->name() + ":0";
+  names[3] = w->name() + ":0";
+}
+
+TEST_F(MasterTest, StepSignatures) {
+  GraphDef def;
+  string names[4];
+  BuildFeedFetchGraph(cluster_->devices()[0].name(),
+                      cluster_->devices()[1].name(), &def, names);
+  for (bool cache_step_signatures : {false, true}) {
+    ConfigProto config;
+    config.mutable_rpc_options()->set_cache_step_signatures(
+        cache_step_signatures);
+    string handle;
+    int64 initial_version;
+    TF_ASSERT_OK(CreateSession(def, &handle, &initial_version, config));
+    // The first step caches the signatures, and the next ones use them. The
+    // workers run in other processes, so that the requests are checked by
+    // MasterSessionTest.StepSignatures; this checks the fetched values.
+    for (int i = 0; i < 5; ++i) {
+      Tensor x = test::AsTensor<float>({1.0f * i, -2.0f * i});
+      Tensor y, z, w;
+      TF_ASSERT_OK(RunStep(handle, {{names[0], &x}},
+                           {{names[1], &y}, {names[2], &z}, {names[3], &w}}));
+      test::ExpectTensorEqual<float>(
+          y, test::AsTensor<float>({2.0f * i, -4.0f * i}));
+      test::ExpectTensorEqual<float>(
+          z, test::AsTensor<float>({-1.0f * i, 2.0f * i}));
+      test::ExpectTensorEqual<float>(
+          w, test::AsTensor<float>({1.0f * i * i, 4.0f * i * i}));
+    }
+    TF_ASSERT_OK(CloseSession(handle));
+  }
+}
+
+// Measures the steps of a graph which does almost no work, so that the
+// time is spent on the RPCs between the master and the workers.
+static void BM_ShortSteps(int iters, int cache_step_signatures) {
+  testing::StopTiming();
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 1;
+  (*options.config.mutable_device_count())["GPU"] = 0;
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_CHECK_OK(test::TestCluster::MakeTestCluster(options, 2, &cluster));
+  std::unique_ptr<grpc::MasterService::Stub> master =
+      grpc::MasterService::NewStub(
+          NewHostPortGrpcChannel(cluster->targets()[0]));
+
+  GraphDef def;
+  string names[4];
+  BuildFeedFetchGraph(cluster->devices()[0].name(),
+                      cluster->devices()[1].name(), &def, names);
+  CreateSessionRequest create_req;
+  *create_req.mutable_graph_def() = def;
+  create_req.mutable_config()->mutable_rpc_options()->set_cache_step_signatures(
+      cache_step_signatures);
+  CreateSessionResponse create_resp;
+  {
+    ::grpc::ClientContext ctx;
+    TF_CHECK_OK(
+        FromGrpcStatus(master->CreateSession(&ctx, create_req, &create_resp)));
+  }
+
+  RunStepRequest req;
+  req.set_session_handle(create_resp.session_handle());
+  auto* feed = req.add_feed();
+  feed->set_name(names[0]);
+  test::AsTensor<float>({1, 2}).AsProtoTensorContent(feed->mutable_tensor());
+  for (int i = 1; i < 4; ++i) {
+    req.add_fetch(names[i]);
+  }
+  auto run_step = [&master, &req]() {
+    ::grpc::ClientContext ctx;
+    RunStepResponse resp;
+    TF_CHECK_OK(FromGrpcStatus(master->RunStep(&ctx, req, &resp)));
+  };
+  // Registers the partitions and caches the step signatures.
+  run_step();
+
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    run_step();
+  }
+  testing::StopTiming();
+
+  ::grpc::ClientContext ctx;
+  CloseSessionRequest close_req;
+  close_req.set_session_handle(create_resp.session_handle());
+  CloseSessionResponse close_resp;
+  TF_CHECK_OK(
+      FromGrpcStatus(master->CloseSession(&ctx, close_req, &close_resp)));
+}
+BENCHMARK(BM_ShortSteps)->Arg(0)->Arg(1);
+
 }  // namespace tensorflow
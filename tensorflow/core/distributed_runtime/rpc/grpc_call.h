@@ -50,6 +50,11 @@ namespace tensorflow {
 //   `Call` type, in order to access its state, and invoke its
 //   `SendResponse()` method.
 //
+// * `ServerStreamingCall<Service, GrpcService, Req, Resp>`: Like
+//   `Call`, but for a method which sends a stream of response
+//   messages. The handler writes the messages one at a time with
+//   `Write()`, and ends the stream with `Finish()`.
+//
 // The lifecycle of a call object is as follows.
 //
 // 1. A `Service` creates a `Call` for a particular method and
@@ -93,13 +98,17 @@ class UntypedCall : public core::RefCounted {
   // the `grpc::ServerContext` associated with the request.
   virtual void RequestCancelled(Service* service, bool ok) = 0;
 
+  // This method will be called when a message of a streaming response has
+  // been written. `ok` is false if the stream is broken.
+  virtual void WriteDone(Service* service, bool ok) {}
+
   // Associates a tag in a `::grpc::CompletionQueue` with a callback
   // for an incoming RPC.  An active Tag owns a reference on the corresponding
   // Call object.
   class Tag {
    public:
     // One enum value per supported callback.
-    enum Callback { kRequestReceived, kResponseSent, kCancelled };
+    enum Callback { kRequestReceived, kResponseSent, kCancelled, kWriteDone };
 
     Tag(UntypedCall* call, Callback cb) : call_(call), callback_(cb) {}
 
@@ -117,6 +126,9 @@ class UntypedCall : public core::RefCounted {
         case kCancelled:
           call_->RequestCancelled(service, ok);
           break;
+        case kWriteDone:
+          call_->WriteDone(service, ok);
+          break;
       }
       call_->Unref();  // Ref acquired when tag handed to grpc.
     }
@@ -256,6 +268,130 @@ class Call : public UntypedCall<Service> {
   std::function<void()> cancel_callback_ GUARDED_BY(mu_);
 };
 
+// Represents a pending call of a method with a streaming response, with
+// known request and response message types, and a known request-handling
+// method.
+template <class Service, class GrpcService, class RequestMessage,
+          class ResponseMessage>
+class ServerStreamingCall : public UntypedCall<Service> {
+ public:
+  // Represents the generic signature of a `Service::HandleFoo()`
+  // method, where `Foo` is the name of an RPC method.
+  using HandleRequestFunction = void (Service::*)(
+      ServerStreamingCall<Service, GrpcService, RequestMessage,
+                          ResponseMessage>*);
+
+  ServerStreamingCall(HandleRequestFunction handle_request_function)
+      : handle_request_function_(handle_request_function), writer_(&ctx_) {}
+
+  virtual ~ServerStreamingCall() {}
+
+  void RequestReceived(Service* service, bool ok) override {
+    if (ok) {
+      this->Ref();
+      (service->*handle_request_function_)(this);
+    }
+  }
+
+  // Writes `message` in the stream, and calls `done` once it has been
+  // written, with false if the stream is broken. There can be only one
+  // outstanding write at a time.
+  void Write(ResponseMessage message, std::function<void(bool)> done) {
+    this->Ref();  // Ref for grpc; released in Tag callback.
+    pending_message_ = std::move(message);
+    write_done_ = std::move(done);
+    writer_.Write(pending_message_, &write_done_tag_);
+  }
+
+  // Ends the stream with `status`, after the outstanding write.
+  void Finish(::grpc::Status status) {
+    this->Ref();  // Ref for grpc; released in Tag callback.
+    writer_.Finish(status, &response_sent_tag_);
+    this->Unref();
+  }
+
+  void WriteDone(Service* service, bool ok) override {
+    std::function<void(bool)> done;
+    std::swap(done, write_done_);
+    done(ok);
+  }
+
+  void RequestCancelled(Service* service, bool ok) override {
+    if (ctx_.IsCancelled()) {
+      mutex_lock l(mu_);
+      if (cancel_callback_) {
+        cancel_callback_();
+      }
+    }
+  }
+
+  // Registers `callback` as the function that should be called if and when this
+  // call is cancelled by the client.
+  void SetCancelCallback(std::function<void()> callback) {
+    mutex_lock l(mu_);
+    cancel_callback_ = std::move(callback);
+  }
+
+  // Clears any cancellation callback that has been registered for this call.
+  void ClearCancelCallback() {
+    mutex_lock l(mu_);
+    cancel_callback_ = nullptr;
+  }
+
+  // Enqueues a new request for the given service on the given
+  // completion queue, using the given `method_id`.
+  //
+  // The request will be handled with the given
+  // `handle_request_function`.
+  static void EnqueueRequestForMethod(
+      GrpcService* grpc_service, ::grpc::ServerCompletionQueue* cq,
+      int method_id, HandleRequestFunction handle_request_function,
+      bool supports_cancel) {
+    auto call = new ServerStreamingCall<Service, GrpcService, RequestMessage,
+                                        ResponseMessage>(
+        handle_request_function);
+    if (supports_cancel) {
+      call->RegisterCancellationHandler();
+    }
+
+    // Initial ref for call handed to grpc; released in Tag callback.
+    grpc_service->RequestAsyncServerStreaming(method_id, &call->ctx_,
+                                              &call->request, &call->writer_,
+                                              cq, cq,
+                                              &call->request_received_tag_);
+  }
+
+  RequestMessage request;
+
+ private:
+  // Creates a completion queue tag for handling cancellation by the client.
+  // NOTE: This method must be called before this call is enqueued on a
+  // completion queue.
+  void RegisterCancellationHandler() {
+    this->Ref();  // Ref for grpc; released in Tag callback.
+    ctx_.AsyncNotifyWhenDone(&cancelled_tag_);
+  }
+
+  HandleRequestFunction handle_request_function_;
+  ::grpc::ServerContext ctx_;
+  ::grpc::ServerAsyncWriter<ResponseMessage> writer_;
+
+  // The message being written and the callback of the write.
+  ResponseMessage pending_message_;
+  std::function<void(bool)> write_done_;
+
+  // Used as void* completion markers from grpc to indicate different
+  // events of interest for a ServerStreamingCall.
+  typedef typename UntypedCall<Service>::Tag Tag;
+  Tag request_received_tag_{this, Tag::kRequestReceived};
+  Tag write_done_tag_{this, Tag::kWriteDone};
+  Tag response_sent_tag_{this, Tag::kResponseSent};
+  Tag cancelled_tag_{this, Tag::kCancelled};
+
+  mutex mu_;
+  std::function<void()> cancel_callback_ GUARDED_BY(mu_);
+};
+
 }  // namespace tensorflow
 
 #endif  // THIRD_PARTY_TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_CALL_H_
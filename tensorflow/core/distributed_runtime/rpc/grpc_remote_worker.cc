@@ -46,6 +46,9 @@ class GrpcRemoteWorker : public WorkerInterface {
         cleanupgraph_(Method(GrpcWorkerMethod::kCleanupGraph)),
         cleanupall_(Method(GrpcWorkerMethod::kCleanupAll)),
         recvtensor_(Method(GrpcWorkerMethod::kRecvTensor)),
+        recvtensorstream_(GrpcWorkerMethodName(
+                              GrpcWorkerMethod::kRecvTensorStream),
+                          ::grpc::RpcMethod::SERVER_STREAMING, channel_),
         logging_(Method(GrpcWorkerMethod::kLogging)),
         tracing_(Method(GrpcWorkerMethod::kTracing)),
         logger_(logger) {}
@@ -156,6 +159,13 @@ class GrpcRemoteWorker : public WorkerInterface {
       cb_to_use = &wrapper_done;
     }
 
+    if (request->stream_chunk_bytes() > 0) {
+      auto state = new RecvTensorStreamState(response, std::move(*cb_to_use),
+                                             call_opts);
+      state->StartRPC(channel_.get(), cq_, recvtensorstream_,
+                      req_copy ? *req_copy : *request);
+      return;
+    }
     IssueRequest(req_copy ? req_copy : request, response, recvtensor_,
                  std::move(*cb_to_use), call_opts);
   }
@@ -218,6 +228,85 @@ class GrpcRemoteWorker : public WorkerInterface {
     }
   };
 
+  // Object allocated per active RecvTensorStream RPC. Reads the messages of
+  // the stream into the response one after the other, and calls "done"
+  // at the end of the stream.
+  class RecvTensorStreamState final : public GrpcClientCQTag {
+   public:
+    RecvTensorStreamState(TensorResponse* response, StatusCallback done,
+                          CallOptions* call_opts)
+        : call_opts_(call_opts), done_(std::move(done)) {
+      stream_.response = response;
+    }
+
+    ~RecvTensorStreamState() override {}
+
+    // Starts the call; "this" is returned by the completion queue once it
+    // is started.
+    void StartRPC(::grpc::ChannelInterface* channel,
+                  ::grpc::CompletionQueue* cq, const ::grpc::RpcMethod& method,
+                  const RecvTensorRequest& request) {
+      reader_.reset(new ::grpc::ClientAsyncReader<TensorResponseStream>(
+          channel, cq, method, InitContext(call_opts_), request, this));
+    }
+
+    void OnCompleted(bool ok) override {
+      switch (state_) {
+        case State::kStarting:
+        case State::kReading:
+          if (ok) {
+            state_ = State::kReading;
+            reader_->Read(&stream_, this);
+          } else {
+            state_ = State::kFinishing;
+            reader_->Finish(&status_, this);
+          }
+          return;
+        case State::kFinishing:
+          break;
+      }
+      if (!status_.ok()) {
+        VLOG(2) << "Call returned with non-ok status: "
+                << status_.error_message();
+      }
+      if (call_opts_) {
+        call_opts_->ClearCancelCallback();
+      }
+      // A parse error ends the stream without changing the status sent by
+      // the server.
+      Status s = stream_.status;
+      if (s.ok()) {
+        s = FromGrpcStatus(status_);
+      }
+      if (s.ok() && (stream_.num_messages == 0 ||
+                     stream_.response->pending_content_bytes() > 0)) {
+        s = errors::Internal("RecvTensorStream ended before the tensor was "
+                             "fully received");
+      }
+      done_(s);
+      delete this;
+    }
+
+   private:
+    enum class State { kStarting, kReading, kFinishing };
+
+    CallOptions* call_opts_;
+    ::grpc::ClientContext context_;
+    std::unique_ptr<::grpc::ClientAsyncReader<TensorResponseStream>> reader_;
+    TensorResponseStream stream_;
+    State state_ = State::kStarting;
+    ::grpc::Status status_;
+    StatusCallback done_;
+
+    ::grpc::ClientContext* InitContext(CallOptions* call_opts) {
+      context_.set_fail_fast(false);
+      if (call_opts) {
+        call_opts->SetCancelCallback([this]() { context_.TryCancel(); });
+      }
+      return &context_;
+    }
+  };
+
   // Utility method for issuing a generic asynchronous request. The
   // given callback, `done`, will be called when the RPC completes.
   template <class RequestMessage, class ResponseMessage>
@@ -245,6 +334,7 @@ class GrpcRemoteWorker : public WorkerInterface {
   const ::grpc::RpcMethod cleanupgraph_;
   const ::grpc::RpcMethod cleanupall_;
   const ::grpc::RpcMethod recvtensor_;
+  const ::grpc::RpcMethod recvtensorstream_;
   const ::grpc::RpcMethod logging_;
   const ::grpc::RpcMethod tracing_;
 
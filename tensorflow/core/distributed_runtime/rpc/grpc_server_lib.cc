@@ -34,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_cache.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service.h"
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_ring.h"
 #include "tensorflow/core/distributed_runtime/server_lib.h"
 #include "tensorflow/core/distributed_runtime/worker_env.h"
 #include "tensorflow/core/framework/op.h"
@@ -66,6 +67,7 @@ GrpcServer::~GrpcServer() {
   delete worker_env_.device_mgr;
 
   delete worker_env_.rendezvous_mgr;
+  delete worker_env_.shared_memory_ring;
 
   // Do not delete (as these are not owned by the server):
   // - master_env_.env
@@ -192,7 +194,15 @@ Status GrpcServer::Init() {
   // Finish setting up worker environment.
   worker_env_.graph_mgr = new GraphMgr(&worker_env_);
   worker_env_.compute_pool = ComputePool(sess_opts);
-  worker_env_.rendezvous_mgr = new RpcRendezvousMgr(&worker_env_);
+  const RPCOptions& rpc_options =
+      server_def_.default_session_config().rpc_options();
+  if (rpc_options.shared_memory_ring_bytes() > 0) {
+    std::unique_ptr<SharedMemoryRing> ring;
+    TF_RETURN_IF_ERROR(SharedMemoryRing::Create(
+        rpc_options.shared_memory_ring_bytes(), &ring));
+    worker_env_.shared_memory_ring = ring.release();
+  }
+  worker_env_.rendezvous_mgr = new RpcRendezvousMgr(&worker_env_, rpc_options);
 
   return Status::OK();
 }
@@ -16,20 +16,29 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_session.h"
 
 #include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/distributed_runtime/call_options.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_channel.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_testlib.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_worker_cache.h"
+#include "tensorflow/core/distributed_runtime/worker_interface.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/graph/default_device.h"
 #include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/lib/core/error_codes.pb.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/init_main.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/master.pb.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/util/port.h"
 
@@ -386,6 +395,148 @@ TEST(GrpcSessionTest, LargeTensorSend) {
   TF_CHECK_OK(session->Close());
 }
 
+TEST(GrpcSessionTest, StreamedTensorSend) {
+  // The workers receive the tensors in host memory in chunks which do not
+  // divide the size of the tensor.
+  SessionOptions cluster_options = Devices(1, 0);
+  cluster_options.config.mutable_rpc_options()
+      ->set_recv_tensor_stream_chunk_bytes(100000);
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_CHECK_OK(
+      test::TestCluster::MakeTestCluster(cluster_options, 2, &cluster));
+
+  Graph graph(OpRegistry::Global());
+
+  // Define a 4 MB fill result.
+  Tensor fill_shape_tensor = test::AsTensor<int32>({1000, 1000});
+  Node* fill_shape_node = test::graph::Constant(&graph, fill_shape_tensor);
+  Tensor fill_val_tensor(DT_FLOAT, TensorShape({}));
+  fill_val_tensor.flat<float>()(0) = 1.0;
+  Node* fill_val_node = test::graph::Constant(&graph, fill_val_tensor);
+  Node* fill_node =
+      test::graph::Binary(&graph, "Fill", fill_shape_node, fill_val_node);
+
+  // Sums all the elements, so that a missing chunk changes the result.
+  Node* sum_axes_node =
+      test::graph::Constant(&graph, test::AsTensor<int32>({0, 1}));
+  Node* sum_node = test::graph::Reduce(&graph, "Sum", fill_node, sum_axes_node);
+
+  GraphDef def;
+  test::graph::ToGraphDef(&graph, &def);
+
+  SetDevice(&def, fill_node->name(), cluster->devices()[0].name());
+  SetDevice(&def, sum_node->name(), cluster->devices()[1].name());
+
+  std::unique_ptr<Session> session(
+      NewRemote(Options(cluster->targets()[0], 1000)));
+  ASSERT_TRUE(session != nullptr);
+  TF_CHECK_OK(session->Create(def));
+  {
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->Run({}, {sum_node->name()}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    IsSingleFloatValue(outputs[0], 1000000.0);
+  }
+  TF_CHECK_OK(session->Close());
+}
+
+TEST(GrpcSessionTest, SharedMemoryTensorSend) {
+  // The workers run on the same host: the 4 MB tensor goes through the
+  // shared memory ring, or through the response when it does not fit.
+  for (int64 ring_bytes : {16 << 20, 1 << 20}) {
+    SessionOptions cluster_options = Devices(1, 0);
+    cluster_options.config.mutable_rpc_options()->set_shared_memory_ring_bytes(
+        ring_bytes);
+    std::unique_ptr<test::TestCluster> cluster;
+    TF_CHECK_OK(
+        test::TestCluster::MakeTestCluster(cluster_options, 2, &cluster));
+
+    Graph graph(OpRegistry::Global());
+    Tensor fill_shape_tensor = test::AsTensor<int32>({1000, 1000});
+    Node* fill_shape_node = test::graph::Constant(&graph, fill_shape_tensor);
+    Tensor fill_val_tensor(DT_FLOAT, TensorShape({}));
+    fill_val_tensor.flat<float>()(0) = 1.0;
+    Node* fill_val_node = test::graph::Constant(&graph, fill_val_tensor);
+    Node* fill_node =
+        test::graph::Binary(&graph, "Fill", fill_shape_node, fill_val_node);
+    Node* sum_axes_node =
+        test::graph::Constant(&graph, test::AsTensor<int32>({0, 1}));
+    Node* sum_node =
+        test::graph::Reduce(&graph, "Sum", fill_node, sum_axes_node);
+
+    GraphDef def;
+    test::graph::ToGraphDef(&graph, &def);
+    SetDevice(&def, fill_node->name(), cluster->devices()[0].name());
+    SetDevice(&def, sum_node->name(), cluster->devices()[1].name());
+
+    std::unique_ptr<Session> session(
+        NewRemote(Options(cluster->targets()[0], 1000)));
+    ASSERT_TRUE(session != nullptr);
+    TF_CHECK_OK(session->Create(def));
+    // Several steps, so that the regions of the ring are reused.
+    for (int i = 0; i < 5; ++i) {
+      std::vector<Tensor> outputs;
+      TF_CHECK_OK(session->Run({}, {sum_node->name()}, {}, &outputs));
+      ASSERT_EQ(1, outputs.size());
+      IsSingleFloatValue(outputs[0], 1000000.0);
+    }
+    TF_CHECK_OK(session->Close());
+  }
+}
+
+TEST(GrpcSessionTest, AllReduce) {
+  const int kNumWorkers = 3;
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_CHECK_OK(
+      test::TestCluster::MakeTestCluster(Devices(1, 0), kNumWorkers, &cluster));
+
+  Graph graph(OpRegistry::Global());
+  const int kSize = 1048576;
+
+  // Worker i reduces a tensor filled with i + 1, in chunks of 64KB.
+  std::vector<Node*> inputs;
+  std::vector<Node*> all_reduces;
+  for (int i = 0; i < kNumWorkers; ++i) {
+    Tensor t(DT_FLOAT, TensorShape({kSize}));
+    t.flat<float>().setConstant(i + 1);
+    inputs.push_back(test::graph::Constant(&graph, t));
+    Node* all_reduce;
+    TF_CHECK_OK(NodeBuilder(graph.NewName("n"), "AllReduce")
+                    .Input(inputs.back())
+                    .Attr("group_key", "g")
+                    .Attr("chunk_bytes", 65536)
+                    .Finalize(&graph, &all_reduce));
+    all_reduces.push_back(all_reduce);
+  }
+
+  GraphDef def;
+  test::graph::ToGraphDef(&graph, &def);
+  for (int i = 0; i < kNumWorkers; ++i) {
+    SetDevice(&def, inputs[i]->name(), cluster->devices()[i].name());
+    SetDevice(&def, all_reduces[i]->name(), cluster->devices()[i].name());
+  }
+
+  std::unique_ptr<Session> session(
+      NewRemote(Options(cluster->targets()[0], 1000)));
+  ASSERT_TRUE(session != nullptr);
+  TF_CHECK_OK(session->Create(def));
+  for (int step = 0; step < 2; ++step) {
+    std::vector<string> names;
+    for (Node* all_reduce : all_reduces) {
+      names.push_back(all_reduce->name());
+    }
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->Run({}, names, {}, &outputs));
+    ASSERT_EQ(kNumWorkers, outputs.size());
+    Tensor expected(DT_FLOAT, TensorShape({kSize}));
+    expected.flat<float>().setConstant(6);
+    for (const Tensor& output : outputs) {
+      test::ExpectTensorEqual<float>(output, expected);
+    }
+  }
+  TF_CHECK_OK(session->Close());
+}
+
 TEST(GrpcSessionTest, MultiDevices_String) {
   std::unique_ptr<test::TestCluster> cluster;
   TF_CHECK_OK(test::TestCluster::MakeTestCluster(Devices(1, 1), 2, &cluster));
@@ -902,4 +1053,158 @@ TEST(SessionTest, RunTimeoutWithRunOptions) {
               error::INTERNAL == status.code());
 }
 
+TEST(GrpcSessionTest, CachedStepSignatures) {
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_CHECK_OK(test::TestCluster::MakeTestCluster(Devices(1, 0), 2, &cluster));
+  const string& dev_a = cluster->devices()[0].name();
+  const string& dev_b = cluster->devices()[1].name();
+
+  // w = -x + (x + x), with "x" and "z" on dev_a and "y" and "w" on dev_b.
+  Graph graph(OpRegistry::Global());
+  Node* x = test::graph::Constant(&graph, test::AsTensor<float>({0, 0}));
+  Node* y = test::graph::Unary(&graph, "Neg", x);
+  Node* z = test::graph::Add(&graph, x, x);
+  Node* w = test::graph::Add(&graph, y, z);
+  GraphDef def;
+  test::graph::ToGraphDef(&graph, &def);
+  SetDevice(&def, x->name(), dev_a);
+  SetDevice(&def, y->name(), dev_b);
+  SetDevice(&def, z->name(), dev_a);
+  SetDevice(&def, w->name(), dev_b);
+
+  SessionOptions options = Options(cluster->targets()[0], 1);
+  options.config.mutable_rpc_options()->set_cache_step_signatures(true);
+  std::unique_ptr<Session> session(NewRemote(options));
+  TF_CHECK_OK(session->Create(def));
+  const std::vector<string> fetches = {w->name() + ":0", z->name() + ":0",
+                                       y->name() + ":0"};
+  for (int i = 1; i <= 5; ++i) {
+    Tensor x_tensor = test::AsTensor<float>({1.0f * i, -2.0f * i});
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->Run({{x->name(), x_tensor}}, fetches, {}, &outputs));
+    ASSERT_EQ(3, outputs.size());
+    test::ExpectTensorEqual<float>(outputs[0], x_tensor);
+    test::ExpectTensorEqual<float>(
+        outputs[1], test::AsTensor<float>({2.0f * i, -4.0f * i}));
+    test::ExpectTensorEqual<float>(
+        outputs[2], test::AsTensor<float>({-1.0f * i, 2.0f * i}));
+  }
+  TF_CHECK_OK(session->Close());
+
+  // Talks to a worker directly to check the lifetime of the signatures.
+  GrpcChannelSpec spec;
+  TF_CHECK_OK(spec.AddHostPortsJob("localhost", cluster->targets()));
+  std::unique_ptr<WorkerCacheInterface> worker_cache(
+      NewGrpcWorkerCache(NewGrpcChannelCache(spec, NewHostPortGrpcChannel)));
+  const string worker_name = "/job:localhost/replica:0/task:0";
+  WorkerInterface* worker = worker_cache->CreateWorker(worker_name);
+  ASSERT_TRUE(worker != nullptr);
+  auto run_graph = [worker](const RunGraphRequest& req,
+                            RunGraphResponse* resp) {
+    CallOptions opts;
+    Notification done;
+    Status status;
+    worker->RunGraphAsync(&opts, &req, resp, [&done, &status](const Status& s) {
+      status = s;
+      done.Notify();
+    });
+    done.WaitForNotification();
+    return status;
+  };
+  auto register_graph = [worker, &dev_a](Graph* g, string* handle) {
+    RegisterGraphRequest req;
+    test::graph::ToGraphDef(g, req.mutable_graph_def());
+    for (NodeDef& node : *req.mutable_graph_def()->mutable_node()) {
+      node.set_device(dev_a);
+    }
+    RegisterGraphResponse resp;
+    TF_CHECK_OK(worker->RegisterGraph(&req, &resp));
+    *handle = resp.graph_handle();
+  };
+
+  // A step which fails returns no signature.
+  {
+    Graph g(OpRegistry::Global());
+    test::graph::Error(&g, test::graph::Constant(&g, Tensor()), "fantasia!");
+    string handle;
+    register_graph(&g, &handle);
+    RunGraphRequest req;
+    req.set_graph_handle(handle);
+    req.set_step_id(1);
+    req.set_cache_step_signature(true);
+    RunGraphResponse resp;
+    EXPECT_FALSE(run_graph(req, &resp).ok());
+    EXPECT_EQ(0, resp.step_signature());
+  }
+
+  // A step which succeeds returns a signature, which is dropped when its
+  // graph is deregistered.
+  {
+    Graph g(OpRegistry::Global());
+    test::graph::Constant(&g, test::AsScalar<float>(1));
+    string handle;
+    register_graph(&g, &handle);
+    RunGraphRequest req;
+    req.set_graph_handle(handle);
+    req.set_step_id(2);
+    req.set_cache_step_signature(true);
+    RunGraphResponse resp;
+    TF_CHECK_OK(run_graph(req, &resp));
+    const int64 signature = resp.step_signature();
+    ASSERT_NE(0, signature);
+
+    RunGraphRequest cached_req;
+    cached_req.set_step_id(3);
+    cached_req.set_step_signature(signature);
+    TF_CHECK_OK(run_graph(cached_req, &resp));
+
+    DeregisterGraphRequest deregister_req;
+    deregister_req.set_graph_handle(handle);
+    DeregisterGraphResponse deregister_resp;
+    TF_CHECK_OK(worker->DeregisterGraph(&deregister_req, &deregister_resp));
+    cached_req.set_step_id(4);
+    EXPECT_TRUE(errors::IsAborted(run_graph(cached_req, &resp)));
+  }
+  worker_cache->ReleaseWorker(worker_name, worker);
+}
+
+// Measures the steps of a graph which does almost no work over two workers,
+// so that the time is spent on launching the steps.
+static void BM_ShortSteps(int iters, int cache_step_signatures) {
+  testing::StopTiming();
+  std::unique_ptr<test::TestCluster> cluster;
+  TF_CHECK_OK(test::TestCluster::MakeTestCluster(Devices(1, 0), 2, &cluster));
+
+  Graph graph(OpRegistry::Global());
+  Tensor x_tensor = test::AsTensor<float>({1, 2});
+  Node* x = test::graph::Constant(&graph, x_tensor);
+  Node* y = test::graph::Unary(&graph, "Neg", x);
+  Node* z = test::graph::Add(&graph, x, y);
+  GraphDef def;
+  test::graph::ToGraphDef(&graph, &def);
+  SetDevice(&def, x->name(), cluster->devices()[0].name());
+  SetDevice(&def, y->name(), cluster->devices()[1].name());
+  SetDevice(&def, z->name(), cluster->devices()[0].name());
+
+  SessionOptions options = Options(cluster->targets()[0], 1000);
+  options.config.mutable_rpc_options()->set_cache_step_signatures(
+      cache_step_signatures);
+  std::unique_ptr<Session> session(NewRemote(options));
+  TF_CHECK_OK(session->Create(def));
+  const std::vector<std::pair<string, Tensor>> inputs = {
+      {x->name(), x_tensor}};
+  const std::vector<string> fetches = {y->name() + ":0", z->name() + ":0"};
+  std::vector<Tensor> outputs;
+  // Registers the partitions and caches the step signatures.
+  TF_CHECK_OK(session->Run(inputs, fetches, {}, &outputs));
+
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    TF_CHECK_OK(session->Run(inputs, fetches, {}, &outputs));
+  }
+  testing::StopTiming();
+  TF_CHECK_OK(session->Close());
+}
+BENCHMARK(BM_ShortSteps)->Arg(0)->Arg(1);
+
 }  // namespace tensorflow
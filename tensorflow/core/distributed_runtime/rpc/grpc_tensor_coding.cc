@@ -16,11 +16,15 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
 #include "grpc++/support/byte_buffer.h"
 #include "grpc++/support/slice.h"
+#include "tensorflow/core/framework/bfloat16.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_reference.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/io/proto_encode_helper.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
 
 namespace tensorflow {
@@ -138,14 +142,11 @@ static void EncodeSkeleton(const Tensor& val, io::ProtoEncodeHelper* e) {
 #endif
 }
 
-void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
-                              ::grpc::ByteBuffer* result) {
+// Encodes "response", with "val" as its tensor, into "*result".
+static void EncodeTensorWithResponseToByteBuffer(RecvTensorResponse response,
+                                                 const Tensor& val,
+                                                 ::grpc::ByteBuffer* result) {
   const int kLargeTensorBytes = 1024;
-  RecvTensorResponse response;
-  if (is_dead) {
-    response.set_is_dead(is_dead);
-  }
-  response.set_send_start_micros(Env::Default()->NowMicros());
   if (!DataTypeCanUseMemcpy(val.dtype())) {
     // Straightforward but slow path for complicated kinds of tensor data
     // TODO(jeff,sanjay): If this becomes an issue, we could
@@ -265,5 +266,157 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
   }
 }
 
+void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
+                              ::grpc::ByteBuffer* result) {
+  RecvTensorResponse response;
+  if (is_dead) {
+    response.set_is_dead(is_dead);
+  }
+  response.set_send_start_micros(Env::Default()->NowMicros());
+  EncodeTensorWithResponseToByteBuffer(std::move(response), val, result);
+}
+
+namespace {
+
+auto* recv_tensor_bytes = monitoring::Counter<1>::New(
+    "/tensorflow/core/distributed_runtime/recv_tensor_bytes",
+    "The number of bytes of the tensors sent to RecvTensor clients, before "
+    "their transport encoding.",
+    "encoding");
+
+auto* recv_tensor_wire_bytes = monitoring::Counter<1>::New(
+    "/tensorflow/core/distributed_runtime/recv_tensor_wire_bytes",
+    "The number of bytes of the RecvTensor responses sent.", "encoding");
+
+// Returns a copy of "val", of type DT_FLOAT, cast to "dtype".
+Tensor CastFloatTensor(const Tensor& val, DataType dtype) {
+  Tensor result(dtype, val.shape());
+  const float* src = val.flat<float>().data();
+  const int64 n = val.NumElements();
+  if (dtype == DT_BFLOAT16) {
+    FloatToBFloat16(src, result.flat<bfloat16>().data(), n);
+  } else {
+    Eigen::half* dst = result.flat<Eigen::half>().data();
+    for (int64 i = 0; i < n; ++i) {
+      dst[i] = Eigen::half(src[i]);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+void EncodeTensorForTransportToByteBuffer(bool is_dead, const Tensor& val,
+                                          const RecvTensorRequest& request,
+                                          ::grpc::ByteBuffer* result) {
+  // Compressing small tensors is not worth it.
+  const int64 kMinCompressionBytes = 1024;
+  RecvTensorResponse response;
+  if (is_dead) {
+    response.set_is_dead(is_dead);
+  }
+  response.set_send_start_micros(Env::Default()->NowMicros());
+
+  Tensor wire_val = val;
+  string encoding;
+  const DataType wire_dtype = request.accept_wire_dtype();
+  if (!is_dead && val.dtype() == DT_FLOAT &&
+      (wire_dtype == DT_HALF || wire_dtype == DT_BFLOAT16)) {
+    wire_val = CastFloatTensor(val, wire_dtype);
+    response.set_original_dtype(DT_FLOAT);
+    encoding = DataTypeString(wire_dtype);
+  }
+  string compressed;
+  StringPiece tdata = wire_val.tensor_data();
+  if (!is_dead && request.accept_compression() == SNAPPY &&
+      DataTypeCanUseMemcpy(wire_val.dtype()) &&
+      tdata.size() >= kMinCompressionBytes &&
+      port::Snappy_Compress(tdata.data(), tdata.size(), &compressed) &&
+      compressed.size() < tdata.size()) {
+    // The compressed content is copied anyway, so the response is encoded
+    // as a regular protocol buffer.
+    TensorProto* proto = response.mutable_tensor();
+    proto->set_dtype(wire_val.dtype());
+    wire_val.shape().AsProto(proto->mutable_tensor_shape());
+    proto->mutable_tensor_content()->swap(compressed);
+    response.set_compression(SNAPPY);
+    encoding =
+        encoding.empty() ? "snappy" : strings::StrCat(encoding, "+snappy");
+    EncodeRecvTensorResponseToByteBuffer(response, result);
+  } else {
+    EncodeTensorWithResponseToByteBuffer(std::move(response), wire_val, result);
+  }
+  if (encoding.empty()) encoding = "none";
+  recv_tensor_bytes->GetCell(encoding)->IncrementBy(val.TotalBytes());
+  recv_tensor_wire_bytes->GetCell(encoding)->IncrementBy(result->Length());
+}
+
+void EncodeRecvTensorChunkToByteBuffer(const RecvTensorChunk& proto,
+                                       ::grpc::ByteBuffer* result) {
+  size_t len = proto.ByteSize();
+  gpr_slice s = gpr_slice_malloc(len);
+  proto.SerializeWithCachedSizesToArray(
+      reinterpret_cast<uint8*>(GPR_SLICE_START_PTR(s)));
+  ::grpc::Slice slice(s, ::grpc::Slice::STEAL_REF);
+  *result = ::grpc::ByteBuffer(&slice, 1);
+}
+
+bool EncodeTensorStreamHeaderToByteBuffer(bool is_dead, const Tensor& val,
+                                          int64 chunk_bytes,
+                                          ::grpc::ByteBuffer* result) {
+  RecvTensorChunk chunk;
+  RecvTensorResponse* response = chunk.mutable_metadata();
+  if (is_dead) {
+    response->set_is_dead(is_dead);
+  }
+  response->set_send_start_micros(Env::Default()->NowMicros());
+  const bool content_in_chunks = DataTypeCanUseMemcpy(val.dtype()) &&
+                                 static_cast<int64>(val.TotalBytes()) >
+                                     chunk_bytes;
+  if (content_in_chunks) {
+    response->mutable_tensor()->set_dtype(val.dtype());
+    val.shape().AsProto(response->mutable_tensor()->mutable_tensor_shape());
+    chunk.set_content_in_chunks(true);
+  } else {
+    val.AsProtoTensorContent(response->mutable_tensor());
+  }
+
+  EncodeRecvTensorChunkToByteBuffer(chunk, result);
+  return content_in_chunks;
+}
+
+// The chunk is encoded as the offset and the tag and length of the data in
+// a first gpr_slice, followed by a gpr_slice pointing to the backing store
+// of "val" and a zero-length slice releasing it, as in
+// EncodeTensorToByteBuffer.
+void EncodeTensorChunkToByteBuffer(const Tensor& val, int64 offset,
+                                   int64 size, ::grpc::ByteBuffer* result) {
+  static const int kVarintMax64 = 10;  // Max length of varint64 encoding
+  StringPiece tdata = val.tensor_data();
+  CHECK_LE(offset + size, static_cast<int64>(tdata.size()));
+  char space[4 * kVarintMax64];
+  io::ProtoEncodeHelper e(space, sizeof(space));
+  if (offset > 0) {
+    e.WriteUint64(RecvTensorChunk::kOffsetFieldNumber, offset);
+  }
+  e.WriteVarlengthBeginning(RecvTensorChunk::kDataFieldNumber, size);
+
+  ::grpc::Slice slices[3];
+  gpr_slice s0 = gpr_slice_malloc(e.size());
+  memcpy(GPR_SLICE_START_PTR(s0), e.data(), e.size());
+  slices[0] = ::grpc::Slice(s0, ::grpc::Slice::STEAL_REF);
+
+  TensorReference* ref = new TensorReference(val);
+  gpr_slice s1 = gpr_slice_new(
+      const_cast<void*>(static_cast<const void*>(tdata.data() + offset)), size,
+      do_nothing);
+  slices[1] = ::grpc::Slice(s1, ::grpc::Slice::STEAL_REF);
+
+  gpr_slice s2 = gpr_slice_new(ref, 0, unref_tensorreference);
+  slices[2] = ::grpc::Slice(s2, ::grpc::Slice::STEAL_REF);
+
+  *result = ::grpc::ByteBuffer(&slices[0], 3);
+}
+
 }  // namespace grpc
 }  // namespace tensorflow
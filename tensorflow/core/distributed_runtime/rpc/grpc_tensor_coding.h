@@ -16,12 +16,16 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_TENSOR_CODING_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_TENSOR_CODING_H_
 
+#include "tensorflow/core/platform/types.h"
+
 namespace grpc {
 class ByteBuffer;
 }  // namespace grpc
 
 namespace tensorflow {
 class Tensor;
+class RecvTensorChunk;
+class RecvTensorRequest;
 class RecvTensorResponse;
 
 // TODO(jeff,sanjay): this should not be grpc specific.  Instead of
@@ -51,6 +55,44 @@ void EncodeRecvTensorResponseToByteBuffer(const RecvTensorResponse& proto,
 void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
                               ::grpc::ByteBuffer* result);
 
+// Like EncodeTensorToByteBuffer, but also applies the transport encodings
+// of "val" accepted by "request" (see RecvTensorRequest.accept_compression
+// and RecvTensorRequest.accept_wire_dtype) when they are worth it, and
+// records them in the response.
+//
+// Discards original contents of *result.
+void EncodeTensorForTransportToByteBuffer(bool is_dead, const Tensor& val,
+                                          const RecvTensorRequest& request,
+                                          ::grpc::ByteBuffer* result);
+
+// Encode a RecvTensorChunk protocol buffer into a byte buffer.
+//
+// Discards original contents of *result.
+void EncodeRecvTensorChunkToByteBuffer(const RecvTensorChunk& proto,
+                                       ::grpc::ByteBuffer* result);
+
+// Encode the first message of the stream of a streaming RecvTensor, which
+// is parseable as a RecvTensorChunk protocol buffer, into "*result".
+//
+// If "val" can be copied with memcpy and holds more than "chunk_bytes"
+// bytes, the message only holds its dtype and shape, returns true, and the
+// content must be sent in the following messages with
+// EncodeTensorChunkToByteBuffer.  Otherwise the message holds the whole
+// tensor and returns false.
+//
+// Discards original contents of *result.
+bool EncodeTensorStreamHeaderToByteBuffer(bool is_dead, const Tensor& val,
+                                          int64 chunk_bytes,
+                                          ::grpc::ByteBuffer* result);
+
+// Encode the "size" bytes of the content of "val" starting at "offset"
+// into a byte buffer in a format that is parseable as a RecvTensorChunk
+// protocol buffer.  The content is shared with "val" rather than copied.
+//
+// Discards original contents of *result.
+void EncodeTensorChunkToByteBuffer(const Tensor& val, int64 offset,
+                                   int64 size, ::grpc::ByteBuffer* result);
+
 }  // namespace grpc
 }  // namespace tensorflow
 
@@ -15,12 +15,15 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
 
+#include <algorithm>
+
 #include "grpc++/support/byte_buffer.h"
 #include "grpc++/support/slice.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
 
@@ -100,4 +103,115 @@ TEST_F(GrpcTensorCodingTest, Simple) {
 
 TEST_F(GrpcTensorCodingTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+// Returns the content of "buf".
+static string ByteBufferToString(const ::grpc::ByteBuffer& buf) {
+  std::vector<::grpc::Slice> slices;
+  (void)buf.Dump(&slices);
+  string tmp;
+  for (const auto& s : slices) {
+    tmp.append(reinterpret_cast<const char*>(s.begin()), s.size());
+  }
+  return tmp;
+}
+
+TEST_F(GrpcTensorCodingTest, Transport) {
+  // Mostly zeros, so that it compresses, and values which are exact in 16
+  // bits.
+  Tensor t(DT_FLOAT, TensorShape({20, 100}));
+  for (int i = 0; i < t.NumElements(); ++i) {
+    t.flat<float>()(i) = (i % 50 == 0) ? i * 0.5f : 0;
+  }
+  string compressed;
+  const bool can_compress =
+      port::Snappy_Compress(t.tensor_data().data(), t.tensor_data().size(),
+                            &compressed) &&
+      compressed.size() < t.TotalBytes() / 2;
+  for (DataType wire_dtype : {DT_INVALID, DT_HALF, DT_BFLOAT16}) {
+    for (bool compress : {false, true}) {
+      RecvTensorRequest request;
+      request.set_accept_wire_dtype(wire_dtype);
+      if (compress) {
+        request.set_accept_compression(SNAPPY);
+      }
+      ::grpc::ByteBuffer buf;
+      grpc::EncodeTensorForTransportToByteBuffer(false, t, request, &buf);
+      RecvTensorResponse response;
+      EXPECT_TRUE(response.ParseFromString(ByteBufferToString(buf)));
+      EXPECT_EQ(wire_dtype == DT_INVALID ? DT_INVALID : DT_FLOAT,
+                response.original_dtype());
+      EXPECT_EQ(wire_dtype == DT_INVALID ? DT_FLOAT : wire_dtype,
+                response.tensor().dtype());
+      const int64 wire_bytes =
+          t.NumElements() * (wire_dtype == DT_INVALID ? 4 : 2);
+      if (compress && can_compress) {
+        EXPECT_EQ(SNAPPY, response.compression());
+        EXPECT_LT(response.tensor().tensor_content().size(), wire_bytes);
+        continue;
+      }
+      EXPECT_EQ(NO_COMPRESSION, response.compression());
+      Tensor result_tensor;
+      EXPECT_TRUE(result_tensor.FromProto(response.tensor()));
+      EXPECT_EQ(wire_bytes, result_tensor.TotalBytes());
+      if (wire_dtype == DT_INVALID) {
+        test::ExpectTensorEqual<float>(t, result_tensor);
+      }
+    }
+  }
+
+  // Dead tensors and other types are sent as they are.
+  RecvTensorRequest request;
+  request.set_accept_wire_dtype(DT_BFLOAT16);
+  request.set_accept_compression(SNAPPY);
+  Tensor ints(DT_INT32, TensorShape({2}));
+  ::grpc::ByteBuffer buf;
+  grpc::EncodeTensorForTransportToByteBuffer(false, ints, request, &buf);
+  RecvTensorResponse response;
+  EXPECT_TRUE(response.ParseFromString(ByteBufferToString(buf)));
+  EXPECT_EQ(DT_INT32, response.tensor().dtype());
+  EXPECT_EQ(NO_COMPRESSION, response.compression());
+  EXPECT_EQ(DT_INVALID, response.original_dtype());
+  grpc::EncodeTensorForTransportToByteBuffer(true, t, request, &buf);
+  EXPECT_TRUE(response.ParseFromString(ByteBufferToString(buf)));
+  EXPECT_TRUE(response.is_dead());
+  EXPECT_EQ(DT_FLOAT, response.tensor().dtype());
+}
+
+TEST_F(GrpcTensorCodingTest, Stream) {
+  Tensor t(DT_INT32, TensorShape({3, 100}));
+  for (int i = 0; i < t.NumElements(); ++i) {
+    t.flat<int32>()(i) = i;
+  }
+  const int64 total_bytes = t.TotalBytes();
+  for (int64 chunk_bytes : {1, 100, 1000, 1200}) {
+    ::grpc::ByteBuffer buf;
+    const bool content_in_chunks =
+        grpc::EncodeTensorStreamHeaderToByteBuffer(false, t, chunk_bytes, &buf);
+    EXPECT_EQ(chunk_bytes < total_bytes, content_in_chunks);
+    RecvTensorChunk header;
+    EXPECT_TRUE(header.ParseFromString(ByteBufferToString(buf)));
+    EXPECT_EQ(content_in_chunks, header.content_in_chunks());
+    Tensor result_tensor;
+    if (!content_in_chunks) {
+      EXPECT_TRUE(result_tensor.FromProto(header.metadata().tensor()));
+      EXPECT_EQ(t.DebugString(), result_tensor.DebugString());
+      continue;
+    }
+    EXPECT_EQ("", header.metadata().tensor().tensor_content());
+    EXPECT_TRUE(result_tensor.FromProto(header.metadata().tensor()));
+    EXPECT_EQ(t.shape().DebugString(), result_tensor.shape().DebugString());
+    string content;
+    for (int64 offset = 0; offset < total_bytes; offset += chunk_bytes) {
+      const int64 size = std::min(chunk_bytes, total_bytes - offset);
+      grpc::EncodeTensorChunkToByteBuffer(t, offset, size, &buf);
+      RecvTensorChunk chunk;
+      EXPECT_TRUE(chunk.ParseFromString(ByteBufferToString(buf)));
+      EXPECT_FALSE(chunk.has_metadata());
+      EXPECT_EQ(offset, chunk.offset());
+      EXPECT_EQ(size, chunk.data().size());
+      content += chunk.data();
+    }
+    EXPECT_EQ(t.tensor_data(), content);
+  }
+}
+
 }  // namespace tensorflow
@@ -36,7 +36,7 @@ namespace {
 
 Status FillServerDef(const string& job_spec, const string& job_name,
                      int num_cpus, int num_gpus, int task_index,
-                     ServerDef* options) {
+                     const RPCOptions& rpc_options, ServerDef* options) {
   options->set_protocol("grpc");
   options->set_job_name(job_name);
   options->set_task_index(task_index);
@@ -68,6 +68,7 @@ Status FillServerDef(const string& job_spec, const string& job_name,
   ConfigProto* config = options->mutable_default_session_config();
   (*config->mutable_device_count())["CPU"] = num_cpus;
   (*config->mutable_device_count())["GPU"] = num_gpus;
+  *config->mutable_rpc_options() = rpc_options;
   return Status::OK();
 }
 
@@ -81,12 +82,19 @@ int main(int argc, char* argv[]) {
   int num_cpus = 1;
   int num_gpus = 0;
   int task_index = 0;
+  tensorflow::int64 recv_tensor_stream_chunk_bytes = 0;
+  tensorflow::int64 shared_memory_ring_bytes = 0;
   std::vector<tensorflow::Flag> flag_list = {
       tensorflow::Flag("tf_jobs", &job_spec, "job specification"),
       tensorflow::Flag("tf_job", &job_name, "job name"),
       tensorflow::Flag("tf_task", &task_index, "task index"),
       tensorflow::Flag("num_cpus", &num_cpus, "number of CPUs"),
       tensorflow::Flag("num_gpus", &num_gpus, "number of GPUs"),
+      tensorflow::Flag("recv_tensor_stream_chunk_bytes",
+                       &recv_tensor_stream_chunk_bytes,
+                       "size of the chunks of streamed tensors"),
+      tensorflow::Flag("shared_memory_ring_bytes", &shared_memory_ring_bytes,
+                       "size of the shared memory ring"),
   };
   tensorflow::string usage = tensorflow::Flags::Usage(argv[0], flag_list);
   const bool parse_result = tensorflow::Flags::Parse(&argc, argv, flag_list);
@@ -95,9 +103,14 @@ int main(int argc, char* argv[]) {
     return -1;
   }
 
+  tensorflow::RPCOptions rpc_options;
+  rpc_options.set_recv_tensor_stream_chunk_bytes(
+      recv_tensor_stream_chunk_bytes);
+  rpc_options.set_shared_memory_ring_bytes(shared_memory_ring_bytes);
   tensorflow::ServerDef def;
-  tensorflow::Status s = tensorflow::FillServerDef(job_spec, job_name, num_cpus,
-                                                   num_gpus, task_index, &def);
+  tensorflow::Status s =
+      tensorflow::FillServerDef(job_spec, job_name, num_cpus, num_gpus,
+                                task_index, rpc_options, &def);
   if (!s.ok()) {
     LOG(ERROR) << "Could not parse job spec: " << s.error_message() << "\n"
                << usage;
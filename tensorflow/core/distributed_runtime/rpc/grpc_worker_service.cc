@@ -15,7 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service.h"
 
+#include <algorithm>
 #include <deque>
+#include <memory>
 
 #include "grpc++/alarm.h"
 #include "grpc++/server_builder.h"
@@ -36,6 +38,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_ring.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_env.h"
 #include "tensorflow/core/framework/cancellation.h"
@@ -129,6 +132,9 @@ class GrpcWorkerService : public AsyncServiceInterface {
     for (int i = 0; i < 1000; ++i) {
       EnqueueRecvTensorRequestRaw();
     }
+    for (int i = 0; i < 100; ++i) {
+      EnqueueRecvTensorStreamRequest();
+    }
     for (int i = 0; i < 100; ++i) {
       ENQUEUE_REQUEST(RunGraph, true);
     }
@@ -179,6 +185,12 @@ class GrpcWorkerService : public AsyncServiceInterface {
   using WorkerCall = Call<GrpcWorkerService, grpc::WorkerService::AsyncService,
                           RequestMessage, ResponseMessage>;
 
+  template <class RequestMessage, class ResponseMessage>
+  using WorkerStreamingCall =
+      ServerStreamingCall<GrpcWorkerService,
+                          grpc::WorkerService::AsyncService, RequestMessage,
+                          ResponseMessage>;
+
   void GetStatusHandler(WorkerCall<GetStatusRequest, GetStatusResponse>* call) {
     env_->compute_pool->Schedule([this, call]() {
       DeviceMgr* dm = env_->device_mgr;
@@ -235,6 +247,12 @@ class GrpcWorkerService : public AsyncServiceInterface {
     EnqueueRecvTensorRequestRaw();
   }
 
+  void RecvTensorStreamHandler(
+      WorkerStreamingCall<RecvTensorRequest, ::grpc::ByteBuffer>* call) {
+    env_->compute_pool->Schedule([this, call]() { DoRecvTensorStream(call); });
+    EnqueueRecvTensorStreamRequest();
+  }
+
   void CleanupGraphHandler(
       WorkerCall<CleanupGraphRequest, CleanupGraphResponse>* call) {
     env_->compute_pool->Schedule([this, call]() {
@@ -276,6 +294,20 @@ class GrpcWorkerService : public AsyncServiceInterface {
     }
   }
 
+  void EnqueueRecvTensorStreamRequest() {
+    mutex_lock l(shutdown_mu_);
+    if (!is_shutdown_) {
+      ServerStreamingCall<GrpcWorkerService,
+                          grpc::WorkerService::AsyncService, RecvTensorRequest,
+                          ::grpc::ByteBuffer>::
+          EnqueueRequestForMethod(
+              &worker_service_, cq_,
+              static_cast<int>(GrpcWorkerMethod::kRecvTensorStream),
+              &GrpcWorkerService::RecvTensorStreamHandler,
+              true /* supports cancel*/);
+    }
+  }
+
   // The following section contains the implementation of RunGraph()
   // RecvTensor(), Logging(), and Tracing(), which are the four
   // non-trivial and potentially long-running RPCs performed by a
@@ -292,12 +324,27 @@ class GrpcWorkerService : public AsyncServiceInterface {
     });
   }
 
-  Status PrepareRunGraph(const RunGraphRequest& req, GraphMgr::NamedTensors* in,
-                         GraphMgr::NamedTensors* out) {
+  // Fills in "*in" and "*out" from "req". If "req" refers to a step
+  // signature, sets "*signature" to it.
+  Status PrepareRunGraph(
+      const RunGraphRequest& req,
+      std::shared_ptr<const GraphMgr::StepSignature>* signature,
+      GraphMgr::NamedTensors* in, GraphMgr::NamedTensors* out) {
     if (req.is_partial()) {
       return errors::Unimplemented(
           "Partial run not implemented for GRPC worker service");
     }
+    const GraphMgr::StepSignature* sig = nullptr;
+    if (req.step_signature() != 0) {
+      TF_RETURN_IF_ERROR(env_->graph_mgr->LookupStepSignature(
+          req.step_signature(), signature));
+      sig = signature->get();
+      if (sig->send_keys.size() != static_cast<size_t>(req.send_size())) {
+        return errors::InvalidArgument(
+            "Expected ", sig->send_keys.size(), " tensors for step signature ",
+            req.step_signature(), " but got ", req.send_size());
+      }
+    }
     if (req.send_size() > 0) {
       // TODO(zhifengc): Let the caller decide on which device to
       // allocate the tensor.
@@ -305,24 +352,54 @@ class GrpcWorkerService : public AsyncServiceInterface {
       TF_RETURN_IF_ERROR(env_->device_mgr->LookupDevice("CPU:0", &cpu_dev));
       AllocatorAttributes alloc_attrs;
       Tensor val;
-      for (const NamedTensor& entry : req.send()) {
+      for (int i = 0; i < req.send_size(); ++i) {
+        const NamedTensor& entry = req.send(i);
         TF_RETURN_IF_ERROR(
             cpu_dev->MakeTensorFromProto(entry.val(), alloc_attrs, &val));
-        in->insert({entry.key(), val});
+        in->insert({sig ? sig->send_keys[i] : entry.key(), val});
       }
     }
-    for (const string& key : req.recv_key()) {
-      out->insert({key, empty_tensor});
+    if (sig) {
+      for (const string& key : sig->recv_keys) {
+        out->insert({key, empty_tensor});
+      }
+    } else {
+      for (const string& key : req.recv_key()) {
+        out->insert({key, empty_tensor});
+      }
     }
     return Status::OK();
   }
 
+  // Registers the step signature of "req" and returns its handle in
+  // "*resp". Only called once the step has succeeded, so that the
+  // signature is never lost with the response of a failed step. If the
+  // graph has been deregistered meanwhile, no handle is returned, and
+  // the caller asks again with its next step.
+  void CacheStepSignature(const RunGraphRequest& req,
+                          RunGraphResponse* resp) {
+    GraphMgr::StepSignature sig;
+    sig.graph_handle = req.graph_handle();
+    for (const NamedTensor& entry : req.send()) {
+      sig.send_keys.push_back(entry.key());
+    }
+    sig.recv_keys.assign(req.recv_key().begin(), req.recv_key().end());
+    int64 handle;
+    Status s = env_->graph_mgr->RegisterStepSignature(sig, &handle);
+    if (s.ok()) {
+      resp->set_step_signature(handle);
+    } else {
+      VLOG(1) << "Could not cache the step signature: " << s;
+    }
+  }
+
   void DoRunGraph(WorkerCall<RunGraphRequest, RunGraphResponse>* call) {
     const int64 step_id = call->request.step_id();
     TRACEPRINTF("RunGraph: %lld", step_id);
+    std::shared_ptr<const GraphMgr::StepSignature> sig;
     GraphMgr::NamedTensors in;
     GraphMgr::NamedTensors* out = new GraphMgr::NamedTensors;
-    Status s = PrepareRunGraph(call->request, &in, out);
+    Status s = PrepareRunGraph(call->request, &sig, &in, out);
     if (!s.ok()) {
       delete out;
       call->SendResponse(ToGrpcStatus(s));
@@ -348,9 +425,9 @@ class GrpcWorkerService : public AsyncServiceInterface {
     }
     CostGraphDef* cost_graph = call->response.mutable_cost_graph();
     env_->graph_mgr->ExecuteAsync(
-        call->request.graph_handle(), step_id, call->request.exec_opts(),
-        collector, cost_graph, cm, in,
-        [this, step_id, call, cm, out, token, collector](Status s) {
+        sig ? sig->graph_handle : call->request.graph_handle(), step_id,
+        call->request.exec_opts(), collector, cost_graph, cm, in,
+        [this, step_id, call, cm, out, token, collector, sig](Status s) {
           if (s.ok()) {
             env_->graph_mgr->RecvOutputs(step_id, out);
           }
@@ -361,7 +438,16 @@ class GrpcWorkerService : public AsyncServiceInterface {
           }
           delete cm;
 
-          if (s.ok()) {
+          if (s.ok() && call->request.cache_step_signature()) {
+            CacheStepSignature(call->request, &call->response);
+          }
+          if (s.ok() && sig) {
+            // The keys are implied by the order of the cached recv keys.
+            for (const string& key : sig->recv_keys) {
+              auto* recv = call->response.add_recv();
+              (*out)[key].AsProtoField(recv->mutable_val());
+            }
+          } else if (s.ok()) {
             for (const auto& p : *out) {
               const string& key = p.first;
               const Tensor& val = p.second;
@@ -477,7 +563,17 @@ class GrpcWorkerService : public AsyncServiceInterface {
                     ToGrpcStatus(errors::Internal("No GPU device in process")));
 #endif  // GOOGLE_CUDA
               } else {
-                grpc::EncodeTensorToByteBuffer(is_dead, val, &call->response);
+                RecvTensorResponse response;
+                SharedMemoryRegion region;
+                if (EncodeTensorToSharedMemory(call->request, is_dead, val,
+                                               &response, &region)) {
+                  grpc::EncodeRecvTensorResponseToByteBuffer(response,
+                                                             &call->response);
+                  ReleaseOnCancel(call, region);
+                } else {
+                  grpc::EncodeTensorForTransportToByteBuffer(
+                      is_dead, val, call->request, &call->response);
+                }
                 call->SendResponse(ToGrpcStatus(Status::OK()));
               }
             }
@@ -488,6 +584,168 @@ class GrpcWorkerService : public AsyncServiceInterface {
         });
   }
 
+  // RecvTensorStream: like RecvTensorRaw, but the content of large tensors
+  // in host memory is sent in a stream of chunks, which the client copies
+  // into the destination tensor as they arrive.
+  void DoRecvTensorStream(
+      WorkerStreamingCall<RecvTensorRequest, ::grpc::ByteBuffer>* call) {
+    const int64 step_id = call->request.step_id();
+    const string& key = call->request.rendezvous_key();
+    TRACEPRINTF("RecvTensorStream: %lld %s", step_id, key.c_str());
+    Rendezvous::ParsedKey parsed;
+    Status s = Rendezvous::ParseKey(key, &parsed);
+    Device* src_dev = nullptr;
+    if (s.ok()) {
+      s = PrepareRecvTensor(parsed, &src_dev);
+    }
+    if (!s.ok()) {
+      call->Finish(ToGrpcStatus(s));
+      return;
+    }
+    const int64 chunk_bytes = call->request.stream_chunk_bytes() > 0
+                                  ? call->request.stream_chunk_bytes()
+                                  : kDefaultStreamChunkBytes;
+
+    call->SetCancelCallback([this, step_id]() { AbortStep(step_id); });
+    env_->rendezvous_mgr->RecvLocalAsync(
+        step_id, parsed,
+        [this, call, src_dev, chunk_bytes](const Status& status,
+                                           const Rendezvous::Args& send_args,
+                                           const Rendezvous::Args& recv_args,
+                                           const Tensor& val,
+                                           const bool is_dead) {
+          call->ClearCancelCallback();
+          if (!status.ok()) {
+            call->Finish(ToGrpcStatus(status));
+            return;
+          }
+          const bool on_host = send_args.alloc_attrs.on_host();
+          if (src_dev->tensorflow_gpu_device_info() && (!on_host)) {
+#if GOOGLE_CUDA
+            // "val" is on a GPU: sends it in a single message, as
+            // RecvTensorRaw does.
+            const DeviceContext* send_dev_context = send_args.device_context;
+            RecvTensorChunk* tmp = new RecvTensorChunk;
+            tmp->mutable_metadata()->set_is_dead(is_dead);
+            CHECK(send_dev_context)
+                << "send dev name: " << src_dev->name()
+                << " gpu_info: " << src_dev->tensorflow_gpu_device_info();
+            StatusCallback response_ready = [call, tmp](const Status& s) {
+              if (!s.ok()) {
+                call->Finish(ToGrpcStatus(s));
+                delete tmp;
+                return;
+              }
+              tmp->mutable_metadata()->set_send_start_micros(
+                  Env::Default()->NowMicros());
+              ::grpc::ByteBuffer buf;
+              grpc::EncodeRecvTensorChunkToByteBuffer(*tmp, &buf);
+              delete tmp;
+              call->Write(std::move(buf), [call](bool ok) {
+                call->Finish(::grpc::Status::OK);
+              });
+            };
+            GPUUtil::SetProtoFromGPU(val, src_dev, send_dev_context,
+                                     tmp->mutable_metadata()->mutable_tensor(),
+                                     is_dead, response_ready);
+#else
+            call->Finish(
+                ToGrpcStatus(errors::Internal("No GPU device in process")));
+#endif  // GOOGLE_CUDA
+            return;
+          }
+          ::grpc::ByteBuffer buf;
+          RecvTensorChunk chunk;
+          SharedMemoryRegion region;
+          if (EncodeTensorToSharedMemory(call->request, is_dead, val,
+                                         chunk.mutable_metadata(), &region)) {
+            grpc::EncodeRecvTensorChunkToByteBuffer(chunk, &buf);
+            ReleaseOnCancel(call, region);
+            SharedMemoryRing* ring = env_->shared_memory_ring;
+            call->Write(std::move(buf), [call, ring, region](bool ok) {
+              if (!ok) ring->Release(region);
+              call->Finish(::grpc::Status::OK);
+            });
+          } else if (grpc::EncodeTensorStreamHeaderToByteBuffer(
+                         is_dead, val, chunk_bytes, &buf)) {
+            call->Write(std::move(buf),
+                        [this, call, val, chunk_bytes](bool ok) {
+                          WriteTensorChunks(call, val, 0, chunk_bytes, ok);
+                        });
+          } else {
+            call->Write(std::move(buf), [call](bool ok) {
+              call->Finish(::grpc::Status::OK);
+            });
+          }
+        });
+  }
+
+  // Writes the content of "val" from "offset" in chunks of "chunk_bytes",
+  // one after the other, and ends the stream of "call". "ok" is false if
+  // the previous write failed.
+  void WriteTensorChunks(
+      WorkerStreamingCall<RecvTensorRequest, ::grpc::ByteBuffer>* call,
+      const Tensor& val, int64 offset, int64 chunk_bytes, bool ok) {
+    const int64 total_bytes = val.TotalBytes();
+    if (!ok || offset >= total_bytes) {
+      // When a write failed, the stream is broken and the status is not
+      // received by the client.
+      call->Finish(::grpc::Status::OK);
+      return;
+    }
+    const int64 size = std::min(chunk_bytes, total_bytes - offset);
+    ::grpc::ByteBuffer buf;
+    grpc::EncodeTensorChunkToByteBuffer(val, offset, size, &buf);
+    call->Write(std::move(buf),
+                [this, call, val, offset, size, chunk_bytes](bool ok) {
+                  WriteTensorChunks(call, val, offset + size, chunk_bytes, ok);
+                });
+  }
+
+  // The size of the chunks of RecvTensorStream when the client does not
+  // choose it.
+  static const int64 kDefaultStreamChunkBytes = 4 << 20;
+
+  // If the client of "request" runs on the same host, copies the content of
+  // "val" to the shared memory ring of the worker, and fills in "*response"
+  // with the rest of the tensor and "*region" with the region of the
+  // content. Returns false if the tensor is to be sent in the response
+  // instead.
+  bool EncodeTensorToSharedMemory(const RecvTensorRequest& request,
+                                  bool is_dead, const Tensor& val,
+                                  RecvTensorResponse* response,
+                                  SharedMemoryRegion* region) {
+    SharedMemoryRing* ring = env_->shared_memory_ring;
+    if (ring == nullptr || request.shared_memory_segment().empty() ||
+        is_dead || val.TotalBytes() < kMinSharedMemoryBytes ||
+        !ring->CanOpen(request.shared_memory_segment())) {
+      return false;
+    }
+    if (!ring->CopyTensor(val, request.shared_memory_segment(), region)) {
+      // The ring is full, or the tensor is not a memcpy-able type.
+      return false;
+    }
+    TensorProto* tensor = response->mutable_tensor();
+    tensor->set_dtype(val.dtype());
+    val.shape().AsProto(tensor->mutable_tensor_shape());
+    response->mutable_transport_options()->PackFrom(*region);
+    response->set_send_start_micros(Env::Default()->NowMicros());
+    return true;
+  }
+
+  // Releases "region" if "call" fails or is cancelled before the client
+  // claims it. The ring takes back the region after a timeout if the call
+  // was cancelled before this.
+  template <class CallType>
+  void ReleaseOnCancel(CallType* call, const SharedMemoryRegion& region) {
+    SharedMemoryRing* ring = env_->shared_memory_ring;
+    call->SetCancelCallback([ring, region]() { ring->Release(region); });
+  }
+
+  // Smaller tensors are sent in the responses, which is as cheap and does
+  // not hold space of the ring.
+  static const int64 kMinSharedMemoryBytes = 16 << 10;
+
   Status DoLogging(WorkerCall<LoggingRequest, LoggingResponse>* call) {
     // TODO(mrry): Platform-specific tracing support.
     return errors::Unimplemented("Logging");
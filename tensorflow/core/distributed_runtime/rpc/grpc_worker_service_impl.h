@@ -62,6 +62,16 @@ class GrpcByteSource : public TensorResponse::Source {
   Reader* stream_ = nullptr;  // Points into space_ if non-nullptr
   char space_[sizeof(Reader)];
 };
+
+// A message of the stream of a RecvTensorStream call, which is parsed into
+// "response" with TensorResponse::ParseChunkFrom.
+struct TensorResponseStream {
+  TensorResponse* response = nullptr;  // Not owned
+  // The number of messages parsed so far.
+  int64 num_messages = 0;
+  // The first parse error; grpc does not return it to the caller.
+  Status status;
+};
 }  // namespace tensorflow
 
 namespace grpc {
@@ -102,6 +112,40 @@ class SerializationTraits<tensorflow::TensorResponse>
     return result;
   }
 };
+
+// Support parsing of the messages of a RecvTensorStream call.
+// Wire-format is identical to RecvTensorChunk.
+template <>
+class SerializationTraits<tensorflow::TensorResponseStream> {
+ public:
+  static Status Serialize(const tensorflow::TensorResponseStream& msg,
+                          grpc_byte_buffer** bp, bool* own_buffer) {
+    LOG(FATAL) << "TensorResponseStream is only received";
+    return Status();
+  }
+  static Status Deserialize(grpc_byte_buffer* buffer,
+                            tensorflow::TensorResponseStream* msg,
+                            int max_message_size) {
+    if (buffer == nullptr) {
+      return Status(StatusCode::INTERNAL, "No payload");
+    }
+    Status result = g_core_codegen_interface->ok();
+    {
+      ::tensorflow::GrpcByteSource source(buffer);
+      auto s = msg->response->ParseChunkFrom(&source);
+      if (s.ok()) {
+        ++msg->num_messages;
+      } else {
+        msg->status.Update(s);
+        result = Status(StatusCode::INTERNAL,
+                        ::tensorflow::strings::StrCat(
+                            "TensorResponse parse error", s.ToString()));
+      }
+    }
+    g_core_codegen_interface->grpc_byte_buffer_destroy(buffer);
+    return result;
+  }
+};
 }  // namespace grpc
 
 namespace tensorflow {
@@ -115,6 +159,7 @@ enum class GrpcWorkerMethod {
   kCleanupGraph,
   kCleanupAll,
   kRecvTensor,
+  kRecvTensorStream,
   kLogging,
   kTracing,
 };
@@ -136,7 +181,9 @@ class WorkerService GRPC_FINAL {
     AsyncService();
     virtual ~AsyncService();
 
-    // Make RequestAsyncUnary public for grpc_call.h
+    // Make RequestAsyncUnary and RequestAsyncServerStreaming public for
+    // grpc_call.h
+    using ::grpc::Service::RequestAsyncServerStreaming;
     using ::grpc::Service::RequestAsyncUnary;
   };
 };
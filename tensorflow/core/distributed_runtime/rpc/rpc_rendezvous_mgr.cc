@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_ring.h"
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_interface.h"
@@ -30,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/protobuf_internal.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
@@ -39,8 +41,10 @@ namespace {
 class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  public:
   RpcRemoteRendezvous(const WorkerEnv* env, WorkerCacheInterface* cache,
-                      int64 step_id)
-      : BaseRemoteRendezvous(env, step_id, false), cache_(cache) {}
+                      int64 step_id, int64 stream_chunk_bytes)
+      : BaseRemoteRendezvous(env, step_id, false),
+        cache_(cache),
+        stream_chunk_bytes_(stream_chunk_bytes) {}
 
  protected:
   void RecvFromRemoteAsync(const Rendezvous::ParsedKey& parsed,
@@ -51,6 +55,9 @@ class RpcRemoteRendezvous : public BaseRemoteRendezvous {
   ~RpcRemoteRendezvous() override {}
 
   WorkerCacheInterface* cache_;  // Not owned.
+  // If positive, tensors received into host memory are streamed in chunks
+  // of this size.
+  const int64 stream_chunk_bytes_;
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRemoteRendezvous);
 };
 
@@ -61,7 +68,9 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
 
   void Init(WorkerInterface* wi, int64 step_id, StringPiece key,
             AllocatorAttributes alloc_attrs, Device* dst_device,
-            const Rendezvous::Args& recv_args, Rendezvous::DoneCallback done) {
+            const Rendezvous::Args& recv_args, int64 stream_chunk_bytes,
+            SharedMemoryRing* shared_memory_ring,
+            Rendezvous::DoneCallback done) {
     wi_ = wi;
     alloc_attrs_ = alloc_attrs;
     dst_device_ = dst_device;
@@ -69,6 +78,24 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     done_ = std::move(done);
     req_.set_step_id(step_id);
     req_.set_rendezvous_key(key.data(), key.size());
+    if (recv_args.wire_compression == "snappy") {
+      req_.set_accept_compression(SNAPPY);
+    }
+    req_.set_accept_wire_dtype(recv_args.wire_dtype);
+    const bool on_host = alloc_attrs.on_host() ||
+                         dst_device->attributes().device_type() == DEVICE_CPU;
+    // The chunks of a stream are copied directly into the tensor, which
+    // must be in host memory. The transport encodings of the edge, if
+    // any, need the whole tensor: it is not streamed.
+    if (stream_chunk_bytes > 0 &&
+        req_.accept_compression() == NO_COMPRESSION &&
+        req_.accept_wire_dtype() == DT_INVALID && on_host) {
+      req_.set_stream_chunk_bytes(stream_chunk_bytes);
+    }
+    // A tensor in shared memory is used in place, which must be host memory.
+    if (shared_memory_ring != nullptr && on_host) {
+      req_.set_shared_memory_segment(shared_memory_ring->name());
+    }
   }
 
   void Reset() {
@@ -80,6 +107,7 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     // opts_ appropriately.
     req_.Clear();
     resp_.Clear();
+    tensor_ = Tensor();
     {
       mutex_lock l(mu_);
       status_ = Status::OK();
@@ -106,7 +134,7 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     return status_;
   }
 
-  const Tensor& tensor() const { return resp_.tensor(); }
+  const Tensor& tensor() const { return tensor_; }
 
   bool is_dead() const { return resp_.metadata().is_dead(); }
 
@@ -124,7 +152,16 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     StatusCallback cb = std::bind(
         [this](std::function<void()> recv_done,
                // Begin unbound arguments.
-               const Status& s) {
+               Status s) {
+          if (s.ok()) {
+            // The call may have been aborted after the response arrived.
+            s = status();
+          }
+          if (s.ok()) {
+            s = ReceiveContent();
+          } else {
+            ReleaseContent();
+          }
           if (!s.ok()) {
             mutex_lock l(mu_);
             status_.Update(s);
@@ -135,6 +172,41 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     wi_->RecvTensorAsync(&opts_, &req_, &resp_, std::move(cb));
   }
 
+  // Sets tensor_ from the response, whose content may be in the shared
+  // memory ring of the sender: see RecvTensorRequest.shared_memory_segment.
+  Status ReceiveContent() {
+    const RecvTensorResponse& meta = resp_.metadata();
+    if (!meta.has_transport_options()) {
+      tensor_ = resp_.tensor();
+      return Status::OK();
+    }
+    SharedMemoryRegion region;
+    TF_RETURN_IF_ERROR(ParseAny(meta.transport_options(), &region,
+                                "tensorflow.SharedMemoryRegion"));
+    if (!TensorShape::IsValid(meta.tensor().tensor_shape())) {
+      ReleaseSharedMemoryRegion(region);
+      return errors::InvalidArgument(
+          "Invalid tensor shape in response: ",
+          meta.tensor().tensor_shape().DebugString());
+    }
+    return TensorFromSharedMemory(region, meta.tensor().dtype(),
+                                  TensorShape(meta.tensor().tensor_shape()),
+                                  &tensor_);
+  }
+
+  // Releases the shared memory region of the response, if any, when the
+  // tensor is not received.
+  void ReleaseContent() {
+    const RecvTensorResponse& meta = resp_.metadata();
+    SharedMemoryRegion region;
+    if (meta.has_transport_options() &&
+        ParseAny(meta.transport_options(), &region,
+                 "tensorflow.SharedMemoryRegion")
+            .ok()) {
+      ReleaseSharedMemoryRegion(region);
+    }
+  }
+
   string src_worker_;
   string src_rel_device_;
   WorkerInterface* wi_;
@@ -143,6 +215,7 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
   CallOptions opts_;
   RecvTensorRequest req_;
   TensorResponse resp_;
+  Tensor tensor_;
   Rendezvous::Args recv_args_;
   Rendezvous::DoneCallback done_;
 
@@ -302,7 +375,8 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
   }
 
   call->Init(rwi, step_id_, parsed.FullKey(), recv_args.alloc_attrs, dst_device,
-             recv_args, std::move(done));
+             recv_args, stream_chunk_bytes_, env_->shared_memory_ring,
+             std::move(done));
 
   // Record "call" in active_ so that it can be aborted cleanly.
   RegisterCall(call);
@@ -326,12 +400,18 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
 }  // namespace
 
 RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env)
+    : RpcRendezvousMgr(env, RPCOptions()) {}
+
+RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env,
+                                   const RPCOptions& rpc_options)
     : BaseRendezvousMgr(env),
-      cache_(new WorkerFreeListCache(env->worker_cache)) {}
+      cache_(new WorkerFreeListCache(env->worker_cache)),
+      stream_chunk_bytes_(rpc_options.recv_tensor_stream_chunk_bytes()) {}
 
 BaseRemoteRendezvous* RpcRendezvousMgr::Create(int64 step_id,
                                                const WorkerEnv* worker_env) {
-  return new RpcRemoteRendezvous(worker_env, cache_.get(), step_id);
+  return new RpcRemoteRendezvous(worker_env, cache_.get(), step_id,
+                                 stream_chunk_bytes_);
 }
 
 }  // end namespace tensorflow
@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_env.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/protobuf/config.pb.h"
 
 namespace tensorflow {
 
@@ -44,6 +45,7 @@ namespace tensorflow {
 class RpcRendezvousMgr : public BaseRendezvousMgr {
  public:
   explicit RpcRendezvousMgr(const WorkerEnv* env);
+  RpcRendezvousMgr(const WorkerEnv* env, const RPCOptions& rpc_options);
 
  protected:
   BaseRemoteRendezvous* Create(int64 step_id,
@@ -53,6 +55,9 @@ class RpcRendezvousMgr : public BaseRendezvousMgr {
   // Private cache_ that allows us to reuse WorkerInterface objects.
   std::unique_ptr<WorkerCacheInterface> cache_;
 
+  // See RPCOptions.recv_tensor_stream_chunk_bytes.
+  const int64 stream_chunk_bytes_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRendezvousMgr);
 };
 
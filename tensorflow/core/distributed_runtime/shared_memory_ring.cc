@@ -0,0 +1,470 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shared_memory_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/posix/error.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Layout of a segment: a SegmentHeader, padded to kHeaderBytes, followed by
+// the capacity bytes of the ring. Each region of the ring is preceded by a
+// SlotHeader, padded to kSlotHeaderBytes, and all the offsets are multiples of
+// kAlignment.
+const int64 kAlignment = 64;
+const int64 kHeaderBytes = 64;
+const int64 kSlotHeaderBytes = 64;
+const uint64 kMagic = 0x676e697273726e74ull;
+
+struct SegmentHeader {
+  uint64 magic;
+  int64 capacity;
+};
+
+// The states of a region. A region is pending until the receiving process
+// claims it, and released once the receiver no longer uses it, or when the
+// ring takes it back.
+enum RegionState : uint64 { kPending = 0, kClaimed = 1, kReleased = 2 };
+const int kStateBits = 2;
+const uint64 kStateMask = (1 << kStateBits) - 1;
+
+struct SlotHeader {
+  // The state of the region in the low kStateBits bits, and its sequence
+  // number above them, so that a late receiver does not claim or release a
+  // later region at the same offset.
+  std::atomic<uint64> state;
+  int64 length;
+};
+
+uint64 StateWord(uint64 sequence, RegionState state) {
+  return sequence << kStateBits | state;
+}
+
+// Moves the region "sequence" of "header" from state "from" to "to". Returns
+// false if it is not in state "from", or is another region.
+bool Transition(SlotHeader* header, uint64 sequence, RegionState from,
+                RegionState to) {
+  uint64 expected = StateWord(sequence, from);
+  return header->state.compare_exchange_strong(expected,
+                                               StateWord(sequence, to),
+                                               std::memory_order_acq_rel);
+}
+
+// Returns false if the process which created the ring "name" exited: the
+// segment is removed when it exits cleanly, and its pid is in the name
+// otherwise.
+bool ReceiverIsAlive(const string& name) {
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return errno != ENOENT;
+  }
+  close(fd);
+  unsigned pid = 0;
+  if (sscanf(name.c_str(), "/tf_%x_", &pid) == 1 && kill(pid, 0) != 0 &&
+      errno == ESRCH) {
+    return false;
+  }
+  return true;
+}
+
+static_assert(sizeof(SegmentHeader) <= kHeaderBytes, "SegmentHeader too big");
+static_assert(sizeof(SlotHeader) <= kSlotHeaderBytes, "SlotHeader too big");
+
+int64 RoundUp(int64 n, int64 alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+// A segment created by another process, mapped in this process.
+class MappedSegment {
+ public:
+  static Status Open(const string& name,
+                     std::shared_ptr<MappedSegment>* segment) {
+    const int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+      return IOError(name, errno);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      const Status s = IOError(name, errno);
+      close(fd);
+      return s;
+    }
+    const int64 size = st.st_size;
+    if (size < kHeaderBytes) {
+      close(fd);
+      return errors::InvalidArgument("Shared memory segment ", name,
+                                     " is too small");
+    }
+    void* base =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      const Status s = IOError(name, errno);
+      close(fd);
+      return s;
+    }
+    close(fd);
+    segment->reset(new MappedSegment(static_cast<char*>(base), size));
+    const SegmentHeader* header = static_cast<const SegmentHeader*>(base);
+    if (header->magic != kMagic ||
+        header->capacity != size - kHeaderBytes) {
+      segment->reset();
+      return errors::InvalidArgument(name,
+                                     " is not a TensorFlow shared memory ring");
+    }
+    return Status::OK();
+  }
+
+  ~MappedSegment() { munmap(base_, size_); }
+
+  char* base() const { return base_; }
+  int64 size() const { return size_; }
+
+ private:
+  MappedSegment(char* base, int64 size) : base_(base), size_(size) {}
+
+  char* const base_;
+  const int64 size_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MappedSegment);
+};
+
+// Returns the segment "name", which is mapped once and stays mapped for the
+// lifetime of the process.
+Status GetMappedSegment(const string& name,
+                        std::shared_ptr<MappedSegment>* segment) {
+  static mutex* mu = new mutex;
+  static auto* segments =
+      new std::unordered_map<string, std::shared_ptr<MappedSegment>>;
+  mutex_lock l(*mu);
+  auto it = segments->find(name);
+  if (it != segments->end()) {
+    *segment = it->second;
+    return Status::OK();
+  }
+  TF_RETURN_IF_ERROR(MappedSegment::Open(name, segment));
+  segments->insert({name, *segment});
+  return Status::OK();
+}
+
+// Maps the segment of "region", and sets "*header" to the header of the
+// region if its offset and length are valid.
+Status GetSlotHeader(const SharedMemoryRegion& region,
+                     std::shared_ptr<MappedSegment>* segment,
+                     SlotHeader** header) {
+  TF_RETURN_IF_ERROR(GetMappedSegment(region.segment(), segment));
+  const int64 offset = region.offset();
+  const int64 length = region.length();
+  if (offset < kHeaderBytes + kSlotHeaderBytes || offset % kAlignment != 0 ||
+      length < 0 || length > (*segment)->size() - offset) {
+    return errors::InvalidArgument("Invalid region of ", length,
+                                   " bytes at offset ", offset, " of ",
+                                   region.segment());
+  }
+  *header = reinterpret_cast<SlotHeader*>((*segment)->base() + offset -
+                                          kSlotHeaderBytes);
+  return Status::OK();
+}
+
+// Hands out a claimed region of a mapped segment as the buffer of a single
+// tensor. Releases the region and deletes itself when the tensor frees the
+// buffer.
+class SharedMemoryRegionAllocator : public Allocator {
+ public:
+  SharedMemoryRegionAllocator(std::shared_ptr<MappedSegment> segment,
+                              SlotHeader* header, uint64 sequence,
+                              int64 length)
+      : segment_(std::move(segment)),
+        header_(header),
+        sequence_(sequence),
+        length_(length) {}
+
+  string Name() override { return "shared_memory_region"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    CHECK_EQ(num_bytes, length_);
+    return reinterpret_cast<char*>(header_) + kSlotHeaderBytes;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    Transition(header_, sequence_, kClaimed, kReleased);
+    delete this;
+  }
+
+ private:
+  std::shared_ptr<MappedSegment> segment_;
+  SlotHeader* const header_;
+  const uint64 sequence_;
+  const int64 length_;
+};
+
+}  // namespace
+
+SharedMemoryRing::SharedMemoryRing(const string& name, char* base,
+                                   int64 capacity,
+                                   int64 unclaimed_timeout_micros)
+    : name_(name),
+      base_(base),
+      capacity_(capacity),
+      unclaimed_timeout_micros_(unclaimed_timeout_micros) {}
+
+SharedMemoryRing::~SharedMemoryRing() {
+  munmap(base_, kHeaderBytes + capacity_);
+  shm_unlink(name_.c_str());
+}
+
+Status SharedMemoryRing::Create(int64 capacity,
+                                std::unique_ptr<SharedMemoryRing>* ring) {
+  return Create(capacity, kDefaultUnclaimedTimeoutMicros, ring);
+}
+
+Status SharedMemoryRing::Create(int64 capacity, int64 unclaimed_timeout_micros,
+                                std::unique_ptr<SharedMemoryRing>* ring) {
+  if (capacity <= 0) {
+    return errors::InvalidArgument("Invalid shared memory ring capacity ",
+                                   capacity);
+  }
+  if (unclaimed_timeout_micros < 0) {
+    return errors::InvalidArgument("Invalid shared memory ring timeout ",
+                                   unclaimed_timeout_micros);
+  }
+  capacity = RoundUp(capacity, kAlignment);
+  // Short enough for the systems which limit the names to 31 characters.
+  const string name =
+      strings::Printf("/tf_%x_%016llx", static_cast<unsigned>(getpid()),
+                      static_cast<unsigned long long>(random::New64()));
+  const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    return IOError(name, errno);
+  }
+  const int64 size = kHeaderBytes + capacity;
+  void* base = MAP_FAILED;
+  if (ftruncate(fd, size) == 0) {
+    base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  const int error = errno;
+  close(fd);
+  if (base == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    return IOError(name, error);
+  }
+  SegmentHeader* header = static_cast<SegmentHeader*>(base);
+  header->magic = kMagic;
+  header->capacity = capacity;
+  ring->reset(new SharedMemoryRing(name, static_cast<char*>(base), capacity,
+                                   unclaimed_timeout_micros));
+  return Status::OK();
+}
+
+bool SharedMemoryRing::CanOpen(const string& name) {
+  mutex_lock l(mu_);
+  auto it = can_open_.find(name);
+  if (it != can_open_.end()) {
+    return it->second;
+  }
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd >= 0) {
+    close(fd);
+  }
+  can_open_[name] = fd >= 0;
+  return fd >= 0;
+}
+
+bool SharedMemoryRing::CopyTensor(const Tensor& tensor, const string& receiver,
+                                  SharedMemoryRegion* region) {
+  if (!DataTypeCanUseMemcpy(tensor.dtype())) {
+    return false;
+  }
+  const StringPiece data = tensor.tensor_data();
+  int64 offset;
+  uint64 sequence;
+  {
+    mutex_lock l(mu_);
+    Reclaim();
+    sequence = next_sequence_++;
+    offset = Allocate(data.size(), sequence, receiver);
+  }
+  if (offset < 0) {
+    return false;
+  }
+  // The region is not reused before the receiver releases it, so the copy
+  // does not need the lock.
+  memcpy(base_ + offset, data.data(), data.size());
+  region->set_segment(name_);
+  region->set_offset(offset);
+  region->set_length(data.size());
+  region->set_sequence(sequence);
+  return true;
+}
+
+void SharedMemoryRing::Release(const SharedMemoryRegion& region) {
+  const int64 offset = region.offset();
+  if (region.segment() != name_ || offset < kHeaderBytes + kSlotHeaderBytes ||
+      offset % kAlignment != 0 || offset > kHeaderBytes + capacity_) {
+    LOG(ERROR) << "Invalid region at offset " << offset << " of "
+               << region.segment();
+    return;
+  }
+  SlotHeader* header =
+      reinterpret_cast<SlotHeader*>(base_ + offset - kSlotHeaderBytes);
+  Transition(header, region.sequence(), kPending, kReleased);
+}
+
+int64 SharedMemoryRing::Allocate(int64 size, uint64 sequence,
+                                 const string& receiver) {
+  const int64 slot_size = kSlotHeaderBytes + RoundUp(size, kAlignment);
+  if (slot_size > capacity_) {
+    return -1;
+  }
+  int64 offset;
+  if (slots_.empty()) {
+    offset = 0;
+  } else {
+    // The free space is from head_ to the first slot, and head_ == tail
+    // means that the ring is full.
+    const int64 tail = slots_.front().offset;
+    if (head_ > tail && capacity_ - head_ >= slot_size) {
+      offset = head_;
+    } else if (head_ > tail && tail >= slot_size) {
+      slots_.push_back({head_, capacity_ - head_, true, 0, "", 0, 0});
+      offset = 0;
+    } else if (head_ < tail && tail - head_ >= slot_size) {
+      offset = head_;
+    } else {
+      return -1;
+    }
+  }
+  const uint64 now_micros = Env::Default()->NowMicros();
+  slots_.push_back({offset, slot_size, false, sequence, receiver, now_micros,
+                    now_micros});
+  head_ = (offset + slot_size) % capacity_;
+  SlotHeader* header = new (base_ + kHeaderBytes + offset) SlotHeader;
+  header->length = size;
+  header->state.store(StateWord(sequence, kPending), std::memory_order_release);
+  return kHeaderBytes + offset + kSlotHeaderBytes;
+}
+
+void SharedMemoryRing::Reclaim() {
+  const uint64 now_micros = Env::Default()->NowMicros();
+  while (!slots_.empty()) {
+    Slot& slot = slots_.front();
+    if (!slot.padding && !IsReleased(&slot, now_micros)) break;
+    slots_.pop_front();
+  }
+}
+
+bool SharedMemoryRing::IsReleased(Slot* slot, uint64 now_micros) {
+  SlotHeader* header =
+      reinterpret_cast<SlotHeader*>(base_ + kHeaderBytes + slot->offset);
+  const uint64 state = header->state.load(std::memory_order_acquire);
+  if ((state & kStateMask) == kReleased) {
+    return true;
+  }
+  const uint64 timeout = unclaimed_timeout_micros_;
+  if ((state & kStateMask) == kPending) {
+    // The response which carried the region was lost, or its receiver
+    // failed before claiming it.
+    if (now_micros - slot->allocated_micros < timeout) {
+      return false;
+    }
+    if (Transition(header, slot->sequence, kPending, kReleased)) {
+      return true;
+    }
+  }
+  // The region is claimed: checks at most once per timeout whether its
+  // receiver is still alive.
+  if (now_micros - slot->checked_micros < timeout) {
+    return false;
+  }
+  slot->checked_micros = now_micros;
+  if (ReceiverIsAlive(slot->receiver)) {
+    return false;
+  }
+  LOG(WARNING) << "Taking back a region of " << name_ << " from "
+               << slot->receiver << ", which exited";
+  header->state.store(StateWord(slot->sequence, kReleased),
+                      std::memory_order_release);
+  return true;
+}
+
+Status TensorFromSharedMemory(const SharedMemoryRegion& region, DataType dtype,
+                              const TensorShape& shape, Tensor* tensor) {
+  std::shared_ptr<MappedSegment> segment;
+  SlotHeader* header;
+  TF_RETURN_IF_ERROR(GetSlotHeader(region, &segment, &header));
+  const int64 length = region.length();
+  const bool holds_tensor =
+      DataTypeCanUseMemcpy(dtype) &&
+      shape.num_elements() * DataTypeSize(dtype) == length;
+  if (!holds_tensor || length == 0) {
+    // The region is not used.
+    Transition(header, region.sequence(), kPending, kReleased);
+    if (!holds_tensor) {
+      return errors::InvalidArgument(
+          "Region of ", length, " bytes of ", region.segment(),
+          " does not hold a tensor of type ", DataTypeString(dtype),
+          " and shape ", shape.DebugString());
+    }
+    // The tensor has no buffer.
+    *tensor = Tensor(dtype, shape);
+    return Status::OK();
+  }
+  if (!Transition(header, region.sequence(), kPending, kClaimed)) {
+    return errors::Aborted("Region of ", length, " bytes at offset ",
+                           region.offset(), " of ", region.segment(),
+                           " was taken back by its sender");
+  }
+  // The length is read once the region is claimed, so that it is the one of
+  // this region.
+  if (header->length != length) {
+    Transition(header, region.sequence(), kClaimed, kReleased);
+    return errors::InvalidArgument("Region of ", region.segment(),
+                                   " holds ", header->length,
+                                   " bytes, not ", length);
+  }
+  *tensor = Tensor(new SharedMemoryRegionAllocator(
+                       std::move(segment), header, region.sequence(), length),
+                   dtype, shape);
+  return Status::OK();
+}
+
+void ReleaseSharedMemoryRegion(const SharedMemoryRegion& region) {
+  std::shared_ptr<MappedSegment> segment;
+  SlotHeader* header;
+  if (GetSlotHeader(region, &segment, &header).ok()) {
+    Transition(header, region.sequence(), kPending, kReleased);
+  }
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,144 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_RING_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_RING_H_
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
+
+namespace tensorflow {
+
+// A ring buffer in a POSIX shared memory segment, through which a process
+// passes the content of tensors to the other processes of the same host.
+//
+// The process which created the ring copies the content of a tensor into a
+// region of the ring and sends a SharedMemoryRegion describing it to the
+// receiving process, which maps the segment, claims the region and uses it as
+// the buffer of the received tensor without copying it (see
+// TensorFromSharedMemory() below). The receiver marks the region as released
+// in the segment once the tensor is freed, after which the ring reuses it.
+//
+// The regions are reused in the order in which they were allocated: while a
+// received tensor is alive, the regions allocated after it are not reused
+// either, and CopyTensor() fails when the ring is full. So that a lost
+// response or a dead receiver does not pin the ring, the ring takes back the
+// regions which are not claimed within "unclaimed_timeout_micros" of their
+// allocation, and the claimed regions of the receivers which have exited.
+//
+// The segment is removed when the ring is destroyed. It is left behind if
+// the process does not exit cleanly.
+class SharedMemoryRing {
+ public:
+  // Creates a ring of "capacity" bytes in a new segment with a unique name,
+  // which only the processes of the same user can open.
+  static Status Create(int64 capacity, std::unique_ptr<SharedMemoryRing>* ring);
+  static Status Create(int64 capacity, int64 unclaimed_timeout_micros,
+                       std::unique_ptr<SharedMemoryRing>* ring);
+
+  static const int64 kDefaultUnclaimedTimeoutMicros = 60 * 1000 * 1000;
+
+  ~SharedMemoryRing();
+
+  // The name of the segment, for shm_open().
+  const string& name() const { return name_; }
+
+  // Returns true if this process can open the segment "name", which was
+  // created by a SharedMemoryRing of another process. The result is cached.
+  bool CanOpen(const string& name);
+
+  // Copies the content of "tensor" into a new region of the ring for the
+  // process whose ring is named "receiver", and fills in "*region". Returns
+  // false if the ring has no room for it, or if the tensor cannot be copied
+  // as bytes.
+  bool CopyTensor(const Tensor& tensor, const string& receiver,
+                  SharedMemoryRegion* region);
+
+  // Releases "region", which CopyTensor() filled in, unless the receiver
+  // already claimed it. Called when the region could not be sent.
+  void Release(const SharedMemoryRegion& region);
+
+ private:
+  struct Slot {
+    int64 offset;
+    int64 size;
+    // True for the space left unused at the end of the ring when an
+    // allocation wraps around.
+    bool padding;
+    uint64 sequence;
+    // The ring of the receiving process, the time of the allocation and of
+    // the last check that the receiver is alive.
+    string receiver;
+    uint64 allocated_micros;
+    uint64 checked_micros;
+  };
+
+  SharedMemoryRing(const string& name, char* base, int64 capacity,
+                   int64 unclaimed_timeout_micros);
+
+  // Returns the offset in the segment of a new region of "size" bytes of
+  // data, or -1 if there is no room for it.
+  int64 Allocate(int64 size, uint64 sequence, const string& receiver)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Reuses the oldest slots which are released, or taken back.
+  void Reclaim() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns true if "slot" is released, after taking it back if it is not
+  // claimed in time or if its receiver exited.
+  bool IsReleased(Slot* slot, uint64 now_micros) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const string name_;
+  char* const base_;
+  const int64 capacity_;
+  const int64 unclaimed_timeout_micros_;
+
+  mutex mu_;
+  // The slots in use, from the oldest to the newest, which cover the ring
+  // from the offset of the first one to head_ (modulo capacity_).
+  std::deque<Slot> slots_ GUARDED_BY(mu_);
+  int64 head_ GUARDED_BY(mu_) = 0;
+  uint64 next_sequence_ GUARDED_BY(mu_) = 1;
+  std::unordered_map<string, bool> can_open_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SharedMemoryRing);
+};
+
+// Claims "region" of the SharedMemoryRing of another process, and sets
+// "*tensor" to a tensor of "dtype" and "shape" whose buffer is the region.
+// The region is released when the buffer is freed, or right away if it does
+// not hold such a tensor. Returns an Aborted error if the sender took the
+// region back. The segments are mapped once per process.
+Status TensorFromSharedMemory(const SharedMemoryRegion& region, DataType dtype,
+                              const TensorShape& shape, Tensor* tensor);
+
+// Releases "region" of the SharedMemoryRing of another process without
+// claiming it, when the response which carried it is dropped.
+void ReleaseSharedMemoryRegion(const SharedMemoryRegion& region);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_RING_H_
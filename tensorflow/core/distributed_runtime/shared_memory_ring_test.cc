@@ -0,0 +1,241 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shared_memory_ring.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
+
+namespace tensorflow {
+namespace {
+
+Tensor MakeTensor(int64 n, float start) {
+  Tensor t(DT_FLOAT, TensorShape({n}));
+  for (int64 i = 0; i < n; ++i) {
+    t.flat<float>()(i) = start + i;
+  }
+  return t;
+}
+
+// Sends "t" through "ring" and receives it back.
+Status SendAndReceive(SharedMemoryRing* ring, const Tensor& t,
+                      Tensor* received) {
+  SharedMemoryRegion region;
+  if (!ring->CopyTensor(t, ring->name(), &region)) {
+    return errors::ResourceExhausted("No room in the ring");
+  }
+  EXPECT_EQ(ring->name(), region.segment());
+  EXPECT_EQ(t.TotalBytes(), region.length());
+  return TensorFromSharedMemory(region, t.dtype(), t.shape(), received);
+}
+
+TEST(SharedMemoryRingTest, RoundTrip) {
+  std::unique_ptr<SharedMemoryRing> ring;
+  TF_ASSERT_OK(SharedMemoryRing::Create(1 << 20, &ring));
+  for (int64 n : {0, 1, 15, 16, 1000}) {
+    Tensor t = MakeTensor(n, 3.0);
+    Tensor received;
+    TF_ASSERT_OK(SendAndReceive(ring.get(), t, &received));
+    test::ExpectTensorEqual<float>(t, received);
+  }
+
+  Tensor t(DT_INT64, TensorShape({3, 2}));
+  t.flat<int64>().setConstant(-7);
+  Tensor received;
+  TF_ASSERT_OK(SendAndReceive(ring.get(), t, &received));
+  test::ExpectTensorEqual<int64>(t, received);
+  // The received tensor is in the segment, which is not where the content
+  // was copied from.
+  EXPECT_NE(t.tensor_data().data(), received.tensor_data().data());
+}
+
+TEST(SharedMemoryRingTest, Strings) {
+  std::unique_ptr<SharedMemoryRing> ring;
+  TF_ASSERT_OK(SharedMemoryRing::Create(1 << 20, &ring));
+  Tensor t(DT_STRING, TensorShape({2}));
+  SharedMemoryRegion region;
+  EXPECT_FALSE(ring->CopyTensor(t, ring->name(), &region));
+}
+
+TEST(SharedMemoryRingTest, ReusesReleasedRegions) {
+  std::unique_ptr<SharedMemoryRing> ring;
+  TF_ASSERT_OK(SharedMemoryRing::Create(4096, &ring));
+  // Fills the ring with tensors which are kept alive.
+  std::vector<Tensor> received;
+  while (true) {
+    Tensor r;
+    Status s = SendAndReceive(ring.get(), MakeTensor(100, received.size()), &r);
+    if (errors::IsResourceExhausted(s)) break;
+    TF_ASSERT_OK(s);
+    received.push_back(r);
+  }
+  ASSERT_GT(received.size(), 1);
+  for (int i = 0; i < received.size(); ++i) {
+    test::ExpectTensorEqual<float>(MakeTensor(100, i), received[i]);
+  }
+
+  // Releasing a tensor other than the oldest one does not make room.
+  received.pop_back();
+  Tensor r;
+  EXPECT_TRUE(errors::IsResourceExhausted(
+      SendAndReceive(ring.get(), MakeTensor(100, 0), &r)));
+  received.erase(received.begin());
+  TF_ASSERT_OK(SendAndReceive(ring.get(), MakeTensor(100, 0), &r));
+  test::ExpectTensorEqual<float>(MakeTensor(100, 0), r);
+
+  // Tensors bigger than the ring never fit.
+  received.clear();
+  r = Tensor();
+  EXPECT_TRUE(errors::IsResourceExhausted(
+      SendAndReceive(ring.get(), MakeTensor(2000, 0), &r)));
+}
+
+TEST(SharedMemoryRingTest, WrapsAround) {
+  std::unique_ptr<SharedMemoryRing> ring;
+  TF_ASSERT_OK(SharedMemoryRing::Create(20000, &ring));
+  // Keeps a few tensors of various sizes alive at any time, so that the
+  // regions wrap around the end of the ring at various offsets.
+  std::vector<Tensor> received(3);
+  for (int i = 0; i < 1000; ++i) {
+    const int64 n = 1 + (i * 37) % 600;
+    Tensor& r = received[i % received.size()];
+    r = Tensor();
+    TF_ASSERT_OK(SendAndReceive(ring.get(), MakeTensor(n, i), &r));
+    test::ExpectTensorEqual<float>(MakeTensor(n, i), r);
+  }
+}
+
+TEST(SharedMemoryRingTest, CanOpen) {
+  std::unique_ptr<SharedMemoryRing> ring1, ring2;
+  TF_ASSERT_OK(SharedMemoryRing::Create(4096, &ring1));
+  TF_ASSERT_OK(SharedMemoryRing::Create(4096, &ring2));
+  EXPECT_NE(ring1->name(), ring2->name());
+  EXPECT_TRUE(ring1->CanOpen(ring2->name()));
+  EXPECT_FALSE(ring1->CanOpen("/tf_no_such_segment"));
+}
+
+TEST(SharedMemoryRingTest, InvalidRegions) {
+  std::unique_ptr<SharedMemoryRing> ring;
+  TF_ASSERT_OK(SharedMemoryRing::Create(4096, &ring));
+  Tensor t = MakeTensor(16, 0);
+  SharedMemoryRegion region;
+  ASSERT_TRUE(ring->CopyTensor(t, ring->name(), &region));
+
+  Tensor r;
+  SharedMemoryRegion bad = region;
+  bad.set_offset(region.offset() + 4);
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      TensorFromSharedMemory(bad, DT_FLOAT, t.shape(), &r)));
+  bad = region;
+  bad.set_offset(1 << 20);
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      TensorFromSharedMemory(bad, DT_FLOAT, t.shape(), &r)));
+  bad = region;
+  bad.set_segment("/tf_no_such_segment");
+  EXPECT_FALSE(TensorFromSharedMemory(bad, DT_FLOAT, t.shape(), &r).ok());
+  bad = region;
+  bad.set_sequence(region.sequence() + 1);
+  EXPECT_TRUE(errors::IsAborted(
+      TensorFromSharedMemory(bad, DT_FLOAT, t.shape(), &r)));
+
+  TF_ASSERT_OK(TensorFromSharedMemory(region, DT_FLOAT, t.shape(), &r));
+  test::ExpectTensorEqual<float>(t, r);
+
+  // A region which does not hold the expected tensor is released.
+  for (DataType dtype : {DT_FLOAT, DT_STRING}) {
+    ASSERT_TRUE(ring->CopyTensor(t, ring->name(), &region));
+    EXPECT_TRUE(errors::IsInvalidArgument(
+        TensorFromSharedMemory(region, dtype, TensorShape({8}), &r)));
+    EXPECT_TRUE(errors::IsAborted(
+        TensorFromSharedMemory(region, DT_FLOAT, t.shape(), &r)));
+  }
+}
+
+// A tensor which fills most of a ring of 4096 bytes.
+Tensor BigTensor(float start) { return MakeTensor(600, start); }
+
+TEST(SharedMemoryRingTest, ReleasesUnsentRegions) {
+  std::unique_ptr<SharedMemoryRing> ring;
+  TF_ASSERT_OK(SharedMemoryRing::Create(4096, &ring));
+  // The response which carries the region is dropped.
+  SharedMemoryRegion lost;
+  ASSERT_TRUE(ring->CopyTensor(BigTensor(0), ring->name(), &lost));
+  SharedMemoryRegion region;
+  EXPECT_FALSE(ring->CopyTensor(BigTensor(1), ring->name(), &region));
+  ring->Release(lost);
+  Tensor r;
+  TF_ASSERT_OK(SendAndReceive(ring.get(), BigTensor(1), &r));
+  test::ExpectTensorEqual<float>(BigTensor(1), r);
+
+  // A late receiver does not get the reused region, and a claimed region
+  // is not released by the ring.
+  Tensor late;
+  EXPECT_TRUE(errors::IsAborted(
+      TensorFromSharedMemory(lost, DT_FLOAT, BigTensor(0).shape(), &late)));
+  ring->Release(lost);
+  EXPECT_FALSE(ring->CopyTensor(BigTensor(2), ring->name(), &region));
+  test::ExpectTensorEqual<float>(BigTensor(1), r);
+  r = Tensor();
+  TF_ASSERT_OK(SendAndReceive(ring.get(), BigTensor(2), &r));
+  test::ExpectTensorEqual<float>(BigTensor(2), r);
+}
+
+TEST(SharedMemoryRingTest, TakesBackUnclaimedRegions) {
+  std::unique_ptr<SharedMemoryRing> ring;
+  TF_ASSERT_OK(SharedMemoryRing::Create(4096, 100 * 1000, &ring));
+  // The response which carries the region is dropped, and its receiver
+  // never releases it.
+  SharedMemoryRegion lost;
+  ASSERT_TRUE(ring->CopyTensor(BigTensor(0), ring->name(), &lost));
+  SharedMemoryRegion region;
+  EXPECT_FALSE(ring->CopyTensor(BigTensor(1), ring->name(), &region));
+  Env::Default()->SleepForMicroseconds(200 * 1000);
+  Tensor r;
+  TF_ASSERT_OK(SendAndReceive(ring.get(), BigTensor(1), &r));
+  test::ExpectTensorEqual<float>(BigTensor(1), r);
+  Tensor late;
+  EXPECT_TRUE(errors::IsAborted(
+      TensorFromSharedMemory(lost, DT_FLOAT, BigTensor(0).shape(), &late)));
+
+  // A claimed region of a live receiver is not taken back.
+  Env::Default()->SleepForMicroseconds(200 * 1000);
+  EXPECT_FALSE(ring->CopyTensor(BigTensor(2), ring->name(), &region));
+  test::ExpectTensorEqual<float>(BigTensor(1), r);
+}
+
+TEST(SharedMemoryRingTest, TakesBackRegionsOfExitedReceivers) {
+  std::unique_ptr<SharedMemoryRing> ring;
+  TF_ASSERT_OK(SharedMemoryRing::Create(4096, 0, &ring));
+  // The receiver claims the region, and exits without releasing it.
+  SharedMemoryRegion region;
+  ASSERT_TRUE(
+      ring->CopyTensor(BigTensor(0), "/tf_no_such_segment", &region));
+  Tensor pinned;
+  TF_ASSERT_OK(TensorFromSharedMemory(region, DT_FLOAT, BigTensor(0).shape(),
+                                      &pinned));
+  Tensor r;
+  TF_ASSERT_OK(SendAndReceive(ring.get(), BigTensor(1), &r));
+  test::ExpectTensorEqual<float>(BigTensor(1), r);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
 #include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/framework/bfloat16.h"
+#include "tensorflow/core/platform/snappy.h"
 
 namespace tensorflow {
 
@@ -31,6 +33,7 @@ void TensorResponse::Clear() {
 
 void TensorResponse::ClearTensor() {
   meta_.Clear();
+  pending_content_bytes_ = 0;
   tensor_ = Tensor();
 }
 
@@ -45,9 +48,71 @@ void TensorResponse::InitAlloc(DeviceBase* d, const AllocatorAttributes& aa) {
   allocator_ = device_->GetAllocator(alloc_attrs_);
 }
 
+// Undoes the transport encodings of the tensor of "*response", applied by
+// the sender: see RecvTensorRequest.accept_compression and
+// RecvTensorRequest.accept_wire_dtype.
+static Status DecodeTransport(RecvTensorResponse* response) {
+  if (response->compression() == NO_COMPRESSION &&
+      response->original_dtype() == DT_INVALID) {
+    return Status::OK();
+  }
+  TensorProto* tensor = response->mutable_tensor();
+  if (response->compression() == SNAPPY) {
+    const string& compressed = tensor->tensor_content();
+    size_t length;
+    if (!port::Snappy_GetUncompressedLength(compressed.data(),
+                                            compressed.size(), &length)) {
+      return errors::InvalidArgument("Cannot uncompress tensor content");
+    }
+    string content;
+    content.resize(length);
+    if (!port::Snappy_Uncompress(compressed.data(), compressed.size(),
+                                 &content[0])) {
+      return errors::InvalidArgument("Cannot uncompress tensor content");
+    }
+    tensor->mutable_tensor_content()->swap(content);
+    response->clear_compression();
+  } else if (response->compression() != NO_COMPRESSION) {
+    return errors::InvalidArgument("Unknown tensor compression ",
+                                   response->compression());
+  }
+  if (response->original_dtype() != DT_INVALID) {
+    const DataType wire_dtype = tensor->dtype();
+    if (response->original_dtype() != DT_FLOAT ||
+        (wire_dtype != DT_HALF && wire_dtype != DT_BFLOAT16)) {
+      return errors::InvalidArgument(
+          "Cannot cast tensor of type ", DataTypeString(wire_dtype), " to ",
+          DataTypeString(response->original_dtype()));
+    }
+    const string& wire_content = tensor->tensor_content();
+    const int64 n = wire_content.size() / sizeof(uint16);
+    string content;
+    content.resize(n * sizeof(float));
+    float* dst = reinterpret_cast<float*>(&content[0]);
+    if (wire_dtype == DT_BFLOAT16) {
+      BFloat16ToFloat(reinterpret_cast<const bfloat16*>(wire_content.data()),
+                      dst, n);
+    } else {
+      const Eigen::half* src =
+          reinterpret_cast<const Eigen::half*>(wire_content.data());
+      for (int64 i = 0; i < n; ++i) {
+        dst[i] = static_cast<float>(src[i]);
+      }
+    }
+    tensor->set_dtype(DT_FLOAT);
+    tensor->mutable_tensor_content()->swap(content);
+    response->clear_original_dtype();
+  }
+  return Status::OK();
+}
+
 Status TensorResponse::InitFrom(RecvTensorResponse* response) {
   Status s;
   meta_.Swap(response);
+  TF_RETURN_IF_ERROR(DecodeTransport(&meta_));
+  if (meta_.has_transport_options()) {
+    return Status::OK();
+  }
   if (on_host_) {
     if (!tensor_.FromProto(allocator_, meta_.tensor())) {
       s = errors::InvalidArgument("Cannot parse tensor from response");
@@ -82,6 +147,10 @@ Status TensorResponse::ParseFrom(Source* source) {
     if (!meta_.ParseFromCodedStream(&input) || !input.ConsumedEntireMessage()) {
       return errors::InvalidArgument("Cannot parse tensor from response");
     }
+    TF_RETURN_IF_ERROR(DecodeTransport(&meta_));
+    if (meta_.has_transport_options()) {
+      return Status::OK();
+    }
     Status s =
         device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
     // Reduce memory usage for big tensors.
@@ -139,27 +208,21 @@ bool ReadNestedMessage(protobuf::io::CodedInputStream* input,
 }  // namespace
 
 bool TensorResponse::ParseTensorSubmessage(
-    protobuf::io::CodedInputStream* input, TensorProto* tensor_meta) {
-  bool seen_tensor_content = false;
+    protobuf::io::CodedInputStream* input, TensorProto* tensor_meta,
+    bool* seen_tensor_content) {
+  *seen_tensor_content = false;
   while (true) {
     auto p = input->ReadTagWithCutoff(127);
     int tag = GetTagFieldNumber(p.first);
     WireType wt = GetTagWireType(p.first);
     if (!p.second) {
-      bool ok = (tag == 0);
-      if (ok && !seen_tensor_content) {
-        // No tensor content: could be because it's a zero-length tensor
-        TensorShape shape(tensor_meta->tensor_shape());
-        Tensor t(allocator_, tensor_meta->dtype(), shape);
-        tensor_ = std::move(t);
-      }
-      return ok;
+      return (tag == 0);
     }
     switch (tag) {
       case TensorProto::kDtypeFieldNumber: {
         uint32 v;
         if ((wt != WIRETYPE_VARINT) || !input->ReadVarint32(&v)) return false;
-        if (seen_tensor_content) return false;
+        if (*seen_tensor_content) return false;
         tensor_meta->set_dtype(static_cast<DataType>(static_cast<int>(v)));
         if (!DataTypeCanUseMemcpy(tensor_meta->dtype())) return false;
         break;
@@ -168,27 +231,27 @@ bool TensorResponse::ParseTensorSubmessage(
         if ((wt != WIRETYPE_LENGTH_DELIMITED) ||
             !ReadNestedMessage(input, tensor_meta->mutable_tensor_shape()))
           return false;
-        if (seen_tensor_content) return false;
+        if (*seen_tensor_content) return false;
         break;
       }
       case TensorProto::kVersionNumberFieldNumber: {
         uint32 v;
         if ((wt != WIRETYPE_VARINT) || !input->ReadVarint32(&v)) return false;
-        if (seen_tensor_content) return false;
+        if (*seen_tensor_content) return false;
         tensor_meta->set_version_number(static_cast<int32>(v));
         break;
       }
       case TensorProto::kTensorContentFieldNumber: {
         // If we haven't seen the dtype and tensor_shape data first, we can't
         // deal with this in the fast path.
-        if (seen_tensor_content) return false;
+        if (*seen_tensor_content) return false;
         if (wt != WIRETYPE_LENGTH_DELIMITED ||
             !tensor_meta->has_tensor_shape()) {
           return false;
         }
         int num_bytes;
         if (!ReadVarintSizeAsInt(input, &num_bytes)) return false;
-        seen_tensor_content = true;
+        *seen_tensor_content = true;
         TensorShape shape(tensor_meta->tensor_shape());
         Tensor t(allocator_, tensor_meta->dtype(), shape);
         StringPiece buf = t.tensor_data();
@@ -213,12 +276,22 @@ bool TensorResponse::ParseTensorSubmessage(
 bool TensorResponse::ParseFast(Source* source) {
   protobuf::io::CodedInputStream input(source->contents());
   input.SetTotalBytesLimit(INT_MAX, INT_MAX);  // Unlimited
+  bool seen_tensor = false;
+  bool seen_tensor_content = false;
   while (true) {
     auto p = input.ReadTagWithCutoff(127);
     int tag = GetTagFieldNumber(p.first);
     WireType wt = GetTagWireType(p.first);
     if (!p.second) {
-      return (tag == 0);
+      if (tag != 0) return false;
+      if (seen_tensor && !seen_tensor_content &&
+          !meta_.has_transport_options()) {
+        // No tensor content: could be because it's a zero-length tensor
+        TensorShape shape(meta_.tensor().tensor_shape());
+        Tensor t(allocator_, meta_.tensor().dtype(), shape);
+        tensor_ = std::move(t);
+      }
+      return true;
     }
     switch (tag) {
       case RecvTensorResponse::kTensorFieldNumber: {
@@ -229,9 +302,11 @@ bool TensorResponse::ParseFast(Source* source) {
         std::pair<protobuf::io::CodedInputStream::Limit, int> p =
             input.IncrementRecursionDepthAndPushLimit(length);
         if (p.second < 0 ||
-            !ParseTensorSubmessage(&input, meta_.mutable_tensor())) {
+            !ParseTensorSubmessage(&input, meta_.mutable_tensor(),
+                                   &seen_tensor_content)) {
           return false;
         }
+        seen_tensor = true;
         if (!input.DecrementRecursionDepthAndPopLimit(p.first)) {
           return false;
         }
@@ -266,9 +341,13 @@ bool TensorResponse::ParseFast(Source* source) {
 }
 
 bool TensorResponse::ParseSlow(Source* source) {
-  if (!meta_.ParseFromZeroCopyStream(source->contents())) {
+  if (!meta_.ParseFromZeroCopyStream(source->contents()) ||
+      !DecodeTransport(&meta_).ok()) {
     return false;
   }
+  if (meta_.has_transport_options()) {
+    return true;
+  }
 
   Tensor parsed(meta_.tensor().dtype());
   if (!parsed.FromProto(allocator_, meta_.tensor())) {
@@ -286,4 +365,92 @@ bool TensorResponse::ParseSlow(Source* source) {
   return true;
 }
 
+Status TensorResponse::ParseChunkFrom(Source* source) {
+  protobuf::io::CodedInputStream input(source->contents());
+  input.SetTotalBytesLimit(INT_MAX, INT_MAX);  // Unlimited
+  const Status parse_error =
+      errors::InvalidArgument("Cannot parse tensor chunk from response");
+  RecvTensorResponse metadata;
+  bool has_metadata = false;
+  bool content_in_chunks = false;
+  int64 offset = 0;
+  while (true) {
+    auto p = input.ReadTagWithCutoff(127);
+    int tag = GetTagFieldNumber(p.first);
+    WireType wt = GetTagWireType(p.first);
+    if (!p.second) {
+      if (tag != 0) return parse_error;
+      break;
+    }
+    switch (tag) {
+      case RecvTensorChunk::kMetadataFieldNumber: {
+        if ((wt != WIRETYPE_LENGTH_DELIMITED) ||
+            !ReadNestedMessage(&input, &metadata))
+          return parse_error;
+        has_metadata = true;
+        break;
+      }
+      case RecvTensorChunk::kContentInChunksFieldNumber: {
+        uint32 v;
+        if ((wt != WIRETYPE_VARINT) || !input.ReadVarint32(&v))
+          return parse_error;
+        content_in_chunks = (v != 0);
+        break;
+      }
+      case RecvTensorChunk::kOffsetFieldNumber: {
+        protobuf_uint64 v;
+        if ((wt != WIRETYPE_VARINT) || !input.ReadVarint64(&v))
+          return parse_error;
+        offset = static_cast<int64>(v);
+        break;
+      }
+      case RecvTensorChunk::kDataFieldNumber: {
+        // The offset precedes the data in the encoding. Copies the data
+        // straight from the stream into the tensor allocated by the first
+        // chunk.
+        int num_bytes;
+        if ((wt != WIRETYPE_LENGTH_DELIMITED) ||
+            !ReadVarintSizeAsInt(&input, &num_bytes))
+          return parse_error;
+        StringPiece buf = tensor_.tensor_data();
+        if (num_bytes > pending_content_bytes_ || offset < 0 ||
+            offset + num_bytes > static_cast<int64>(buf.size())) {
+          return errors::InvalidArgument(
+              "Tensor chunk of ", num_bytes, " bytes at offset ", offset,
+              " does not fit in the ", pending_content_bytes_,
+              " bytes left of the tensor content");
+        }
+        if (!input.ReadRaw(const_cast<char*>(buf.data()) + offset,
+                           num_bytes))
+          return parse_error;
+        pending_content_bytes_ -= num_bytes;
+        break;
+      }
+      default:
+        return parse_error;
+    }
+  }
+  if (!has_metadata) {
+    return Status::OK();
+  }
+
+  // The first chunk of a new stream.
+  if (already_used_) {
+    ClearTensor();
+  }
+  already_used_ = true;
+  if (!content_in_chunks) {
+    return InitFrom(&metadata);
+  }
+  const TensorProto& tensor_meta = metadata.tensor();
+  if (!on_host_ || !DataTypeCanUseMemcpy(tensor_meta.dtype()) ||
+      !TensorShape::IsValid(tensor_meta.tensor_shape())) {
+    return errors::InvalidArgument(
+        "Cannot receive the content of the tensor in chunks");
+  }
+  InitPartial(metadata);
+  pending_content_bytes_ = tensor_.TotalBytes();
+  return Status::OK();
+}
+
 }  // namespace tensorflow
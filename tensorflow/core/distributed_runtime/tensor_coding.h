@@ -32,6 +32,10 @@ class TensorProto;
 // TensorResponse can be used as the destination of an RPC that returns
 // a RecvTensorResponse.  It efficiently decodes the incoming data
 // into Tensor contents as well as associated metadata.
+//
+// If the response has transport_options, the content of the tensor is not
+// in the response: tensor() is left empty, and metadata().tensor() keeps the
+// dtype and the shape of the tensor, for the transport to fill in.
 class TensorResponse {
  public:
   TensorResponse() {}
@@ -70,6 +74,16 @@ class TensorResponse {
   // source->contents() into *this.
   Status ParseFrom(Source* source);
 
+  // Parse the RecvTensorChunk encoded in the data yielded by
+  // source->contents() into *this. The first chunk of a stream initializes
+  // the tensor and its metadata, and the pieces of the content in the
+  // following chunks are copied directly into the tensor.
+  Status ParseChunkFrom(Source* source);
+
+  // Returns the number of bytes of the tensor content which ParseChunkFrom()
+  // has yet to receive.
+  int64 pending_content_bytes() const { return pending_content_bytes_; }
+
   // Initialize tensor from *response.
   // Leaves *response with unspecified contents.
   Status InitFrom(RecvTensorResponse* response);
@@ -89,7 +103,8 @@ class TensorResponse {
 
  private:
   bool ParseTensorSubmessage(protobuf::io::CodedInputStream* input,
-                             TensorProto* tensor_meta);
+                             TensorProto* tensor_meta,
+                             bool* seen_tensor_content);
   bool ParseFast(Source* source);
   bool ParseSlow(Source* source);
 
@@ -98,6 +113,7 @@ class TensorResponse {
   AllocatorAttributes alloc_attrs_;
   Allocator* allocator_ = nullptr;
   bool already_used_ = false;
+  int64 pending_content_bytes_ = 0;
   Tensor tensor_;
   RecvTensorResponse meta_;
 };
@@ -15,13 +15,16 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
 
+#include "tensorflow/core/framework/bfloat16.h"
 #include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
@@ -155,6 +158,178 @@ TEST_F(TensorResponseTest, Simple) {
 
 TEST_F(TensorResponseTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+TEST_F(TensorResponseTest, TransportEncodings) {
+  // Values which are exact in 16 bits.
+  Tensor src(DT_FLOAT, TensorShape({20, 100}));
+  for (int i = 0; i < src.NumElements(); ++i) {
+    src.flat<float>()(i) = (i % 7) * 0.5f - 1;
+  }
+  DummyDevice cpu_device(Env::Default());
+  TensorResponse response;
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  for (DataType wire_dtype : {DT_INVALID, DT_HALF, DT_BFLOAT16}) {
+    for (bool compress : {false, true}) {
+      RecvTensorResponse proto;
+      proto.set_send_start_micros(123456);
+      Tensor wire(wire_dtype == DT_INVALID ? DT_FLOAT : wire_dtype,
+                  src.shape());
+      if (wire_dtype == DT_BFLOAT16) {
+        FloatToBFloat16(src.flat<float>().data(), wire.flat<bfloat16>().data(),
+                        src.NumElements());
+      } else if (wire_dtype == DT_HALF) {
+        for (int i = 0; i < src.NumElements(); ++i) {
+          wire.flat<Eigen::half>()(i) = Eigen::half(src.flat<float>()(i));
+        }
+      } else {
+        wire = src;
+      }
+      wire.AsProtoTensorContent(proto.mutable_tensor());
+      if (wire_dtype != DT_INVALID) {
+        proto.set_original_dtype(DT_FLOAT);
+      }
+      if (compress) {
+        string compressed;
+        if (!port::Snappy_Compress(wire.tensor_data().data(),
+                                   wire.tensor_data().size(), &compressed)) {
+          continue;  // Snappy is not available.
+        }
+        proto.mutable_tensor()->set_tensor_content(compressed);
+        proto.set_compression(SNAPPY);
+      }
+      string encoded;
+      proto.AppendToString(&encoded);
+      StringSource source(&encoded, 1024);
+      TF_EXPECT_OK(response.ParseFrom(&source));
+      EXPECT_EQ(123456, response.metadata().send_start_micros());
+      EXPECT_EQ(NO_COMPRESSION, response.metadata().compression());
+      EXPECT_EQ(DT_INVALID, response.metadata().original_dtype());
+      test::ExpectTensorEqual<float>(src, response.tensor());
+    }
+  }
+}
+
+TEST_F(TensorResponseTest, BadTransportEncodings) {
+  DummyDevice cpu_device(Env::Default());
+  TensorResponse response;
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  RecvTensorResponse proto;
+  test::AsTensor<int32>({1, 2, 3}).AsProtoTensorContent(proto.mutable_tensor());
+  proto.set_original_dtype(DT_FLOAT);
+  string encoded;
+  proto.AppendToString(&encoded);
+  StringSource source(&encoded, 1024);
+  EXPECT_FALSE(response.ParseFrom(&source).ok());
+}
+
+// Parses "chunks", the encoded messages of a streaming RecvTensor, into
+// "response".
+static Status ParseChunks(const std::vector<RecvTensorChunk>& chunks,
+                          TensorResponse* response) {
+  for (const RecvTensorChunk& chunk : chunks) {
+    string encoded;
+    chunk.AppendToString(&encoded);
+    StringSource source(&encoded, 7);
+    TF_RETURN_IF_ERROR(response->ParseChunkFrom(&source));
+  }
+  return Status::OK();
+}
+
+TEST_F(TensorResponseTest, Chunks) {
+  Tensor src(DT_FLOAT, TensorShape({10, 7}));
+  for (int i = 0; i < src.NumElements(); ++i) {
+    src.flat<float>()(i) = i;
+  }
+  const StringPiece content = src.tensor_data();
+  DummyDevice cpu_device(Env::Default());
+  TensorResponse response;
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  for (int chunk_bytes : {1, 12, 100, 280}) {
+    std::vector<RecvTensorChunk> chunks(1);
+    chunks[0].mutable_metadata()->set_send_start_micros(123456);
+    chunks[0].mutable_metadata()->mutable_tensor()->set_dtype(DT_FLOAT);
+    src.shape().AsProto(
+        chunks[0].mutable_metadata()->mutable_tensor()->mutable_tensor_shape());
+    chunks[0].set_content_in_chunks(true);
+    for (int offset = 0; offset < content.size(); offset += chunk_bytes) {
+      chunks.emplace_back();
+      chunks.back().set_offset(offset);
+      chunks.back().set_data(content.substr(offset, chunk_bytes).ToString());
+    }
+    TF_EXPECT_OK(ParseChunks(chunks, &response));
+    EXPECT_EQ(0, response.pending_content_bytes());
+    EXPECT_EQ(123456, response.metadata().send_start_micros());
+    test::ExpectTensorEqual<float>(src, response.tensor());
+  }
+}
+
+TEST_F(TensorResponseTest, WholeTensorChunk) {
+  DummyDevice cpu_device(Env::Default());
+  TensorResponse response;
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  for (const Tensor& src : {test::AsTensor<float>({1, 2, 3}),
+                            test::AsTensor<string>({"a", "bc"})}) {
+    std::vector<RecvTensorChunk> chunks(1);
+    src.AsProtoTensorContent(chunks[0].mutable_metadata()->mutable_tensor());
+    TF_EXPECT_OK(ParseChunks(chunks, &response));
+    EXPECT_EQ(0, response.pending_content_bytes());
+    EXPECT_EQ(src.DebugString(), response.tensor().DebugString());
+  }
+}
+
+TEST_F(TensorResponseTest, ChunkOutOfTensor) {
+  DummyDevice cpu_device(Env::Default());
+  TensorResponse response;
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  std::vector<RecvTensorChunk> chunks(2);
+  chunks[0].mutable_metadata()->mutable_tensor()->set_dtype(DT_INT32);
+  TensorShape({2}).AsProto(
+      chunks[0].mutable_metadata()->mutable_tensor()->mutable_tensor_shape());
+  chunks[0].set_content_in_chunks(true);
+  chunks[1].set_offset(4);
+  chunks[1].set_data("12345678");
+  EXPECT_TRUE(errors::IsInvalidArgument(ParseChunks(chunks, &response)));
+
+  // A piece of content without a tensor.
+  TensorResponse fresh_response;
+  fresh_response.InitAlloc(&cpu_device, AllocatorAttributes());
+  chunks.erase(chunks.begin());
+  EXPECT_TRUE(errors::IsInvalidArgument(ParseChunks(chunks, &fresh_response)));
+}
+
+TEST_F(TensorResponseTest, TransportOptions) {
+  // The content of the tensor is received out of band: only its dtype and
+  // shape are parsed, without allocating it.
+  RecvTensorResponse proto;
+  proto.mutable_tensor()->set_dtype(DT_FLOAT);
+  TensorShape({1000, 10})
+      .AsProto(proto.mutable_tensor()->mutable_tensor_shape());
+  SharedMemoryRegion region;
+  region.set_segment("/segment");
+  region.set_length(40000);
+  proto.mutable_transport_options()->PackFrom(region);
+  string encoded;
+  proto.AppendToString(&encoded);
+
+  DummyDevice cpu_device(Env::Default());
+  TensorResponse response;
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  StringSource source(&encoded, 1024);
+  TF_ASSERT_OK(response.ParseFrom(&source));
+  EXPECT_EQ(0, response.tensor().NumElements());
+  EXPECT_EQ(DT_FLOAT, response.metadata().tensor().dtype());
+  EXPECT_EQ(TensorShape({1000, 10}),
+            TensorShape(response.metadata().tensor().tensor_shape()));
+  EXPECT_TRUE(response.metadata().transport_options().Is<SharedMemoryRegion>());
+
+  std::vector<RecvTensorChunk> chunks(1);
+  *chunks[0].mutable_metadata() = proto;
+  TF_ASSERT_OK(ParseChunks(chunks, &response));
+  EXPECT_EQ(0, response.pending_content_bytes());
+  EXPECT_EQ(0, response.tensor().NumElements());
+  EXPECT_EQ(TensorShape({1000, 10}),
+            TensorShape(response.metadata().tensor().tensor_shape()));
+}
+
 string MakeFloatTensorTestCase(int num_elems) {
   std::vector<int8> v(num_elems);
   for (int i = 0; i < num_elems; i++) {
@@ -28,6 +28,7 @@ class DeviceMgr;
 class Env;
 class GraphMgr;
 class RendezvousMgrInterface;
+class SharedMemoryRing;
 class WorkerCacheInterface;
 
 // The worker environment class, which holds a bag of pointers to
@@ -55,6 +56,10 @@ struct WorkerEnv {
 
   // A pool of threads for scheduling compute work.
   thread::ThreadPool* compute_pool = nullptr;
+
+  // If set, the content of the tensors received by the workers of the same
+  // host is passed through this ring rather than in the RPC responses.
+  SharedMemoryRing* shared_memory_ring = nullptr;
 };
 
 }  // end namespace tensorflow
@@ -30,6 +30,8 @@ void AllocatorStats::Clear() {
   this->max_bytes_in_use = 0;
   this->max_alloc_size = 0;
   this->bytes_limit = 0;
+  this->num_pool_hits = 0;
+  this->bytes_reserved = 0;
 }
 
 string AllocatorStats::DebugString() const {
@@ -38,9 +40,12 @@ string AllocatorStats::DebugString() const {
       "InUse:        %20lld\n"
       "MaxInUse:     %20lld\n"
       "NumAllocs:    %20lld\n"
-      "MaxAllocSize: %20lld\n",
+      "MaxAllocSize: %20lld\n"
+      "PoolHits:     %20lld\n"
+      "Reserved:     %20lld\n",
       this->bytes_limit, this->bytes_in_use, this->max_bytes_in_use,
-      this->num_allocs, this->max_alloc_size);
+      this->num_allocs, this->max_alloc_size, this->num_pool_hits,
+      this->bytes_reserved);
 }
 
 constexpr size_t Allocator::kAllocatorAlignment;
@@ -56,6 +56,13 @@ struct AllocatorStats {
   // unknown.
   int64 bytes_limit;
 
+  // For allocators that keep freed memory for reuse: the number of
+  // allocations served from that memory instead of the underlying
+  // allocator, and the bytes currently obtained from the underlying
+  // allocator, whether in use or kept for reuse.
+  int64 num_pool_hits;
+  int64 bytes_reserved;
+
   AllocatorStats() { Clear(); }
 
   void Clear();
@@ -221,8 +221,14 @@ OpKernelContext::~OpKernelContext() {
 }
 
 Allocator* OpKernelContext::get_allocator(AllocatorAttributes attr) {
-  Allocator* allocator =
-      params_->device->GetStepAllocator(attr, step_resource_manager());
+  Allocator* allocator;
+  if (params_->step_allocator != nullptr && !attr.nic_compatible() &&
+      !attr.gpu_compatible()) {
+    allocator = params_->step_allocator;
+  } else {
+    allocator =
+        params_->device->GetStepAllocator(attr, step_resource_manager());
+  }
   if (params_->track_allocations) {
     mutex_lock lock(mu_);
     for (const auto& wrapped : wrapped_allocators_) {
@@ -514,6 +514,11 @@ class OpKernelContext {
     // Per-step resources accessible by this op kernel invocation.
     ResourceMgr* step_resource_manager = nullptr;
 
+    // If not null, the allocator to use for the memory of this step which
+    // stays on the device, i.e. which is neither NIC nor GPU compatible.
+    // Resolved once per step by the executor.
+    Allocator* step_allocator = nullptr;
+
     // Mechanism used by this op kernel invocation to communicate with
     // computations running on other devices.
     Rendezvous* rendezvous = nullptr;
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/framework/rendezvous.h"
 
+#include <atomic>
 #include <functional>
 #include <utility>
 #include <vector>
@@ -130,10 +131,16 @@ Status Rendezvous::Recv(const ParsedKey& key, const Args& recv_args,
   return ret;
 }
 
+// The table of pending messages and waiters is split into shards, each
+// with its own lock, so that the Send/Recv pairs of independent edges
+// do not serialize on one mutex. The abort status is published through
+// an atomic flag that is read under the shard lock; StartAbort() sets
+// the flag before draining each shard, so every item inserted into a
+// shard is either drained by StartAbort() or rejected on insertion.
 class LocalRendezvousImpl : public Rendezvous {
  public:
   explicit LocalRendezvousImpl(bool tolerate_dup_recv)
-      : tolerate_dup_recv_(tolerate_dup_recv) {}
+      : tolerate_dup_recv_(tolerate_dup_recv), aborted_(false) {}
 
   Status Send(const ParsedKey& key, const Args& send_args, const Tensor& val,
               const bool is_dead) override {
@@ -141,14 +148,15 @@ class LocalRendezvousImpl : public Rendezvous {
     Args recv_args;
     uint64 key_hash = KeyHash(key.FullKey());
     VLOG(2) << "Send " << this << " " << key_hash << " " << key.FullKey();
+    Shard* shard = GetShard(key_hash);
     {
-      mutex_lock l(mu_);
-      if (!status_.ok()) {
-        return status_;
+      mutex_lock l(shard->mu);
+      if (aborted_.load(std::memory_order_relaxed)) {
+        return GetStatus();
       }
       Item* item = nullptr;
-      Table::iterator iter = table_.find(key_hash);
-      if (iter == table_.end()) {
+      Table::iterator iter = shard->table.find(key_hash);
+      if (iter == shard->table.end()) {
         // There is no waiter for this message. Insert the message
         // into the waiters table. The waiter will pick it up when
         // arrives.
@@ -165,7 +173,7 @@ class LocalRendezvousImpl : public Rendezvous {
         // The allocator attributes of item->value.
         item->send_alloc_attrs = send_args.alloc_attrs;
 
-        CHECK(table_.insert({key_hash, item}).second);
+        CHECK(shard->table.insert({key_hash, item}).second);
         return Status::OK();
       } else {
         item = iter->second;
@@ -209,19 +217,19 @@ class LocalRendezvousImpl : public Rendezvous {
                  DoneCallback done) override {
     uint64 key_hash = KeyHash(key.FullKey());
     VLOG(2) << "Recv " << this << " " << key_hash << " " << key.FullKey();
-    mu_.lock();
-    if (!status_.ok()) {
+    Shard* shard = GetShard(key_hash);
+    shard->mu.lock();
+    if (aborted_.load(std::memory_order_relaxed)) {
       // Rendezvous has been aborted.
-      Status s = status_;
-      mu_.unlock();
-      done(s, Args(), recv_args, Tensor(), false);
+      shard->mu.unlock();
+      done(GetStatus(), Args(), recv_args, Tensor(), false);
       return;
     }
-    Table::iterator iter = table_.find(key_hash);
-    if (iter != table_.end()) {
+    Table::iterator iter = shard->table.find(key_hash);
+    if (iter != shard->table.end()) {
       Item* item = iter->second;
       if (item->has_been_recvd && !tolerate_dup_recv_) {
-        mu_.unlock();
+        shard->mu.unlock();
         done(errors::Aborted("Duplicated recv: ", key.FullKey()), Args(),
              recv_args, Tensor(), false);
       } else if (item->waiter == nullptr || tolerate_dup_recv_) {
@@ -244,13 +252,13 @@ class LocalRendezvousImpl : public Rendezvous {
         Args send_args;
         send_args.device_context = item->send_dev_context;
         send_args.alloc_attrs = item->send_alloc_attrs;
-        mu_.unlock();
+        shard->mu.unlock();
         done(Status::OK(), send_args, recv_args, v, is_dead);
         if (send_dev_context) send_dev_context->Unref();
       } else {
         // Already have a waiter in the waiters table under this key,
         // which should not happen.
-        mu_.unlock();
+        shard->mu.unlock();
         done(errors::Aborted("Duplicated recv: ", key.FullKey()), Args(),
              recv_args, Tensor(), false);
       }
@@ -266,21 +274,25 @@ class LocalRendezvousImpl : public Rendezvous {
       item->recv_dev_context = recv_args.device_context;
       item->recv_dev_context->Ref();
     }
-    CHECK(table_.insert({key_hash, item}).second);
-    mu_.unlock();
+    CHECK(shard->table.insert({key_hash, item}).second);
+    shard->mu.unlock();
     return;
   }
 
   void StartAbort(const Status& status) override {
     CHECK(!status.ok());
-    std::vector<Item*> items;
     {
-      mutex_lock l(mu_);
+      mutex_lock l(status_mu_);
       if (!status_.ok()) return;
       status_ = status;
-      items.reserve(table_.size());
-      for (const auto& p : table_) items.push_back(p.second);
-      table_.clear();
+      aborted_.store(true);
+    }
+    std::vector<Item*> items;
+    for (Shard& shard : shards_) {
+      mutex_lock l(shard.mu);
+      items.reserve(items.size() + shard.table.size());
+      for (const auto& p : shard.table) items.push_back(p.second);
+      shard.table.clear();
     }
     for (Item* item : items) {
       if (item->waiter != nullptr) {
@@ -320,14 +332,35 @@ class LocalRendezvousImpl : public Rendezvous {
 
   typedef gtl::FlatMap<uint64, Item*> Table;
 
-  // TODO(zhifengc): shard table_.
-  mutex mu_;
-  Table table_ GUARDED_BY(mu_);
-  Status status_;
+  // A rendezvous is created for every step, so the number of shards is
+  // kept small.
+  static const int kNumShards = 8;
+  struct Shard {
+    mutex mu;
+    Table table GUARDED_BY(mu);
+  };
+  Shard shards_[kNumShards];
+
+  Shard* GetShard(uint64 key_hash) {
+    // The low bits of the hash are used by the table itself.
+    return &shards_[(key_hash >> 32) % kNumShards];
+  }
+
+  Status GetStatus() {
+    mutex_lock l(status_mu_);
+    return status_;
+  }
+
+  // Set once, under status_mu_, when the rendezvous is aborted.
+  std::atomic<bool> aborted_;
+  mutex status_mu_;
+  Status status_ GUARDED_BY(status_mu_);
 
   ~LocalRendezvousImpl() override {
-    for (auto i : table_) {
-      delete i.second;
+    for (Shard& shard : shards_) {
+      for (auto i : shard.table) {
+        delete i.second;
+      }
     }
   }
 
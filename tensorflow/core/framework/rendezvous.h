@@ -42,6 +42,16 @@ class Rendezvous : public core::RefCounted {
   struct Args {
     DeviceContext* device_context = nullptr;
     AllocatorAttributes alloc_attrs;
+
+    // Transport encodings which the receiver of a tensor from another
+    // process accepts, set from the "_wire_compression" and "_wire_dtype"
+    // attrs of the Recv node. Ignored by local rendezvous.
+    //
+    // "snappy" to accept a compressed tensor content, or empty.
+    string wire_compression;
+    // DT_HALF or DT_BFLOAT16 to accept DT_FLOAT tensors sent at a lower
+    // precision, or DT_INVALID.
+    DataType wire_dtype = DT_INVALID;
   };
 
   // Constructs a rendezvous key for the tensor of "name" sent from
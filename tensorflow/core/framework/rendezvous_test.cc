@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -261,6 +262,27 @@ TEST_F(LocalRendezvousTest, AbortThenRecvOrSend) {
       errors::IsAborted(rendez_->Recv(KeyFoo(), args, &val, &val_dead)));
 }
 
+TEST_F(LocalRendezvousTest, AbortWakesAllPendingRecvs) {
+  // Enough keys to land in every shard of the table.
+  const int N = 100;
+  mutex mu;
+  int num_aborted = 0;
+  for (int i = 0; i < N; ++i) {
+    rendez_->RecvAsync(MakeKey(strings::StrCat("key", i)), Rendezvous::Args(),
+                       [&mu, &num_aborted](const Status& s,
+                                           const Rendezvous::Args& send_args,
+                                           const Rendezvous::Args& recv_args,
+                                           const Tensor& val, bool is_dead) {
+                         EXPECT_TRUE(errors::IsAborted(s));
+                         mutex_lock l(mu);
+                         ++num_aborted;
+                       });
+  }
+  rendez_->StartAbort(errors::Aborted(""));
+  mutex_lock l(mu);
+  EXPECT_EQ(N, num_aborted);
+}
+
 class DummyDeviceContext : public DeviceContext {
  public:
   explicit DummyDeviceContext(int stream_id) : stream_id_(stream_id) {}
@@ -346,4 +368,48 @@ static void BM_RecvSend(int iters) {
 }
 BENCHMARK(BM_RecvSend);
 
+// Each of "threads" threads sends and receives its own set of keys
+// through one rendezvous shared by all of them, as the executors of
+// one step do. The keys are parsed beforehand, like those of _Send and
+// _Recv kernels. A new rendezvous is used for every round of
+// kKeysPerThread keys, as each step creates its own.
+static void BM_SendRecvParallel(int iters, int threads) {
+  testing::StopTiming();
+  const int kKeysPerThread = 1024;
+  std::vector<std::vector<Rendezvous::ParsedKey>> keys(threads);
+  for (int t = 0; t < threads; ++t) {
+    for (int k = 0; k < kKeysPerThread; ++k) {
+      keys[t].push_back(MakeKey(strings::StrCat("t", t, "_k", k)));
+    }
+  }
+  thread::ThreadPool* pool =
+      new thread::ThreadPool(Env::Default(), "test", threads);
+  const Tensor orig = V("val");
+  const int rounds = std::max(1, iters / (threads * kKeysPerThread));
+  testing::StartTiming();
+  for (int r = 0; r < rounds; ++r) {
+    Rendezvous* rendez = NewLocalRendezvous();
+    BlockingCounter counter(threads);
+    for (int t = 0; t < threads; ++t) {
+      pool->Schedule([rendez, &keys, &orig, &counter, t]() {
+        Tensor val;
+        bool is_dead = false;
+        Rendezvous::Args args;
+        for (const Rendezvous::ParsedKey& key : keys[t]) {
+          TF_CHECK_OK(rendez->Send(key, args, orig, is_dead));
+          TF_CHECK_OK(rendez->Recv(key, args, &val, &is_dead));
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    rendez->Unref();
+  }
+  testing::StopTiming();
+  testing::ItemsProcessed(static_cast<int64>(rounds) * threads *
+                          kKeysPerThread);
+  delete pool;
+}
+BENCHMARK(BM_SendRecvParallel)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(16);
+
 }  // namespace tensorflow
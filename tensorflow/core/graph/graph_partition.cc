@@ -15,7 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/graph/graph_partition.h"
 
+#include <algorithm>
 #include <deque>
+#include <map>
 #include <unordered_map>
 #include <vector>
 
@@ -247,6 +249,16 @@ NodeDef* AddRecv(const PartitionOptions& opts, const GraphInfo& g_info,
   SetSendRecvAttrs(opts, edge, &recv_builder);
   recv_builder.Device(dst->assigned_device_name())
       .Attr("tensor_type", cast_dtype);
+  // The transport encodings which the user set on the source node apply to
+  // its output edges.
+  if (!edge->IsControlEdge()) {
+    for (const char* attr_name : {"_wire_compression", "_wire_dtype"}) {
+      auto it = src->def().attr().find(attr_name);
+      if (it != src->def().attr().end()) {
+        recv_builder.Attr(attr_name, it->second);
+      }
+    }
+  }
   NodeDef* recv = gdef->add_node();
   *status = recv_builder.Finalize(recv);
   if (!status->ok()) return nullptr;
@@ -801,11 +813,61 @@ Status AddControlEdges(const PartitionOptions& opts,
   return Status::OK();
 }
 
+namespace {
+
+// Gives every AllReduce node which is not yet part of a group the sorted
+// names and the incarnations of the devices of all the AllReduce nodes with
+// its "group_key", which its kernel needs to address its peers.
+Status AddCollectiveGroups(const PartitionOptions& opts, Graph* g) {
+  std::map<string, std::vector<Node*>> groups;
+  for (Node* node : g->nodes()) {
+    if (node->type_string() != "AllReduce" ||
+        node->def().attr().count("_group_devices") > 0) {
+      continue;
+    }
+    string group_key;
+    TF_RETURN_IF_ERROR(GetNodeAttr(node->def(), "group_key", &group_key));
+    groups[group_key].push_back(node);
+  }
+  for (const auto& group : groups) {
+    std::vector<string> devices;
+    for (const Node* node : group.second) {
+      devices.push_back(node->assigned_device_name());
+    }
+    std::sort(devices.begin(), devices.end());
+    if (std::adjacent_find(devices.begin(), devices.end()) != devices.end()) {
+      return errors::InvalidArgument(
+          "The AllReduce group '", group.first,
+          "' has several nodes on the same device.");
+    }
+    std::vector<int64> incarnations;
+    for (const string& device : devices) {
+      const uint64 incarnation = opts.get_incarnation(device);
+      if (incarnation == PartitionOptions::kIllegalIncarnation) {
+        return errors::Internal("Failed to find the incarnation of device ",
+                                device, " in the AllReduce group '",
+                                group.first, "'.");
+      }
+      incarnations.push_back(incarnation);
+    }
+    for (Node* node : group.second) {
+      node->AddAttr("_group_devices", devices);
+      node->AddAttr("_group_incarnations", incarnations);
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
 Status Partition(const PartitionOptions& opts, Graph* g,
                  std::unordered_map<string, GraphDef>* partitions) {
   Status status;
   partitions->clear();
 
+  status = AddCollectiveGroups(opts, g);
+  if (!status.ok()) return status;
+
   GraphInfo g_info;
   if (!opts.control_flow_added) {
     // Add the "code" for distributed execution of control flow. Code is
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/cc/ops/control_flow_ops.h"
 #include "tensorflow/cc/ops/random_ops.h"
 #include "tensorflow/cc/ops/sendrecv_ops.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/graph/equal_graph_def.h"
 #include "tensorflow/core/graph/graph.h"
@@ -230,6 +231,37 @@ TEST_F(GraphPartitionTest, CrossDeviceData) {
   ExpectMatchB();
 }
 
+TEST_F(GraphPartitionTest, CrossDeviceWireEncoding) {
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+  auto a1 = Input(in_.WithOpName("A1"));
+  auto b1 = Input(in_.WithOpName("B1"));
+  Combine(in_.WithOpName("B2"), a1, b1);
+  GraphDef graph_def = ToGraphDef();
+  for (NodeDef& node : *graph_def.mutable_node()) {
+    if (node.name() == "A1") {
+      AddNodeAttr("_wire_compression", "snappy", &node);
+      AddNodeAttr("_wire_dtype", DT_BFLOAT16, &node);
+    }
+  }
+
+  Partition(graph_def, &partitions_);
+  EXPECT_EQ(2, partitions_.size());
+
+  int num_recvs = 0;
+  for (const NodeDef& node :
+       partitions_["/job:a/replica:0/task:0/cpu:1"].node()) {
+    if (node.op() != "_Recv") continue;
+    ++num_recvs;
+    string compression;
+    TF_EXPECT_OK(GetNodeAttr(node, "_wire_compression", &compression));
+    EXPECT_EQ("snappy", compression);
+    DataType wire_dtype;
+    TF_EXPECT_OK(GetNodeAttr(node, "_wire_dtype", &wire_dtype));
+    EXPECT_EQ(DT_BFLOAT16, wire_dtype);
+  }
+  EXPECT_EQ(1, num_recvs);
+}
+
 TEST_F(GraphPartitionTest, CrossDeviceControl) {
   using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
   auto a1 = Input(in_.WithOpName("A1"));
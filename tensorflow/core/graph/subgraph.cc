@@ -70,18 +70,27 @@ static Status FeedInputs(Graph* g, const DeviceAttributes& device_info,
           "FeedInputs: ", t, " should have output index < ", n->num_outputs());
     }
 
+    NodeBuilder recv_builder(
+        strings::StrCat("_recv_", id.first, "_", id.second), "_Recv");
+    recv_builder.Attr("tensor_type", BaseType(n->output_type(id.second)))
+        .Attr("tensor_name", t)
+        .Attr("send_device", device_info.name())
+        .Attr("recv_device", device_info.name())
+        .Attr("send_device_incarnation",
+              static_cast<int64>(device_info.incarnation()))
+        .Attr("client_terminated", true);
+    // Keep the shape declared by a fed placeholder, so that passes running
+    // on the rewritten graph can still infer the shapes downstream of it.
+    // A legacy Placeholder with an empty shape has an unknown shape.
+    const string& op = n->def().op();
+    PartialTensorShape shape;
+    if ((op == "Placeholder" || op == "PlaceholderV2") &&
+        GetNodeAttr(n->def(), "shape", &shape).ok() &&
+        shape.dims() > (op == "Placeholder" ? 0 : -1)) {
+      recv_builder.Attr("_output_shapes", {shape});
+    }
     Node* recv_node;
-    TF_RETURN_IF_ERROR(
-        NodeBuilder(strings::StrCat("_recv_", id.first, "_", id.second),
-                    "_Recv")
-            .Attr("tensor_type", BaseType(n->output_type(id.second)))
-            .Attr("tensor_name", t)
-            .Attr("send_device", device_info.name())
-            .Attr("recv_device", device_info.name())
-            .Attr("send_device_incarnation",
-                  static_cast<int64>(device_info.incarnation()))
-            .Attr("client_terminated", true)
-            .Finalize(g, &recv_node));
+    TF_RETURN_IF_ERROR(recv_builder.Finalize(g, &recv_node));
     recv_node->set_assigned_device_name(device_info.name());
 
     // Update name_index
@@ -0,0 +1,308 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/collective_ops.cc.
+//
+// AllReduce runs a ring all-reduce over the rendezvous of the step. With N
+// devices in the group, the flattened tensor is split into N segments, and
+// each device sends segments to the next device of the ring and receives them
+// from the previous one in 2 * (N - 1) steps: during the first N - 1 steps
+// (reduce-scatter) a device adds the received segment into its output, after
+// which it holds the full reduction of one segment, and during the last N - 1
+// steps (all-gather) the reduced segments are passed around the ring and
+// copied. Each segment is further split into chunks of at most chunk_bytes,
+// and the chunks go through their steps independently so that large tensors
+// are pipelined over the ring.
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/rendezvous.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+
+namespace {
+
+enum class Reduction { kSum, kProd, kMax, kMin };
+
+template <typename T>
+void Reduce(Reduction reduction, const T* in, T* out, int64 n) {
+  switch (reduction) {
+    case Reduction::kSum:
+      for (int64 i = 0; i < n; ++i) out[i] += in[i];
+      break;
+    case Reduction::kProd:
+      for (int64 i = 0; i < n; ++i) out[i] *= in[i];
+      break;
+    case Reduction::kMax:
+      for (int64 i = 0; i < n; ++i) out[i] = std::max(out[i], in[i]);
+      break;
+    case Reduction::kMin:
+      for (int64 i = 0; i < n; ++i) out[i] = std::min(out[i], in[i]);
+      break;
+  }
+}
+
+}  // namespace
+
+template <typename T>
+class AllReduceOp : public AsyncOpKernel {
+ public:
+  explicit AllReduceOp(OpKernelConstruction* ctx) : AsyncOpKernel(ctx) {
+    string reduction;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("reduction", &reduction));
+    if (reduction == "sum") {
+      reduction_ = Reduction::kSum;
+    } else if (reduction == "prod") {
+      reduction_ = Reduction::kProd;
+    } else if (reduction == "max") {
+      reduction_ = Reduction::kMax;
+    } else {
+      reduction_ = Reduction::kMin;
+    }
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("group_key", &group_key_));
+    int64 chunk_bytes;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("chunk_bytes", &chunk_bytes));
+    chunk_elements_ = std::max<int64>(1, chunk_bytes / sizeof(T));
+
+    // The group is filled in when the graph is partitioned.
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("_group_devices", &devices_));
+    std::vector<int64> incarnations;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("_group_incarnations", &incarnations));
+    OP_REQUIRES(ctx, incarnations.size() == devices_.size(),
+                errors::InvalidArgument(
+                    "_group_devices and _group_incarnations have different "
+                    "sizes: ",
+                    devices_.size(), " vs. ", incarnations.size()));
+    for (int64 incarnation : incarnations) {
+      incarnations_.push_back(static_cast<uint64>(incarnation));
+    }
+    const string& device = ctx->device()->attributes().name();
+    auto it = std::find(devices_.begin(), devices_.end(), device);
+    OP_REQUIRES(ctx, it != devices_.end(),
+                errors::InvalidArgument("Device ", device,
+                                        " is not in the group of AllReduce ",
+                                        group_key_));
+    rank_ = it - devices_.begin();
+  }
+
+  void ComputeAsync(OpKernelContext* ctx, DoneCallback done) override {
+    const Tensor& input = ctx->input(0);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK_ASYNC(
+        ctx, ctx->allocate_output(0, input.shape(), &output), done);
+    std::copy_n(input.flat<T>().data(), input.NumElements(),
+                output->flat<T>().data());
+    const int num_devices = devices_.size();
+    if (num_devices == 1) {
+      done();
+      return;
+    }
+    OP_REQUIRES_ASYNC(
+        ctx, ctx->rendezvous() != nullptr,
+        errors::Internal("Op kernel context needs to provide a rendezvous."),
+        done);
+
+    const int64 num_elements = input.NumElements();
+    const int64 segment_elements =
+        (num_elements + num_devices - 1) / num_devices;
+    const int64 num_chunks = std::max<int64>(
+        1, (segment_elements + chunk_elements_ - 1) / chunk_elements_);
+    State* state = new State(ctx, std::move(done));
+    state->output.CopyFrom(*output, TensorShape({num_elements}));
+    state->segment_elements = segment_elements;
+    for (int64 chunk = 0; chunk < num_chunks; ++chunk) {
+      state->Ref();
+      RunStep(state, chunk, 0);
+    }
+    state->Unref();
+  }
+
+ private:
+  // The state of one execution of the kernel, shared by the chunks. Calls
+  // 'done' once all the chunks went through all their steps.
+  class State : public core::RefCounted {
+   public:
+    State(OpKernelContext* ctx, DoneCallback done)
+        : ctx(ctx), done(std::move(done)) {}
+
+    ~State() override {
+      ctx->SetStatus(status);
+      done();
+    }
+
+    void SetStatus(const Status& s) {
+      mutex_lock l(mu);
+      status.Update(s);
+    }
+
+    bool ok() {
+      mutex_lock l(mu);
+      return status.ok();
+    }
+
+    OpKernelContext* const ctx;
+    const DoneCallback done;
+    // The output, flattened.
+    Tensor output;
+    int64 segment_elements = 0;
+
+    mutex mu;
+    Status status GUARDED_BY(mu);
+  };
+
+  // Returns the range of elements of 'chunk' of 'segment' in the flattened
+  // tensor, which may be empty.
+  void ChunkRange(const State* state, int segment, int64 chunk, int64* begin,
+                  int64* end) const {
+    const int64 num_elements = state->output.NumElements();
+    const int64 segment_begin =
+        std::min(num_elements, segment * state->segment_elements);
+    const int64 segment_end =
+        std::min(num_elements, segment_begin + state->segment_elements);
+    *begin = std::min(segment_end, segment_begin + chunk * chunk_elements_);
+    *end = std::min(segment_end, *begin + chunk_elements_);
+  }
+
+  string KeyName(int64 chunk, int step) const {
+    return strings::StrCat("AllReduce:", group_key_, ":", chunk, ":", step);
+  }
+
+  // Sends the segment of step 'step' of 'chunk' to the next device, receives
+  // one from the previous device and continues with the next step, until all
+  // the steps are done. Takes one reference on 'state'.
+  void RunStep(State* state, int64 chunk, int step) {
+    const int num_devices = devices_.size();
+    if (step == 2 * (num_devices - 1) || !state->ok()) {
+      state->Unref();
+      return;
+    }
+    OpKernelContext* ctx = state->ctx;
+    const int next = (rank_ + 1) % num_devices;
+    const int prev = (rank_ + num_devices - 1) % num_devices;
+    // During the reduce-scatter steps, the device sends the segment it
+    // received at the previous step, and after them it holds the reduction
+    // of segment rank_ + 1, which is the first one it sends in the
+    // all-gather steps.
+    const bool reduce = step < num_devices - 1;
+    const int offset = reduce ? step : step - (num_devices - 1) - 1;
+    const int send_segment = (rank_ - offset + 2 * num_devices) % num_devices;
+    const int recv_segment = (send_segment + num_devices - 1) % num_devices;
+
+    Rendezvous::Args args;
+    args.device_context = ctx->op_device_context();
+    args.alloc_attrs = ctx->output_alloc_attr(0);
+
+    // The slices share the buffer of the output: the ring guarantees that a
+    // device only writes a segment after the device which received it
+    // consumed it.
+    int64 begin, end;
+    ChunkRange(state, send_segment, chunk, &begin, &end);
+    Rendezvous::ParsedKey send_key;
+    Status s = Rendezvous::ParseKey(
+        Rendezvous::CreateKey(devices_[rank_], incarnations_[rank_],
+                              devices_[next], KeyName(chunk, step),
+                              ctx->frame_iter()),
+        &send_key);
+    if (s.ok()) {
+      s = ctx->rendezvous()->Send(send_key, args,
+                                  state->output.Slice(begin, end), false);
+    }
+    Rendezvous::ParsedKey recv_key;
+    if (s.ok()) {
+      s = Rendezvous::ParseKey(
+          Rendezvous::CreateKey(devices_[prev], incarnations_[prev],
+                                devices_[rank_], KeyName(chunk, step),
+                                ctx->frame_iter()),
+          &recv_key);
+    }
+    if (!s.ok()) {
+      state->SetStatus(s);
+      state->Unref();
+      return;
+    }
+    ChunkRange(state, recv_segment, chunk, &begin, &end);
+    ctx->rendezvous()->RecvAsync(
+        recv_key, args,
+        [this, state, chunk, step, reduce, begin, end](
+            const Status& s, const Rendezvous::Args& send_args,
+            const Rendezvous::Args& recv_args, const Tensor& val,
+            bool is_dead) {
+          if (!s.ok()) {
+            state->SetStatus(s);
+            state->Unref();
+            return;
+          }
+          if (is_dead || val.dtype() != DataTypeToEnum<T>::v() ||
+              val.NumElements() != end - begin) {
+            state->SetStatus(errors::InvalidArgument(
+                "AllReduce ", group_key_,
+                " received a tensor which does not match its input; all "
+                "the inputs of the group must have the same shape"));
+            state->Unref();
+            return;
+          }
+          // Continues on the worker threads of the device rather than in
+          // the callback, which may run on the thread of the sender.
+          Tensor received = val;
+          state->ctx->device()->tensorflow_cpu_worker_threads()->workers->
+              Schedule([this, state, chunk, step, reduce, begin, end,
+                        received]() {
+                // The slices may not be aligned: access their data directly.
+                const T* in = reinterpret_cast<const T*>(
+                    received.tensor_data().data());
+                T* out = state->output.template flat<T>().data() + begin;
+                if (reduce) {
+                  Reduce<T>(reduction_, in, out, end - begin);
+                } else {
+                  std::copy_n(in, end - begin, out);
+                }
+                RunStep(state, chunk, step + 1);
+              });
+        });
+  }
+
+  Reduction reduction_;
+  string group_key_;
+  int64 chunk_elements_;
+  std::vector<string> devices_;
+  std::vector<uint64> incarnations_;
+  int rank_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(AllReduceOp);
+};
+
+#define REGISTER_KERNEL(T)                                         \
+  REGISTER_KERNEL_BUILDER(                                         \
+      Name("AllReduce").Device(DEVICE_CPU).TypeConstraint<T>("T"), \
+      AllReduceOp<T>);
+
+REGISTER_KERNEL(float);
+REGISTER_KERNEL(double);
+REGISTER_KERNEL(int32);
+REGISTER_KERNEL(int64);
+#undef REGISTER_KERNEL
+
+}  // namespace tensorflow
@@ -0,0 +1,184 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/rendezvous.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+// Runs the AllReduce kernels of a group of "num_devices" CPU devices, which
+// exchange their tensors through a local rendezvous.
+class AllReduceOpTest : public ::testing::Test {
+ protected:
+  void Init(int num_devices, const string& reduction, int64 chunk_bytes) {
+    std::vector<string> device_names;
+    for (int i = 0; i < num_devices; ++i) {
+      devices_.emplace_back(DeviceFactory::NewDevice(
+          "CPU", {}, strings::StrCat("/job:a/replica:0/task:", i)));
+      device_names.push_back(devices_.back()->name());
+    }
+    const std::vector<int64> incarnations(num_devices, 1);
+    for (int i = 0; i < num_devices; ++i) {
+      NodeDef node_def;
+      TF_ASSERT_OK(NodeDefBuilder("all_reduce", "AllReduce")
+                       .Input(FakeInput(DT_FLOAT))
+                       .Attr("reduction", reduction)
+                       .Attr("group_key", "g")
+                       .Attr("chunk_bytes", chunk_bytes)
+                       .Attr("_group_devices", device_names)
+                       .Attr("_group_incarnations", incarnations)
+                       .Finalize(&node_def));
+      Status status;
+      kernels_.emplace_back(CreateOpKernel(
+          DEVICE_CPU, devices_[i].get(),
+          devices_[i]->GetAllocator(AllocatorAttributes()), node_def,
+          TF_GRAPH_DEF_VERSION, &status));
+      TF_ASSERT_OK(status);
+    }
+  }
+
+  // Runs the kernels on "inputs" and returns their outputs.
+  std::vector<Tensor> Run(const std::vector<Tensor>& inputs,
+                          Status* status) {
+    const int num_devices = devices_.size();
+    Rendezvous* rendezvous = NewLocalRendezvous();
+    std::vector<gtl::InlinedVector<TensorValue, 4>> input_values(num_devices);
+    std::vector<std::unique_ptr<OpKernelContext::Params>> params;
+    std::vector<std::unique_ptr<OpKernelContext>> contexts;
+    std::vector<AllocatorAttributes> output_attrs(1);
+    BlockingCounter counter(num_devices);
+    for (int i = 0; i < num_devices; ++i) {
+      input_values[i].push_back(
+          TensorValue(const_cast<Tensor*>(&inputs[i])));
+      params.emplace_back(new OpKernelContext::Params);
+      params[i]->device = devices_[i].get();
+      params[i]->frame_iter = FrameAndIter(0, 0);
+      params[i]->inputs = &input_values[i];
+      params[i]->op_kernel = kernels_[i].get();
+      params[i]->rendezvous = rendezvous;
+      params[i]->output_attr_array = output_attrs.data();
+      contexts.emplace_back(new OpKernelContext(params[i].get()));
+    }
+    for (int i = 0; i < num_devices; ++i) {
+      OpKernelContext* ctx = contexts[i].get();
+      // Like the executor, aborts the step when a kernel fails.
+      devices_[i]->ComputeAsync(kernels_[i]->AsAsync(), ctx,
+                                [rendezvous, ctx, &counter]() {
+                                  if (!ctx->status().ok()) {
+                                    rendezvous->StartAbort(ctx->status());
+                                  }
+                                  counter.DecrementCount();
+                                });
+    }
+    counter.Wait();
+    rendezvous->Unref();
+
+    std::vector<Tensor> outputs;
+    for (int i = 0; i < num_devices; ++i) {
+      status->Update(contexts[i]->status());
+      if (contexts[i]->status().ok()) {
+        outputs.push_back(*contexts[i]->mutable_output(0));
+      }
+    }
+    return outputs;
+  }
+
+  std::vector<std::unique_ptr<Device>> devices_;
+  std::vector<std::unique_ptr<OpKernel>> kernels_;
+};
+
+TEST_F(AllReduceOpTest, SingleDevice) {
+  Init(1, "sum", 4);
+  Status status;
+  std::vector<Tensor> outputs =
+      Run({test::AsTensor<float>({1, 2, 3}, {3})}, &status);
+  TF_ASSERT_OK(status);
+  test::ExpectTensorEqual<float>(outputs[0],
+                                 test::AsTensor<float>({1, 2, 3}, {3}));
+}
+
+TEST_F(AllReduceOpTest, Sum) {
+  // Covers tensors smaller than the group, and tensors which are split in
+  // several chunks per segment.
+  for (int num_devices : {2, 3, 5}) {
+    for (int64 chunk_bytes : {4, 12, 1 << 20}) {
+      for (int num_elements : {1, 4, 17, 100}) {
+        devices_.clear();
+        kernels_.clear();
+        Init(num_devices, "sum", chunk_bytes);
+        std::vector<Tensor> inputs;
+        Tensor expected(DT_FLOAT, TensorShape({num_elements}));
+        expected.flat<float>().setZero();
+        for (int i = 0; i < num_devices; ++i) {
+          Tensor input(DT_FLOAT, TensorShape({num_elements}));
+          for (int j = 0; j < num_elements; ++j) {
+            input.flat<float>()(j) = i * 1000 + j;
+            expected.flat<float>()(j) += i * 1000 + j;
+          }
+          inputs.push_back(input);
+        }
+        Status status;
+        std::vector<Tensor> outputs = Run(inputs, &status);
+        TF_ASSERT_OK(status);
+        for (const Tensor& output : outputs) {
+          test::ExpectTensorEqual<float>(output, expected);
+        }
+      }
+    }
+  }
+}
+
+TEST_F(AllReduceOpTest, Max) {
+  Init(3, "max", 4);
+  Status status;
+  std::vector<Tensor> outputs =
+      Run({test::AsTensor<float>({1, 5, 3, 0}, {2, 2}),
+           test::AsTensor<float>({4, 2, 3, 0}, {2, 2}),
+           test::AsTensor<float>({2, 2, 6, -1}, {2, 2})},
+          &status);
+  TF_ASSERT_OK(status);
+  for (const Tensor& output : outputs) {
+    test::ExpectTensorEqual<float>(
+        output, test::AsTensor<float>({4, 5, 6, 0}, {2, 2}));
+  }
+}
+
+TEST_F(AllReduceOpTest, DifferentShapes) {
+  Init(2, "sum", 1 << 20);
+  Status status;
+  Run({test::AsTensor<float>({1, 2, 3, 4}, {4}),
+       test::AsTensor<float>({1, 2, 3, 4, 5, 6}, {6})},
+      &status);
+  EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -17,7 +17,9 @@ limitations under the License.
 // processing, to optimize latency and memory usage.
 
 #include <string.h>
+#include <algorithm>
 #include <map>
+#include <memory>
 #include <vector>
 #include "tensorflow/core/framework/common_shape_fns.h"
 #include "tensorflow/core/framework/numeric_op.h"
@@ -34,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/util/mirror_pad_mode.h"
 #include "tensorflow/core/util/padding.h"
 #include "tensorflow/core/util/tensor_format.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -248,8 +251,259 @@ class FusedResizeAndPadConvFunctor {
   }
 };
 
+// Activations that can be applied in the output stage of a convolution.
+enum Activation {
+  NO_ACTIVATION = 0,
+  RELU = 1,
+  RELU6 = 2,
+};
+
+// Copies the filter_height x filter_width x input_depth patch of the image
+// whose top left corner is at (in_y_origin, in_x_origin) into "patch", with
+// zeroes in place of the parts that fall outside of the image.
+template <class T>
+void CopyPatch(const T* image, int input_height, int input_width,
+               int input_depth, int filter_height, int filter_width,
+               int in_y_origin, int in_x_origin, T* patch) {
+  const int in_x_end = in_x_origin + filter_width;
+  const int left_zero_count = std::max(0, 0 - in_x_origin);
+  const int right_zero_count = std::max(0, in_x_end - input_width);
+  const int center_copy_count =
+      std::max(0, filter_width - (left_zero_count + right_zero_count));
+  const int row_value_count = filter_width * input_depth;
+  for (int filter_y = 0; filter_y < filter_height; ++filter_y) {
+    const int in_y = in_y_origin + filter_y;
+    T* row_start = patch + (filter_y * row_value_count);
+    if ((in_y < 0) || (in_y >= input_height) || (center_copy_count == 0)) {
+      std::fill(row_start, row_start + row_value_count, T(0));
+      continue;
+    }
+    std::fill(row_start, row_start + (left_zero_count * input_depth), T(0));
+    const T* input_row_start = image + (in_y * input_width * input_depth) +
+                               (std::max(0, in_x_origin) * input_depth);
+    std::copy(input_row_start,
+              input_row_start + (center_copy_count * input_depth),
+              row_start + (left_zero_count * input_depth));
+    std::fill(row_start + ((left_zero_count + center_copy_count) * input_depth),
+              row_start + row_value_count, T(0));
+  }
+}
+
+// Adds the bias to each of the "rows" rows of "filter_count" values at
+// "data", then applies the activation in place.
+template <class T>
+void ApplyBiasAndActivation(const T* bias, Activation activation, int64 rows,
+                            int filter_count, T* data) {
+  typedef Eigen::Map<
+      Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>
+      MatrixT;
+  typedef Eigen::Map<const Eigen::Matrix<T, 1, Eigen::Dynamic>> ConstRowT;
+  MatrixT matrix(data, rows, filter_count);
+  matrix.rowwise() += ConstRowT(bias, filter_count);
+  switch (activation) {
+    case NO_ACTIVATION:
+      break;
+    case RELU:
+      matrix = matrix.cwiseMax(T(0));
+      break;
+    case RELU6:
+      matrix = matrix.cwiseMax(T(0)).cwiseMin(T(6));
+      break;
+  }
+}
+
 }  // namespace
 
+// Computes activation(conv2d(input, filter) + bias) with the im2col approach.
+// The patches are split into chunks that are processed in parallel, each
+// with its own im2col buffer. The bias and the activation are applied to the
+// output rows of a chunk right after the GEMM that produces them, while they
+// are still in the caches.
+template <class T, class TGemmFunctor>
+class FusedConv2DBiasActivationOp : public OpKernel {
+ public:
+  explicit FusedConv2DBiasActivationOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("strides", &strides_));
+    OP_REQUIRES(context, strides_.size() == 4,
+                errors::InvalidArgument("Sliding window strides field must "
+                                        "specify 4 dimensions"));
+    const int64 stride_n = GetTensorDim(strides_, FORMAT_NHWC, 'N');
+    const int64 stride_c = GetTensorDim(strides_, FORMAT_NHWC, 'C');
+    OP_REQUIRES(
+        context, stride_n == 1 && stride_c == 1,
+        errors::InvalidArgument("Current implementation does not yet support "
+                                "strides in the batch and depth dimensions."));
+    OP_REQUIRES_OK(context, context->GetAttr("padding", &padding_));
+    string activation;
+    OP_REQUIRES_OK(context, context->GetAttr("activation", &activation));
+    if (activation == "Relu") {
+      activation_ = RELU;
+    } else if (activation == "Relu6") {
+      activation_ = RELU6;
+    } else if (activation == "None") {
+      activation_ = NO_ACTIVATION;
+    } else {
+      OP_REQUIRES(context, false, errors::InvalidArgument(
+                                      "Unknown activation ", activation));
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    // Input tensor is of the following dimensions:
+    // [ batch, in_rows, in_cols, in_depth ]
+    const Tensor& input = context->input(0);
+
+    // Input filter is of the following dimensions:
+    // [ filter_rows, filter_cols, in_depth, out_depth]
+    const Tensor& filter = context->input(1);
+
+    const Tensor& bias = context->input(2);
+
+    OP_REQUIRES(context, input.dims() == 4,
+                errors::InvalidArgument("input must be 4-dimensional",
+                                        input.shape().DebugString()));
+    OP_REQUIRES(context, filter.dims() == 4,
+                errors::InvalidArgument("filter must be 4-dimensional: ",
+                                        filter.shape().DebugString()));
+    for (int i = 0; i < 4; i++) {
+      OP_REQUIRES(context, FastBoundsCheck(filter.dim_size(i),
+                                           std::numeric_limits<int>::max()),
+                  errors::InvalidArgument("filter too large"));
+      OP_REQUIRES(context, FastBoundsCheck(input.dim_size(i),
+                                           std::numeric_limits<int>::max()),
+                  errors::InvalidArgument("input too large"));
+    }
+
+    const int in_depth = static_cast<int>(input.dim_size(3));
+    OP_REQUIRES(
+        context, in_depth == filter.dim_size(2),
+        errors::InvalidArgument("input and filter must have the same depth: ",
+                                in_depth, " vs ", filter.dim_size(2)));
+    const int out_depth = static_cast<int>(filter.dim_size(3));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(bias.shape()) &&
+                             bias.dim_size(0) == out_depth,
+                errors::InvalidArgument(
+                    "bias must be a vector of size ", out_depth,
+                    ", the last dimension of the filter: ",
+                    bias.shape().DebugString()));
+
+    const int batch = static_cast<int>(input.dim_size(0));
+    const int input_rows = static_cast<int>(input.dim_size(1));
+    const int input_cols = static_cast<int>(input.dim_size(2));
+    const int filter_rows = static_cast<int>(filter.dim_size(0));
+    const int filter_cols = static_cast<int>(filter.dim_size(1));
+    const int stride_rows = GetTensorDim(strides_, FORMAT_NHWC, 'H');
+    const int stride_cols = GetTensorDim(strides_, FORMAT_NHWC, 'W');
+
+    int64 out_rows = 0, out_cols = 0, pad_rows = 0, pad_cols = 0;
+    OP_REQUIRES_OK(context,
+                   GetWindowedOutputSize(input_rows, filter_rows, stride_rows,
+                                         padding_, &out_rows, &pad_rows));
+    OP_REQUIRES_OK(context,
+                   GetWindowedOutputSize(input_cols, filter_cols, stride_cols,
+                                         padding_, &out_cols, &pad_cols));
+    TensorShape out_shape =
+        ShapeFromFormat(FORMAT_NHWC, batch, out_rows, out_cols, out_depth);
+
+    // Output tensor is of the following dimensions:
+    // [ in_batch, out_rows, out_cols, out_depth ]
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, out_shape, &output));
+
+    VLOG(2) << "FusedConv2DBiasActivation: in_depth = " << in_depth
+            << ", input_cols = " << input_cols
+            << ", filter_cols = " << filter_cols
+            << ", input_rows = " << input_rows
+            << ", filter_rows = " << filter_rows
+            << ", stride_rows = " << stride_rows
+            << ", stride_cols = " << stride_cols
+            << ", out_depth = " << out_depth;
+
+    // If there is nothing to compute, return.
+    if (out_shape.num_elements() == 0) {
+      return;
+    }
+
+    const T* input_data = input.flat<T>().data();
+    const T* filter_data = filter.flat<T>().data();
+    const T* bias_data = bias.flat<T>().data();
+    T* output_data = output->flat<T>().data();
+
+    // Each row of the im2col matrix holds one patch, and each row of the
+    // output one result pixel.
+    const int64 filter_value_count =
+        static_cast<int64>(filter_rows) * filter_cols * in_depth;
+    const int64 patch_count = out_shape.num_elements() / out_depth;
+    // For 1x1 filters with unit strides the input already is the im2col
+    // matrix.
+    const bool input_is_im2col = filter_rows == 1 && filter_cols == 1 &&
+                                 stride_rows == 1 && stride_cols == 1;
+
+    // Bound the im2col buffers, but leave enough chunks for all threads.
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    const int64 max_patches_per_chunk =
+        std::max<int64>(1, kMaxChunkSize / (filter_value_count * sizeof(T)));
+    const int64 patches_per_chunk = std::min(
+        max_patches_per_chunk,
+        (patch_count + worker_threads.num_threads - 1) /
+            worker_threads.num_threads);
+    const int64 chunk_count =
+        (patch_count + patches_per_chunk - 1) / patches_per_chunk;
+    const int64 patches_per_image = out_rows * out_cols;
+    const int64 image_value_count =
+        static_cast<int64>(input_rows) * input_cols * in_depth;
+    const Activation activation = activation_;
+
+    auto work = [=](int64 start_chunk, int64 limit_chunk) {
+      std::unique_ptr<T[]> im2col_buffer;
+      if (!input_is_im2col) {
+        im2col_buffer.reset(new T[patches_per_chunk * filter_value_count]);
+      }
+      for (int64 chunk = start_chunk; chunk < limit_chunk; ++chunk) {
+        const int64 start_patch = chunk * patches_per_chunk;
+        const int64 patches =
+            std::min(patches_per_chunk, patch_count - start_patch);
+        const T* im2col_data;
+        if (input_is_im2col) {
+          im2col_data = input_data + (start_patch * filter_value_count);
+        } else {
+          for (int64 i = 0; i < patches; ++i) {
+            const int64 patch_index = start_patch + i;
+            const int64 image_index = patch_index / patches_per_image;
+            const int64 pixel_index = patch_index % patches_per_image;
+            const int out_y = pixel_index / out_cols;
+            const int out_x = pixel_index % out_cols;
+            CopyPatch(input_data + (image_index * image_value_count),
+                      input_rows, input_cols, in_depth, filter_rows,
+                      filter_cols, (out_y * stride_rows) - pad_rows,
+                      (out_x * stride_cols) - pad_cols,
+                      im2col_buffer.get() + (i * filter_value_count));
+          }
+          im2col_data = im2col_buffer.get();
+        }
+        T* chunk_output_data = output_data + (start_patch * out_depth);
+        TGemmFunctor gemm_functor;
+        gemm_functor(patches, out_depth, filter_value_count, im2col_data,
+                     filter_value_count, filter_data, out_depth,
+                     chunk_output_data, out_depth);
+        ApplyBiasAndActivation(bias_data, activation, patches, out_depth,
+                               chunk_output_data);
+      }
+    };
+    Shard(worker_threads.num_threads, worker_threads.workers, chunk_count,
+          patches_per_chunk * filter_value_count * out_depth, work);
+  }
+
+ private:
+  std::vector<int32> strides_;
+  Padding padding_;
+  Activation activation_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FusedConv2DBiasActivationOp);
+};
+
 // Implements a version of convolution with bilinear resizing and mirror padding
 // included.
 template <class T, class TConvFunctor, bool DoResize>
@@ -534,4 +788,13 @@ TF_CALL_float(REGISTER_FUSED);
 
 TF_CALL_float(REGISTER_PAD_ONLY_FUSED);
 
+#define REGISTER_BIAS_ACTIVATION_FUSED(T)                                    \
+  REGISTER_KERNEL_BUILDER(Name("FusedConv2DBiasActivation")                  \
+                              .Device(DEVICE_CPU)                            \
+                              .TypeConstraint<T>("T"),                       \
+                          FusedConv2DBiasActivationOp<                       \
+                              T, FastGemmFunctor<T, T, T>>);
+
+TF_CALL_float(REGISTER_BIAS_ACTIVATION_FUSED);
+
 }  // namespace tensorflow
@@ -298,4 +298,105 @@ TEST_F(FusedResizePadConvOpTest, NoResizePadOnlySymmetricComparative) {
   CompareFusedPadOnlyAndSeparate(4, 4, 1, 2, 2, 1, 1, "SYMMETRIC", 1, "SAME");
 }
 
+class FusedConvBiasActivationOpTest : public OpsTestBase {
+ protected:
+  void CompareFusedAndSeparate(int input_batches, int input_width,
+                               int input_height, int input_depth,
+                               int filter_size, int filter_count, int stride,
+                               string padding, string activation) {
+    auto root = tensorflow::Scope::NewRootScope();
+    using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+    Tensor input_data(DT_FLOAT, TensorShape({input_batches, input_height,
+                                             input_width, input_depth}));
+    test::FillFn<float>(&input_data,
+                        [](int i) -> float { return (i % 11) - 5.0f; });
+    Output input =
+        Const(root.WithOpName("input"), Input::Initializer(input_data));
+
+    Tensor filter_data(DT_FLOAT, TensorShape({filter_size, filter_size,
+                                              input_depth, filter_count}));
+    test::FillFn<float>(&filter_data,
+                        [](int i) -> float { return ((i % 7) - 3) * 0.5f; });
+    Output filter =
+        Const(root.WithOpName("filter"), Input::Initializer(filter_data));
+
+    Tensor bias_data(DT_FLOAT, TensorShape({filter_count}));
+    test::FillFn<float>(&bias_data,
+                        [](int i) -> float { return (i % 5) - 2.0f; });
+    Output bias = Const(root.WithOpName("bias"), Input::Initializer(bias_data));
+
+    Output conv = Conv2D(root.WithOpName("conv"), input, filter,
+                         {1, stride, stride, 1}, padding);
+    Output bias_add = BiasAdd(root.WithOpName("bias_add"), conv, bias);
+    if (activation == "Relu") {
+      Relu(root.WithOpName("separate"), bias_add);
+    } else if (activation == "Relu6") {
+      Relu6(root.WithOpName("separate"), bias_add);
+    } else {
+      Identity(root.WithOpName("separate"), bias_add);
+    }
+
+    FusedConv2DBiasActivation(
+        root.WithOpName("fused"), input, filter, bias, {1, stride, stride, 1},
+        padding, FusedConv2DBiasActivation::Activation(activation));
+
+    tensorflow::GraphDef graph;
+    TF_ASSERT_OK(root.ToGraphDef(&graph));
+
+    std::unique_ptr<tensorflow::Session> session(
+        tensorflow::NewSession(tensorflow::SessionOptions()));
+    TF_ASSERT_OK(session->Create(graph));
+
+    std::vector<Tensor> unfused_tensors;
+    TF_ASSERT_OK(session->Run({}, {"separate"}, {}, &unfused_tensors));
+
+    std::vector<Tensor> fused_tensors;
+    TF_ASSERT_OK(session->Run({}, {"fused"}, {}, &fused_tensors));
+
+    test::ExpectTensorNear<float>(unfused_tensors[0], fused_tensors[0], 1e-4);
+  }
+};
+
+TEST_F(FusedConvBiasActivationOpTest, ReluComparative) {
+  CompareFusedAndSeparate(2, 10, 10, 3, 3, 4, 1, "SAME", "Relu");
+}
+
+TEST_F(FusedConvBiasActivationOpTest, Relu6Comparative) {
+  CompareFusedAndSeparate(1, 10, 8, 3, 3, 4, 1, "SAME", "Relu6");
+}
+
+TEST_F(FusedConvBiasActivationOpTest, NoActivationComparative) {
+  CompareFusedAndSeparate(1, 10, 10, 3, 3, 4, 1, "SAME", "None");
+}
+
+TEST_F(FusedConvBiasActivationOpTest, ValidStridedComparative) {
+  CompareFusedAndSeparate(2, 11, 9, 2, 4, 5, 2, "VALID", "Relu");
+}
+
+TEST_F(FusedConvBiasActivationOpTest, SameStridedComparative) {
+  CompareFusedAndSeparate(1, 11, 9, 2, 5, 3, 3, "SAME", "Relu");
+}
+
+TEST_F(FusedConvBiasActivationOpTest, OneByOneComparative) {
+  CompareFusedAndSeparate(3, 6, 6, 8, 1, 16, 1, "SAME", "Relu");
+}
+
+TEST_F(FusedConvBiasActivationOpTest, BiasSizeMismatch) {
+  TF_EXPECT_OK(NodeDefBuilder("fused", "FusedConv2DBiasActivation")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("strides", {1, 1, 1, 1})
+                   .Attr("padding", "SAME")
+                   .Finalize(node_def()));
+  TF_EXPECT_OK(InitOp());
+  AddInputFromArray<float>(TensorShape({1, 2, 2, 1}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({1, 1, 1, 2}), {1, 2});
+  AddInputFromArray<float>(TensorShape({3}), {1, 2, 3});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(StringPiece(s.ToString()).contains("bias must be a vector"))
+      << s;
+}
+
 }  // namespace tensorflow
@@ -0,0 +1,216 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/image_ops.cc
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/image_resizer_state.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/jpeg/jpeg_mem.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Returns the largest libjpeg scaling ratio that still decodes an image of
+// in_height x in_width to at least out_height x out_width pixels.
+int DecodeRatio(int64 in_height, int64 in_width, int64 out_height,
+                int64 out_width) {
+  for (int ratio : {8, 4, 2}) {
+    // libjpeg rounds the scaled dimensions up.
+    if ((in_height + ratio - 1) / ratio >= out_height &&
+        (in_width + ratio - 1) / ratio >= out_width) {
+      return ratio;
+    }
+  }
+  return 1;
+}
+
+// Bilinear resize of one HWC image, computed like the ResizeBilinear op.
+void ResizeImage(const uint8* image, int64 in_height, int64 in_width,
+                 int channels, int64 out_height, int64 out_width,
+                 bool align_corners, float* output) {
+  const float height_scale =
+      CalculateResizeScale(in_height, out_height, align_corners);
+  const float width_scale =
+      CalculateResizeScale(in_width, out_width, align_corners);
+
+  // The horizontal interpolation is the same for all rows.
+  std::vector<int64> left(out_width);
+  std::vector<int64> right(out_width);
+  std::vector<float> x_lerp(out_width);
+  for (int64 x = 0; x < out_width; ++x) {
+    const float in_x = x * width_scale;
+    left[x] = static_cast<int64>(floorf(in_x)) * channels;
+    right[x] =
+        std::min(static_cast<int64>(ceilf(in_x)), in_width - 1) * channels;
+    x_lerp[x] = in_x - floorf(in_x);
+  }
+
+  const int64 in_row_size = in_width * channels;
+  for (int64 y = 0; y < out_height; ++y) {
+    const float in_y = y * height_scale;
+    const int64 top_y = static_cast<int64>(floorf(in_y));
+    const int64 bottom_y =
+        std::min(static_cast<int64>(ceilf(in_y)), in_height - 1);
+    const float y_lerp = in_y - top_y;
+    const uint8* top_row = image + top_y * in_row_size;
+    const uint8* bottom_row = image + bottom_y * in_row_size;
+    for (int64 x = 0; x < out_width; ++x) {
+      for (int c = 0; c < channels; ++c) {
+        const float top_left(top_row[left[x] + c]);
+        const float top_right(top_row[right[x] + c]);
+        const float bottom_left(bottom_row[left[x] + c]);
+        const float bottom_right(bottom_row[right[x] + c]);
+        const float top = top_left + (top_right - top_left) * x_lerp[x];
+        const float bottom =
+            bottom_left + (bottom_right - bottom_left) * x_lerp[x];
+        *output++ = top + (bottom - top) * y_lerp;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+// Decodes a batch of JPEG images in parallel and resizes them into a single
+// float tensor.
+class DecodeAndResizeJpegBatchOp : public OpKernel {
+ public:
+  explicit DecodeAndResizeJpegBatchOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("channels", &flags_.components));
+    OP_REQUIRES(context, flags_.components == 1 || flags_.components == 3,
+                errors::InvalidArgument("channels must be 1 or 3, got ",
+                                        flags_.components));
+    OP_REQUIRES_OK(
+        context, context->GetAttr("fancy_upscaling", &flags_.fancy_upscaling));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("try_recover_truncated",
+                                    &flags_.try_recover_truncated_jpeg));
+    OP_REQUIRES_OK(context, context->GetAttr("acceptable_fraction",
+                                             &flags_.min_acceptable_fraction));
+    OP_REQUIRES_OK(context, context->GetAttr("align_corners", &align_corners_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& contents = context->input(0);
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(contents.shape()),
+                errors::InvalidArgument("contents must be a vector, got shape ",
+                                        contents.shape().DebugString()));
+    const Tensor& size = context->input(1);
+    OP_REQUIRES(context, size.dims() == 1,
+                errors::InvalidArgument("size must be 1-dimensional, got shape ",
+                                        size.shape().DebugString()));
+    OP_REQUIRES(context, size.NumElements() == 2,
+                errors::InvalidArgument("size must have two elements, got ",
+                                        size.NumElements()));
+    auto size_vec = size.vec<int32>();
+    const int64 out_height = size_vec(0);
+    const int64 out_width = size_vec(1);
+    OP_REQUIRES(context, out_height > 0 && out_width > 0,
+                errors::InvalidArgument("output dimensions must be positive"));
+
+    const int64 batch_size = contents.NumElements();
+    const int channels = flags_.components;
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape({batch_size, out_height,
+                                                out_width, channels}),
+                                &output));
+    if (batch_size == 0) return;
+
+    auto contents_vec = contents.vec<string>();
+    float* output_data = output->flat<float>().data();
+    const int64 image_size = out_height * out_width * channels;
+    std::vector<Status> statuses(batch_size);
+    auto decode_and_resize = [this, &contents_vec, output_data, image_size,
+                              out_height, out_width, channels,
+                              &statuses](int64 start, int64 limit) {
+      // Reused by the images of the shard.
+      std::vector<uint8> decoded;
+      for (int64 i = start; i < limit; ++i) {
+        statuses[i] = DecodeAndResize(contents_vec(i), out_height, out_width,
+                                      channels, &decoded,
+                                      output_data + i * image_size);
+      }
+    };
+    // Decoding dominates, so that each image is worth its own shard.
+    const int64 kCostPerImage = 1000000;
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
+          kCostPerImage, decode_and_resize);
+
+    for (int64 i = 0; i < batch_size; ++i) {
+      if (!statuses[i].ok()) {
+        context->SetStatus(errors::InvalidArgument(
+            "Image ", i, " of the batch: ", statuses[i].error_message()));
+        return;
+      }
+    }
+  }
+
+ private:
+  // Decodes "input" at the smallest scale that is still larger than the
+  // output, using "decoded" as scratch space, and resizes it into "output".
+  Status DecodeAndResize(const string& input, int64 out_height,
+                         int64 out_width, int channels,
+                         std::vector<uint8>* decoded, float* output) const {
+    if (input.size() > std::numeric_limits<int>::max()) {
+      return errors::InvalidArgument("JPEG contents are too large for int: ",
+                                     input.size());
+    }
+    int in_width;
+    int in_height;
+    if (!jpeg::GetImageInfo(input.data(), input.size(), &in_width, &in_height,
+                            nullptr)) {
+      return errors::InvalidArgument("Invalid JPEG data, size ", input.size());
+    }
+    jpeg::UncompressFlags flags = flags_;
+    flags.ratio = DecodeRatio(in_height, in_width, out_height, out_width);
+
+    int width = 0;
+    int height = 0;
+    if (jpeg::Uncompress(
+            input.data(), input.size(), flags, nullptr /* nwarn */,
+            [decoded, &width, &height](int w, int h, int c) -> uint8* {
+              width = w;
+              height = h;
+              decoded->resize(static_cast<size_t>(w) * h * c);
+              return decoded->data();
+            }) == nullptr) {
+      return errors::InvalidArgument("Invalid JPEG data, size ", input.size());
+    }
+    ResizeImage(decoded->data(), height, width, channels, out_height,
+                out_width, align_corners_, output);
+    return Status::OK();
+  }
+
+  jpeg::UncompressFlags flags_;
+  bool align_corners_;
+};
+REGISTER_KERNEL_BUILDER(Name("DecodeAndResizeJpegBatch").Device(DEVICE_CPU),
+                        DecodeAndResizeJpegBatchOp);
+
+}  // namespace tensorflow
@@ -0,0 +1,142 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/jpeg/jpeg_mem.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+
+class DecodeAndResizeJpegBatchOpTest : public OpsTestBase {
+ protected:
+  Status Init(int channels) {
+    TF_CHECK_OK(NodeDefBuilder("decode_and_resize", "DecodeAndResizeJpegBatch")
+                    .Input(FakeInput(DT_STRING))
+                    .Input(FakeInput(DT_INT32))
+                    .Attr("channels", channels)
+                    .Finalize(node_def()));
+    return InitOp();
+  }
+
+  // Returns an RGB JPEG image whose red channel increases with x and green
+  // channel with y, by 4 per pixel.
+  static string Gradient(int height, int width) {
+    std::vector<uint8> pixels(height * width * 3);
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        uint8* pixel = &pixels[(y * width + x) * 3];
+        pixel[0] = x * 4;
+        pixel[1] = y * 4;
+        pixel[2] = 128;
+      }
+    }
+    jpeg::CompressFlags flags;
+    flags.format = jpeg::FORMAT_RGB;
+    flags.quality = 100;
+    flags.chroma_downsampling = false;
+    return jpeg::Compress(pixels.data(), width, height, flags);
+  }
+};
+
+TEST_F(DecodeAndResizeJpegBatchOpTest, SameSize) {
+  TF_ASSERT_OK(Init(3));
+  const string image = Gradient(24, 32);
+  AddInputFromArray<string>(TensorShape({2}), {image, image});
+  AddInputFromArray<int32>(TensorShape({2}), {24, 32});
+  TF_ASSERT_OK(RunOpKernel());
+
+  // Without resizing, the output is the decoded image.
+  int width, height, channels;
+  std::unique_ptr<uint8[]> decoded(jpeg::Uncompress(
+      image.data(), image.size(), jpeg::UncompressFlags(), &width, &height,
+      &channels, nullptr /* nwarn */));
+  ASSERT_NE(nullptr, decoded.get());
+  const int image_size = width * height * channels;
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({2, 24, 32, 3}));
+  auto expected_flat = expected.flat<float>();
+  for (int i = 0; i < 2 * image_size; ++i) {
+    expected_flat(i) = decoded[i % image_size];
+  }
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+TEST_F(DecodeAndResizeJpegBatchOpTest, Downscale) {
+  TF_ASSERT_OK(Init(3));
+  AddInputFromArray<string>(TensorShape({3}), {Gradient(48, 64),
+                                               Gradient(24, 32),
+                                               Gradient(6, 8)});
+  AddInputFromArray<int32>(TensorShape({2}), {6, 8});
+  TF_ASSERT_OK(RunOpKernel());
+
+  const Tensor& output = *GetOutput(0);
+  ASSERT_EQ(TensorShape({3, 6, 8, 3}), output.shape());
+  auto images = output.tensor<float, 4>();
+  // The images are decoded at ratios 8, 4 and 1, so that each output pixel
+  // is the average of the input pixels it covers.
+  const int ratios[] = {8, 4, 1};
+  for (int b = 0; b < 3; ++b) {
+    const float offset = (ratios[b] - 1) / 2.0f;
+    for (int y = 0; y < 6; ++y) {
+      for (int x = 0; x < 8; ++x) {
+        EXPECT_NEAR(4 * (x * ratios[b] + offset), images(b, y, x, 0), 3);
+        EXPECT_NEAR(4 * (y * ratios[b] + offset), images(b, y, x, 1), 3);
+        EXPECT_NEAR(128, images(b, y, x, 2), 3);
+      }
+    }
+  }
+}
+
+TEST_F(DecodeAndResizeJpegBatchOpTest, Grayscale) {
+  TF_ASSERT_OK(Init(1));
+  AddInputFromArray<string>(TensorShape({1}), {Gradient(20, 20)});
+  AddInputFromArray<int32>(TensorShape({2}), {7, 9});
+  TF_ASSERT_OK(RunOpKernel());
+  EXPECT_EQ(TensorShape({1, 7, 9, 1}), GetOutput(0)->shape());
+}
+
+TEST_F(DecodeAndResizeJpegBatchOpTest, EmptyBatch) {
+  TF_ASSERT_OK(Init(3));
+  AddInputFromArray<string>(TensorShape({0}), {});
+  AddInputFromArray<int32>(TensorShape({2}), {4, 5});
+  TF_ASSERT_OK(RunOpKernel());
+  EXPECT_EQ(TensorShape({0, 4, 5, 3}), GetOutput(0)->shape());
+}
+
+TEST_F(DecodeAndResizeJpegBatchOpTest, InvalidImage) {
+  TF_ASSERT_OK(Init(3));
+  AddInputFromArray<string>(TensorShape({2}), {Gradient(8, 8), "not a jpeg"});
+  AddInputFromArray<int32>(TensorShape({2}), {4, 4});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s));
+  EXPECT_TRUE(StringPiece(s.error_message())
+                  .contains("Image 1 of the batch: Invalid JPEG data, size 10"))
+      << s;
+}
+
+TEST_F(DecodeAndResizeJpegBatchOpTest, InvalidChannels) {
+  EXPECT_TRUE(errors::IsInvalidArgument(Init(0)));
+}
+
+}  // namespace tensorflow
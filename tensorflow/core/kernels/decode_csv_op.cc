@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 
 // See docs in ../ops/parsing_ops.cc.
+#include <string.h>
+#include <deque>
 #include <vector>
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -21,9 +23,99 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
+namespace {
+
+const uint64 kLowBytes = 0x0101010101010101ULL;
+const uint64 kHighBits = 0x8080808080808080ULL;
+
+// Returns a non-zero value if one of the bytes of "word" is zero.
+inline uint64 HasZeroByte(uint64 word) {
+  return (word - kLowBytes) & ~word & kHighBits;
+}
+
+// Returns the position of the first delim, quote or line break of "input"
+// from "pos", or input.size(). Scans 8 bytes at a time.
+size_t FindFieldEnd(StringPiece input, size_t pos, char delim) {
+  const char* data = input.data();
+  const size_t size = input.size();
+  const uint64 delims = kLowBytes * static_cast<uint8>(delim);
+  const uint64 quotes = kLowBytes * static_cast<uint8>('"');
+  const uint64 newlines = kLowBytes * static_cast<uint8>('\n');
+  const uint64 returns = kLowBytes * static_cast<uint8>('\r');
+  for (; pos + sizeof(uint64) <= size; pos += sizeof(uint64)) {
+    uint64 word;
+    memcpy(&word, data + pos, sizeof(word));
+    if (HasZeroByte(word ^ delims) | HasZeroByte(word ^ quotes) |
+        HasZeroByte(word ^ newlines) | HasZeroByte(word ^ returns)) {
+      break;
+    }
+  }
+  for (; pos < size; ++pos) {
+    const char c = data[pos];
+    if (c == delim || c == '"' || c == '\n' || c == '\r') break;
+  }
+  return pos;
+}
+
+// Fast path for the common decimal forms of integers, [-]digits. Returns
+// false if "field" has another form, or may overflow, and has to be parsed
+// with safe_strto32 or safe_strto64.
+template <typename T>
+bool FastParseInt(StringPiece field, T* value) {
+  // Fewer digits than std::numeric_limits<T>::max() can't overflow.
+  const size_t kMaxDigits = std::numeric_limits<T>::digits10;
+  const bool negative = field.Consume("-");
+  if (field.empty() || field.size() > kMaxDigits) return false;
+  T result = 0;
+  for (char c : field) {
+    if (c < '0' || c > '9') return false;
+    result = result * 10 + (c - '0');
+  }
+  *value = negative ? -result : result;
+  return true;
+}
+
+// Fast path for the common decimal forms of floats, [-]digits[.digits].
+// The result is exact when the digits form an integer below 2^24 and there
+// are at most 10 of them after the point, since both that integer and the
+// power of ten are then floats, and their quotient is correctly rounded.
+// Returns false otherwise, and "field" has to be parsed with safe_strtof.
+bool FastParseFloat(StringPiece field, float* value) {
+  const int kMaxFractionDigits = 10;
+  const int32 kMaxMantissa = 1 << 24;
+  static const float kPowersOfTen[kMaxFractionDigits + 1] = {
+      1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+  const bool negative = field.Consume("-");
+  int32 mantissa = 0;
+  int num_digits = 0;
+  int fraction_digits = -1;
+  for (char c : field) {
+    if (c == '.' && fraction_digits < 0) {
+      fraction_digits = 0;
+      continue;
+    }
+    if (c < '0' || c > '9') return false;
+    mantissa = mantissa * 10 + (c - '0');
+    if (mantissa >= kMaxMantissa) return false;
+    ++num_digits;
+    if (fraction_digits >= 0 && ++fraction_digits > kMaxFractionDigits) {
+      return false;
+    }
+  }
+  if (num_digits == 0) return false;
+  float result = static_cast<float>(mantissa);
+  if (fraction_digits > 0) result /= kPowersOfTen[fraction_digits];
+  *value = negative ? -result : result;
+  return true;
+}
+
+}  // namespace
+
 class DecodeCSVOp : public OpKernel {
  public:
   explicit DecodeCSVOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
@@ -60,178 +152,204 @@ class DecodeCSVOp : public OpKernel {
     OpOutputList output;
     OP_REQUIRES_OK(ctx, ctx->output_list("output", &output));
 
+    std::vector<Tensor*> outputs(out_type_.size());
     for (int i = 0; i < static_cast<int>(out_type_.size()); ++i) {
-      Tensor* out = nullptr;
-      output.allocate(i, records->shape(), &out);
+      OP_REQUIRES_OK(ctx, output.allocate(i, records->shape(), &outputs[i]));
     }
 
-    for (int64 i = 0; i < records_size; ++i) {
-      const StringPiece record(records_t(i));
-      std::vector<string> fields;
-      ExtractFields(ctx, record, &fields);
-      OP_REQUIRES(ctx, fields.size() == out_type_.size(),
-                  errors::InvalidArgument("Expect ", out_type_.size(),
-                                          " fields but have ", fields.size(),
-                                          " in record ", i));
-
-      // Check each field in the record
-      for (int f = 0; f < static_cast<int>(out_type_.size()); ++f) {
-        const DataType& dtype = out_type_[f];
-        switch (dtype) {
-          case DT_INT32: {
-            // If this field is empty, check if default is given:
-            // If yes, use default value; Otherwise report error.
-            if (fields[f].empty()) {
-              OP_REQUIRES(ctx, record_defaults[f].NumElements() == 1,
-                          errors::InvalidArgument(
-                              "Field ", f,
-                              " is required but missing in record ", i, "!"));
-
-              output[f]->flat<int32>()(i) = record_defaults[f].flat<int32>()(0);
-            } else {
-              int32 value;
-              OP_REQUIRES(ctx, strings::safe_strto32(fields[f], &value),
-                          errors::InvalidArgument("Field ", f, " in record ", i,
-                                                  " is not a valid int32: ",
-                                                  fields[f]));
-              output[f]->flat<int32>()(i) = value;
-            }
-            break;
-          }
-          case DT_INT64: {
-            // If this field is empty, check if default is given:
-            // If yes, use default value; Otherwise report error.
-            if (fields[f].empty()) {
-              OP_REQUIRES(ctx, record_defaults[f].NumElements() == 1,
-                          errors::InvalidArgument(
-                              "Field ", f,
-                              " is required but missing in record ", i, "!"));
-
-              output[f]->flat<int64>()(i) = record_defaults[f].flat<int64>()(0);
-            } else {
-              int64 value;
-              OP_REQUIRES(ctx, strings::safe_strto64(fields[f], &value),
-                          errors::InvalidArgument("Field ", f, " in record ", i,
-                                                  " is not a valid int64: ",
-                                                  fields[f]));
-              output[f]->flat<int64>()(i) = value;
-            }
-            break;
-          }
-          case DT_FLOAT: {
-            // If this field is empty, check if default is given:
-            // If yes, use default value; Otherwise report error.
-            if (fields[f].empty()) {
-              OP_REQUIRES(ctx, record_defaults[f].NumElements() == 1,
-                          errors::InvalidArgument(
-                              "Field ", f,
-                              " is required but missing in record ", i, "!"));
-              output[f]->flat<float>()(i) = record_defaults[f].flat<float>()(0);
-            } else {
-              float value;
-              OP_REQUIRES(ctx, strings::safe_strtof(fields[f].c_str(), &value),
-                          errors::InvalidArgument("Field ", f, " in record ", i,
-                                                  " is not a valid float: ",
-                                                  fields[f]));
-              output[f]->flat<float>()(i) = value;
-            }
-            break;
-          }
-          case DT_STRING: {
-            // If this field is empty, check if default is given:
-            // If yes, use default value; Otherwise report error.
-            if (fields[f].empty()) {
-              OP_REQUIRES(ctx, record_defaults[f].NumElements() == 1,
-                          errors::InvalidArgument(
-                              "Field ", f,
-                              " is required but missing in record ", i, "!"));
-              output[f]->flat<string>()(i) =
-                  record_defaults[f].flat<string>()(0);
-            } else {
-              output[f]->flat<string>()(i) = fields[f];
-            }
-            break;
+    // The error of the first record that fails, so that the reported error
+    // does not depend on the sharding.
+    mutex mu;
+    int64 error_record = records_size;
+    Status error_status;
+    auto parse_records = [this, &records_t, &record_defaults, &outputs, &mu,
+                          &error_record, &error_status](int64 start,
+                                                        int64 limit) {
+      // Reused by the records of the shard.
+      std::vector<StringPiece> fields;
+      std::deque<string> unescaped;
+      string buffer;
+      for (int64 i = start; i < limit; ++i) {
+        Status s = ExtractFields(records_t(i), &fields, &unescaped);
+        if (s.ok()) {
+          s = ParseRecord(i, fields, record_defaults, outputs, &buffer);
+        }
+        if (!s.ok()) {
+          mutex_lock l(mu);
+          if (i < error_record) {
+            error_record = i;
+            error_status = s;
           }
-          default:
-            OP_REQUIRES(ctx, false,
-                        errors::InvalidArgument("csv: data type ", dtype,
-                                                " not supported in field ", f));
+          return;
         }
       }
-    }
+    };
+    const int64 kCostPerField = 100;
+    const int64 cost_per_record = kCostPerField * (out_type_.size() + 1);
+    auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, records_size,
+          cost_per_record, parse_records);
+    OP_REQUIRES_OK(ctx, error_status);
   }
 
  private:
   std::vector<DataType> out_type_;
   char delim_;
 
-  void ExtractFields(OpKernelContext* ctx, StringPiece input,
-                     std::vector<string>* result) {
-    int64 current_idx = 0;
-    if (!input.empty()) {
-      while (static_cast<size_t>(current_idx) < input.size()) {
-        if (input[current_idx] == '\n' || input[current_idx] == '\r') {
-          current_idx++;
-          continue;
-        }
+  // Converts the fields of record i into the outputs. "buffer" is scratch
+  // space for the fields that need a null-terminated copy.
+  Status ParseRecord(int64 i, const std::vector<StringPiece>& fields,
+                     const OpInputList& record_defaults,
+                     const std::vector<Tensor*>& outputs,
+                     string* buffer) const {
+    if (fields.size() != out_type_.size()) {
+      return errors::InvalidArgument("Expect ", out_type_.size(),
+                                     " fields but have ", fields.size(),
+                                     " in record ", i);
+    }
 
-        bool quoted = false;
-        if (input[current_idx] == '"') {
-          quoted = true;
-          current_idx++;
+    // Check each field in the record
+    for (int f = 0; f < static_cast<int>(out_type_.size()); ++f) {
+      const StringPiece field = fields[f];
+      const DataType& dtype = out_type_[f];
+      // If this field is empty, check if default is given:
+      // If yes, use default value; Otherwise report error.
+      if (field.empty()) {
+        if (record_defaults[f].NumElements() != 1) {
+          return errors::InvalidArgument(
+              "Field ", f, " is required but missing in record ", i, "!");
         }
-
-        // This is the body of the field;
-        string field;
-        if (!quoted) {
-          while (static_cast<size_t>(current_idx) < input.size() &&
-                 input[current_idx] != delim_) {
-            OP_REQUIRES(ctx, input[current_idx] != '"' &&
-                                 input[current_idx] != '\n' &&
-                                 input[current_idx] != '\r',
-                        errors::InvalidArgument(
-                            "Unquoted fields cannot have quotes/CRLFs inside"));
-            field += input[current_idx];
-            current_idx++;
+      }
+      switch (dtype) {
+        case DT_INT32: {
+          int32& value = outputs[f]->flat<int32>()(i);
+          if (field.empty()) {
+            value = record_defaults[f].flat<int32>()(0);
+          } else if (!FastParseInt(field, &value) &&
+                     !strings::safe_strto32(field, &value)) {
+            return errors::InvalidArgument("Field ", f, " in record ", i,
+                                           " is not a valid int32: ", field);
           }
-
-          // Go to next field or the end
-          current_idx++;
-        } else {
-          // Quoted field needs to be ended with '"' and delim or end
-          while (
-              (static_cast<size_t>(current_idx) < input.size() - 1) &&
-              (input[current_idx] != '"' || input[current_idx + 1] != delim_)) {
-            if (input[current_idx] != '"') {
-              field += input[current_idx];
-              current_idx++;
-            } else {
-              OP_REQUIRES(
-                  ctx, input[current_idx + 1] == '"',
-                  errors::InvalidArgument("Quote inside a string has to be "
-                                          "escaped by another quote"));
-              field += '"';
-              current_idx += 2;
+          break;
+        }
+        case DT_INT64: {
+          int64& value = outputs[f]->flat<int64>()(i);
+          if (field.empty()) {
+            value = record_defaults[f].flat<int64>()(0);
+          } else if (!FastParseInt(field, &value) &&
+                     !strings::safe_strto64(field, &value)) {
+            return errors::InvalidArgument("Field ", f, " in record ", i,
+                                           " is not a valid int64: ", field);
+          }
+          break;
+        }
+        case DT_FLOAT: {
+          float& value = outputs[f]->flat<float>()(i);
+          if (field.empty()) {
+            value = record_defaults[f].flat<float>()(0);
+          } else if (!FastParseFloat(field, &value)) {
+            buffer->assign(field.data(), field.size());
+            if (!strings::safe_strtof(buffer->c_str(), &value)) {
+              return errors::InvalidArgument("Field ", f, " in record ", i,
+                                             " is not a valid float: ", field);
             }
           }
+          break;
+        }
+        case DT_STRING: {
+          string& value = outputs[f]->flat<string>()(i);
+          if (field.empty()) {
+            value = record_defaults[f].flat<string>()(0);
+          } else {
+            value.assign(field.data(), field.size());
+          }
+          break;
+        }
+        default:
+          return errors::InvalidArgument("csv: data type ", dtype,
+                                         " not supported in field ", f);
+      }
+    }
+    return Status::OK();
+  }
 
-          OP_REQUIRES(
-              ctx, (static_cast<size_t>(current_idx) < input.size() &&
-                    input[current_idx] == '"' &&
-                    (static_cast<size_t>(current_idx) == input.size() - 1 ||
-                     input[current_idx + 1] == delim_)),
-              errors::InvalidArgument("Quoted field has to end with quote "
-                                      "followed by delim or end"));
+  // Splits "input" into "fields". The fields point into "input", except for
+  // the quoted fields with escaped quotes, which are unescaped into
+  // "unescaped".
+  Status ExtractFields(StringPiece input, std::vector<StringPiece>* fields,
+                       std::deque<string>* unescaped) const {
+    fields->clear();
+    unescaped->clear();
+    if (input.empty()) return Status::OK();
 
+    const char* data = input.data();
+    const size_t size = input.size();
+    size_t current_idx = 0;
+    while (current_idx < size) {
+      if (data[current_idx] == '\n' || data[current_idx] == '\r') {
+        current_idx++;
+        continue;
+      }
+
+      if (data[current_idx] != '"') {
+        const size_t end = FindFieldEnd(input, current_idx, delim_);
+        if (end < size && data[end] != delim_) {
+          return errors::InvalidArgument(
+              "Unquoted fields cannot have quotes/CRLFs inside");
+        }
+        fields->emplace_back(data + current_idx, end - current_idx);
+
+        // Go to next field or the end
+        current_idx = end + 1;
+      } else {
+        current_idx++;
+        // The text of the field from "segment" on is not copied into
+        // "field" yet.
+        size_t segment = current_idx;
+        string* field = nullptr;
+        // Quoted field needs to be ended with '"' and delim or end
+        while (current_idx < size - 1) {
+          const char* quote = static_cast<const char*>(
+              memchr(data + current_idx, '"', size - 1 - current_idx));
+          if (quote == nullptr) {
+            current_idx = size - 1;
+            break;
+          }
+          current_idx = quote - data;
+          if (data[current_idx + 1] == delim_) break;
+          if (data[current_idx + 1] != '"') {
+            return errors::InvalidArgument(
+                "Quote inside a string has to be escaped by another quote");
+          }
+          if (field == nullptr) {
+            unescaped->emplace_back();
+            field = &unescaped->back();
+          }
+          // Keep one of the two quotes.
+          field->append(data + segment, current_idx + 1 - segment);
           current_idx += 2;
+          segment = current_idx;
         }
 
-        result->push_back(field);
-      }
+        if (!(current_idx < size && data[current_idx] == '"' &&
+              (current_idx == size - 1 || data[current_idx + 1] == delim_))) {
+          return errors::InvalidArgument(
+              "Quoted field has to end with quote followed by delim or end");
+        }
 
-      // Check if the last field is missing
-      if (input[input.size() - 1] == delim_) result->push_back(string());
+        if (field == nullptr) {
+          fields->emplace_back(data + segment, current_idx - segment);
+        } else {
+          field->append(data + segment, current_idx - segment);
+          fields->emplace_back(*field);
+        }
+        current_idx += 2;
+      }
     }
+
+    // Check if the last field is missing
+    if (data[size - 1] == delim_) fields->emplace_back();
+    return Status::OK();
   }
 };
 
@@ -0,0 +1,197 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+
+class DecodeCSVOpTest : public OpsTestBase {
+ protected:
+  void Init(const DataTypeVector& out_type) {
+    TF_ASSERT_OK(NodeDefBuilder("decode_csv", "DecodeCSV")
+                     .Input(FakeInput(DT_STRING))
+                     .Input(FakeInput(out_type))
+                     .Attr("OUT_TYPE", out_type)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // Parses "record" into two required string fields.
+  Status RunOnStringPair(const string& record) {
+    Init({DT_STRING, DT_STRING});
+    AddInputFromArray<string>(TensorShape({1}), {record});
+    AddInputFromArray<string>(TensorShape({0}), {});
+    AddInputFromArray<string>(TensorShape({0}), {});
+    return RunOpKernel();
+  }
+};
+
+TEST_F(DecodeCSVOpTest, Fields) {
+  Init({DT_INT32, DT_INT64, DT_FLOAT, DT_STRING});
+  AddInputFromArray<string>(
+      TensorShape({4}),
+      {"1,-20000000000,0.5,abc", "\"2\",3,\"-1.25\",\"a,\"\"b\"\"\"",
+       ",4, 7 ,", "\n5,6,1e3,\"\""});
+  AddInputFromArray<int32>(TensorShape({1}), {-1});
+  AddInputFromArray<int64>(TensorShape({1}), {-2});
+  AddInputFromArray<float>(TensorShape({1}), {-3});
+  AddInputFromArray<string>(TensorShape({1}), {"default"});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_int32(allocator(), DT_INT32, TensorShape({4}));
+  test::FillValues<int32>(&expected_int32, {1, 2, -1, 5});
+  test::ExpectTensorEqual<int32>(expected_int32, *GetOutput(0));
+  Tensor expected_int64(allocator(), DT_INT64, TensorShape({4}));
+  test::FillValues<int64>(&expected_int64, {-20000000000LL, 3, 4, 6});
+  test::ExpectTensorEqual<int64>(expected_int64, *GetOutput(1));
+  Tensor expected_float(allocator(), DT_FLOAT, TensorShape({4}));
+  test::FillValues<float>(&expected_float, {0.5, -1.25, 7, 1000});
+  test::ExpectTensorEqual<float>(expected_float, *GetOutput(2));
+  Tensor expected_string(allocator(), DT_STRING, TensorShape({4}));
+  test::FillValues<string>(&expected_string,
+                           {"abc", "a,\"b\"", "default", "default"});
+  test::ExpectTensorEqual<string>(expected_string, *GetOutput(3));
+}
+
+TEST_F(DecodeCSVOpTest, Numbers) {
+  // Enough records for several shards, in forms that take the fast paths or
+  // not. The results must be the same as the ones of the general parsers.
+  Init({DT_FLOAT, DT_INT32, DT_INT64});
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  const int kNumRecords = 20000;
+  std::vector<string> floats;
+  std::vector<string> records;
+  for (int i = 0; i < kNumRecords; ++i) {
+    string number;
+    switch (i % 6) {
+      case 0:
+        number = strings::StrCat(rnd.Uniform(1000000), ".", rnd.Uniform(1000));
+        break;
+      case 1:
+        number = strings::StrCat("-0.", rnd.Uniform(100000000));
+        break;
+      case 2:
+        number = strings::StrCat(rnd.Uniform(100), ".", rnd.Uniform64(1e12));
+        break;
+      case 3:
+        number = strings::StrCat(16777200 + rnd.Uniform(100));
+        break;
+      case 4:
+        number = strings::StrCat(rnd.Uniform(1000), "e", rnd.Uniform(20));
+        break;
+      default:
+        number = strings::StrCat(" ", rnd.RandFloat(), " ");
+    }
+    floats.push_back(number);
+    records.push_back(strings::StrCat(number, ",", -i, ",", i * 1000000007LL));
+  }
+  AddInputFromArray<string>(TensorShape({kNumRecords}), records);
+  AddInputFromArray<float>(TensorShape({0}), {});
+  AddInputFromArray<int32>(TensorShape({0}), {});
+  AddInputFromArray<int64>(TensorShape({0}), {});
+  TF_ASSERT_OK(RunOpKernel());
+
+  auto float_values = GetOutput(0)->flat<float>();
+  auto int32_values = GetOutput(1)->flat<int32>();
+  auto int64_values = GetOutput(2)->flat<int64>();
+  for (int i = 0; i < kNumRecords; ++i) {
+    float expected;
+    ASSERT_TRUE(strings::safe_strtof(floats[i].c_str(), &expected));
+    EXPECT_EQ(expected, float_values(i)) << floats[i];
+    EXPECT_EQ(-i, int32_values(i));
+    EXPECT_EQ(i * 1000000007LL, int64_values(i));
+  }
+}
+
+TEST_F(DecodeCSVOpTest, IntegerLimits) {
+  Init({DT_INT32, DT_INT64});
+  AddInputFromArray<string>(
+      TensorShape({3}), {"2147483647,9223372036854775807",
+                         "-2147483648,-9223372036854775808", "007, -1 "});
+  AddInputFromArray<int32>(TensorShape({0}), {});
+  AddInputFromArray<int64>(TensorShape({0}), {});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_int32(allocator(), DT_INT32, TensorShape({3}));
+  test::FillValues<int32>(&expected_int32, {kint32max, kint32min, 7});
+  test::ExpectTensorEqual<int32>(expected_int32, *GetOutput(0));
+  Tensor expected_int64(allocator(), DT_INT64, TensorShape({3}));
+  test::FillValues<int64>(&expected_int64, {kint64max, kint64min, -1});
+  test::ExpectTensorEqual<int64>(expected_int64, *GetOutput(1));
+}
+
+TEST_F(DecodeCSVOpTest, Overflow) {
+  Init({DT_INT32});
+  AddInputFromArray<string>(TensorShape({1}), {"2147483648"});
+  AddInputFromArray<int32>(TensorShape({0}), {});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(StringPiece(s.ToString())
+                  .contains("Field 0 in record 0 is not a valid int32"))
+      << s;
+}
+
+TEST_F(DecodeCSVOpTest, FirstErrorIsReported) {
+  Init({DT_INT32, DT_STRING});
+  std::vector<string> records(10000, "1,a");
+  records[9000] = "1,a,b";
+  records[5000] = "1,\"a";
+  records[7000] = "x,a";
+  AddInputFromArray<string>(TensorShape({10000}), records);
+  AddInputFromArray<int32>(TensorShape({0}), {});
+  AddInputFromArray<string>(TensorShape({0}), {});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s));
+  EXPECT_TRUE(StringPiece(s.ToString())
+                  .contains("Quoted field has to end with quote followed by "
+                            "delim or end"))
+      << s;
+}
+
+TEST_F(DecodeCSVOpTest, QuoteInUnquotedField) {
+  EXPECT_TRUE(StringPiece(RunOnStringPair("a\"b,c").ToString())
+                  .contains("Unquoted fields cannot have quotes/CRLFs inside"));
+}
+
+TEST_F(DecodeCSVOpTest, UnescapedQuote) {
+  EXPECT_TRUE(StringPiece(RunOnStringPair("\"a\"b\",c").ToString())
+                  .contains("Quote inside a string has to be escaped"));
+}
+
+TEST_F(DecodeCSVOpTest, MissingField) {
+  EXPECT_TRUE(StringPiece(RunOnStringPair("a").ToString())
+                  .contains("Expect 2 fields but have 1 in record 0"));
+}
+
+TEST_F(DecodeCSVOpTest, ExtraField) {
+  EXPECT_TRUE(StringPiece(RunOnStringPair("a,b,").ToString())
+                  .contains("Expect 2 fields but have 3 in record 0"));
+}
+
+}  // namespace tensorflow
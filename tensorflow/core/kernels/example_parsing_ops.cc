@@ -15,7 +15,6 @@ limitations under the License.
 
 // See docs in ../ops/parsing_ops.cc.
 
-#include <numeric>
 #include <unordered_set>
 #include <vector>
 
@@ -153,10 +152,13 @@ class ExampleParserOp : public OpKernel {
 REGISTER_KERNEL_BUILDER(Name("ParseExample").Device(DEVICE_CPU),
                         ExampleParserOp);
 
-class SingleSequenceExampleParserOp : public OpKernel {
+// Parses SequenceExamples with FastParseSequenceExample. ParseSequenceExample
+// outputs the result for a batch, ParseSingleSequenceExample for a single
+// example, without the batch dimension.
+class SequenceExampleParserOp : public OpKernel {
  public:
-  explicit SingleSequenceExampleParserOp(OpKernelConstruction* ctx)
-      : OpKernel(ctx) {
+  explicit SequenceExampleParserOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx), batched_(type_string() == "ParseSequenceExample") {
     OP_REQUIRES_OK(ctx, attrs_.Init(ctx));
   }
 
@@ -249,19 +251,36 @@ class SingleSequenceExampleParserOp : public OpKernel {
           feature_list_dense_missing_assumped_empty_t(de));
     }
 
-    bool has_debug_name = (debug_name->NumElements() > 0);
-    if (has_debug_name) {
-      OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(debug_name->shape()),
+    if (batched_) {
+      OP_REQUIRES(ctx, TensorShapeUtils::IsVector(serialized->shape()),
                   errors::InvalidArgument(
-                      "Expected debug_name to be a scalar, got shape: ",
-                      debug_name->shape().DebugString()));
+                      "Expected serialized to be a vector, got shape: ",
+                      serialized->shape().DebugString()));
+      if (debug_name->NumElements() > 0) {
+        OP_REQUIRES(ctx, TensorShapeUtils::IsVector(debug_name->shape()),
+                    errors::InvalidArgument(
+                        "Expected debug_name to be a vector, got shape: ",
+                        debug_name->shape().DebugString()));
+        OP_REQUIRES(ctx,
+                    debug_name->NumElements() == serialized->NumElements(),
+                    errors::InvalidArgument(
+                        "Expected len(debug_name) == len(serialized), but "
+                        "got: ",
+                        debug_name->NumElements(), " vs. ",
+                        serialized->NumElements()));
+      }
+    } else {
+      if (debug_name->NumElements() > 0) {
+        OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(debug_name->shape()),
+                    errors::InvalidArgument(
+                        "Expected debug_name to be a scalar, got shape: ",
+                        debug_name->shape().DebugString()));
+      }
+      OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(serialized->shape()),
+                  errors::InvalidArgument(
+                      "Expected serialized to be a scalar, got shape: ",
+                      serialized->shape().DebugString()));
     }
-    auto debug_name_t = debug_name->scalar<string>();
-
-    OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(serialized->shape()),
-                errors::InvalidArgument(
-                    "Expected serialized to be a scalar, got shape: ",
-                    serialized->shape().DebugString()));
 
     OP_REQUIRES(ctx, context_dense_defaults.size() == attrs_.num_context_dense,
                 errors::InvalidArgument("Expected len(context_dense_defaults) "
@@ -269,11 +288,8 @@ class SingleSequenceExampleParserOp : public OpKernel {
                                         context_dense_defaults.size(), " vs. ",
                                         attrs_.num_context_dense));
 
-    std::vector<bool> required(attrs_.num_context_dense);
     for (int d = 0; d < attrs_.num_context_dense; ++d) {
       const Tensor& def_value = context_dense_defaults[d];
-      required[d] = (def_value.NumElements() == 0);  // No default provided.
-
       if (def_value.NumElements() > 0) {
         OP_REQUIRES(
             ctx, def_value.shape() == attrs_.context_dense_shapes[d],
@@ -290,8 +306,50 @@ class SingleSequenceExampleParserOp : public OpKernel {
       }
     }
 
-    auto serialized_t = serialized->scalar<string>();
+    example::FastParseSequenceExampleConfig config;
+    for (int d = 0; d < attrs_.num_context_dense; ++d) {
+      config.context.dense.push_back(
+          {context_dense_keys_t[d], attrs_.context_dense_types[d],
+           attrs_.context_dense_shapes[d], context_dense_defaults[d]});
+    }
+    for (int d = 0; d < attrs_.num_context_sparse; ++d) {
+      config.context.sparse.push_back(
+          {context_sparse_keys_t[d], attrs_.context_sparse_types[d]});
+    }
+    for (int d = 0; d < attrs_.num_feature_list_dense; ++d) {
+      const string& key = feature_list_dense_keys_t[d];
+      config.feature_list_dense.push_back(
+          {key, attrs_.feature_list_dense_types[d],
+           attrs_.feature_list_dense_shapes[d],
+           feature_list_dense_missing_assumed_empty_set.count(key) > 0});
+    }
+    for (int d = 0; d < attrs_.num_feature_list_sparse; ++d) {
+      config.feature_list_sparse.push_back(
+          {feature_list_sparse_keys_t[d], attrs_.feature_list_sparse_types[d]});
+    }
+
+    auto serialized_t = serialized->flat<string>();
+    auto debug_name_t = debug_name->flat<string>();
+    gtl::ArraySlice<string> slice(serialized_t.data(), serialized_t.size());
+    gtl::ArraySlice<string> names_slice(debug_name_t.data(),
+                                        debug_name_t.size());
+
+    example::SequenceResult result;
+    OP_REQUIRES_OK(
+        ctx, FastParseSequenceExample(
+                 config, slice, names_slice,
+                 batched_
+                     ? ctx->device()->tensorflow_cpu_worker_threads()->workers
+                     : nullptr,
+                 &result));
+
+    OP_REQUIRES_OK(ctx, batched_ ? SetBatchOutputs(ctx, result)
+                                 : SetSingleExampleOutputs(ctx, result));
+  }
 
+ private:
+  Status SetBatchOutputs(OpKernelContext* ctx,
+                         const example::SequenceResult& result) {
     OpOutputList context_sparse_indices;
     OpOutputList context_sparse_values;
     OpOutputList context_sparse_shapes;
@@ -300,243 +358,141 @@ class SingleSequenceExampleParserOp : public OpKernel {
     OpOutputList feature_list_sparse_values;
     OpOutputList feature_list_sparse_shapes;
     OpOutputList feature_list_dense_values;
-
-    OP_REQUIRES_OK(ctx, ctx->output_list("context_sparse_indices",
-                                         &context_sparse_indices));
-    OP_REQUIRES_OK(
-        ctx, ctx->output_list("context_sparse_values", &context_sparse_values));
-    OP_REQUIRES_OK(
-        ctx, ctx->output_list("context_sparse_shapes", &context_sparse_shapes));
-    OP_REQUIRES_OK(
-        ctx, ctx->output_list("context_dense_values", &context_dense_values));
-    OP_REQUIRES_OK(ctx, ctx->output_list("context_sparse_indices",
-                                         &context_sparse_indices));
-    OP_REQUIRES_OK(ctx, ctx->output_list("feature_list_sparse_indices",
-                                         &feature_list_sparse_indices));
-    OP_REQUIRES_OK(ctx, ctx->output_list("feature_list_sparse_values",
-                                         &feature_list_sparse_values));
-    OP_REQUIRES_OK(ctx, ctx->output_list("feature_list_sparse_shapes",
-                                         &feature_list_sparse_shapes));
-    OP_REQUIRES_OK(ctx, ctx->output_list("feature_list_dense_values",
-                                         &feature_list_dense_values));
-
-    SequenceExample ex;
-    OP_REQUIRES(
-        ctx, ParseProtoUnlimited(&ex, serialized_t()),
-        errors::InvalidArgument("Could not parse example input, value: '",
-                                serialized_t(), "'"));
-
-    const string& name = (has_debug_name) ? debug_name_t() : "<unknown>";
-    const Features& context = ex.context();
-    const auto& context_dict = context.feature();
-
-    // Context Dense -----------------------------------------------------------
-
-    // Preallocate context_dense_values, since we know their sizes
-    for (int d = 0; d < attrs_.num_context_dense; ++d) {
-      TensorShape out_shape;
-      for (const int dim : attrs_.context_dense_shapes[d].dim_sizes())
-        out_shape.AddDim(dim);
-      Tensor* out = nullptr;
-      context_dense_values.allocate(d, out_shape, &out);
+    OpOutputList feature_list_dense_lengths;
+    TF_RETURN_IF_ERROR(
+        ctx->output_list("context_sparse_indices", &context_sparse_indices));
+    TF_RETURN_IF_ERROR(
+        ctx->output_list("context_sparse_values", &context_sparse_values));
+    TF_RETURN_IF_ERROR(
+        ctx->output_list("context_sparse_shapes", &context_sparse_shapes));
+    TF_RETURN_IF_ERROR(
+        ctx->output_list("context_dense_values", &context_dense_values));
+    TF_RETURN_IF_ERROR(ctx->output_list("feature_list_sparse_indices",
+                                        &feature_list_sparse_indices));
+    TF_RETURN_IF_ERROR(ctx->output_list("feature_list_sparse_values",
+                                        &feature_list_sparse_values));
+    TF_RETURN_IF_ERROR(ctx->output_list("feature_list_sparse_shapes",
+                                        &feature_list_sparse_shapes));
+    TF_RETURN_IF_ERROR(ctx->output_list("feature_list_dense_values",
+                                        &feature_list_dense_values));
+    TF_RETURN_IF_ERROR(ctx->output_list("feature_list_dense_lengths",
+                                        &feature_list_dense_lengths));
+    for (int d = 0; d < attrs_.num_context_sparse; ++d) {
+      context_sparse_indices.set(d, result.context.sparse_indices[d]);
+      context_sparse_values.set(d, result.context.sparse_values[d]);
+      context_sparse_shapes.set(d, result.context.sparse_shapes[d]);
     }
-
     for (int d = 0; d < attrs_.num_context_dense; ++d) {
-      const string& key = context_dense_keys_t[d];
-      const DataType& dtype = attrs_.context_dense_types[d];
-      const TensorShape& shape = attrs_.context_dense_shapes[d];
-
-      const auto& feature_found = context_dict.find(key);
-      OP_REQUIRES(
-          ctx, (feature_found != context_dict.end()) || !required[d],
-          errors::InvalidArgument("Name: ", name, ", Context feature '", key,
-                                  "' is required but could not be found."));
-      if (feature_found != context_dict.end()) {
-        const Feature& f = feature_found->second;
-        bool types_match;
-        OP_REQUIRES_OK(ctx, CheckTypesMatch(f, dtype, &types_match));
-        OP_REQUIRES(
-            ctx, types_match,
-            errors::InvalidArgument("Name: ", name, ", Context feature: ", key,
-                                    ".  Data types don't match. ",
-                                    "Expected type: ", DataTypeString(dtype),
-                                    "  Feature is: ", ProtoDebugString(f)));
-
-        OP_REQUIRES_OK(ctx, FeatureDenseCopy(0, name, key, dtype, shape, f,
-                                             context_dense_values[d]));
-      } else {
-        RowDenseCopy(0, dtype, context_dense_defaults[d],
-                     context_dense_values[d]);
-      }
+      context_dense_values.set(d, result.context.dense_values[d]);
     }
-
-    // Context Sparse ----------------------------------------------------------
-    for (int d = 0; d < attrs_.num_context_sparse; ++d) {
-      const string& key = context_sparse_keys_t[d];
-      const DataType& dtype = attrs_.context_sparse_types[d];
-
-      const auto& feature_found = context_dict.find(key);
-      bool feature_has_data =  // Found key & data type is set
-          (feature_found != context_dict.end() &&
-           (feature_found->second.kind_case() != Feature::KIND_NOT_SET));
-
-      if (feature_has_data) {
-        const Feature& f = feature_found->second;
-        bool types_match;
-        OP_REQUIRES_OK(ctx, CheckTypesMatch(f, dtype, &types_match));
-        OP_REQUIRES(
-            ctx, types_match,
-            errors::InvalidArgument("Name: ", name, ", Context feature: ", key,
-                                    ".  Data types don't match. ",
-                                    "Expected type: ", DataTypeString(dtype),
-                                    "  Feature is: ", ProtoDebugString(f)));
-
-        Tensor feature_values = FeatureSparseCopy(0, key, dtype, f);
-        const int64 num_elements = feature_values.NumElements();
-        TensorShape indices_shape({num_elements, 1});
-        Tensor* sp_indices_d = nullptr;
-        Tensor* sp_shape_d = nullptr;
-        context_sparse_indices.allocate(d, indices_shape, &sp_indices_d);
-        context_sparse_values.set(d, feature_values);
-        context_sparse_shapes.allocate(d, TensorShape({1}), &sp_shape_d);
-        auto shape_t = sp_shape_d->vec<int64>();
-        shape_t(0) = num_elements;
-        auto indices_t = sp_indices_d->matrix<int64>();
-        std::iota(indices_t.data(), indices_t.data() + num_elements, 0);
-      } else {
-        TensorShape indices_shape({0, 1});
-        TensorShape values_shape({0});
-        Tensor* sp_indices_d = nullptr;
-        Tensor* sp_values_d = nullptr;
-        Tensor* sp_shape_d = nullptr;
-        context_sparse_indices.allocate(d, indices_shape, &sp_indices_d);
-        context_sparse_values.allocate(d, values_shape, &sp_values_d);
-        context_sparse_shapes.allocate(d, TensorShape({1}), &sp_shape_d);
-        auto shape_t = sp_shape_d->vec<int64>();
-        shape_t(0) = 0;
-      }
+    for (int d = 0; d < attrs_.num_feature_list_sparse; ++d) {
+      feature_list_sparse_indices.set(d, result.feature_list_sparse_indices[d]);
+      feature_list_sparse_values.set(d, result.feature_list_sparse_values[d]);
+      feature_list_sparse_shapes.set(d, result.feature_list_sparse_shapes[d]);
     }
-
-    // Feature List Dense ------------------------------------------------------
-
-    // Preallocate context_dense_values, since we can infer their
-    // sizes
-    const FeatureLists& feature_lists = ex.feature_lists();
-    const auto& feature_list_dict = feature_lists.feature_list();
-    FeatureList empty_feature_list;  // Placeholder for missing FLs
-
     for (int d = 0; d < attrs_.num_feature_list_dense; ++d) {
-      const string& key = feature_list_dense_keys_t[d];
-      const DataType& dtype = attrs_.feature_list_dense_types[d];
-      const TensorShape& shape = attrs_.feature_list_dense_shapes[d];
-
-      const auto& feature_list_found = feature_list_dict.find(key);
-      bool feature_list_missing =
-          (feature_list_found == feature_list_dict.end());
-      bool feature_list_allowed_missing =
-          (feature_list_dense_missing_assumed_empty_set.count(key) > 0);
+      feature_list_dense_values.set(d, result.feature_list_dense_values[d]);
+      feature_list_dense_lengths.set(d, result.feature_list_dense_lengths[d]);
+    }
+    return Status::OK();
+  }
 
-      OP_REQUIRES(
-          ctx, !feature_list_missing || feature_list_allowed_missing,
-          errors::InvalidArgument("Name: ", name, ", Feature list '", key,
-                                  "' is required but could not be found.  "
-                                  "Did you mean to include it in "
-                                  "feature_list_dense_missing_assumed_empty or "
-                                  "feature_list_dense_defaults?"));
-
-      TensorShape out_shape;
-      const FeatureList& fl = (feature_list_missing)
-                                  ? empty_feature_list
-                                  : feature_list_found->second;
-      out_shape.AddDim(fl.feature_size());
-      for (const int dim : attrs_.feature_list_dense_shapes[d].dim_sizes()) {
-        out_shape.AddDim(dim);
-      }
-      Tensor* out = nullptr;
-      feature_list_dense_values.allocate(d, out_shape, &out);
+  // Sets the outputs of ParseSingleSequenceExample from the result for a
+  // batch of one example.
+  Status SetSingleExampleOutputs(OpKernelContext* ctx,
+                                 const example::SequenceResult& result) {
+    OpOutputList context_sparse_indices;
+    OpOutputList context_sparse_values;
+    OpOutputList context_sparse_shapes;
+    OpOutputList context_dense_values;
+    OpOutputList feature_list_sparse_indices;
+    OpOutputList feature_list_sparse_values;
+    OpOutputList feature_list_sparse_shapes;
+    OpOutputList feature_list_dense_values;
+    TF_RETURN_IF_ERROR(
+        ctx->output_list("context_sparse_indices", &context_sparse_indices));
+    TF_RETURN_IF_ERROR(
+        ctx->output_list("context_sparse_values", &context_sparse_values));
+    TF_RETURN_IF_ERROR(
+        ctx->output_list("context_sparse_shapes", &context_sparse_shapes));
+    TF_RETURN_IF_ERROR(
+        ctx->output_list("context_dense_values", &context_dense_values));
+    TF_RETURN_IF_ERROR(ctx->output_list("feature_list_sparse_indices",
+                                        &feature_list_sparse_indices));
+    TF_RETURN_IF_ERROR(ctx->output_list("feature_list_sparse_values",
+                                        &feature_list_sparse_values));
+    TF_RETURN_IF_ERROR(ctx->output_list("feature_list_sparse_shapes",
+                                        &feature_list_sparse_shapes));
+    TF_RETURN_IF_ERROR(ctx->output_list("feature_list_dense_values",
+                                        &feature_list_dense_values));
 
-      for (int64 t = 0; t < fl.feature_size(); ++t) {
-        const Feature& f = fl.feature(t);
-        bool types_match;
-        OP_REQUIRES_OK(ctx, CheckTypesMatch(f, dtype, &types_match));
-        OP_REQUIRES(
-            ctx, types_match,
-            errors::InvalidArgument(
-                "Name: ", name, ", Feature list: ", key, ", Index: ", t,
-                ".  Data types don't match. ", "Expected type: ",
-                DataTypeString(dtype), "  Feature is: ", ProtoDebugString(f)));
-        OP_REQUIRES_OK(ctx, FeatureDenseCopy(t, name, key, dtype, shape, f,
-                                             feature_list_dense_values[d]));
-      }
+    for (int d = 0; d < attrs_.num_context_sparse; ++d) {
+      TF_RETURN_IF_ERROR(RemoveBatchDimension(
+          result.context.sparse_indices[d], result.context.sparse_shapes[d],
+          d, &context_sparse_indices, &context_sparse_shapes));
+      context_sparse_values.set(d, result.context.sparse_values[d]);
+    }
+    for (int d = 0; d < attrs_.num_context_dense; ++d) {
+      Tensor value;
+      CHECK(value.CopyFrom(result.context.dense_values[d],
+                           attrs_.context_dense_shapes[d]));
+      context_dense_values.set(d, value);
     }
-
-    // Feature List Sparse -----------------------------------------------------
     for (int d = 0; d < attrs_.num_feature_list_sparse; ++d) {
-      const string& key = feature_list_sparse_keys_t[d];
-      const DataType& dtype = attrs_.feature_list_sparse_types[d];
-
-      const auto& feature_list_found = feature_list_dict.find(key);
-      bool feature_list_has_data =  // Found key
-          (feature_list_found != feature_list_dict.end());
-
-      std::vector<Tensor> sparse_values_tmp;
-      int64 feature_list_size = 0;
-      if (feature_list_has_data) {
-        const FeatureList& fl = feature_list_found->second;
-        feature_list_size = fl.feature_size();
-        for (int64 t = 0; t < feature_list_size; ++t) {
-          const Feature& f = fl.feature(t);
-          bool types_match;
-          OP_REQUIRES_OK(ctx, CheckTypesMatch(f, dtype, &types_match));
-          OP_REQUIRES(ctx, types_match,
-                      errors::InvalidArgument(
-                          "Name: ", name, ", Feature List: ", key, ", Index: ",
-                          t, ".  Data types don't match. ", "Expected type: ",
-                          DataTypeString(dtype), "  Feature is: ",
-                          ProtoDebugString(f)));
-          sparse_values_tmp.push_back(FeatureSparseCopy(t, key, dtype, f));
-        }
-      } else {
-        sparse_values_tmp.push_back(Tensor(dtype, TensorShape({0})));
-      }
-
-      int64 total_num_features = 0;
-      int64 max_num_features = 0;
-      for (int t = 0; t < feature_list_size; ++t) {
-        const Tensor& v = sparse_values_tmp[t];
-        const int64 num_elements = v.shape().num_elements();
-        total_num_features += num_elements;
-        max_num_features = std::max(max_num_features, num_elements);
-      }
+      TF_RETURN_IF_ERROR(RemoveBatchDimension(
+          result.feature_list_sparse_indices[d],
+          result.feature_list_sparse_shapes[d], d,
+          &feature_list_sparse_indices, &feature_list_sparse_shapes));
+      feature_list_sparse_values.set(d, result.feature_list_sparse_values[d]);
+    }
+    for (int d = 0; d < attrs_.num_feature_list_dense; ++d) {
+      const Tensor& batch_value = result.feature_list_dense_values[d];
+      TensorShape shape({batch_value.dim_size(1)});
+      shape.AppendShape(attrs_.feature_list_dense_shapes[d]);
+      Tensor value;
+      CHECK(value.CopyFrom(batch_value, shape));
+      feature_list_dense_values.set(d, value);
+    }
+    return Status::OK();
+  }
 
-      TensorShape indices_shape({total_num_features, 2});
-      TensorShape values_shape({total_num_features});
-      Tensor* sp_indices_d = nullptr;
-      Tensor* sp_values_d = nullptr;
-      Tensor* sp_shape_d = nullptr;
-      feature_list_sparse_indices.allocate(d, indices_shape, &sp_indices_d);
-      feature_list_sparse_values.allocate(d, values_shape, &sp_values_d);
-      feature_list_sparse_shapes.allocate(d, TensorShape({2}), &sp_shape_d);
-      auto shape_t = sp_shape_d->vec<int64>();
-      shape_t(0) = feature_list_size;
-      shape_t(1) = max_num_features;
-
-      int64 offset = 0;
-
-      for (int t = 0; t < feature_list_size; ++t) {
-        const int64 num_elements = CopyIntoSparseTensor(
-            sparse_values_tmp[t], t, offset, sp_indices_d, sp_values_d);
-        offset += num_elements;
+  // Allocates output "d" of "indices" and "shapes" for the sparse tensor of
+  // a batch of one given by "batch_indices" and "batch_shape", without the
+  // batch dimension.
+  static Status RemoveBatchDimension(const Tensor& batch_indices,
+                                     const Tensor& batch_shape, int d,
+                                     OpOutputList* indices,
+                                     OpOutputList* shapes) {
+    auto batch_indices_t = batch_indices.matrix<int64>();
+    const int64 num_values = batch_indices_t.dimension(0);
+    const int64 rank = batch_indices_t.dimension(1) - 1;
+    Tensor* indices_d = nullptr;
+    TF_RETURN_IF_ERROR(
+        indices->allocate(d, TensorShape({num_values, rank}), &indices_d));
+    auto indices_t = indices_d->matrix<int64>();
+    for (int64 i = 0; i < num_values; ++i) {
+      for (int64 j = 0; j < rank; ++j) {
+        indices_t(i, j) = batch_indices_t(i, j + 1);
       }
     }
+    Tensor* shape_d = nullptr;
+    TF_RETURN_IF_ERROR(shapes->allocate(d, TensorShape({rank}), &shape_d));
+    auto batch_shape_t = batch_shape.vec<int64>();
+    auto shape_t = shape_d->vec<int64>();
+    for (int64 j = 0; j < rank; ++j) {
+      shape_t(j) = batch_shape_t(j + 1);
+    }
+    return Status::OK();
   }
 
- protected:
+  const bool batched_;
   ParseSingleSequenceExampleAttrs attrs_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("ParseSingleSequenceExample").Device(DEVICE_CPU),
-                        SingleSequenceExampleParserOp);
+                        SequenceExampleParserOp);
+REGISTER_KERNEL_BUILDER(Name("ParseSequenceExample").Device(DEVICE_CPU),
+                        SequenceExampleParserOp);
 
 #ifndef IS_MOBILE_PLATFORM
 // when using lite protos on mobile, decoding JSON is not available.
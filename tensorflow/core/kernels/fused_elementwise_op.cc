@@ -0,0 +1,272 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/math_ops.cc.
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <vector>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/kernels/cwise_ops.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+namespace {
+
+// The elementwise ops a _FusedElementwise node may evaluate. Must include
+// every op that the elementwise fusion pass
+// (common_runtime/elementwise_fusion.cc) fuses.
+enum FusedOp {
+  kAdd,
+  kSub,
+  kMul,
+  kDiv,
+  kMaximum,
+  kMinimum,
+  kSquaredDifference,
+  kAbs,
+  kNeg,
+  kExp,
+  kLog,
+  kSqrt,
+  kRsqrt,
+  kSquare,
+  kReciprocal,
+  kRelu,
+  kRelu6,
+  kSigmoid,
+  kTanh,
+};
+
+struct FusedOpInfo {
+  const char* name;
+  FusedOp op;
+  int num_inputs;
+};
+
+const FusedOpInfo kFusedOps[] = {
+    {"Add", kAdd, 2},
+    {"Sub", kSub, 2},
+    {"Mul", kMul, 2},
+    {"Div", kDiv, 2},
+    {"RealDiv", kDiv, 2},
+    {"Maximum", kMaximum, 2},
+    {"Minimum", kMinimum, 2},
+    {"SquaredDifference", kSquaredDifference, 2},
+    {"Abs", kAbs, 1},
+    {"Neg", kNeg, 1},
+    {"Exp", kExp, 1},
+    {"Log", kLog, 1},
+    {"Sqrt", kSqrt, 1},
+    {"Rsqrt", kRsqrt, 1},
+    {"Square", kSquare, 1},
+    {"Inv", kReciprocal, 1},
+    {"Reciprocal", kReciprocal, 1},
+    {"Relu", kRelu, 1},
+    {"Relu6", kRelu6, 1},
+    {"Sigmoid", kSigmoid, 1},
+    {"Tanh", kTanh, 1},
+};
+
+const FusedOpInfo* FindFusedOp(const string& name) {
+  for (const FusedOpInfo& info : kFusedOps) {
+    if (name == info.name) return &info;
+  }
+  return nullptr;
+}
+
+// Computes out[0, n) = op(x[0, n), y[0, n)). "y" is ignored for unary
+// ops.
+template <typename T>
+void EvaluateOp(FusedOp op, const T* x, const T* y, T* out, int64 n) {
+  typename TTypes<T>::UnalignedConstFlat a(x, n);
+  typename TTypes<T>::UnalignedConstFlat b(y, y == nullptr ? 0 : n);
+  typename TTypes<T>::UnalignedFlat z(out, n);
+  switch (op) {
+    case kAdd:
+      z = a.binaryExpr(b, typename functor::add<T>::func());
+      break;
+    case kSub:
+      z = a.binaryExpr(b, typename functor::sub<T>::func());
+      break;
+    case kMul:
+      z = a.binaryExpr(b, typename functor::mul<T>::func());
+      break;
+    case kDiv:
+      z = a.binaryExpr(b, typename functor::div<T>::func());
+      break;
+    case kMaximum:
+      z = a.binaryExpr(b, typename functor::maximum<T>::func());
+      break;
+    case kMinimum:
+      z = a.binaryExpr(b, typename functor::minimum<T>::func());
+      break;
+    case kSquaredDifference:
+      z = (a - b).square();
+      break;
+    case kAbs:
+      z = a.unaryExpr(typename functor::abs<T>::func());
+      break;
+    case kNeg:
+      z = a.unaryExpr(typename functor::neg<T>::func());
+      break;
+    case kExp:
+      z = a.unaryExpr(typename functor::exp<T>::func());
+      break;
+    case kLog:
+      z = a.unaryExpr(typename functor::log<T>::func());
+      break;
+    case kSqrt:
+      z = a.unaryExpr(typename functor::sqrt<T>::func());
+      break;
+    case kRsqrt:
+      z = a.unaryExpr(typename functor::rsqrt<T>::func());
+      break;
+    case kSquare:
+      z = a.unaryExpr(typename functor::square<T>::func());
+      break;
+    case kReciprocal:
+      z = a.unaryExpr(typename functor::inverse<T>::func());
+      break;
+    case kRelu:
+      z = a.cwiseMax(static_cast<T>(0));
+      break;
+    case kRelu6:
+      z = a.cwiseMax(static_cast<T>(0)).cwiseMin(static_cast<T>(6));
+      break;
+    case kSigmoid:
+      z = a.unaryExpr(typename functor::sigmoid<T>::func());
+      break;
+    case kTanh:
+      z = a.unaryExpr(typename functor::tanh<T>::func());
+      break;
+  }
+}
+
+// Elements per block. Small enough for the intermediate results of a long
+// chain to fit in L2.
+const int64 kBlockSize = 1024;
+
+}  // namespace
+
+// Evaluates the ops of the chain one block of elements at a time, so that
+// the intermediate results stay in the CPU caches instead of making a
+// round trip to memory per op.
+template <typename T>
+class FusedElementwiseOp : public OpKernel {
+ public:
+  explicit FusedElementwiseOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    std::vector<string> op_names;
+    OP_REQUIRES_OK(context, context->GetAttr("ops", &op_names));
+    OP_REQUIRES_OK(context, context->GetAttr("operands", &operands_));
+    OP_REQUIRES(context, operands_.size() == 2 * op_names.size(),
+                errors::InvalidArgument("Expected ", 2 * op_names.size(),
+                                        " operands, got ", operands_.size()));
+    const int num_inputs = context->num_inputs();
+    for (int i = 0; i < op_names.size(); ++i) {
+      const FusedOpInfo* info = FindFusedOp(op_names[i]);
+      OP_REQUIRES(context, info != nullptr,
+                  errors::InvalidArgument("Cannot fuse op ", op_names[i]));
+      ops_.push_back(info->op);
+      // Values num_inputs + i and above are not computed yet.
+      for (int j = 0; j < 2; ++j) {
+        const int operand = operands_[2 * i + j];
+        if (j < info->num_inputs) {
+          OP_REQUIRES(context, operand >= 0 && operand < num_inputs + i,
+                      errors::InvalidArgument("Invalid operand ", operand,
+                                              " of op ", i, " ",
+                                              op_names[i]));
+        } else {
+          OP_REQUIRES(context, operand == -1,
+                      errors::InvalidArgument("Op ", i, " ", op_names[i],
+                                              " takes ", info->num_inputs,
+                                              " operands"));
+        }
+      }
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const int num_inputs = context->num_inputs();
+    const Tensor& input0 = context->input(0);
+    std::vector<const T*> inputs(num_inputs);
+    for (int i = 0; i < num_inputs; ++i) {
+      const Tensor& input = context->input(i);
+      OP_REQUIRES(context, input.shape() == input0.shape(),
+                  errors::InvalidArgument(
+                      "Inputs must all be of the same shape: ",
+                      input0.shape().DebugString(), " vs. ",
+                      input.shape().DebugString(), " for input ", i));
+      inputs[i] = input.flat<T>().data();
+    }
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, input0.shape(), &output));
+    T* out = output->flat<T>().data();
+    const int64 num_elements = input0.NumElements();
+    const int64 num_blocks = (num_elements + kBlockSize - 1) / kBlockSize;
+    const int num_ops = ops_.size();
+
+    auto work = [this, &inputs, out, num_elements, num_inputs, num_ops](
+        int64 begin_block, int64 end_block) {
+      // Holds the results of all ops but the last, which is written to
+      // the output directly.
+      std::vector<T> results((num_ops - 1) * kBlockSize);
+      std::vector<const T*> values(num_inputs + num_ops);
+      for (int64 block = begin_block; block < end_block; ++block) {
+        const int64 begin = block * kBlockSize;
+        const int64 n = std::min(kBlockSize, num_elements - begin);
+        for (int i = 0; i < num_inputs; ++i) values[i] = inputs[i] + begin;
+        for (int i = 0; i < num_ops; ++i) {
+          T* result =
+              i == num_ops - 1 ? out + begin : results.data() + i * kBlockSize;
+          const int y = operands_[2 * i + 1];
+          EvaluateOp<T>(ops_[i], values[operands_[2 * i]],
+                        y < 0 ? nullptr : values[y], result, n);
+          values[num_inputs + i] = result;
+        }
+      }
+    };
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads.num_threads, worker_threads.workers, num_blocks,
+          kBlockSize * num_ops * 5, work);
+  }
+
+ private:
+  std::vector<FusedOp> ops_;
+  std::vector<int32> operands_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FusedElementwiseOp);
+};
+
+#define REGISTER_KERNEL(T)                                                   \
+  REGISTER_KERNEL_BUILDER(                                                   \
+      Name("_FusedElementwise").Device(DEVICE_CPU).TypeConstraint<T>("T"), \
+      FusedElementwiseOp<T>);
+
+TF_CALL_float(REGISTER_KERNEL);
+TF_CALL_double(REGISTER_KERNEL);
+#undef REGISTER_KERNEL
+
+}  // namespace tensorflow
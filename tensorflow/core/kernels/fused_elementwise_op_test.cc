@@ -0,0 +1,103 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+#include <vector>
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+
+class FusedElementwiseOpTest : public OpsTestBase {
+ protected:
+  Status Init(int num_inputs, const std::vector<string>& ops,
+              const std::vector<int32>& operands) {
+    TF_CHECK_OK(NodeDefBuilder("fused", "_FusedElementwise")
+                    .Input(FakeInput(num_inputs, DT_FLOAT))
+                    .Attr("ops", ops)
+                    .Attr("operands", operands)
+                    .Finalize(node_def()));
+    return InitOp();
+  }
+};
+
+TEST_F(FusedElementwiseOpTest, Chain) {
+  // sigmoid(relu(x + y) * y), over several blocks.
+  TF_ASSERT_OK(
+      Init(2, {"Add", "Relu", "Mul", "Sigmoid"}, {0, 1, 2, -1, 3, 1, 4, -1}));
+  const int n = 3000;
+  std::vector<float> x(n), y(n), expected(n);
+  for (int i = 0; i < n; ++i) {
+    x[i] = (i % 13) - 6.0f;
+    y[i] = (i % 7) * 0.25f - 0.5f;
+    const float relu = std::max(0.0f, x[i] + y[i]);
+    expected[i] = 1 / (1 + std::exp(-relu * y[i]));
+  }
+  AddInputFromArray<float>(TensorShape({3, 1000}), x);
+  AddInputFromArray<float>(TensorShape({3, 1000}), y);
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_tensor(allocator(), DT_FLOAT, TensorShape({3, 1000}));
+  test::FillValues<float>(&expected_tensor, expected);
+  test::ExpectTensorNear<float>(expected_tensor, *GetOutput(0), 1e-5);
+}
+
+TEST_F(FusedElementwiseOpTest, Tree) {
+  // (x + y) * (x - y) - square(y) / 2
+  TF_ASSERT_OK(Init(3, {"Add", "Sub", "Mul", "Square", "Div", "Sub"},
+                    {0, 1, 0, 1, 3, 4, 1, -1, 6, 2, 5, 7}));
+  AddInputFromArray<float>(TensorShape({4}), {1, 2, 3, 4});
+  AddInputFromArray<float>(TensorShape({4}), {4, 3, 2, 1});
+  AddInputFromArray<float>(TensorShape({4}), {2, 2, 2, 2});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({4}));
+  test::FillValues<float>(&expected, {-23, -9.5, 3, 14.5});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-5);
+}
+
+TEST_F(FusedElementwiseOpTest, Empty) {
+  TF_ASSERT_OK(Init(1, {"Neg", "Exp"}, {0, -1, 1, -1}));
+  AddInputFromArray<float>(TensorShape({0, 5}), {});
+  TF_ASSERT_OK(RunOpKernel());
+  EXPECT_EQ(TensorShape({0, 5}), GetOutput(0)->shape());
+}
+
+TEST_F(FusedElementwiseOpTest, ShapeMismatch) {
+  TF_ASSERT_OK(Init(2, {"Add", "Relu"}, {0, 1, 2, -1}));
+  AddInputFromArray<float>(TensorShape({2}), {1, 2});
+  AddInputFromArray<float>(TensorShape({1}), {1});
+  EXPECT_TRUE(errors::IsInvalidArgument(RunOpKernel()));
+}
+
+TEST_F(FusedElementwiseOpTest, InvalidPrograms) {
+  // Unknown op.
+  EXPECT_FALSE(Init(1, {"MatMul"}, {0, 0}).ok());
+  // Operand count.
+  EXPECT_FALSE(Init(1, {"Relu"}, {0}).ok());
+  // A unary op with two operands.
+  EXPECT_FALSE(Init(1, {"Relu"}, {0, 0}).ok());
+  // Use of a value that is not computed yet.
+  EXPECT_FALSE(Init(1, {"Relu", "Tanh"}, {0, -1, 2, -1}).ok());
+}
+
+}  // namespace tensorflow
@@ -87,10 +87,8 @@ int64 ReaderBase::ReadUpTo(const int64 num_records, QueueInterface* queue,
     if (remaining == 0) {
       return records_produced_this_call;
     }
-    if (!work_in_progress()) {
-      GetNextWorkLocked(queue, context);
-      if (!context->status().ok()) return records_produced_this_call;
-    }
+    GetMoreWorkLocked(queue, context);
+    if (!context->status().ok()) return records_produced_this_call;
     bool at_end = false;
 
     Status status =
@@ -110,7 +108,7 @@ int64 ReaderBase::ReadUpTo(const int64 num_records, QueueInterface* queue,
     }
     if (status.ok() && at_end) {
       status = OnWorkFinishedLocked();
-      work_finished_ = work_started_;
+      ++work_finished_;
       if (records_produced_this_call > 0) {
         return records_produced_this_call;
       }
@@ -144,10 +142,8 @@ void ReaderBase::Read(QueueInterface* queue, string* key, string* value,
                       OpKernelContext* context) {
   mutex_lock lock(mu_);
   while (true) {
-    if (!work_in_progress()) {
-      GetNextWorkLocked(queue, context);
-      if (!context->status().ok()) return;
-    }
+    GetMoreWorkLocked(queue, context);
+    if (!context->status().ok()) return;
 
     bool produced = false;
     bool at_end = false;
@@ -165,7 +161,7 @@ void ReaderBase::Read(QueueInterface* queue, string* key, string* value,
     }
     if (status.ok() && at_end) {
       status = OnWorkFinishedLocked();
-      work_finished_ = work_started_;
+      ++work_finished_;
     }
     if (!status.ok()) {
       context->SetStatus(status);
@@ -208,6 +204,18 @@ void ReaderBase::GetNextWorkLocked(QueueInterface* queue,
   n.WaitForNotification();
 }
 
+void ReaderBase::GetMoreWorkLocked(QueueInterface* queue,
+                                   OpKernelContext* context) {
+  if (!work_in_progress()) {
+    GetNextWorkLocked(queue, context);
+    if (!context->status().ok()) return;
+  }
+  while (WantsMoreWorkLocked() && queue->size() > 0) {
+    GetNextWorkLocked(queue, context);
+    if (!context->status().ok()) return;
+  }
+}
+
 void ReaderBase::SaveBaseState(ReaderBaseState* state) const {
   state->Clear();
   state->set_work_started(work_started_);
@@ -230,7 +238,7 @@ Status ReaderBase::RestoreBaseState(const ReaderBaseState& state) {
         "Unexpected negative value when restoring in ", name(), ": ",
         state.DebugString());
   }
-  if (work_started_ > work_finished_) {
+  if (work_started_ < work_finished_) {
     return errors::InvalidArgument(
         "Inconsistent work started vs. finished when restoring in ", name(),
         ": ", state.DebugString());
@@ -69,6 +69,14 @@ class ReaderBase : public ReaderInterface {
   // Called to reset the Reader to a newly constructed state.
   virtual Status ResetLocked();
 
+  // Readers that interleave the records of several work items return true
+  // while they can take one more.  More work is then started, with
+  // OnWorkStartedLocked(), whenever the queue is not empty, and
+  // ReadLocked() sets *at_end each time one of the work items in progress
+  // is finished.  Note that if another reader empties and closes the queue
+  // concurrently, starting more work may fail with OutOfRange.
+  virtual bool WantsMoreWorkLocked() const { return false; }
+
   // Default implementation generates an Unimplemented error.
   // See the protected helper methods below.
   virtual Status SerializeStateLocked(string* state);
@@ -81,7 +89,8 @@ class ReaderBase : public ReaderInterface {
 
   // Returns the name of the current work item (valid if
   // work_in_progress() returns true).  May change between calls to
-  // ReadLocked().
+  // ReadLocked().  For readers that interleave several work items, the
+  // name of the last one started.
   const string& current_work() const { return work_; }
 
   // What was passed to the constructor.
@@ -124,6 +133,10 @@ class ReaderBase : public ReaderInterface {
   // OnWorkStartedLocked().  May block.
   void GetNextWorkLocked(QueueInterface* queue, OpKernelContext* context);
 
+  // Gets work items from *queue, without blocking if some are in
+  // progress, while WantsMoreWorkLocked().
+  void GetMoreWorkLocked(QueueInterface* queue, OpKernelContext* context);
+
   mutable mutex mu_;
   const string name_;
   int64 work_started_ = 0;
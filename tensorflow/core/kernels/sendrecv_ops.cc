@@ -39,6 +39,10 @@ static void GetRendezvousKey(const string& key_prefix,
                      frame_iter.iter_id);
 }
 
+static bool IsRootFrame(const FrameAndIter& frame_iter) {
+  return frame_iter.frame_id == 0 && frame_iter.iter_id == 0;
+}
+
 SendOp::SendOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
   string send_device;
   OP_REQUIRES_OK(ctx, ctx->GetAttr("send_device", &send_device));
@@ -52,17 +56,23 @@ SendOp::SendOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
   OP_REQUIRES_OK(ctx, ctx->GetAttr("tensor_name", &tensor_name));
   key_prefix_ = GetRendezvousKeyPrefix(send_device, recv_device,
                                        send_device_incarnation, tensor_name);
+  // The key outside of any loop is the same for every step: parse it once.
+  GetRendezvousKey(key_prefix_, FrameAndIter(0, 0), &parsed_key_.buf_);
+  OP_REQUIRES_OK(ctx, Rendezvous::ParseKey(parsed_key_.buf_, &parsed_key_));
 }
 
 void SendOp::Compute(OpKernelContext* ctx) {
   OP_REQUIRES(
       ctx, ctx->rendezvous() != nullptr,
       errors::Internal("Op kernel context needs to provide a rendezvous."));
-  Rendezvous::ParsedKey parsed;
-  GetRendezvousKey(key_prefix_, ctx->frame_iter(), &parsed.buf_);
-  VLOG(2) << "Send " << parsed.buf_;
-
-  OP_REQUIRES_OK(ctx, Rendezvous::ParseKey(parsed.buf_, &parsed));
+  const Rendezvous::ParsedKey* key = &parsed_key_;
+  Rendezvous::ParsedKey in_loop_key;
+  if (!IsRootFrame(ctx->frame_iter())) {
+    GetRendezvousKey(key_prefix_, ctx->frame_iter(), &in_loop_key.buf_);
+    OP_REQUIRES_OK(ctx, Rendezvous::ParseKey(in_loop_key.buf_, &in_loop_key));
+    key = &in_loop_key;
+  }
+  VLOG(2) << "Send " << key->buf_;
 
   // The device context may be passed between the Send/Recv
   // boundary, so that the device context used to produce the Tensor
@@ -71,7 +81,7 @@ void SendOp::Compute(OpKernelContext* ctx) {
   Rendezvous::Args args;
   args.device_context = ctx->op_device_context();
   args.alloc_attrs = ctx->input_alloc_attr(0);
-  OP_REQUIRES_OK(ctx, ctx->rendezvous()->Send(parsed, args, ctx->input(0),
+  OP_REQUIRES_OK(ctx, ctx->rendezvous()->Send(*key, args, ctx->input(0),
                                               ctx->is_input_dead()));
 }
 
@@ -99,21 +109,44 @@ RecvOp::RecvOp(OpKernelConstruction* ctx) : AsyncOpKernel(ctx) {
   OP_REQUIRES_OK(ctx, ctx->GetAttr("tensor_name", &tensor_name));
   key_prefix_ = GetRendezvousKeyPrefix(send_device, recv_device,
                                        send_device_incarnation, tensor_name);
+  // The key outside of any loop is the same for every step: parse it once.
+  GetRendezvousKey(key_prefix_, FrameAndIter(0, 0), &parsed_key_.buf_);
+  OP_REQUIRES_OK(ctx, Rendezvous::ParseKey(parsed_key_.buf_, &parsed_key_));
+  // The optional transport encodings of the edge, set when the graph is
+  // partitioned.
+  if (ctx->def().attr().count("_wire_compression") > 0) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("_wire_compression", &wire_compression_));
+    OP_REQUIRES(ctx, wire_compression_.empty() || wire_compression_ == "snappy",
+                errors::InvalidArgument("Unsupported _wire_compression: ",
+                                        wire_compression_));
+  }
+  if (ctx->def().attr().count("_wire_dtype") > 0) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("_wire_dtype", &wire_dtype_));
+    OP_REQUIRES(ctx, wire_dtype_ == DT_HALF || wire_dtype_ == DT_BFLOAT16,
+                errors::InvalidArgument("Unsupported _wire_dtype: ",
+                                        DataTypeString(wire_dtype_)));
+  }
 }
 
 void RecvOp::ComputeAsync(OpKernelContext* ctx, DoneCallback done) {
   OP_REQUIRES(
       ctx, ctx->rendezvous() != nullptr,
       errors::Internal("Op kernel context needs to provide a rendezvous."));
-  Rendezvous::ParsedKey parsed;
-  GetRendezvousKey(key_prefix_, ctx->frame_iter(), &parsed.buf_);
-  VLOG(2) << "Recv " << parsed.buf_;
-
-  OP_REQUIRES_OK_ASYNC(ctx, Rendezvous::ParseKey(parsed.buf_, &parsed), done);
+  const Rendezvous::ParsedKey* key = &parsed_key_;
+  Rendezvous::ParsedKey in_loop_key;
+  if (!IsRootFrame(ctx->frame_iter())) {
+    GetRendezvousKey(key_prefix_, ctx->frame_iter(), &in_loop_key.buf_);
+    OP_REQUIRES_OK_ASYNC(
+        ctx, Rendezvous::ParseKey(in_loop_key.buf_, &in_loop_key), done);
+    key = &in_loop_key;
+  }
+  VLOG(2) << "Recv " << key->buf_;
 
   Rendezvous::Args args;
   args.device_context = ctx->op_device_context();
   args.alloc_attrs = ctx->output_alloc_attr(0);
+  args.wire_compression = wire_compression_;
+  args.wire_dtype = wire_dtype_;
   using namespace std::placeholders;
   Rendezvous::DoneCallback done_cb = std::bind(
       [ctx](DoneCallback done,
@@ -134,7 +167,7 @@ void RecvOp::ComputeAsync(OpKernelContext* ctx, DoneCallback done) {
         done();
       },
       std::move(done), _1, _2, _3, _4, _5);
-  ctx->rendezvous()->RecvAsync(parsed, args, std::move(done_cb));
+  ctx->rendezvous()->RecvAsync(*key, args, std::move(done_cb));
 }
 
 REGISTER_KERNEL_BUILDER(Name("_Recv").Device(DEVICE_CPU), RecvOp);
@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_KERNELS_SENDRECV_OPS_H_
 
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/platform/macros.h"
 
 namespace tensorflow {
@@ -28,6 +29,7 @@ class SendOp : public OpKernel {
 
  private:
   string key_prefix_;
+  Rendezvous::ParsedKey parsed_key_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(SendOp);
 };
@@ -39,6 +41,10 @@ class RecvOp : public AsyncOpKernel {
 
  private:
   string key_prefix_;
+  Rendezvous::ParsedKey parsed_key_;
+  // See Rendezvous::Args.
+  string wire_compression_;
+  DataType wire_dtype_ = DT_INVALID;
 
   TF_DISALLOW_COPY_AND_ASSIGN(RecvOp);
 };
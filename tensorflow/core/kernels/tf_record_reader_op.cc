@@ -15,13 +15,20 @@ limitations under the License.
 
 // See docs in ../ops/io_ops.cc.
 
+#include <deque>
 #include <memory>
+#include <vector>
 #include "tensorflow/core/framework/reader_op_kernel.h"
 #include "tensorflow/core/kernels/reader_base.h"
+#include "tensorflow/core/kernels/reader_base.pb.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/protobuf.h"
 
 namespace tensorflow {
 
@@ -40,6 +47,8 @@ class TFRecordReader : public ReaderBase {
 
     io::RecordReaderOptions options =
         io::RecordReaderOptions::CreateRecordReaderOptions(compression_type_);
+    // Keeps reads of the file in flight while the records are consumed.
+    options.read_ahead_chunk_size = 256 << 10;
     reader_.reset(new io::RecordReader(file_.get(), options));
     return Status::OK();
   }
@@ -80,6 +89,255 @@ class TFRecordReader : public ReaderBase {
   string compression_type_ = "";
 };
 
+// Reads the records of a file ahead of their consumption, on the threads of
+// a pool, keeping up to about buffer_bytes of them in memory.
+class RecordPrefetcher {
+ public:
+  // Starts reading at the record at "offset".
+  RecordPrefetcher(Env* env, const string& filename, uint64 offset,
+                   const io::RecordReaderOptions& options, int64 buffer_bytes,
+                   thread::ThreadPool* pool)
+      : env_(env),
+        filename_(filename),
+        options_(options),
+        buffer_bytes_(buffer_bytes),
+        pool_(pool),
+        offset_(offset) {
+    mutex_lock l(mu_);
+    ScheduleReadLocked();
+  }
+
+  ~RecordPrefetcher() {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    while (reading_) cond_.wait(l);
+  }
+
+  // Returns the next record and its offset, or sets *at_end if there are no
+  // more records.  Blocks until the record is read.
+  Status GetNext(uint64* offset, string* record, bool* at_end) {
+    mutex_lock l(mu_);
+    while (records_.empty() && !at_end_ && status_.ok()) {
+      ScheduleReadLocked();
+      cond_.wait(l);
+    }
+    if (!records_.empty()) {
+      BufferedRecord& next = records_.front();
+      *offset = offset_;
+      offset_ = next.next_offset;
+      buffered_bytes_ -= next.record.size();
+      record->swap(next.record);
+      records_.pop_front();
+      ScheduleReadLocked();
+      return Status::OK();
+    }
+    if (!status_.ok()) return status_;
+    *at_end = true;
+    return Status::OK();
+  }
+
+  const string& filename() const { return filename_; }
+
+  // The offset of the next record returned by GetNext().
+  uint64 offset() {
+    mutex_lock l(mu_);
+    return offset_;
+  }
+
+ private:
+  struct BufferedRecord {
+    string record;
+    uint64 next_offset;
+  };
+
+  void ScheduleReadLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (reading_ || at_end_ || !status_.ok() || cancelled_ ||
+        buffered_bytes_ >= buffer_bytes_) {
+      return;
+    }
+    reading_ = true;
+    pool_->Schedule([this]() { ReadRecords(); });
+  }
+
+  // Reads records until the buffer is full. Only one call runs at a time,
+  // which owns file_, reader_ and read_offset_.
+  void ReadRecords() {
+    Status s;
+    if (reader_ == nullptr) s = Open();
+    while (s.ok()) {
+      {
+        mutex_lock l(mu_);
+        if (cancelled_ || buffered_bytes_ >= buffer_bytes_) break;
+      }
+      const uint64 record_offset = read_offset_;
+      BufferedRecord buffered;
+      s = reader_->ReadRecord(&read_offset_, &buffered.record);
+      if (!s.ok()) break;
+      // Compressed files are read from the start, and the records before
+      // the starting offset are skipped.
+      if (record_offset < start_offset_) continue;
+      buffered.next_offset = read_offset_;
+      mutex_lock l(mu_);
+      buffered_bytes_ += buffered.record.size();
+      records_.push_back(std::move(buffered));
+      cond_.notify_all();
+    }
+    mutex_lock l(mu_);
+    if (errors::IsOutOfRange(s)) {
+      at_end_ = true;
+    } else if (!s.ok()) {
+      status_ = s;
+    }
+    reading_ = false;
+    cond_.notify_all();
+  }
+
+  Status Open() {
+    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(filename_, &file_));
+    reader_.reset(new io::RecordReader(file_.get(), options_));
+    mutex_lock l(mu_);
+    start_offset_ = offset_;
+    if (options_.compression_type == io::RecordReaderOptions::NONE) {
+      read_offset_ = offset_;
+    }
+    return Status::OK();
+  }
+
+  Env* const env_;
+  const string filename_;
+  const io::RecordReaderOptions options_;
+  const int64 buffer_bytes_;
+  thread::ThreadPool* const pool_;
+
+  // Owned by the running ReadRecords() call.
+  std::unique_ptr<RandomAccessFile> file_;
+  std::unique_ptr<io::RecordReader> reader_;
+  uint64 read_offset_ = 0;
+  uint64 start_offset_ = 0;
+
+  mutex mu_;
+  condition_variable cond_;
+  std::deque<BufferedRecord> records_ GUARDED_BY(mu_);
+  int64 buffered_bytes_ GUARDED_BY(mu_) = 0;
+  uint64 offset_ GUARDED_BY(mu_);
+  bool reading_ GUARDED_BY(mu_) = false;
+  bool at_end_ GUARDED_BY(mu_) = false;
+  bool cancelled_ GUARDED_BY(mu_) = false;
+  Status status_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RecordPrefetcher);
+};
+
+// A TFRecordReader that keeps up to num_parallel_files files open, takes
+// their records in turn, and prefetches them on background threads.
+class InterleavedTFRecordReader : public ReaderBase {
+ public:
+  InterleavedTFRecordReader(const string& node_name,
+                            const string& compression_type,
+                            int num_parallel_files,
+                            int64 prefetch_buffer_bytes, Env* env)
+      : ReaderBase(strings::StrCat("TFRecordReader '", node_name, "'")),
+        env_(env),
+        options_(io::RecordReaderOptions::CreateRecordReaderOptions(
+            compression_type)),
+        num_parallel_files_(num_parallel_files),
+        // At least one record is read ahead for each file.
+        buffer_bytes_per_file_(
+            std::max<int64>(1, prefetch_buffer_bytes / num_parallel_files)),
+        pool_(env, "tf_record_prefetch", num_parallel_files) {}
+
+  bool WantsMoreWorkLocked() const override {
+    return static_cast<int>(files_.size()) < num_parallel_files_;
+  }
+
+  Status OnWorkStartedLocked() override {
+    AddFileLocked(current_work(), 0);
+    return Status::OK();
+  }
+
+  Status ReadLocked(string* key, string* value, bool* produced,
+                    bool* at_end) override {
+    if (files_.empty()) {
+      *at_end = true;
+      return Status::OK();
+    }
+    RecordPrefetcher* file = files_[next_file_].get();
+    uint64 offset;
+    bool file_at_end = false;
+    TF_RETURN_IF_ERROR(file->GetNext(&offset, value, &file_at_end));
+    if (file_at_end) {
+      // The next file takes the place of this one.
+      files_.erase(files_.begin() + next_file_);
+      if (next_file_ == static_cast<int>(files_.size())) next_file_ = 0;
+      *at_end = true;
+      return Status::OK();
+    }
+    *key = strings::StrCat(file->filename(), ":", offset);
+    *produced = true;
+    next_file_ = (next_file_ + 1) % files_.size();
+    return Status::OK();
+  }
+
+  Status ResetLocked() override {
+    files_.clear();
+    next_file_ = 0;
+    return ReaderBase::ResetLocked();
+  }
+
+  Status SerializeStateLocked(string* state) override {
+    InterleavedTFRecordReaderState proto;
+    SaveBaseState(proto.mutable_base());
+    for (const auto& file : files_) {
+      InterleavedTFRecordReaderState::File* file_proto = proto.add_files();
+      file_proto->set_filename(file->filename());
+      file_proto->set_offset(file->offset());
+    }
+    proto.set_next_file(next_file_);
+    proto.SerializeToString(state);
+    return Status::OK();
+  }
+
+  Status RestoreStateLocked(const string& state) override {
+    InterleavedTFRecordReaderState proto;
+    if (!ParseProtoUnlimited(&proto, state)) {
+      return errors::InvalidArgument("Could not parse state for ", name(),
+                                     ": ", str_util::CEscape(state));
+    }
+    TF_RETURN_IF_ERROR(RestoreBaseState(proto.base()));
+    const int64 num_files = proto.files_size();
+    if (num_files != proto.base().work_started() -
+                         proto.base().work_finished() ||
+        num_files > num_parallel_files_ ||
+        (num_files > 0 &&
+         (proto.next_file() < 0 || proto.next_file() >= num_files))) {
+      return errors::InvalidArgument("Inconsistent files when restoring ",
+                                     name(), ": ", proto.DebugString());
+    }
+    files_.clear();
+    for (const auto& file : proto.files()) {
+      AddFileLocked(file.filename(), file.offset());
+    }
+    next_file_ = num_files > 0 ? proto.next_file() : 0;
+    return Status::OK();
+  }
+
+ private:
+  void AddFileLocked(const string& filename, uint64 offset) {
+    files_.emplace_back(new RecordPrefetcher(
+        env_, filename, offset, options_, buffer_bytes_per_file_, &pool_));
+  }
+
+  Env* const env_;
+  const io::RecordReaderOptions options_;
+  const int num_parallel_files_;
+  const int64 buffer_bytes_per_file_;
+  // Destroyed after the files, whose reads it runs.
+  thread::ThreadPool pool_;
+  std::vector<std::unique_ptr<RecordPrefetcher>> files_;
+  // Index in files_ of the file of the next record.
+  int next_file_ = 0;
+};
+
 class TFRecordReaderOp : public ReaderOpKernel {
  public:
   explicit TFRecordReaderOp(OpKernelConstruction* context)
@@ -89,9 +347,33 @@ class TFRecordReaderOp : public ReaderOpKernel {
     string compression_type;
     context->GetAttr("compression_type", &compression_type);
 
-    SetReaderFactory([this, compression_type, env]() {
-      return new TFRecordReader(name(), compression_type, env);
-    });
+    int num_parallel_files;
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("num_parallel_files", &num_parallel_files));
+    OP_REQUIRES(context, num_parallel_files >= 1,
+                errors::InvalidArgument(
+                    "num_parallel_files must be at least 1, got ",
+                    num_parallel_files));
+    int64 prefetch_buffer_bytes;
+    OP_REQUIRES_OK(context, context->GetAttr("prefetch_buffer_bytes",
+                                             &prefetch_buffer_bytes));
+    OP_REQUIRES(context, prefetch_buffer_bytes >= 0,
+                errors::InvalidArgument(
+                    "prefetch_buffer_bytes must be non-negative, got ",
+                    prefetch_buffer_bytes));
+
+    if (num_parallel_files == 1 && prefetch_buffer_bytes == 0) {
+      SetReaderFactory([this, compression_type, env]() {
+        return new TFRecordReader(name(), compression_type, env);
+      });
+    } else {
+      SetReaderFactory([this, compression_type, num_parallel_files,
+                        prefetch_buffer_bytes, env]() {
+        return new InterleavedTFRecordReader(name(), compression_type,
+                                             num_parallel_files,
+                                             prefetch_buffer_bytes, env);
+      });
+    }
   }
 };
 
@@ -13,14 +13,24 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
-// A portable implementation of crc32c, optimized to handle
+// An implementation of crc32c that uses the crc32 instructions of SSE4.2 or
+// ARMv8 when available, and otherwise a portable version optimized to handle
 // four bytes at a time.
 
 #include "tensorflow/core/lib/hash/crc32c.h"
 
 #include <stdint.h>
+#include <string.h>
 #include "tensorflow/core/lib/core/coding.h"
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define TF_CRC32C_HW_TARGET __attribute__((target("sse4.2")))
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define TF_CRC32C_HW_TARGET
+#endif
+
 namespace tensorflow {
 namespace crc32c {
 
@@ -206,7 +216,7 @@ static inline uint32_t LE_LOAD32(const uint8_t *p) {
   return core::DecodeFixed32(reinterpret_cast<const char *>(p));
 }
 
-uint32 Extend(uint32 crc, const char *buf, size_t size) {
+static uint32 ExtendPortable(uint32 crc, const char *buf, size_t size) {
   const uint8 *p = reinterpret_cast<const uint8 *>(buf);
   const uint8 *e = p + size;
   uint32 l = crc ^ 0xffffffffu;
@@ -255,5 +265,140 @@ uint32 Extend(uint32 crc, const char *buf, size_t size) {
   return l ^ 0xffffffffu;
 }
 
+#if defined(TF_CRC32C_HW_TARGET)
+
+#if defined(__x86_64__)
+static bool CanUseHardwareCrc() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+
+static inline TF_CRC32C_HW_TARGET uint32 HardwareCrc8(uint32 l, uint8 v) {
+  return _mm_crc32_u8(l, v);
+}
+
+static inline TF_CRC32C_HW_TARGET uint32 HardwareCrc64(uint32 l, uint64 v) {
+  return _mm_crc32_u64(l, v);
+}
+#else   // defined(__aarch64__)
+static bool CanUseHardwareCrc() { return true; }
+
+static inline uint32 HardwareCrc8(uint32 l, uint8 v) { return __crc32cb(l, v); }
+
+static inline uint32 HardwareCrc64(uint32 l, uint64 v) {
+  return __crc32cd(l, v);
+}
+#endif  // defined(__x86_64__)
+
+// The crc32 instructions have a latency of several cycles but can start
+// every cycle, so large buffers are split in three blocks whose crcs are
+// computed together and then combined.  Combining uses the linearity of the
+// crc: the crc of A followed by B is the crc of A followed by |B| zeros,
+// xor the crc of B started from zero.
+static const size_t kLongBlock = 8192;
+static const size_t kShortBlock = 256;
+
+// Tables to compute the crc of a (non-inverted) crc followed by a fixed
+// number of zeros, one byte of the crc at a time.
+struct ZerosTable {
+  uint32 table[4][256];
+
+  explicit ZerosTable(size_t num_zeros) {
+    // The crc of each bit of the crc followed by the zeros.
+    uint32 bits[32];
+    for (int i = 0; i < 32; ++i) {
+      uint32 l = 1u << i;
+      for (size_t j = 0; j < num_zeros; ++j) {
+        l = table0_[l & 0xff] ^ (l >> 8);
+      }
+      bits[i] = l;
+    }
+    for (int k = 0; k < 4; ++k) {
+      for (int b = 0; b < 256; ++b) {
+        uint32 l = 0;
+        for (int i = 0; i < 8; ++i) {
+          if (b & (1 << i)) l ^= bits[8 * k + i];
+        }
+        table[k][b] = l;
+      }
+    }
+  }
+
+  uint32 Shift(uint32 l) const {
+    return table[0][l & 0xff] ^ table[1][(l >> 8) & 0xff] ^
+           table[2][(l >> 16) & 0xff] ^ table[3][l >> 24];
+  }
+};
+
+static inline uint64 Load64(const uint8 *p) {
+  uint64 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// Processes as many groups of three blocks of "block_size" bytes as fit in
+// [*p, e).
+static inline TF_CRC32C_HW_TARGET uint32 ExtendInterleaved(
+    uint32 l, size_t block_size, const ZerosTable &zeros, const uint8 **p,
+    const uint8 *e) {
+  const uint8 *q = *p;
+  while (static_cast<size_t>(e - q) >= 3 * block_size) {
+    uint32 l1 = 0;
+    uint32 l2 = 0;
+    const uint8 *end = q + block_size;
+    do {
+      l = HardwareCrc64(l, Load64(q));
+      l1 = HardwareCrc64(l1, Load64(q + block_size));
+      l2 = HardwareCrc64(l2, Load64(q + 2 * block_size));
+      q += 8;
+    } while (q < end);
+    l = zeros.Shift(l) ^ l1;
+    l = zeros.Shift(l) ^ l2;
+    q += 2 * block_size;
+  }
+  *p = q;
+  return l;
+}
+
+static TF_CRC32C_HW_TARGET uint32 ExtendHardware(uint32 crc, const char *buf,
+                                                 size_t size) {
+  const uint8 *p = reinterpret_cast<const uint8 *>(buf);
+  const uint8 *e = p + size;
+  uint32 l = crc ^ 0xffffffffu;
+
+  // Process bytes until finished or p is 8-byte aligned
+  while (p != e && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    l = HardwareCrc8(l, *p++);
+  }
+  if (static_cast<size_t>(e - p) >= 3 * kShortBlock) {
+    static const ZerosTable *long_zeros = new ZerosTable(kLongBlock);
+    static const ZerosTable *short_zeros = new ZerosTable(kShortBlock);
+    l = ExtendInterleaved(l, kLongBlock, *long_zeros, &p, e);
+    l = ExtendInterleaved(l, kShortBlock, *short_zeros, &p, e);
+  }
+  // Process bytes 8 at a time
+  while ((e - p) >= 8) {
+    l = HardwareCrc64(l, Load64(p));
+    p += 8;
+  }
+  // Process the last few bytes
+  while (p != e) {
+    l = HardwareCrc8(l, *p++);
+  }
+  return l ^ 0xffffffffu;
+}
+
+#endif  // defined(TF_CRC32C_HW_TARGET)
+
+uint32 Extend(uint32 crc, const char *buf, size_t size) {
+#if defined(TF_CRC32C_HW_TARGET)
+  static const bool use_hardware = CanUseHardwareCrc();
+  if (use_hardware) {
+    return ExtendHardware(crc, buf, size);
+  }
+#endif  // defined(TF_CRC32C_HW_TARGET)
+  return ExtendPortable(crc, buf, size);
+}
+
 }  // namespace crc32c
 }  // namespace tensorflow
@@ -14,7 +14,10 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/lib/hash/crc32c.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace crc32c {
@@ -54,6 +57,26 @@ TEST(CRC, Extend) {
   ASSERT_EQ(Value("hello world", 11), Extend(Value("hello ", 6), "world", 5));
 }
 
+TEST(CRC, LargeBuffers) {
+  // Buffers large enough to be split in interleaved blocks must have the
+  // same crc as when extended a byte at a time, at any alignment.
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  string data(100000, ' ');
+  for (char& c : data) {
+    c = rnd.Uniform(256);
+  }
+  for (size_t size : {767, 768, 769, 24575, 24576, 24577, 25000, 99000}) {
+    for (int offset = 0; offset < 8; ++offset) {
+      uint32 expected = 0;
+      for (size_t i = 0; i < size; ++i) {
+        expected = Extend(expected, &data[offset + i], 1);
+      }
+      EXPECT_EQ(expected, Value(&data[offset], size)) << size << " " << offset;
+    }
+  }
+}
+
 TEST(CRC, Mask) {
   uint32 crc = Value("foo", 3);
   ASSERT_NE(crc, Mask(crc));
@@ -62,5 +85,16 @@ TEST(CRC, Mask) {
   ASSERT_EQ(crc, Unmask(Unmask(Mask(Mask(crc)))));
 }
 
+static void BM_CRC(int iters, int len) {
+  string input(len, 'x');
+  uint32 h = 0;
+  for (int i = 0; i < iters; i++) {
+    h = Extend(h, input.data() + 1, len - 1);
+  }
+  testing::BytesProcessed(static_cast<int64>(iters) * (len - 1));
+  VLOG(1) << h;
+}
+BENCHMARK(BM_CRC)->Range(16, 256 << 10);
+
 }  // namespace crc32c
 }  // namespace tensorflow
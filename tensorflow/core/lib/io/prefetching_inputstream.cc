@@ -0,0 +1,123 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/prefetching_inputstream.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace io {
+
+PrefetchingInputStream::PrefetchingInputStream(RandomAccessFile* file,
+                                               size_t chunk_size,
+                                               int num_chunks)
+    : file_(file), chunk_size_(chunk_size), num_chunks_(num_chunks) {
+  CHECK_GT(chunk_size_, 0);
+  CHECK_GT(num_chunks_, 0);
+}
+
+PrefetchingInputStream::~PrefetchingInputStream() { DropChunks(); }
+
+Status PrefetchingInputStream::ReadNBytes(int64 bytes_to_read,
+                                          string* result) {
+  if (bytes_to_read < 0) {
+    return errors::InvalidArgument("Cannot read negative number of bytes");
+  }
+  result->clear();
+  result->reserve(bytes_to_read);
+  while (result->size() < bytes_to_read) {
+    Prefetch();
+    Chunk* chunk = chunks_.front().get();
+    WaitForChunk(chunk);
+    if (!chunk->status.ok() && !errors::IsOutOfRange(chunk->status)) {
+      const Status s = chunk->status;
+      // Reads the chunks again if the caller retries.
+      DropChunks();
+      return s;
+    }
+    const int64 offset_in_chunk = pos_ - chunk->offset;
+    if (chunk->data.size() < chunk_size_) {
+      at_eof_ = true;
+    }
+    if (offset_in_chunk >= chunk->data.size()) {
+      return errors::OutOfRange("reached end of file");
+    }
+    const size_t n = std::min<int64>(bytes_to_read - result->size(),
+                                     chunk->data.size() - offset_in_chunk);
+    result->append(chunk->data.data() + offset_in_chunk, n);
+    pos_ += n;
+  }
+  // Keeps reading ahead while the caller uses the result.
+  Prefetch();
+  return Status::OK();
+}
+
+int64 PrefetchingInputStream::Tell() const { return pos_; }
+
+Status PrefetchingInputStream::Seek(int64 position) {
+  pos_ = position;
+  return Status::OK();
+}
+
+void PrefetchingInputStream::Prefetch() {
+  if (!chunks_.empty() &&
+      (pos_ < chunks_.front()->offset || pos_ >= next_chunk_offset_)) {
+    DropChunks();
+  }
+  while (!chunks_.empty() && chunks_.front()->offset + chunk_size_ <= pos_) {
+    WaitForChunk(chunks_.front().get());
+    chunks_.pop_front();
+  }
+  if (chunks_.empty()) {
+    next_chunk_offset_ = pos_;
+    at_eof_ = false;
+  }
+  while (!at_eof_ && chunks_.size() < num_chunks_) {
+    std::unique_ptr<Chunk> chunk(new Chunk);
+    chunk->offset = next_chunk_offset_;
+    chunk->scratch.resize(chunk_size_);
+    next_chunk_offset_ += chunk_size_;
+    Chunk* c = chunk.get();
+    chunks_.push_back(std::move(chunk));
+    file_->ReadAsync(c->offset, chunk_size_, &c->scratch[0],
+                     [this, c](const Status& s, StringPiece data) {
+                       mutex_lock l(mu_);
+                       c->status = s;
+                       c->data = data;
+                       c->done = true;
+                       chunk_done_.notify_all();
+                     });
+  }
+}
+
+void PrefetchingInputStream::WaitForChunk(Chunk* chunk) {
+  mutex_lock l(mu_);
+  while (!chunk->done) {
+    chunk_done_.wait(l);
+  }
+}
+
+void PrefetchingInputStream::DropChunks() {
+  for (const auto& chunk : chunks_) {
+    WaitForChunk(chunk.get());
+  }
+  chunks_.clear();
+}
+
+}  // namespace io
+}  // namespace tensorflow
@@ -0,0 +1,96 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LIB_IO_PREFETCHING_INPUTSTREAM_H_
+#define TENSORFLOW_LIB_IO_PREFETCHING_INPUTSTREAM_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/lib/io/inputstream_interface.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace io {
+
+// Wraps a RandomAccessFile in an InputStreamInterface which reads the file
+// ahead of the current position, in chunks of "chunk_size" bytes of which up
+// to "num_chunks" are read concurrently with RandomAccessFile::ReadAsync().
+// A given instance of PrefetchingInputStream is NOT safe for concurrent use by
+// multiple threads.
+class PrefetchingInputStream : public InputStreamInterface {
+ public:
+  // Does not take ownership of 'file'. 'file' must outlive *this.
+  PrefetchingInputStream(RandomAccessFile* file, size_t chunk_size,
+                         int num_chunks);
+
+  ~PrefetchingInputStream() override;
+
+  Status ReadNBytes(int64 bytes_to_read, string* result) override;
+
+  int64 Tell() const override;
+
+  // Moves the position to 'position'. The chunks read ahead are kept if they
+  // follow the new position.
+  Status Seek(int64 position);
+
+  Status Reset() override { return Seek(0); }
+
+ private:
+  struct Chunk {
+    int64 offset;
+    string scratch;
+    // Set by the read callback.
+    bool done = false;
+    Status status;
+    StringPiece data;
+  };
+
+  // Drops the chunks before the position, and reads ahead of it up to
+  // num_chunks_ chunks.
+  void Prefetch();
+
+  // Waits until the read of 'chunk' completes.
+  void WaitForChunk(Chunk* chunk);
+
+  // Waits for the pending reads and drops all the chunks.
+  void DropChunks();
+
+  RandomAccessFile* file_;  // Not owned.
+  const size_t chunk_size_;
+  const int num_chunks_;
+  int64 pos_ = 0;  // Tracks where we are in the file.
+
+  // The chunks read ahead, which are contiguous and start at or before the
+  // position unless empty.
+  std::deque<std::unique_ptr<Chunk>> chunks_;
+  // The offset of the next chunk to read.
+  int64 next_chunk_offset_ = 0;
+  // Set once a chunk reached the end of the file.
+  bool at_eof_ = false;
+
+  mutex mu_;
+  condition_variable chunk_done_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PrefetchingInputStream);
+};
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_LIB_IO_PREFETCHING_INPUTSTREAM_H_
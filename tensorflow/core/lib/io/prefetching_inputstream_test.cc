@@ -0,0 +1,149 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/prefetching_inputstream.h"
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace io {
+namespace {
+
+// Chunk sizes and numbers of chunks covering reads within a chunk, across
+// chunks and past the read-ahead window.
+const size_t kChunkSizes[] = {1, 2, 3, 4, 5, 11, 64};
+const int kNumChunks[] = {1, 2, 8};
+
+TEST(PrefetchingInputStream, ReadNBytes) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/prefetching_inputstream_test";
+  WriteStringToFile(env, fname, "0123456789");
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+  for (size_t chunk_size : kChunkSizes) {
+    for (int num_chunks : kNumChunks) {
+      string read;
+      PrefetchingInputStream in(file.get(), chunk_size, num_chunks);
+      TF_ASSERT_OK(in.ReadNBytes(3, &read));
+      EXPECT_EQ(read, "012");
+      EXPECT_EQ(3, in.Tell());
+      TF_ASSERT_OK(in.ReadNBytes(0, &read));
+      EXPECT_EQ(read, "");
+      EXPECT_EQ(3, in.Tell());
+      TF_ASSERT_OK(in.ReadNBytes(5, &read));
+      EXPECT_EQ(read, "34567");
+      EXPECT_EQ(8, in.Tell());
+      EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(20, &read)));
+      EXPECT_EQ(read, "89");
+      EXPECT_EQ(10, in.Tell());
+      EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &read)));
+      EXPECT_EQ(read, "");
+      EXPECT_EQ(10, in.Tell());
+    }
+  }
+}
+
+TEST(PrefetchingInputStream, SkipNBytes) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/prefetching_inputstream_test";
+  WriteStringToFile(env, fname, "0123456789");
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+  for (size_t chunk_size : kChunkSizes) {
+    for (int num_chunks : kNumChunks) {
+      string read;
+      PrefetchingInputStream in(file.get(), chunk_size, num_chunks);
+      TF_ASSERT_OK(in.SkipNBytes(3));
+      EXPECT_EQ(3, in.Tell());
+      TF_ASSERT_OK(in.ReadNBytes(4, &read));
+      EXPECT_EQ(read, "3456");
+      EXPECT_EQ(7, in.Tell());
+      EXPECT_TRUE(errors::IsOutOfRange(in.SkipNBytes(20)));
+      EXPECT_EQ(10, in.Tell());
+      EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(5, &read)));
+      EXPECT_EQ(read, "");
+    }
+  }
+}
+
+TEST(PrefetchingInputStream, Seek) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/prefetching_inputstream_seek_test";
+  WriteStringToFile(env, fname, "0123456789");
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+  for (size_t chunk_size : kChunkSizes) {
+    for (int num_chunks : kNumChunks) {
+      string read;
+      PrefetchingInputStream in(file.get(), chunk_size, num_chunks);
+
+      // Seek forward
+      TF_ASSERT_OK(in.Seek(3));
+      TF_ASSERT_OK(in.ReadNBytes(4, &read));
+      EXPECT_EQ(read, "3456");
+      EXPECT_EQ(7, in.Tell());
+
+      // Seek backwards
+      TF_ASSERT_OK(in.Seek(1));
+      TF_ASSERT_OK(in.ReadNBytes(4, &read));
+      EXPECT_EQ(read, "1234");
+      EXPECT_EQ(5, in.Tell());
+
+      // Seek past the end of the file, and back into it.
+      TF_ASSERT_OK(in.Seek(12));
+      EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &read)));
+      TF_ASSERT_OK(in.Seek(8));
+      TF_ASSERT_OK(in.ReadNBytes(2, &read));
+      EXPECT_EQ(read, "89");
+    }
+  }
+}
+
+TEST(PrefetchingInputStream, ReadLargeFile) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/prefetching_inputstream_large_test";
+  string content;
+  for (int i = 0; i < 100000; ++i) {
+    strings::StrAppend(&content, i, ",");
+  }
+  WriteStringToFile(env, fname, content);
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+  PrefetchingInputStream in(file.get(), 4096, 16);
+  string read;
+  size_t offset = 0;
+  for (int64 n = 1; offset < content.size(); n = n * 3 % 10007) {
+    const Status s = in.ReadNBytes(n, &read);
+    EXPECT_EQ(content.substr(offset, n), read);
+    offset += read.size();
+    if (offset < content.size()) {
+      TF_ASSERT_OK(s);
+    } else {
+      EXPECT_TRUE(s.ok() || errors::IsOutOfRange(s)) << s;
+    }
+  }
+  EXPECT_EQ(content.size(), in.Tell());
+}
+
+}  // anonymous namespace
+}  // namespace io
+}  // namespace tensorflow
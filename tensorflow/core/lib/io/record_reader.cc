@@ -16,16 +16,23 @@ limitations under the License.
 #include "tensorflow/core/lib/io/record_reader.h"
 
 #include <limits.h>
+#include <algorithm>
 
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
+#if !defined(IS_SLIM_BUILD)
+#include "tensorflow/core/lib/io/snappy/snappy_inputbuffer.h"
+#endif  // IS_SLIM_BUILD
 #include "tensorflow/core/platform/env.h"
 
 namespace tensorflow {
 namespace io {
 
+static const size_t kHeaderSize = sizeof(uint64) + sizeof(uint32);
+static const size_t kFooterSize = sizeof(uint32);
+
 RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
     const string& compression_type) {
   RecordReaderOptions options;
@@ -44,6 +51,13 @@ RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
                << " No compression will be used.";
 #else
     options.zlib_options = io::ZlibCompressionOptions::GZIP();
+#endif  // IS_SLIM_BUILD
+  } else if (compression_type == "SNAPPY") {
+#if defined(IS_SLIM_BUILD)
+    LOG(ERROR) << "Compression is not supported but compression_type is set."
+               << " No compression will be used.";
+#else
+    options.compression_type = io::RecordReaderOptions::SNAPPY_COMPRESSION;
 #endif  // IS_SLIM_BUILD
   } else if (compression_type != "") {
     LOG(ERROR) << "Unsupported compression_type:" << compression_type
@@ -55,15 +69,39 @@ RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
 RecordReader::RecordReader(RandomAccessFile* file,
                            const RecordReaderOptions& options)
     : src_(file), options_(options) {
+#if !defined(IS_SLIM_BUILD)
+  if (options.read_ahead_chunk_size > 0) {
+    prefetching_input_stream_.reset(new PrefetchingInputStream(
+        file, options.read_ahead_chunk_size, options.read_ahead_chunks));
+  }
+#endif  // IS_SLIM_BUILD
   if (options.compression_type == RecordReaderOptions::ZLIB_COMPRESSION) {
 // We don't have zlib available on all embedded platforms, so fail.
 #if defined(IS_SLIM_BUILD)
     LOG(FATAL) << "Zlib compression is unsupported on mobile platforms.";
 #else   // IS_SLIM_BUILD
-    random_input_stream_.reset(new RandomAccessInputStream(file));
-    zlib_input_stream_.reset(new ZlibInputStream(
-        random_input_stream_.get(), options.zlib_options.input_buffer_size,
+    InputStreamInterface* input_stream = prefetching_input_stream_.get();
+    if (input_stream == nullptr) {
+      random_input_stream_.reset(new RandomAccessInputStream(file));
+      input_stream = random_input_stream_.get();
+    }
+    compressed_input_stream_.reset(new ZlibInputStream(
+        input_stream, options.zlib_options.input_buffer_size,
         options.zlib_options.output_buffer_size, options.zlib_options));
+#endif  // IS_SLIM_BUILD
+  } else if (options.compression_type ==
+             RecordReaderOptions::SNAPPY_COMPRESSION) {
+#if defined(IS_SLIM_BUILD)
+    LOG(FATAL) << "Snappy compression is unsupported on mobile platforms.";
+#else   // IS_SLIM_BUILD
+    // The input buffer must fit a whole compressed block, whose size is
+    // bounded as in snappy::MaxCompressedLength().
+    const int64 block_size = options.snappy_options.output_buffer_size;
+    const int64 input_buffer_size =
+        std::max(options.snappy_options.input_buffer_size,
+                 32 + block_size + block_size / 6);
+    compressed_input_stream_.reset(
+        new SnappyInputBuffer(file, input_buffer_size, block_size));
 #endif  // IS_SLIM_BUILD
   } else if (options.compression_type == RecordReaderOptions::NONE) {
     // Nothing to do.
@@ -73,14 +111,16 @@ RecordReader::RecordReader(RandomAccessFile* file,
 }
 
 RecordReader::~RecordReader() {
-  zlib_input_stream_.reset(nullptr);
+  compressed_input_stream_.reset(nullptr);
+  prefetching_input_stream_.reset(nullptr);
   random_input_stream_.reset(nullptr);
 }
 
 // Read n+4 bytes from file, verify that checksum of first n bytes is
 // stored in the last 4 bytes and store the first n bytes in *result.
 // May use *storage as backing store.
-Status RecordReader::ReadChecksummed(uint64 offset, size_t n,
+// If "verify" is false, the checksum is not verified.
+Status RecordReader::ReadChecksummed(uint64 offset, size_t n, bool verify,
                                      StringPiece* result, string* storage) {
   if (n >= SIZE_MAX - sizeof(uint32)) {
     return errors::DataLoss("record size too large");
@@ -90,15 +130,27 @@ Status RecordReader::ReadChecksummed(uint64 offset, size_t n,
   storage->resize(expected);
 
 #if !defined(IS_SLIM_BUILD)
-  if (zlib_input_stream_) {
-    // If we have a zlib compressed buffer, we assume that the
+  InputStreamInterface* input_stream = compressed_input_stream_.get();
+  if (input_stream == nullptr && prefetching_input_stream_) {
+    // The uncompressed file is read ahead from the current position, which
+    // follows the record unless the records are read out of order.
+    if (prefetching_input_stream_->Tell() != offset) {
+      TF_RETURN_IF_ERROR(prefetching_input_stream_->Seek(offset));
+    }
+    input_stream = prefetching_input_stream_.get();
+  }
+  if (input_stream) {
+    // If we have a compressed buffer, we assume that the
     // file is being read sequentially, and we use the underlying
     // implementation to read the data.
     //
     // No checks are done to validate that the file is being read
-    // sequentially.  At some point the zlib input buffer may support
+    // sequentially.  At some point the compressed input buffers may support
     // seeking, possibly inefficiently.
-    TF_RETURN_IF_ERROR(zlib_input_stream_->ReadNBytes(expected, storage));
+    Status s = input_stream->ReadNBytes(expected, storage);
+    if (!s.ok() && !errors::IsOutOfRange(s)) {
+      return s;
+    }
 
     if (storage->size() != expected) {
       if (storage->size() == 0) {
@@ -109,7 +161,8 @@ Status RecordReader::ReadChecksummed(uint64 offset, size_t n,
     }
 
     uint32 masked_crc = core::DecodeFixed32(storage->data() + n);
-    if (crc32c::Unmask(masked_crc) != crc32c::Value(storage->data(), n)) {
+    if (verify &&
+        crc32c::Unmask(masked_crc) != crc32c::Value(storage->data(), n)) {
       return errors::DataLoss("corrupted record at ", offset);
     }
     *result = StringPiece(storage->data(), n);
@@ -127,7 +180,7 @@ Status RecordReader::ReadChecksummed(uint64 offset, size_t n,
       }
     }
     uint32 masked_crc = core::DecodeFixed32(data.data() + n);
-    if (crc32c::Unmask(masked_crc) != crc32c::Value(data.data(), n)) {
+    if (verify && crc32c::Unmask(masked_crc) != crc32c::Value(data.data(), n)) {
       return errors::DataLoss("corrupted record at ", offset);
     }
     *result = StringPiece(data.data(), n);
@@ -139,12 +192,9 @@ Status RecordReader::ReadChecksummed(uint64 offset, size_t n,
 }
 
 Status RecordReader::ReadRecord(uint64* offset, string* record) {
-  static const size_t kHeaderSize = sizeof(uint64) + sizeof(uint32);
-  static const size_t kFooterSize = sizeof(uint32);
-
   // Read header data.
   StringPiece lbuf;
-  Status s = ReadChecksummed(*offset, sizeof(uint64), &lbuf, record);
+  Status s = ReadChecksummed(*offset, sizeof(uint64), true, &lbuf, record);
   if (!s.ok()) {
     return s;
   }
@@ -152,7 +202,8 @@ Status RecordReader::ReadRecord(uint64* offset, string* record) {
 
   // Read data
   StringPiece data;
-  s = ReadChecksummed(*offset + kHeaderSize, length, &data, record);
+  s = ReadChecksummed(*offset + kHeaderSize, length, options_.verify_checksums,
+                      &data, record);
   if (!s.ok()) {
     if (errors::IsOutOfRange(s)) {
       s = errors::DataLoss("truncated record at ", *offset);
@@ -171,5 +222,49 @@ Status RecordReader::ReadRecord(uint64* offset, string* record) {
   return Status::OK();
 }
 
+MappedRecordReader::MappedRecordReader(ReadOnlyMemoryRegion* region,
+                                       const RecordReaderOptions& options)
+    : region_(region), options_(options) {
+  if (options.compression_type != RecordReaderOptions::NONE) {
+    LOG(FATAL) << "Compression is unsupported for memory-mapped files.";
+  }
+  region_->AdviseSequentialAccess();
+}
+
+Status MappedRecordReader::ReadRecord(uint64* offset, StringPiece* record) {
+  const uint64 size = region_->length();
+  if (*offset >= size) {
+    return errors::OutOfRange("eof");
+  }
+  if (size - *offset < kHeaderSize) {
+    return errors::DataLoss("truncated record at ", *offset);
+  }
+
+  // Read header data.
+  const char* header = static_cast<const char*>(region_->data()) + *offset;
+  uint32 masked_crc = core::DecodeFixed32(header + sizeof(uint64));
+  if (crc32c::Unmask(masked_crc) != crc32c::Value(header, sizeof(uint64))) {
+    return errors::DataLoss("corrupted record at ", *offset);
+  }
+  const uint64 length = core::DecodeFixed64(header);
+
+  // Read data
+  const uint64 remaining = size - *offset - kHeaderSize;
+  if (remaining < kFooterSize || length > remaining - kFooterSize) {
+    return errors::DataLoss("truncated record at ", *offset);
+  }
+  const char* data = header + kHeaderSize;
+  if (options_.verify_checksums) {
+    masked_crc = core::DecodeFixed32(data + length);
+    if (crc32c::Unmask(masked_crc) != crc32c::Value(data, length)) {
+      return errors::DataLoss("corrupted record at ", *offset);
+    }
+  }
+
+  *record = StringPiece(data, length);
+  *offset += kHeaderSize + length + kFooterSize;
+  return Status::OK();
+}
+
 }  // namespace io
 }  // namespace tensorflow
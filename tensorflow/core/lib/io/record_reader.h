@@ -19,7 +19,10 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
 #if !defined(IS_SLIM_BUILD)
+#include "tensorflow/core/lib/io/inputstream_interface.h"
+#include "tensorflow/core/lib/io/prefetching_inputstream.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
+#include "tensorflow/core/lib/io/snappy/snappy_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
 #endif  // IS_SLIM_BUILD
@@ -29,20 +32,38 @@ limitations under the License.
 namespace tensorflow {
 
 class RandomAccessFile;
+class ReadOnlyMemoryRegion;
 
 namespace io {
 
 class RecordReaderOptions {
  public:
-  enum CompressionType { NONE = 0, ZLIB_COMPRESSION = 1 };
+  enum CompressionType {
+    NONE = 0,
+    ZLIB_COMPRESSION = 1,
+    SNAPPY_COMPRESSION = 2
+  };
   CompressionType compression_type = NONE;
 
   static RecordReaderOptions CreateRecordReaderOptions(
       const string& compression_type);
 
+  // If false, the checksums of the record data are not verified.  The
+  // checksums of the record lengths always are.
+  bool verify_checksums = true;
+
+  // If positive, the file is read ahead of the records in chunks of this
+  // many bytes, of which up to "read_ahead_chunks" are read concurrently.
+  // Best suited to reading the records in order.
+  int64 read_ahead_chunk_size = 0;
+  int read_ahead_chunks = 4;
+
 #if !defined(IS_SLIM_BUILD)
   // Options specific to zlib compression.
   ZlibCompressionOptions zlib_options;
+
+  // Options specific to snappy compression.
+  SnappyCompressionOptions snappy_options;
 #endif  // IS_SLIM_BUILD
 };
 
@@ -61,19 +82,46 @@ class RecordReader {
   Status ReadRecord(uint64* offset, string* record);
 
  private:
-  Status ReadChecksummed(uint64 offset, size_t n, StringPiece* result,
-                         string* storage);
+  Status ReadChecksummed(uint64 offset, size_t n, bool verify,
+                         StringPiece* result, string* storage);
 
   RandomAccessFile* src_;
   RecordReaderOptions options_;
 #if !defined(IS_SLIM_BUILD)
   std::unique_ptr<RandomAccessInputStream> random_input_stream_;
-  std::unique_ptr<ZlibInputStream> zlib_input_stream_;
+  // Reads the file ahead when options_.read_ahead_chunk_size is set.
+  std::unique_ptr<PrefetchingInputStream> prefetching_input_stream_;
+  // Uncompresses the file when it is compressed.
+  std::unique_ptr<InputStreamInterface> compressed_input_stream_;
 #endif  // IS_SLIM_BUILD
 
   TF_DISALLOW_COPY_AND_ASSIGN(RecordReader);
 };
 
+// Reads records from a file mapped into memory, e.g. by
+// Env::NewReadOnlyMemoryRegionFromFile().  Unlike RecordReader, it does not
+// copy the records nor issue a system call per record.  Only uncompressed
+// files are supported.
+class MappedRecordReader {
+ public:
+  // Create a reader that will return log records from "*region", which is
+  // advised to be read sequentially.  "*region" must remain live while this
+  // Reader and the records it returned are in use.
+  MappedRecordReader(ReadOnlyMemoryRegion* region,
+                     const RecordReaderOptions& options = RecordReaderOptions());
+
+  // Point *record at the record at "*offset" in the region and update
+  // *offset to point to the offset of the next record.  Returns OK on
+  // success, OUT_OF_RANGE for end of file, or something else for an error.
+  Status ReadRecord(uint64* offset, StringPiece* record);
+
+ private:
+  ReadOnlyMemoryRegion* region_;
+  RecordReaderOptions options_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MappedRecordReader);
+};
+
 }  // namespace io
 }  // namespace tensorflow
 
@@ -24,7 +24,9 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 
@@ -105,4 +107,243 @@ TEST(RecordReaderWriterTest, TestZlib) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestReadAhead) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_read_ahead_test";
+  const string large_record(1000, 'x');
+
+  for (auto compression_type : {io::RecordWriterOptions::NONE,
+                                io::RecordWriterOptions::ZLIB_COMPRESSION}) {
+    {
+      std::unique_ptr<WritableFile> file;
+      TF_CHECK_OK(env->NewWritableFile(fname, &file));
+
+      io::RecordWriterOptions options;
+      options.compression_type = compression_type;
+      io::RecordWriter writer(file.get(), options);
+      TF_CHECK_OK(writer.WriteRecord("abc"));
+      TF_CHECK_OK(writer.WriteRecord(large_record));
+      TF_CHECK_OK(writer.WriteRecord("defg"));
+      TF_CHECK_OK(writer.Flush());
+    }
+
+    for (auto buf_size : BufferSizes()) {
+      std::unique_ptr<RandomAccessFile> read_file;
+      TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+      io::RecordReaderOptions options;
+      options.compression_type =
+          static_cast<io::RecordReaderOptions::CompressionType>(
+              compression_type);
+      options.read_ahead_chunk_size = buf_size;
+      io::RecordReader reader(read_file.get(), options);
+      uint64 offset = 0;
+      string record;
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+      EXPECT_EQ("abc", record);
+      const uint64 second_offset = offset;
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+      EXPECT_EQ(large_record, record);
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+      EXPECT_EQ("defg", record);
+      EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+
+      if (compression_type == io::RecordWriterOptions::NONE) {
+        // Uncompressed records can still be read out of order.
+        offset = second_offset;
+        TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+        EXPECT_EQ(large_record, record);
+      }
+    }
+  }
+}
+
+static bool SnappyCompressionSupported() {
+  string out;
+  StringPiece in = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+  return port::Snappy_Compress(in.data(), in.size(), &out);
+}
+
+TEST(RecordReaderWriterTest, TestSnappy) {
+  if (!SnappyCompressionSupported()) {
+    fprintf(stderr, "Snappy disabled. Skipping test\n");
+    return;
+  }
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_snappy_test";
+
+  // Records larger than the blocks span several of them.
+  const string large_record(100000, 'x');
+  for (auto buf_size : {100, 65536}) {
+    {
+      std::unique_ptr<WritableFile> file;
+      TF_CHECK_OK(env->NewWritableFile(fname, &file));
+
+      io::RecordWriterOptions options;
+      options.compression_type = io::RecordWriterOptions::SNAPPY_COMPRESSION;
+      options.snappy_options.input_buffer_size = buf_size;
+      io::RecordWriter writer(file.get(), options);
+      TF_CHECK_OK(writer.WriteRecord("abc"));
+      TF_CHECK_OK(writer.WriteRecord(large_record));
+      TF_CHECK_OK(writer.WriteRecord("defg"));
+      TF_CHECK_OK(writer.Flush());
+    }
+
+    {
+      std::unique_ptr<RandomAccessFile> read_file;
+      // Read it back with the RecordReader.
+      TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+      io::RecordReaderOptions options =
+          io::RecordReaderOptions::CreateRecordReaderOptions("SNAPPY");
+      options.snappy_options.output_buffer_size = buf_size;
+      io::RecordReader reader(read_file.get(), options);
+      uint64 offset = 0;
+      string record;
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+      EXPECT_EQ("abc", record);
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+      EXPECT_EQ(large_record, record);
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+      EXPECT_EQ("defg", record);
+      EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+    }
+  }
+}
+
+TEST(RecordReaderWriterTest, TestMapped) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_mapped_test";
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_CHECK_OK(writer.WriteRecord("abc"));
+    TF_CHECK_OK(writer.WriteRecord(""));
+    TF_CHECK_OK(writer.WriteRecord("defg"));
+    TF_CHECK_OK(writer.Flush());
+  }
+
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_CHECK_OK(env->NewReadOnlyMemoryRegionFromFile(fname, &region));
+  io::MappedRecordReader reader(region.get());
+  uint64 offset = 0;
+  StringPiece record;
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ("abc", record);
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ("", record);
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ("defg", record);
+  EXPECT_EQ(region->length(), offset);
+  EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+
+  // The records are returned in place.
+  offset = 0;
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ(static_cast<const char*>(region->data()) + 12, record.data());
+}
+
+TEST(RecordReaderWriterTest, TestMappedEmpty) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_mapped_empty";
+  TF_CHECK_OK(WriteStringToFile(env, fname, ""));
+
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_CHECK_OK(env->NewReadOnlyMemoryRegionFromFile(fname, &region));
+  io::MappedRecordReader reader(region.get());
+  uint64 offset = 0;
+  StringPiece record;
+  EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+}
+
+TEST(RecordReaderWriterTest, TestMappedCorrupted) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_mapped_corrupted";
+  string contents;
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_CHECK_OK(writer.WriteRecord("abc"));
+    TF_CHECK_OK(writer.Flush());
+  }
+  TF_CHECK_OK(ReadFileToString(env, fname, &contents));
+  contents[12] = 'x';
+  TF_CHECK_OK(WriteStringToFile(env, fname, contents));
+
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_CHECK_OK(env->NewReadOnlyMemoryRegionFromFile(fname, &region));
+  uint64 offset = 0;
+  StringPiece record;
+  {
+    io::MappedRecordReader reader(region.get());
+    EXPECT_TRUE(errors::IsDataLoss(reader.ReadRecord(&offset, &record)));
+    EXPECT_EQ(0, offset);
+  }
+  {
+    io::RecordReaderOptions options;
+    options.verify_checksums = false;
+    io::MappedRecordReader reader(region.get(), options);
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("xbc", record);
+  }
+
+  // A truncated record is detected even without checksums.
+  TF_CHECK_OK(WriteStringToFile(env, fname, contents.substr(0, 17)));
+  TF_CHECK_OK(env->NewReadOnlyMemoryRegionFromFile(fname, &region));
+  io::RecordReaderOptions options;
+  options.verify_checksums = false;
+  io::MappedRecordReader reader(region.get(), options);
+  offset = 0;
+  Status s = reader.ReadRecord(&offset, &record);
+  EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+}
+
+static void BM_ReadRecords(int iters, int compression_type) {
+  testing::StopTiming();
+  if (compression_type == io::RecordReaderOptions::SNAPPY_COMPRESSION &&
+      !SnappyCompressionSupported()) {
+    return;
+  }
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_benchmark";
+  // Records of 1KB of text, which compress to about half their size.
+  string record;
+  for (int i = 0; i < 100; ++i) {
+    strings::StrAppend(&record, "value ", i % 17, " ");
+  }
+  record.resize(1024, ' ');
+  const int kNumRecords = 10000;
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriterOptions options;
+    options.compression_type =
+        static_cast<io::RecordWriterOptions::CompressionType>(compression_type);
+    io::RecordWriter writer(file.get(), options);
+    for (int i = 0; i < kNumRecords; ++i) {
+      TF_CHECK_OK(writer.WriteRecord(record));
+    }
+    TF_CHECK_OK(writer.Flush());
+  }
+
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    std::unique_ptr<RandomAccessFile> file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &file));
+    io::RecordReaderOptions options;
+    options.compression_type =
+        static_cast<io::RecordReaderOptions::CompressionType>(compression_type);
+    io::RecordReader reader(file.get(), options);
+    uint64 offset = 0;
+    for (int j = 0; j < kNumRecords; ++j) {
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    }
+  }
+  testing::BytesProcessed(static_cast<int64>(iters) * kNumRecords * 1024);
+}
+BENCHMARK(BM_ReadRecords)
+    ->Arg(io::RecordReaderOptions::NONE)
+    ->Arg(io::RecordReaderOptions::ZLIB_COMPRESSION)
+    ->Arg(io::RecordReaderOptions::SNAPPY_COMPRESSION);
+
 }  // namespace tensorflow
@@ -156,6 +156,27 @@ TEST(SnappyBuffers, MultipleWriteCallsWithFlush) {
   TF_CHECK_OK(TestMultipleWrites(10000, 10000, 10000, 10000, 2, true));
 }
 
+TEST(SnappyBuffers, WriteLargerThanInputBuffer) {
+  if (!SnappyCompressionSupported()) {
+    fprintf(stderr, "skipping compression tests\n");
+    return;
+  }
+  // Blocks hold at most as many bytes as the compression input buffer, so
+  // an uncompression output buffer of the same size is enough.
+  TF_CHECK_OK(TestMultipleWrites(1000, 1000, 2000, 1000, 2, false, 5));
+}
+
+TEST(SnappyBuffers, SmallUncompressOutputBuffer) {
+  if (!SnappyCompressionSupported()) {
+    fprintf(stderr, "skipping compression tests\n");
+    return;
+  }
+  CHECK_EQ(TestMultipleWrites(10000, 10000, 10000, 100, 2, true),
+           errors::ResourceExhausted("Output buffer(size: 100 bytes) too "
+                                     "small. Should be larger than ",
+                                     GetRecord().size(), " bytes."));
+}
+
 TEST(SnappyBuffers, SmallUncompressInputBuffer) {
   if (!SnappyCompressionSupported()) {
     fprintf(stderr, "skipping compression tests\n");
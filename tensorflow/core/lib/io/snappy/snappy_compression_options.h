@@ -0,0 +1,44 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LIB_IO_SNAPPY_SNAPPY_COMPRESSION_OPTIONS_H_
+#define TENSORFLOW_LIB_IO_SNAPPY_SNAPPY_COMPRESSION_OPTIONS_H_
+
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace io {
+
+class SnappyCompressionOptions {
+ public:
+  // Size of the buffer used for caching the data read from source file.
+  //
+  // When compressing, the data is compressed in independent blocks of at most
+  // this many bytes.  When uncompressing, the buffer must hold a whole
+  // compressed block; it is enlarged as needed to fit the compressed form of
+  // `output_buffer_size` bytes.
+  int64 input_buffer_size = 256 << 10;
+
+  // Size of the sink buffer where the compressed/uncompressed data is cached.
+  //
+  // When uncompressing, it must be at least as large as the
+  // `input_buffer_size` used when compressing.
+  int64 output_buffer_size = 256 << 10;
+};
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_LIB_IO_SNAPPY_SNAPPY_COMPRESSION_OPTIONS_H_
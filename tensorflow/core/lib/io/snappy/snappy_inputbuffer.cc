@@ -105,7 +105,12 @@ Status SnappyInputBuffer::Inflate() {
   DCHECK_EQ(avail_out_, 0);
 
   // Output buffer must be large enough to fit the uncompressed block.
-  DCHECK_GE(output_buffer_capacity_, uncompressed_length);
+  if (uncompressed_length > output_buffer_capacity_) {
+    return errors::ResourceExhausted(
+        "Output buffer(size: ", output_buffer_capacity_,
+        " bytes) too small. Should be larger than ", uncompressed_length,
+        " bytes.");
+  }
   next_out_ = (char*)output_buffer_.get();
 
   bool status = port::Snappy_Uncompress(next_in_, compressed_block_length,
@@ -129,7 +134,7 @@ Status SnappyInputBuffer::ReadCompressedBlockLength(uint32* length) {
     size_t readable = std::min(bytes_to_read, avail_in_);
 
     for (int i = 0; i < readable; i++) {
-      *length = (*length << 8) | next_in_[0];
+      *length = (*length << 8) | static_cast<uint8>(next_in_[0]);
       bytes_to_read--;
       next_in_++;
       avail_in_--;
@@ -55,17 +55,22 @@ Status SnappyOutputBuffer::Write(StringPiece data) {
     return Status::OK();
   }
 
-  // `data` is too large to fit in input buffer so we deflate it directly.
-  // Note that at this point we have already deflated all existing input so
-  // we do not need to backup next_in and avail_in.
-  next_in_ = const_cast<char*>(data.data());
-  avail_in_ = bytes_to_write;
-
-  TF_RETURN_IF_ERROR(Deflate());
+  // `data` is too large to fit in input buffer so we deflate it directly, in
+  // blocks of the size of the input buffer so that readers can uncompress
+  // them. Note that at this point we have already deflated all existing input
+  // so we do not need to backup next_in and avail_in.
+  while (bytes_to_write > input_buffer_capacity_) {
+    next_in_ = const_cast<char*>(data.data());
+    avail_in_ = input_buffer_capacity_;
+    TF_RETURN_IF_ERROR(Deflate());
+    data.remove_prefix(input_buffer_capacity_);
+    bytes_to_write -= input_buffer_capacity_;
+  }
 
   DCHECK(avail_in_ == 0);  // All input will be used up.
 
   next_in_ = input_buffer_.get();
+  AddToInputBuffer(data);
 
   return Status::OK();
 }
@@ -76,6 +81,17 @@ Status SnappyOutputBuffer::Flush() {
   return Status::OK();
 }
 
+Status SnappyOutputBuffer::Append(const StringPiece& data) {
+  return Write(data);
+}
+
+Status SnappyOutputBuffer::Close() { return Flush(); }
+
+Status SnappyOutputBuffer::Sync() {
+  TF_RETURN_IF_ERROR(Flush());
+  return file_->Sync();
+}
+
 int32 SnappyOutputBuffer::AvailableInputSpace() const {
   return input_buffer_capacity_ - avail_in_;
 }
@@ -161,10 +177,9 @@ Status SnappyOutputBuffer::Deflate() {
   }
 
   // Write length of compressed block to output buffer.
-  char* compressed_length_array = new char[4];
-  std::fill(compressed_length_array, compressed_length_array + 4, 0);
+  char compressed_length_array[4];
   for (int i = 0; i < 4; i++) {
-    // Little endian.
+    // Big endian.
     compressed_length_array[i] = output.size() >> (8 * (3 - i));
   }
   TF_RETURN_IF_ERROR(AddToOutputBuffer(compressed_length_array, 4));
@@ -173,7 +188,6 @@ Status SnappyOutputBuffer::Deflate() {
   TF_RETURN_IF_ERROR(AddToOutputBuffer(output.data(), output.size()));
   next_in_ += avail_in_;
   avail_in_ = 0;
-  delete[] compressed_length_array;
 
   return Status::OK();
 }
@@ -42,8 +42,9 @@ namespace io {
 // starts with a 4 byte header which stores the length (in bytes) of the
 // _compressed_ block _excluding_ this header. The compressed
 // block (excluding the 4 byte header) is a valid snappy block and can directly
-// be uncompressed using Snappy_Uncompress.
-class SnappyOutputBuffer {
+// be uncompressed using Snappy_Uncompress. Blocks hold at most
+// `input_buffer_bytes` uncompressed bytes.
+class SnappyOutputBuffer : public WritableFile {
  public:
   // Create an SnappyOutputBuffer for `file` with two buffers that cache the
   // 1. input data to be deflated
@@ -65,7 +66,16 @@ class SnappyOutputBuffer {
 
   // Compresses any cached input and writes all output to file. This must be
   // called before the destructor to avoid any data loss.
-  Status Flush();
+  Status Flush() override;
+
+  // Same as `Write`.
+  Status Append(const StringPiece& data) override;
+
+  // Same as `Flush`. Does *not* close `file`.
+  Status Close() override;
+
+  // Compresses any cached input, writes all output to file and syncs it.
+  Status Sync() override;
 
  private:
   // Appends `data` to `input_buffer_`.
@@ -0,0 +1,50 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/common_shape_fns.h"
+#include "tensorflow/core/framework/op.h"
+
+namespace tensorflow {
+
+REGISTER_OP("AllReduce")
+    .Input("input: T")
+    .Output("output: T")
+    .Attr("T: {float, double, int32, int64}")
+    .Attr("reduction: {'sum', 'prod', 'max', 'min'} = 'sum'")
+    .Attr("group_key: string")
+    .Attr("chunk_bytes: int >= 1 = 4194304")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::UnchangedShape)
+    .Doc(R"doc(
+Reduces the inputs of all the AllReduce nodes of a group across devices.
+
+The group consists of the AllReduce nodes with the same `group_key` which
+run in a step, each on a different device, and each of them outputs the
+elementwise reduction of the inputs of all of them. The inputs must have the
+same shape.
+
+The devices exchange the tensors over a ring, through the rendezvous of the
+step, so that each of them sends and receives about twice the size of the
+tensor whatever the size of the group. The tensor is split into chunks of at
+most `chunk_bytes` bytes which go around the ring concurrently.
+
+input: The tensor to reduce.
+output: The reduction of the inputs of the group.
+reduction: The reduction to apply.
+group_key: Identifies the AllReduce nodes which reduce their inputs together.
+chunk_bytes: The maximum size of the pieces of the tensor sent at once.
+)doc");
+
+}  // namespace tensorflow
@@ -350,6 +350,55 @@ acceptable_fraction: The minimum required fraction of lines before a truncated
 image: 3-D with shape `[height, width, channels]`..
 )doc");
 
+// --------------------------------------------------------------------------
+REGISTER_OP("DecodeAndResizeJpegBatch")
+    .Input("contents: string")
+    .Input("size: int32")
+    .Attr("channels: int = 3")
+    .Attr("fancy_upscaling: bool = true")
+    .Attr("try_recover_truncated: bool = false")
+    .Attr("acceptable_fraction: float = 1.0")
+    .Attr("align_corners: bool = false")
+    .Output("images: float")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle contents;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 1, &contents));
+      int32 channels;
+      TF_RETURN_IF_ERROR(c->GetAttr("channels", &channels));
+      if (channels != 1 && channels != 3) {
+        return errors::InvalidArgument("channels must be 1 or 3, got ",
+                                       channels);
+      }
+      return SetOutputToSizedImage(c, c->Dim(contents, 0),
+                                   1 /* size_input_idx */,
+                                   c->MakeDim(channels));
+    })
+    .Doc(R"doc(
+Decode a batch of JPEG-encoded images and resize them to `size`.
+
+The images are decoded in parallel, and each one is resized with bilinear
+interpolation into its slice of a single output tensor.  Images larger than
+`size` are downscaled by a factor of 2, 4 or 8 during decoding when they remain
+at least as large as `size`, which is much faster than decoding them at full
+resolution.  The result is then close to, but not exactly the same as, the
+result of `DecodeJpeg` followed by `ResizeBilinear`.
+
+contents: 1-D.  The JPEG-encoded images.
+size: A 1-D int32 Tensor of 2 elements: `new_height, new_width`.  The
+  new size for the images.
+channels: Number of color channels for the decoded images, 1 (grayscale) or
+  3 (RGB).
+fancy_upscaling: If true use a slower but nicer upscaling of the
+  chroma planes (yuv420/422 only).
+try_recover_truncated:  If true try to recover an image from truncated input.
+acceptable_fraction: The minimum required fraction of lines before a truncated
+  input is accepted.
+align_corners: If true, rescale input by (new_height - 1) / (height - 1), which
+  exactly aligns the 4 corners of images and resized images. If false, rescale
+  by new_height / height. Treat similarly the width dimension.
+images: 4-D with shape `[batch, new_height, new_width, channels]`.
+)doc");
+
 // --------------------------------------------------------------------------
 REGISTER_OP("EncodeJpeg")
     .Input("image: uint8")
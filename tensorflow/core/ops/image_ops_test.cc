@@ -91,6 +91,41 @@ TEST(ImageOpsTest, DecodeImage_ShapeFn) {
   }
 }
 
+TEST(ImageOpsTest, DecodeAndResizeJpegBatch_ShapeFn) {
+  ShapeInferenceTestOp op("DecodeAndResizeJpegBatch");
+  op.input_tensors.resize(2);
+  TF_ASSERT_OK(NodeDefBuilder("test", "DecodeAndResizeJpegBatch")
+                   .Input({"a", 0, DT_STRING})
+                   .Input({"b", 0, DT_INT32})
+                   .Finalize(&op.node_def));
+
+  // Rank and size checks.
+  INFER_ERROR("Shape must be rank 1 but is rank 0", op, "[];?");
+  INFER_ERROR("Shape must be rank 1 but is rank 0", op, "?;[]");
+  INFER_ERROR("Dimension must be 2 but is 3", op, "?;[3]");
+
+  // The channels default to 3.
+  INFER_OK(op, "[5];[2]", "[d0_0,?,?,3]");
+
+  Tensor size_tensor = test::AsTensor<int32>({20, 30});
+  op.input_tensors[1] = &size_tensor;
+  INFER_OK(op, "[5];[2]", "[d0_0,20,30,3]");
+
+  TF_ASSERT_OK(NodeDefBuilder("test", "DecodeAndResizeJpegBatch")
+                   .Input({"a", 0, DT_STRING})
+                   .Input({"b", 0, DT_INT32})
+                   .Attr("channels", 1)
+                   .Finalize(&op.node_def));
+  INFER_OK(op, "?;[2]", "[?,20,30,1]");
+
+  TF_ASSERT_OK(NodeDefBuilder("test", "DecodeAndResizeJpegBatch")
+                   .Input({"a", 0, DT_STRING})
+                   .Input({"b", 0, DT_INT32})
+                   .Attr("channels", 4)
+                   .Finalize(&op.node_def));
+  INFER_ERROR("channels must be 1 or 3, got 4", op, "?;[2]");
+}
+
 TEST(ImageOpsTest, EncodeImage_ShapeFn) {
   for (const char* op_name : {"EncodeJpeg", "EncodePng"}) {
     ShapeInferenceTestOp op(op_name);
@@ -420,16 +420,31 @@ REGISTER_OP("TFRecordReader")
     .Attr("container: string = ''")
     .Attr("shared_name: string = ''")
     .Attr("compression_type: string = ''")
+    .Attr("num_parallel_files: int = 1")
+    .Attr("prefetch_buffer_bytes: int = 0")
     .SetIsStateful()
     .SetShapeFn(TwoElementOutput)
     .Doc(R"doc(
 A Reader that outputs the records from a TensorFlow Records file.
 
+With `num_parallel_files` > 1, the reader keeps up to that many files of its
+queue open and outputs their records in turn.  It then only waits for the
+queue when no file is open, and should not share its queue with other readers:
+if another reader empties a closed queue first, the reader may report
+OutOfRange while files are still open.  With `num_parallel_files` > 1 or
+`prefetch_buffer_bytes` > 0, the records are read ahead on background threads,
+and the reader supports serializing and restoring its state.
+
 reader_handle: The handle to reference the Reader.
 container: If non-empty, this reader is placed in the given container.
         Otherwise, a default container is used.
 shared_name: If non-empty, this reader is named in the given bucket
              with this shared_name. Otherwise, the node name is used instead.
+compression_type: The compression of the files: "", "ZLIB", "GZIP" or
+  "SNAPPY".
+num_parallel_files: The number of files whose records are interleaved.
+prefetch_buffer_bytes: The number of bytes of records read ahead, over all
+  the open files.  At least one record per file is read ahead.
 )doc");
 
 REGISTER_OP("IdentityReader")
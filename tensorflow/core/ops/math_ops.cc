@@ -49,6 +49,37 @@ inputs: Must all be the same size and shape.
 
 // --------------------------------------------------------------------------
 
+REGISTER_OP("_FusedElementwise")
+    .Input("inputs: N * T")
+    .Output("y: T")
+    .Attr("N: int >= 1")
+    .Attr("T: {float, double}")
+    .Attr("ops: list(string) >= 1")
+    .Attr("operands: list(int) >= 2")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle cur = c->input(0);
+      for (int i = 1; i < c->num_inputs(); ++i) {
+        TF_RETURN_WITH_CONTEXT_IF_ERROR(c->Merge(c->input(i), cur, &cur),
+                                        "From merging shape ", i,
+                                        " with other shapes.");
+      }
+      c->set_output(0, cur);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Evaluates a chain of elementwise ops in a single pass over its inputs.
+
+Created by the elementwise fusion graph optimization. Op i of the chain is
+the elementwise op named ops[i], applied to the values numbered
+operands[2 * i] and operands[2 * i + 1]; the latter is -1 for unary ops.
+Values 0 to N - 1 are the inputs, and value N + j is the result of op j < i.
+y is the result of the last op.
+
+inputs: Must all be the same size and shape.
+)doc");
+
+// --------------------------------------------------------------------------
+
 REGISTER_OP("BatchMatMul")
     .Input("x: T")
     .Input("y: T")
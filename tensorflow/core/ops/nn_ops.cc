@@ -701,6 +701,50 @@ strides: 1-D of length 4.  The stride of the sliding window for each dimension
 padding: The type of padding algorithm to use.
  )doc");
 
+REGISTER_OP("FusedConv2DBiasActivation")
+    .Input("input: T")
+    .Input("filter: T")
+    .Input("bias: T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .Attr("strides: list(int)")
+    .Attr(GetPaddingAttrString())
+    .Attr("activation: {'Relu', 'Relu6', 'None'} = 'Relu'")
+    .SetShapeFn([](InferenceContext* c) {
+      TF_RETURN_IF_ERROR(shape_inference::Conv2DShape(c));
+      ShapeHandle bias;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &bias));
+      DimensionHandle out_depth;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(c->output(0), 3), c->Dim(bias, 0), &out_depth));
+      ShapeHandle output;
+      TF_RETURN_IF_ERROR(
+          c->ReplaceDim(c->output(0), 3, out_depth, &output));
+      c->set_output(0, output);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Computes `activation(conv2d(input, filter) + bias)` in a single pass.
+
+The bias addition and the activation are applied to each block of the
+convolution result right after the matrix multiply that produces it, while it
+is still in the CPU caches, instead of writing the whole convolution result
+out and reading it back twice. This is equivalent to a Conv2D, BiasAdd and
+Relu (or Relu6) sequence in 'NHWC' order, and is substituted for it by the
+fuse_convolutions graph transform.
+The data_format attribute for Conv2D isn't supported by this op, and 'NHWC'
+order is used instead.
+
+input: 4-D with shape `[batch, in_height, in_width, in_channels]`.
+filter: 4-D with shape
+  `[filter_height, filter_width, in_channels, out_channels]`.
+bias: 1-D with size `out_channels`.
+strides: 1-D of length 4.  The stride of the sliding window for each dimension
+   of `input`.
+padding: The type of padding algorithm to use.
+activation: The activation to apply after the bias, or 'None'.
+ )doc");
+
 // --------------------------------------------------------------------------
 
 REGISTER_OP("DepthwiseConv2dNative")
@@ -270,6 +270,125 @@ feature_list_sparse_types: A list of Nfeature_list_sparse types; the data types
   DT_INT64 (Int64List), and DT_STRING (BytesList).
 )doc");
 
+REGISTER_OP("ParseSequenceExample")
+    .Input("serialized: string")
+    .Input("feature_list_dense_missing_assumed_empty: string")
+    .Input("context_sparse_keys: Ncontext_sparse * string")
+    .Input("context_dense_keys: Ncontext_dense * string")
+    .Input("feature_list_sparse_keys: Nfeature_list_sparse * string")
+    .Input("feature_list_dense_keys: Nfeature_list_dense * string")
+    .Input("context_dense_defaults: Tcontext_dense")
+    .Input("debug_name: string")
+    .Output("context_sparse_indices: Ncontext_sparse * int64")
+    .Output("context_sparse_values: context_sparse_types")
+    .Output("context_sparse_shapes: Ncontext_sparse * int64")
+    .Output("context_dense_values: Tcontext_dense")
+    .Output("feature_list_sparse_indices: Nfeature_list_sparse * int64")
+    .Output("feature_list_sparse_values: feature_list_sparse_types")
+    .Output("feature_list_sparse_shapes: Nfeature_list_sparse * int64")
+    .Output("feature_list_dense_values: feature_list_dense_types")
+    .Output("feature_list_dense_lengths: Nfeature_list_dense * int64")
+    .Attr("Ncontext_sparse: int >= 0 = 0")
+    .Attr("Ncontext_dense: int >= 0 = 0")
+    .Attr("Nfeature_list_sparse: int >= 0 = 0")
+    .Attr("Nfeature_list_dense: int >= 0 = 0")
+    .Attr("context_sparse_types: list({float,int64,string}) >= 0 = []")
+    .Attr("Tcontext_dense: list({float,int64,string}) >= 0 = []")
+    .Attr("feature_list_dense_types: list({float,int64,string}) >= 0 = []")
+    .Attr("context_dense_shapes: list(shape) >= 0 = []")
+    .Attr("feature_list_sparse_types: list({float,int64,string}) >= 0 = []")
+    .Attr("feature_list_dense_shapes: list(shape) >= 0 = []")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      ParseSingleSequenceExampleAttrs attrs;
+      TF_RETURN_IF_ERROR(attrs.Init(c));
+
+      ShapeHandle input;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 1, &input));
+      ShapeHandle batch = c->Vector(c->Dim(input, 0));
+
+      // feature_list_dense_missing_assumed_empty
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &unused));
+
+      int output_idx = 0;
+
+      // Output context_sparse_indices, context_sparse_values, and
+      // context_sparse_shapes.
+      for (int i = 0; i < attrs.num_context_sparse; ++i) {
+        c->set_output(output_idx++, c->Matrix(c->UnknownDim(), 2));
+      }
+      for (int i = 0; i < attrs.num_context_sparse; ++i) {
+        c->set_output(output_idx++, c->Vector(c->UnknownDim()));
+      }
+      for (int i = 0; i < attrs.num_context_sparse; ++i) {
+        c->set_output(output_idx++, c->Vector(2));
+      }
+
+      // Output context_dense_values.
+      TensorShapeProto shape_proto;
+      for (int i = 0; i < attrs.num_context_dense; ++i) {
+        attrs.context_dense_shapes[i].AsProto(&shape_proto);
+        ShapeHandle s;
+        TF_RETURN_IF_ERROR(c->MakeShapeFromShapeProto(shape_proto, &s));
+        TF_RETURN_IF_ERROR(c->Concatenate(batch, s, &s));
+        c->set_output(output_idx++, s);
+      }
+
+      // Output feature_list_sparse_indices, feature_list_sparse_values,
+      // feature_list_sparse_shapes.
+      for (int i = 0; i < attrs.num_feature_list_sparse; ++i) {
+        c->set_output(output_idx++, c->Matrix(c->UnknownDim(), 3));
+      }
+      for (int i = 0; i < attrs.num_feature_list_sparse; ++i) {
+        c->set_output(output_idx++, c->Vector(c->UnknownDim()));
+      }
+      for (int i = 0; i < attrs.num_feature_list_sparse; ++i) {
+        c->set_output(output_idx++, c->Vector(3));
+      }
+
+      // Output feature_list_dense_values.
+      for (int i = 0; i < attrs.num_feature_list_dense; ++i) {
+        attrs.feature_list_dense_shapes[i].AsProto(&shape_proto);
+        ShapeHandle s;
+        TF_RETURN_IF_ERROR(c->MakeShapeFromShapeProto(shape_proto, &s));
+        TF_RETURN_IF_ERROR(
+            c->Concatenate(c->Vector(InferenceContext::kUnknownDim), s, &s));
+        TF_RETURN_IF_ERROR(c->Concatenate(batch, s, &s));
+        c->set_output(output_idx++, s);
+      }
+
+      // Output feature_list_dense_lengths.
+      for (int i = 0; i < attrs.num_feature_list_dense; ++i) {
+        c->set_output(output_idx++, batch);
+      }
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Transforms a vector of brain.SequenceExample protos (as strings) into typed
+tensors.
+
+This is the batched version of ParseSingleSequenceExample, and takes the same
+inputs and attributes, except for serialized and debug_name. The outputs have
+an additional leading batch dimension:
+- context_dense_values[j] has shape [B] + context_dense_shapes[j].
+- context sparse tensors have rank 2: [B, max number of values].
+- feature_list_dense_values[j] has shape [B, T] + feature_list_dense_shapes[j],
+  where T is the length of the longest FeatureList of the batch. Shorter lists
+  are padded with zeros, or empty strings for DT_STRING.
+- feature list sparse tensors have rank 3: [B, max number of steps,
+  max number of values in a step].
+
+serialized: A vector containing binary serialized SequenceExample protos.
+debug_name: A vector containing the names of the serialized protos.
+  May contain, for example, table key (descriptive) name for the
+  corresponding serialized proto.  This is purely useful for debugging
+  purposes, and the presence of values here has no effect on the output.
+  May also be an empty vector if no names are available.
+feature_list_dense_lengths: A list of Nfeature_list_dense vectors holding the
+  number of steps of each FeatureList given in feature_list_dense_keys, for
+  each example.
+)doc");
+
 REGISTER_OP("ParseTensor")
     .Input("serialized: string")
     .Output("output: out_type")
@@ -186,4 +186,52 @@ TEST(ParsingOpsTest, ParseSingleSequenceExample_ShapeFn) {
               "?;?;?;?;?;?;?;?");
 }
 
+TEST(ParsingOpsTest, ParseSequenceExample_ShapeFn) {
+  ShapeInferenceTestOp op("ParseSequenceExample");
+  auto set_outputs = [&op](int num_context_sparse, int num_context_dense,
+                           int num_feature_list_sparse,
+                           int num_feature_list_dense) {
+    using NodeOutList = std::vector<NodeDefBuilder::NodeOut>;
+    using DataTypeList = std::vector<DataType>;
+    NodeDefBuilder::NodeOut string_in{"a", 0, DT_STRING};
+
+    TF_ASSERT_OK(
+        NodeDefBuilder("test", "ParseSequenceExample")
+            .Input("serialized", 0, DT_STRING)
+            .Input("feature_list_dense_missing_assumed_empty", 0, DT_STRING)
+            .Input(NodeOutList(num_context_sparse, string_in))
+            .Input(NodeOutList(num_context_dense, string_in))
+            .Input(NodeOutList(num_feature_list_sparse, string_in))
+            .Input(NodeOutList(num_feature_list_dense, string_in))
+            .Input(NodeOutList(num_context_dense, string_in))
+            .Input("debug_name", 0, DT_STRING)
+            .Attr("context_sparse_types",
+                  DataTypeList(num_context_sparse, DT_FLOAT))
+            .Attr("context_dense_shapes",
+                  MakeDenseShapes(num_context_dense, false))
+            .Attr("feature_list_sparse_types",
+                  DataTypeList(num_feature_list_sparse, DT_FLOAT))
+            .Attr("feature_list_dense_types",
+                  DataTypeList(num_feature_list_dense, DT_FLOAT))
+            .Attr("feature_list_dense_shapes",
+                  MakeDenseShapes(num_feature_list_dense, false))
+            .Finalize(&op.node_def));
+  };
+
+  // Verify inputs 'serialized' and 'feature_list_dense_missing_assumed_empty'.
+  set_outputs(0, 0, 0, 0);
+  INFER_OK(op, "?;?;?", "");
+  INFER_OK(op, "[5];[20];?", "");
+  INFER_ERROR("must be rank 1", op, "[];?;?");
+  INFER_ERROR("must be rank 1", op, "?;[2,3];?");
+
+  set_outputs(2, 3, 2, 3);
+  INFER_OK(op, "[5];?;?;?;?;?;?;?;?;?;?;?;?;?;?;?",
+           ("[?,2];[?,2];[?];[?];[2];[2];"           // context sparse outputs
+            "[d0_0,1];[d0_0,1,2];[d0_0,1,2,3];"      // context dense outputs
+            "[?,3];[?,3];[?];[?];[3];[3];"           // feature_list sparse
+            "[d0_0,?,1];[d0_0,?,1,2];[d0_0,?,1,2,3];"  // feature_list dense
+            "[d0_0];[d0_0];[d0_0]"));                  // lengths
+}
+
 }  // end namespace tensorflow
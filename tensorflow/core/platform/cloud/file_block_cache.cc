@@ -0,0 +1,93 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/platform/cloud/file_block_cache.h"
+
+namespace tensorflow {
+
+std::shared_ptr<const string> FileBlockCache::Lookup(const string& key,
+                                                     uint64 block) {
+  mutex_lock lock(mu_);
+  return LookupLocked(std::make_pair(key, block));
+}
+
+std::shared_ptr<const string> FileBlockCache::LookupOrClaim(const string& key,
+                                                            uint64 block,
+                                                            bool* claimed) {
+  mutex_lock lock(mu_);
+  const BlockId id = std::make_pair(key, block);
+  std::shared_ptr<const string> data = LookupLocked(id);
+  *claimed = data == nullptr && fetching_.insert(id).second;
+  return data;
+}
+
+void FileBlockCache::FinishFetch(const string& key, uint64 block) {
+  mutex_lock lock(mu_);
+  fetching_.erase(std::make_pair(key, block));
+  fetch_done_.notify_all();
+}
+
+std::shared_ptr<const string> FileBlockCache::WaitForFetch(const string& key,
+                                                           uint64 block) {
+  mutex_lock lock(mu_);
+  const BlockId id = std::make_pair(key, block);
+  while (fetching_.count(id) > 0) {
+    fetch_done_.wait(lock);
+  }
+  return LookupLocked(id);
+}
+
+void FileBlockCache::Insert(const string& key, uint64 block,
+                            std::shared_ptr<const string> data) {
+  mutex_lock lock(mu_);
+  const BlockId id = std::make_pair(key, block);
+  auto it = blocks_.find(id);
+  if (it != blocks_.end()) {
+    EraseLocked(it);
+  }
+  if (data->size() > max_bytes_) {
+    return;
+  }
+  while (cache_size_ + data->size() > max_bytes_) {
+    EraseLocked(blocks_.find(lru_list_.back()));
+  }
+  cache_size_ += data->size();
+  lru_list_.push_front(id);
+  Entry& entry = blocks_[id];
+  entry.data = std::move(data);
+  entry.lru_position = lru_list_.begin();
+}
+
+size_t FileBlockCache::CacheSize() const {
+  mutex_lock lock(mu_);
+  return cache_size_;
+}
+
+std::shared_ptr<const string> FileBlockCache::LookupLocked(const BlockId& id) {
+  auto it = blocks_.find(id);
+  if (it == blocks_.end()) {
+    return nullptr;
+  }
+  lru_list_.splice(lru_list_.begin(), lru_list_, it->second.lru_position);
+  return it->second.data;
+}
+
+void FileBlockCache::EraseLocked(std::map<BlockId, Entry>::iterator it) {
+  cache_size_ -= it->second.data->size();
+  lru_list_.erase(it->second.lru_position);
+  blocks_.erase(it);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,115 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_PLATFORM_CLOUD_FILE_BLOCK_CACHE_H_
+#define TENSORFLOW_CORE_PLATFORM_CLOUD_FILE_BLOCK_CACHE_H_
+
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+/// \brief A size-bounded LRU cache of fixed-size blocks of files.
+///
+/// The blocks are identified by a key, which should identify both the file
+/// and its version, and by their index in the file. The cache can be shared
+/// by all the files of a file system. Thread-safe.
+///
+/// The cache also tracks the blocks being fetched, so that concurrent readers
+/// of a missing block fetch it only once: the first one claims the fetch with
+/// LookupOrClaim() and the others wait for it with WaitForFetch().
+class FileBlockCache {
+ public:
+  FileBlockCache(size_t block_size, size_t max_bytes)
+      : block_size_(block_size), max_bytes_(max_bytes) {}
+
+  /// The size of the blocks, except for the last block of a file which may
+  /// be shorter.
+  size_t block_size() const { return block_size_; }
+
+  /// \brief Looks up a block, and marks it as the most recently used.
+  ///
+  /// Returns nullptr if the block is not cached. The returned block remains
+  /// valid after it is evicted from the cache.
+  std::shared_ptr<const string> Lookup(const string& key, uint64 block);
+
+  /// \brief Looks up a block like Lookup(), and claims its fetch if it is
+  /// neither cached nor being fetched.
+  ///
+  /// '*claimed' is set to true if the caller must fetch the block, and then
+  /// call FinishFetch(). It is set to false if the block is returned, or if
+  /// another reader is fetching it.
+  std::shared_ptr<const string> LookupOrClaim(const string& key, uint64 block,
+                                              bool* claimed);
+
+  /// Ends the fetch of a block claimed by LookupOrClaim(), after the block
+  /// was inserted if the fetch succeeded, and wakes up its waiters.
+  void FinishFetch(const string& key, uint64 block);
+
+  /// \brief Waits until the block is not being fetched, and then looks it up.
+  ///
+  /// Returns nullptr if the fetch failed, or if the block was not cached.
+  std::shared_ptr<const string> WaitForFetch(const string& key, uint64 block);
+
+  /// \brief Adds a block, evicting the least recently used ones to keep
+  /// the cache within its maximum size.
+  ///
+  /// Replaces the block if it is already cached. Blocks larger than the
+  /// maximum size are not cached.
+  void Insert(const string& key, uint64 block,
+              std::shared_ptr<const string> data);
+
+  /// The total size of the cached blocks.
+  size_t CacheSize() const;
+
+ private:
+  typedef std::pair<string, uint64> BlockId;
+  struct Entry {
+    std::shared_ptr<const string> data;
+    // The position of the block in lru_list_.
+    std::list<BlockId>::iterator lru_position;
+  };
+
+  std::shared_ptr<const string> LookupLocked(const BlockId& id)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void EraseLocked(std::map<BlockId, Entry>::iterator it)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const size_t block_size_;
+  const size_t max_bytes_;
+
+  mutable mutex mu_;
+  std::map<BlockId, Entry> blocks_ GUARDED_BY(mu_);
+  // The cached blocks, most recently used first.
+  std::list<BlockId> lru_list_ GUARDED_BY(mu_);
+  size_t cache_size_ GUARDED_BY(mu_) = 0;
+  // The blocks claimed by LookupOrClaim() and not yet finished.
+  std::set<BlockId> fetching_ GUARDED_BY(mu_);
+  condition_variable fetch_done_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FileBlockCache);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_PLATFORM_CLOUD_FILE_BLOCK_CACHE_H_
@@ -0,0 +1,120 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/platform/cloud/file_block_cache.h"
+#include <memory>
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+std::shared_ptr<const string> Block(const string& data) {
+  return std::make_shared<const string>(data);
+}
+
+TEST(FileBlockCacheTest, LookupAndInsert) {
+  FileBlockCache cache(4, 100);
+  EXPECT_EQ(4, cache.block_size());
+  EXPECT_EQ(nullptr, cache.Lookup("a", 0));
+
+  cache.Insert("a", 0, Block("0123"));
+  cache.Insert("a", 1, Block("45"));
+  cache.Insert("b", 0, Block("abcd"));
+  EXPECT_EQ("0123", *cache.Lookup("a", 0));
+  EXPECT_EQ("45", *cache.Lookup("a", 1));
+  EXPECT_EQ("abcd", *cache.Lookup("b", 0));
+  EXPECT_EQ(nullptr, cache.Lookup("b", 1));
+  EXPECT_EQ(10, cache.CacheSize());
+
+  // Inserting an existing block replaces it.
+  cache.Insert("a", 1, Block("4567"));
+  EXPECT_EQ("4567", *cache.Lookup("a", 1));
+  EXPECT_EQ(12, cache.CacheSize());
+}
+
+TEST(FileBlockCacheTest, EvictsLeastRecentlyUsed) {
+  FileBlockCache cache(4, 12);
+  cache.Insert("a", 0, Block("0123"));
+  cache.Insert("a", 1, Block("4567"));
+  cache.Insert("a", 2, Block("89ab"));
+  // Block 0 becomes the most recently used, so block 1 is evicted.
+  ASSERT_NE(nullptr, cache.Lookup("a", 0));
+  std::shared_ptr<const string> block1 = cache.Lookup("a", 1);
+  cache.Lookup("a", 0);
+  cache.Lookup("a", 2);
+  cache.Insert("a", 3, Block("cdef"));
+  EXPECT_EQ(nullptr, cache.Lookup("a", 1));
+  EXPECT_NE(nullptr, cache.Lookup("a", 0));
+  EXPECT_NE(nullptr, cache.Lookup("a", 2));
+  EXPECT_NE(nullptr, cache.Lookup("a", 3));
+  EXPECT_EQ(12, cache.CacheSize());
+  // Evicted blocks remain valid for their users.
+  EXPECT_EQ("4567", *block1);
+}
+
+TEST(FileBlockCacheTest, BlockLargerThanCache) {
+  FileBlockCache cache(8, 4);
+  cache.Insert("a", 0, Block("0123"));
+  cache.Insert("a", 1, Block("456789"));
+  EXPECT_EQ(nullptr, cache.Lookup("a", 1));
+  EXPECT_EQ("0123", *cache.Lookup("a", 0));
+  EXPECT_EQ(4, cache.CacheSize());
+}
+
+TEST(FileBlockCacheTest, ClaimsFetches) {
+  FileBlockCache cache(4, 100);
+  bool claimed;
+  EXPECT_EQ(nullptr, cache.LookupOrClaim("a", 0, &claimed));
+  EXPECT_TRUE(claimed);
+  // The block is being fetched, so it is not claimed again.
+  EXPECT_EQ(nullptr, cache.LookupOrClaim("a", 0, &claimed));
+  EXPECT_FALSE(claimed);
+
+  // A reader waits for the fetch, and gets the block it inserted.
+  Notification waited;
+  std::shared_ptr<const string> waited_block;
+  std::unique_ptr<Thread> waiter(Env::Default()->StartThread(
+      {}, "waiter", [&cache, &waited, &waited_block]() {
+        waited_block = cache.WaitForFetch("a", 0);
+        waited.Notify();
+      }));
+  Env::Default()->SleepForMicroseconds(10000);
+  EXPECT_FALSE(waited.HasBeenNotified());
+  cache.Insert("a", 0, Block("0123"));
+  cache.FinishFetch("a", 0);
+  waited.WaitForNotification();
+  ASSERT_NE(nullptr, waited_block);
+  EXPECT_EQ("0123", *waited_block);
+
+  EXPECT_EQ("0123", *cache.LookupOrClaim("a", 0, &claimed));
+  EXPECT_FALSE(claimed);
+}
+
+TEST(FileBlockCacheTest, FailedFetch) {
+  FileBlockCache cache(4, 100);
+  bool claimed;
+  cache.LookupOrClaim("a", 1, &claimed);
+  ASSERT_TRUE(claimed);
+  // The fetch failed, so the block is missing and can be claimed again.
+  cache.FinishFetch("a", 1);
+  EXPECT_EQ(nullptr, cache.WaitForFetch("a", 1));
+  EXPECT_EQ(nullptr, cache.LookupOrClaim("a", 1, &claimed));
+  EXPECT_TRUE(claimed);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -21,14 +21,18 @@ limitations under the License.
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <set>
 #include <vector>
 #include "include/json/json.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/gtl/stl_util.h"
 #include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/cloud/google_auth_provider.h"
 #include "tensorflow/core/platform/cloud/time_util.h"
 #include "tensorflow/core/platform/env.h"
@@ -51,6 +55,21 @@ constexpr int kGetChildrenDefaultPageSize = 1000;
 constexpr uint64 kUploadRetryDelayMicros = 1000000L;
 // The HTTP response code "308 Resume Incomplete".
 constexpr uint64 HTTP_CODE_RESUME_INCOMPLETE = 308;
+// The environment variables which enable the block cache of the default
+// file system. Setting either of them to 0 disables the cache.
+constexpr char kReadCacheBlockSizeMb[] = "GCS_READ_CACHE_BLOCK_SIZE_MB";
+constexpr char kReadCacheMaxSizeMb[] = "GCS_READ_CACHE_MAX_SIZE_MB";
+// The number of blocks a read fetches concurrently in the default file system.
+constexpr int32 kDefaultMaxParallelReads = 8;
+// The environment variable which enables the composite uploads of the default
+// file system, and the number of parts each file uploads concurrently.
+constexpr char kUploadPartSizeMb[] = "GCS_UPLOAD_PART_SIZE_MB";
+constexpr int32 kDefaultMaxParallelUploads = 8;
+// The prefix of the temporary objects holding the parts of composite uploads,
+// which are named after their object and upload id.
+constexpr char kUploadPartPrefix[] = ".gcs_upload_parts/";
+// The maximum number of objects a single GCS compose request accepts.
+constexpr size_t kMaxComposeSources = 32;
 
 // The file statistics returned by Stat() for directories.
 const FileStatistics DIRECTORY_STAT(0, 0, true);
@@ -146,6 +165,24 @@ Status ParseJson(StringPiece json, Json::Value* result) {
   return Status::OK();
 }
 
+/// Returns the number of bytes in the environment variable 'name', which
+/// holds a number of megabytes, or 0 if it is unset. Invalid values are
+/// logged and also read as 0.
+uint64 GetEnvMegabytes(const char* name) {
+  const char* value = std::getenv(name);
+  if (value == nullptr) {
+    return 0;
+  }
+  uint64 megabytes;
+  if (!strings::safe_strtou64(value, &megabytes) ||
+      megabytes > kuint64max / (1024 * 1024)) {
+    LOG(WARNING) << "Ignoring " << name << "=" << value
+                 << ", which is not a number of megabytes.";
+    return 0;
+  }
+  return megabytes * 1024 * 1024;
+}
+
 /// Reads a JSON value with the given name from a parent JSON value.
 Status GetValue(const Json::Value& parent, const string& name,
                 Json::Value* result) {
@@ -300,6 +337,180 @@ class GcsRandomAccessFile : public RandomAccessFile {
   mutable bool buffer_reached_eof_ GUARDED_BY(mu_) = false;
 };
 
+/// \brief A GCS-based implementation of a random access file which reads
+/// through a block cache shared by all files.
+///
+/// The blocks are cached by object generation, so that the file always sees
+/// the version of the object it was opened for.
+class GcsBlockCachedRandomAccessFile : public RandomAccessFile {
+ public:
+  GcsBlockCachedRandomAccessFile(const string& bucket, const string& object,
+                                 uint64 size, const string& generation,
+                                 AuthProvider* auth_provider,
+                                 HttpRequest::Factory* http_request_factory,
+                                 FileBlockCache* block_cache,
+                                 thread::ThreadPool* read_pool)
+      : bucket_(bucket),
+        object_(object),
+        size_(size),
+        generation_(generation),
+        cache_key_(strings::StrCat(bucket, "/", object, "#", generation)),
+        auth_provider_(auth_provider),
+        http_request_factory_(http_request_factory),
+        block_cache_(block_cache),
+        read_pool_(read_pool) {}
+
+  /// Reads the cached blocks, and fetches the missing ones. Thread-safe.
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    const size_t block_size = block_cache_->block_size();
+    size_t copied = 0;
+    if (n > 0 && offset < size_) {
+      const uint64 first_block = offset / block_size;
+      const uint64 last_block =
+          (std::min<uint64>(offset + n, size_) - 1) / block_size;
+      std::vector<std::shared_ptr<const string>> blocks;
+      std::vector<uint64> claimed_blocks;
+      std::vector<uint64> pending_blocks;
+      for (uint64 block = first_block; block <= last_block; ++block) {
+        bool claimed;
+        blocks.push_back(
+            block_cache_->LookupOrClaim(cache_key_, block, &claimed));
+        if (claimed) {
+          claimed_blocks.push_back(block);
+        } else if (!blocks.back()) {
+          pending_blocks.push_back(block);
+        }
+      }
+      // The claimed fetches are finished even if they failed, so that the
+      // readers waiting for them fetch the blocks themselves.
+      const Status status = FetchBlocks(claimed_blocks, first_block, &blocks);
+      for (uint64 block : claimed_blocks) {
+        block_cache_->FinishFetch(cache_key_, block);
+      }
+      TF_RETURN_IF_ERROR(status);
+
+      // The blocks which other readers are fetching are waited for, and
+      // fetched again if they are still missing.
+      std::vector<uint64> missing_blocks;
+      for (uint64 block : pending_blocks) {
+        blocks[block - first_block] =
+            block_cache_->WaitForFetch(cache_key_, block);
+        if (!blocks[block - first_block]) {
+          missing_blocks.push_back(block);
+        }
+      }
+      TF_RETURN_IF_ERROR(FetchBlocks(missing_blocks, first_block, &blocks));
+
+      for (const auto& block : blocks) {
+        const size_t offset_in_block = (offset + copied) % block_size;
+        if (offset_in_block >= block->size()) {
+          break;
+        }
+        const size_t copy_size =
+            std::min(n - copied, block->size() - offset_in_block);
+        std::memcpy(scratch + copied, block->data() + offset_in_block,
+                    copy_size);
+        copied += copy_size;
+        if (block->size() < block_size) {
+          // The object is shorter than its metadata said.
+          break;
+        }
+      }
+    }
+    *result = StringPiece(scratch, copied);
+
+    if (result->size() < n) {
+      // This is not an error per se. The RandomAccessFile interface expects
+      // that Read returns OutOfRange if fewer bytes were read than requested.
+      return errors::OutOfRange("EOF reached, ", result->size(),
+                                " bytes were read out of ", n,
+                                " bytes requested.");
+    }
+    return Status::OK();
+  }
+
+ private:
+  /// \brief Downloads the given blocks concurrently and adds them to the
+  /// cache and to 'blocks', which starts with block 'first_block'.
+  Status FetchBlocks(const std::vector<uint64>& missing_blocks,
+                     uint64 first_block,
+                     std::vector<std::shared_ptr<const string>>* blocks) const {
+    if (missing_blocks.empty()) {
+      return Status::OK();
+    }
+    string auth_token;
+    TF_RETURN_IF_ERROR(AuthProvider::GetToken(auth_provider_, &auth_token));
+
+    struct Fetch {
+      std::unique_ptr<HttpRequest> request;
+      std::shared_ptr<string> data;
+      StringPiece result;
+      Status status;
+    };
+    const size_t block_size = block_cache_->block_size();
+    std::vector<Fetch> fetches(missing_blocks.size());
+    for (size_t i = 0; i < fetches.size(); ++i) {
+      Fetch& fetch = fetches[i];
+      const uint64 start = missing_blocks[i] * block_size;
+      const size_t length = std::min<uint64>(block_size, size_ - start);
+      fetch.data = std::make_shared<string>(length, '\0');
+      fetch.request.reset(http_request_factory_->Create());
+      TF_RETURN_IF_ERROR(fetch.request->Init());
+      TF_RETURN_IF_ERROR(fetch.request->SetUri(
+          strings::StrCat("https://", bucket_, ".", kStorageHost, "/",
+                          fetch.request->EscapeString(object_))));
+      TF_RETURN_IF_ERROR(fetch.request->AddAuthBearerHeader(auth_token));
+      TF_RETURN_IF_ERROR(
+          fetch.request->AddHeader("x-goog-if-generation-match", generation_));
+      TF_RETURN_IF_ERROR(fetch.request->SetRange(start, start + length - 1));
+      TF_RETURN_IF_ERROR(fetch.request->SetResultBuffer(
+          &(*fetch.data)[0], length, &fetch.result));
+    }
+
+    // Send the requests from the read threads, and the last one from this
+    // thread.
+    BlockingCounter counter(read_pool_ ? fetches.size() - 1 : 0);
+    for (size_t i = 0; i < fetches.size(); ++i) {
+      Fetch* fetch = &fetches[i];
+      if (read_pool_ && i + 1 < fetches.size()) {
+        read_pool_->Schedule([fetch, &counter]() {
+          fetch->status = fetch->request->Send();
+          counter.DecrementCount();
+        });
+      } else {
+        fetch->status = fetch->request->Send();
+      }
+    }
+    counter.Wait();
+
+    for (size_t i = 0; i < fetches.size(); ++i) {
+      Fetch& fetch = fetches[i];
+      TF_RETURN_WITH_CONTEXT_IF_ERROR(fetch.status, " when reading gs://",
+                                      bucket_, "/", object_);
+      if (fetch.result.data() != fetch.data->data()) {
+        std::memmove(&(*fetch.data)[0], fetch.result.data(),
+                     fetch.result.size());
+      }
+      fetch.data->resize(fetch.result.size());
+      block_cache_->Insert(cache_key_, missing_blocks[i], fetch.data);
+      (*blocks)[missing_blocks[i] - first_block] = std::move(fetch.data);
+    }
+    return Status::OK();
+  }
+
+  const string bucket_;
+  const string object_;
+  const uint64 size_;
+  const string generation_;
+  // Identifies the blocks of this version of the object in the cache.
+  const string cache_key_;
+  AuthProvider* auth_provider_;
+  HttpRequest::Factory* http_request_factory_;
+  FileBlockCache* block_cache_;
+  thread::ThreadPool* read_pool_;
+};
+
 /// \brief GCS-based implementation of a writeable file.
 ///
 /// Since GCS objects are immutable, this implementation writes to a local
@@ -568,6 +779,331 @@ class GcsWritableFile : public WritableFile {
   int32 max_upload_attempts_;
 };
 
+/// \brief GCS-based implementation of a writeable file which uploads the file
+/// while it is being written.
+///
+/// Every 'part_size' bytes appended to the file are uploaded concurrently as
+/// a temporary object. Sync() uploads the remaining bytes as the last part and
+/// composes all the parts into the destination object; the last part is
+/// overwritten once it is full, so all the other parts have 'part_size' bytes.
+/// Flush() uploads nothing more than the full parts.
+///
+/// The parts are named '.gcs_upload_parts/<object>.<upload id>/<index>' in
+/// the bucket of the object, with an upload id of their own for each file.
+/// They are deleted when the file is closed, or when it is destroyed without
+/// having been closed successfully. Only the parts of a process which exits
+/// while writing the file are left behind, and they can be deleted with
+/// their prefix.
+class GcsCompositeWritableFile : public WritableFile {
+ public:
+  GcsCompositeWritableFile(const string& bucket, const string& object,
+                           const string& upload_id,
+                           AuthProvider* auth_provider,
+                           HttpRequest::Factory* http_request_factory,
+                           size_t part_size, int32 max_parallel_uploads,
+                           thread::ThreadPool* upload_pool)
+      : bucket_(bucket),
+        object_(object),
+        part_prefix_(
+            strings::StrCat(kUploadPartPrefix, object, ".", upload_id, "/")),
+        auth_provider_(auth_provider),
+        http_request_factory_(http_request_factory),
+        part_size_(part_size),
+        max_parallel_uploads_(max_parallel_uploads),
+        upload_pool_(upload_pool) {}
+
+  ~GcsCompositeWritableFile() {
+    Close();
+    // The uploads reference this object even if Close() failed.
+    WaitForUploads();
+    if (!closed_) {
+      LOG(WARNING) << "Abandoning the upload of " << GetGcsPath()
+                   << " and deleting its parts.";
+      closed_ = true;
+      DeleteParts();
+    }
+  }
+
+  Status Append(const StringPiece& data) override {
+    TF_RETURN_IF_ERROR(CheckWritable());
+    StringPiece remaining = data;
+    while (!remaining.empty()) {
+      const size_t n = std::min(remaining.size(), part_size_ - buffer_.size());
+      buffer_.append(remaining.data(), n);
+      remaining.remove_prefix(n);
+      synced_ = false;
+      if (buffer_.size() == part_size_) {
+        TF_RETURN_IF_ERROR(UploadBuffer());
+      }
+    }
+    return Status::OK();
+  }
+
+  Status Close() override {
+    if (closed_) {
+      return Status::OK();
+    }
+    TF_RETURN_IF_ERROR(Sync());
+    closed_ = true;
+    DeleteParts();
+    return Status::OK();
+  }
+
+  /// The full parts are already being uploaded, and uploading the bytes of
+  /// the part being filled is left to Sync() and Close().
+  Status Flush() override { return CheckWritable(); }
+
+  /// \brief Makes the current version of the file the content of the GCS
+  /// object.
+  ///
+  /// The parts which failed to upload in the background are uploaded again,
+  /// and if that fails too, they are kept for the next Sync() call.
+  Status Sync() override {
+    TF_RETURN_IF_ERROR(CheckWritable());
+    if (synced_) {
+      return Status::OK();
+    }
+    WaitForUploads();
+
+    std::vector<std::unique_ptr<Part>> failed_parts;
+    {
+      mutex_lock l(mu_);
+      failed_parts.swap(failed_parts_);
+    }
+    Status status;
+    for (auto& part : failed_parts) {
+      if (status.ok()) {
+        status = CreateUploadRequest(part.get());
+        if (status.ok()) {
+          status = part->request->Send();
+        }
+      }
+      if (!status.ok()) {
+        mutex_lock l(mu_);
+        failed_parts_.push_back(std::move(part));
+      }
+    }
+    TF_RETURN_WITH_CONTEXT_IF_ERROR(status, " when uploading ", GetGcsPath());
+
+    int num_parts = num_parts_;
+    if (!buffer_.empty() || num_parts_ == 0) {
+      // The bytes stay in the buffer, and the part is uploaded again under
+      // the same name once it is full.
+      Part tail;
+      tail.index = num_parts_;
+      tail.data = buffer_;
+      TF_RETURN_IF_ERROR(CreateUploadRequest(&tail));
+      TF_RETURN_WITH_CONTEXT_IF_ERROR(tail.request->Send(), " when uploading ",
+                                      GetGcsPath());
+      tail_uploaded_ = true;
+      ++num_parts;
+    }
+    TF_RETURN_IF_ERROR(ComposeParts(num_parts));
+    synced_ = true;
+    return Status::OK();
+  }
+
+ private:
+  struct Part {
+    int index;
+    string data;
+    std::unique_ptr<HttpRequest> request;
+  };
+
+  Status CheckWritable() const {
+    if (closed_) {
+      return errors::FailedPrecondition("The file ", GetGcsPath(),
+                                        " is closed.");
+    }
+    return Status::OK();
+  }
+
+  string GetGcsPath() const {
+    return strings::StrCat("gs://", bucket_, "/", object_);
+  }
+
+  string PartName(int index) const {
+    return strings::StrCat(part_prefix_, index);
+  }
+
+  Status CreateUploadRequest(Part* part) {
+    string auth_token;
+    TF_RETURN_IF_ERROR(AuthProvider::GetToken(auth_provider_, &auth_token));
+
+    part->request.reset(http_request_factory_->Create());
+    TF_RETURN_IF_ERROR(part->request->Init());
+    TF_RETURN_IF_ERROR(part->request->SetUri(strings::StrCat(
+        kGcsUploadUriBase, "b/", bucket_, "/o?uploadType=media&name=",
+        part->request->EscapeString(PartName(part->index)))));
+    TF_RETURN_IF_ERROR(part->request->AddAuthBearerHeader(auth_token));
+    TF_RETURN_IF_ERROR(
+        part->request->SetPostFromBuffer(part->data.data(), part->data.size()));
+    return Status::OK();
+  }
+
+  /// \brief Uploads the buffered bytes as the next part, in the background if
+  /// there is an upload pool.
+  ///
+  /// Blocks while 'max_parallel_uploads_' parts of the file are in flight.
+  Status UploadBuffer() {
+    std::unique_ptr<Part> part(new Part);
+    part->index = num_parts_++;
+    part->data.swap(buffer_);
+    // The part overwrites the last part uploaded by Sync(), if any.
+    tail_uploaded_ = false;
+    TF_RETURN_IF_ERROR(CreateUploadRequest(part.get()));
+    if (!upload_pool_) {
+      const Status status = part->request->Send();
+      mutex_lock l(mu_);
+      FinishUpload(std::move(part), status);
+      return Status::OK();
+    }
+    {
+      mutex_lock l(mu_);
+      while (uploads_in_flight_ >= max_parallel_uploads_) {
+        upload_done_.wait(l);
+      }
+      ++uploads_in_flight_;
+    }
+    Part* released_part = part.release();
+    upload_pool_->Schedule([this, released_part]() {
+      std::unique_ptr<Part> part(released_part);
+      const Status status = part->request->Send();
+      mutex_lock l(mu_);
+      --uploads_in_flight_;
+      FinishUpload(std::move(part), status);
+      upload_done_.notify_all();
+    });
+    return Status::OK();
+  }
+
+  /// Releases the part if it was uploaded, or keeps it for Sync() to retry.
+  void FinishUpload(std::unique_ptr<Part> part, const Status& status)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (status.ok()) {
+      return;
+    }
+    LOG(WARNING) << "Failed to upload part " << part->index << " of "
+                 << GetGcsPath() << ": " << status;
+    part->request.reset();
+    failed_parts_.push_back(std::move(part));
+  }
+
+  void WaitForUploads() {
+    mutex_lock l(mu_);
+    while (uploads_in_flight_ > 0) {
+      upload_done_.wait(l);
+    }
+  }
+
+  /// \brief Composes the first 'num_parts' parts into the destination object.
+  ///
+  /// Since a compose request accepts at most kMaxComposeSources objects, the
+  /// parts past the first ones are appended to the object by further
+  /// requests.
+  Status ComposeParts(int num_parts) {
+    string auth_token;
+    TF_RETURN_IF_ERROR(AuthProvider::GetToken(auth_provider_, &auth_token));
+
+    int next_part = 0;
+    while (next_part < num_parts) {
+      Json::Value root;
+      Json::Value& sources = root["sourceObjects"];
+      if (next_part > 0) {
+        sources.append(Json::Value())["name"] = object_;
+      }
+      while (sources.size() < kMaxComposeSources && next_part < num_parts) {
+        sources.append(Json::Value())["name"] = PartName(next_part++);
+      }
+      root["destination"]["contentType"] = "application/octet-stream";
+      const string body = Json::FastWriter().write(root);
+
+      std::unique_ptr<HttpRequest> request(http_request_factory_->Create());
+      TF_RETURN_IF_ERROR(request->Init());
+      TF_RETURN_IF_ERROR(request->SetUri(
+          strings::StrCat(kGcsUriBase, "b/", bucket_, "/o/",
+                          request->EscapeString(object_), "/compose")));
+      TF_RETURN_IF_ERROR(request->AddAuthBearerHeader(auth_token));
+      TF_RETURN_IF_ERROR(request->SetPostFromBuffer(body.data(), body.size()));
+      TF_RETURN_WITH_CONTEXT_IF_ERROR(request->Send(), " when composing ",
+                                      GetGcsPath());
+    }
+    return Status::OK();
+  }
+
+  /// \brief Deletes the parts which were uploaded, which are no longer needed
+  /// once the file is closed.
+  ///
+  /// Failures are only logged, since the object itself is complete.
+  void DeleteParts() {
+    std::set<int> failed_indices;
+    {
+      mutex_lock l(mu_);
+      for (const auto& part : failed_parts_) {
+        failed_indices.insert(part->index);
+      }
+    }
+    string auth_token;
+    Status status = AuthProvider::GetToken(auth_provider_, &auth_token);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to delete the uploaded parts of " << GetGcsPath()
+                   << ": " << status;
+      return;
+    }
+    const int num_parts = num_parts_ + (tail_uploaded_ ? 1 : 0);
+    for (int i = 0; i < num_parts; ++i) {
+      if (failed_indices.count(i) > 0) {
+        continue;
+      }
+      std::unique_ptr<HttpRequest> request(http_request_factory_->Create());
+      status = request->Init();
+      if (status.ok()) {
+        status = request->SetUri(
+            strings::StrCat(kGcsUriBase, "b/", bucket_, "/o/",
+                            request->EscapeString(PartName(i))));
+      }
+      if (status.ok()) {
+        status = request->AddAuthBearerHeader(auth_token);
+      }
+      if (status.ok()) {
+        status = request->SetDeleteRequest();
+      }
+      if (status.ok()) {
+        status = request->Send();
+      }
+      if (!status.ok()) {
+        LOG(WARNING) << "Failed to delete the uploaded part " << PartName(i)
+                     << " of " << GetGcsPath() << ": " << status;
+      }
+    }
+  }
+
+  const string bucket_;
+  const string object_;
+  // The prefix of the names of the parts.
+  const string part_prefix_;
+  AuthProvider* auth_provider_;
+  HttpRequest::Factory* http_request_factory_;
+  const size_t part_size_;
+  const int32 max_parallel_uploads_;
+  thread::ThreadPool* upload_pool_;
+
+  // The bytes appended since the last full part was uploaded.
+  string buffer_;
+  // The number of full parts.
+  int num_parts_ = 0;
+  // Whether Sync() uploaded 'buffer_' as part 'num_parts_'.
+  bool tail_uploaded_ = false;
+  // Whether the object holds all the bytes appended so far.
+  bool synced_ = false;
+  bool closed_ = false;
+
+  mutex mu_;
+  condition_variable upload_done_;
+  int32 uploads_in_flight_ GUARDED_BY(mu_) = 0;
+  std::vector<std::unique_ptr<Part>> failed_parts_ GUARDED_BY(mu_);
+};
+
 class GcsReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
  public:
   GcsReadOnlyMemoryRegion(std::unique_ptr<char[]> data, uint64 length)
@@ -583,7 +1119,21 @@ class GcsReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
 
 GcsFileSystem::GcsFileSystem()
     : auth_provider_(new GoogleAuthProvider()),
-      http_request_factory_(new HttpRequest::Factory()) {}
+      http_request_factory_(new HttpRequest::Factory()) {
+  const uint64 block_size = GetEnvMegabytes(kReadCacheBlockSizeMb);
+  const uint64 max_cache_bytes = GetEnvMegabytes(kReadCacheMaxSizeMb);
+  if (block_size > max_cache_bytes && max_cache_bytes > 0) {
+    LOG(WARNING) << "Not caching the blocks of GCS files, as "
+                 << kReadCacheBlockSizeMb << " is larger than "
+                 << kReadCacheMaxSizeMb << ".";
+  } else {
+    InitBlockCache(block_size, max_cache_bytes, kDefaultMaxParallelReads);
+  }
+  const uint64 upload_part_size = GetEnvMegabytes(kUploadPartSizeMb);
+  if (upload_part_size > 0) {
+    EnableCompositeUploads(upload_part_size, kDefaultMaxParallelUploads);
+  }
+}
 
 GcsFileSystem::GcsFileSystem(
     std::unique_ptr<AuthProvider> auth_provider,
@@ -594,10 +1144,61 @@ GcsFileSystem::GcsFileSystem(
       read_ahead_bytes_(read_ahead_bytes),
       max_upload_attempts_(max_upload_attempts) {}
 
+GcsFileSystem::GcsFileSystem(
+    std::unique_ptr<AuthProvider> auth_provider,
+    std::unique_ptr<HttpRequest::Factory> http_request_factory,
+    size_t block_size, size_t max_cache_bytes, int32 max_parallel_reads,
+    int32 max_upload_attempts)
+    : auth_provider_(std::move(auth_provider)),
+      http_request_factory_(std::move(http_request_factory)),
+      max_upload_attempts_(max_upload_attempts) {
+  InitBlockCache(block_size, max_cache_bytes, max_parallel_reads);
+}
+
+void GcsFileSystem::InitBlockCache(size_t block_size, size_t max_cache_bytes,
+                                   int32 max_parallel_reads) {
+  if (block_size == 0 || max_cache_bytes == 0) {
+    return;
+  }
+  block_cache_.reset(new FileBlockCache(block_size, max_cache_bytes));
+  if (max_parallel_reads > 1) {
+    read_pool_.reset(new thread::ThreadPool(Env::Default(), "gcs_read",
+                                            max_parallel_reads - 1));
+  }
+}
+
+void GcsFileSystem::EnableCompositeUploads(
+    size_t part_size, int32 max_parallel_uploads,
+    std::function<string()> new_upload_id) {
+  upload_part_size_ = part_size;
+  max_parallel_uploads_ = max_parallel_uploads;
+  new_upload_id_ = std::move(new_upload_id);
+  if (!new_upload_id_) {
+    new_upload_id_ = []() {
+      return strings::Printf("%016llx",
+                             static_cast<unsigned long long>(random::New64()));
+    };
+  }
+  if (max_parallel_uploads > 0) {
+    upload_pool_.reset(new thread::ThreadPool(Env::Default(), "gcs_upload",
+                                              max_parallel_uploads));
+  }
+}
+
 Status GcsFileSystem::NewRandomAccessFile(
     const string& fname, std::unique_ptr<RandomAccessFile>* result) {
   string bucket, object;
   TF_RETURN_IF_ERROR(ParseGcsPath(fname, false, &bucket, &object));
+  if (block_cache_) {
+    uint64 size;
+    string generation;
+    TF_RETURN_IF_ERROR(
+        ObjectSizeAndGeneration(bucket, object, &size, &generation));
+    result->reset(new GcsBlockCachedRandomAccessFile(
+        bucket, object, size, generation, auth_provider_.get(),
+        http_request_factory_.get(), block_cache_.get(), read_pool_.get()));
+    return Status::OK();
+  }
   result->reset(new GcsRandomAccessFile(bucket, object, auth_provider_.get(),
                                         http_request_factory_.get(),
                                         read_ahead_bytes_));
@@ -608,6 +1209,13 @@ Status GcsFileSystem::NewWritableFile(const string& fname,
                                       std::unique_ptr<WritableFile>* result) {
   string bucket, object;
   TF_RETURN_IF_ERROR(ParseGcsPath(fname, false, &bucket, &object));
+  if (upload_part_size_ > 0) {
+    result->reset(new GcsCompositeWritableFile(
+        bucket, object, new_upload_id_(), auth_provider_.get(),
+        http_request_factory_.get(), upload_part_size_, max_parallel_uploads_,
+        upload_pool_.get()));
+    return Status::OK();
+  }
   result->reset(new GcsWritableFile(bucket, object, auth_provider_.get(),
                                     http_request_factory_.get(),
                                     max_upload_attempts_));
@@ -752,6 +1360,38 @@ Status GcsFileSystem::StatForObject(const string& bucket, const string& object,
   return Status::OK();
 }
 
+Status GcsFileSystem::ObjectSizeAndGeneration(const string& bucket,
+                                              const string& object,
+                                              uint64* size,
+                                              string* generation) {
+  string auth_token;
+  TF_RETURN_IF_ERROR(AuthProvider::GetToken(auth_provider_.get(), &auth_token));
+
+  std::unique_ptr<char[]> scratch(new char[kBufferSize]);
+  StringPiece response_piece;
+
+  std::unique_ptr<HttpRequest> request(http_request_factory_->Create());
+  TF_RETURN_IF_ERROR(request->Init());
+  TF_RETURN_IF_ERROR(request->SetUri(strings::StrCat(
+      kGcsUriBase, "b/", bucket, "/o/", request->EscapeString(object),
+      "?fields=size%2Cgeneration")));
+  TF_RETURN_IF_ERROR(request->AddAuthBearerHeader(auth_token));
+  TF_RETURN_IF_ERROR(
+      request->SetResultBuffer(scratch.get(), kBufferSize, &response_piece));
+  TF_RETURN_WITH_CONTEXT_IF_ERROR(
+      request->Send(), " when reading metadata of gs://", bucket, "/", object);
+
+  Json::Value root;
+  TF_RETURN_IF_ERROR(ParseJson(response_piece, &root));
+  int64 size_value;
+  TF_RETURN_IF_ERROR(GetInt64Value(root, "size", &size_value));
+  *size = size_value;
+  int64 generation_value;
+  TF_RETURN_IF_ERROR(GetInt64Value(root, "generation", &generation_value));
+  *generation = strings::StrCat(generation_value);
+  return Status::OK();
+}
+
 Status GcsFileSystem::BucketExists(const string& bucket, bool* result) {
   if (!result) {
     return errors::Internal("'result' cannot be nullptr.");
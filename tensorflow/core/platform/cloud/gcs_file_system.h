@@ -16,10 +16,13 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_PLATFORM_GCS_FILE_SYSTEM_H_
 #define TENSORFLOW_CORE_PLATFORM_GCS_FILE_SYSTEM_H_
 
+#include <functional>
 #include <string>
 #include <vector>
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/platform/cloud/auth_provider.h"
+#include "tensorflow/core/platform/cloud/file_block_cache.h"
 #include "tensorflow/core/platform/cloud/http_request.h"
 #include "tensorflow/core/platform/cloud/retrying_file_system.h"
 #include "tensorflow/core/platform/file_system.h"
@@ -30,6 +33,20 @@ namespace tensorflow {
 ///
 /// The clients should use RetryingGcsFileSystem defined below,
 /// which adds retry logic to GCS operations.
+///
+/// By default, each file read from GCS has its own read-ahead buffer. When
+/// the environment variables GCS_READ_CACHE_BLOCK_SIZE_MB and
+/// GCS_READ_CACHE_MAX_SIZE_MB are set to positive numbers, with a block size
+/// no larger than the cache, files are instead read through a block cache
+/// shared by all of them.
+///
+/// Similarly, the files written to GCS are uploaded as a whole when they are
+/// flushed or closed, unless GCS_UPLOAD_PART_SIZE_MB is set, in which case
+/// they are uploaded in parts while being written (see
+/// EnableCompositeUploads). The parts are temporary objects under
+/// '.gcs_upload_parts/' in the bucket, which the files delete once they are
+/// closed; the parts of a process which exits while writing a file are left
+/// there, under a prefix of their own.
 class GcsFileSystem : public FileSystem {
  public:
   GcsFileSystem();
@@ -37,6 +54,30 @@ class GcsFileSystem : public FileSystem {
                 std::unique_ptr<HttpRequest::Factory> http_request_factory,
                 size_t read_ahead_bytes, int32 max_upload_attempts);
 
+  /// \brief Creates a file system which reads files through a shared LRU
+  /// cache of 'block_size'-byte blocks, holding at most 'max_cache_bytes'.
+  ///
+  /// Up to 'max_parallel_reads' missing blocks of a read are fetched
+  /// concurrently. If 'block_size' or 'max_cache_bytes' is 0, the files are
+  /// read without a cache instead.
+  GcsFileSystem(std::unique_ptr<AuthProvider> auth_provider,
+                std::unique_ptr<HttpRequest::Factory> http_request_factory,
+                size_t block_size, size_t max_cache_bytes,
+                int32 max_parallel_reads, int32 max_upload_attempts);
+
+  /// \brief Makes the files opened by NewWritableFile upload every
+  /// 'part_size' bytes written to them as a temporary object, with up to
+  /// 'max_parallel_uploads' uploads per file in flight.
+  ///
+  /// The parts are composed into the destination object when the file is
+  /// synced or closed, and deleted once it is closed. The parts of each file
+  /// are named after an upload id of their own, which 'new_upload_id' returns
+  /// if it is set and which is random otherwise. Must be called before any
+  /// file is opened.
+  void EnableCompositeUploads(
+      size_t part_size, int32 max_parallel_uploads,
+      std::function<string()> new_upload_id = nullptr);
+
   Status NewRandomAccessFile(
       const string& filename,
       std::unique_ptr<RandomAccessFile>* result) override;
@@ -105,6 +146,13 @@ class GcsFileSystem : public FileSystem {
   /// Retrieves file statistics assuming fname points to a GCS object.
   Status StatForObject(const string& bucket, const string& object,
                        FileStatistics* stat);
+  /// Retrieves the size and the generation of a GCS object.
+  Status ObjectSizeAndGeneration(const string& bucket, const string& object,
+                                 uint64* size, string* generation);
+  /// Creates the block cache and the threads to fill it, unless
+  /// 'block_size' or 'max_cache_bytes' is 0.
+  void InitBlockCache(size_t block_size, size_t max_cache_bytes,
+                      int32 max_parallel_reads);
   Status RenameObject(const string& src, const string& target);
 
   std::unique_ptr<AuthProvider> auth_provider_;
@@ -118,6 +166,22 @@ class GcsFileSystem : public FileSystem {
   // upload API.
   const int32 max_upload_attempts_ = 5;
 
+  // If set, the RandomAccessFile implementation reads the blocks of files
+  // through this cache instead of buffering them.
+  std::unique_ptr<FileBlockCache> block_cache_;
+
+  // Fetches the blocks missing from the cache concurrently. May be null.
+  std::unique_ptr<thread::ThreadPool> read_pool_;
+
+  // If positive, the WritableFile implementation uploads the files in parts
+  // of this size while they are written, and composes them on flush/close.
+  size_t upload_part_size_ = 0;
+  int32 max_parallel_uploads_ = 0;
+  std::function<string()> new_upload_id_;
+
+  // Uploads the parts of the files being written.
+  std::unique_ptr<thread::ThreadPool> upload_pool_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(GcsFileSystem);
 };
 
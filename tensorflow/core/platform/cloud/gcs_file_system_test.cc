@@ -175,6 +175,122 @@ TEST(GcsFileSystemTest, NewRandomAccessFile_WithReadAhead) {
   EXPECT_EQ("0123", result);
 }
 
+TEST(GcsFileSystemTest, NewRandomAccessFile_WithBlockCache) {
+  std::vector<HttpRequest*> requests(
+      {new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+           "random_access.txt?fields=size%2Cgeneration\n"
+           "Auth Token: fake_token\n",
+           "{\"size\": \"20\", \"generation\": \"1234\"}"),
+       new FakeHttpRequest(
+           "Uri: https://bucket.storage.googleapis.com/random_access.txt\n"
+           "Auth Token: fake_token\n"
+           "Header x-goog-if-generation-match: 1234\n"
+           "Range: 0-7\n",
+           "01234567"),
+       new FakeHttpRequest(
+           "Uri: https://bucket.storage.googleapis.com/random_access.txt\n"
+           "Auth Token: fake_token\n"
+           "Header x-goog-if-generation-match: 1234\n"
+           "Range: 8-15\n",
+           "89abcdef"),
+       new FakeHttpRequest(
+           "Uri: https://bucket.storage.googleapis.com/random_access.txt\n"
+           "Auth Token: fake_token\n"
+           "Header x-goog-if-generation-match: 1234\n"
+           "Range: 16-19\n",
+           "ghij"),
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+           "random_access.txt?fields=size%2Cgeneration\n"
+           "Auth Token: fake_token\n",
+           "{\"size\": \"20\", \"generation\": \"1234\"}"),
+       new FakeHttpRequest(
+           "Uri: https://bucket.storage.googleapis.com/random_access.txt\n"
+           "Auth Token: fake_token\n"
+           "Header x-goog-if-generation-match: 1234\n"
+           "Range: 0-7\n",
+           "01234567")});
+  GcsFileSystem fs(std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+                   std::unique_ptr<HttpRequest::Factory>(
+                       new FakeHttpRequestFactory(&requests)),
+                   8 /* block size */, 16 /* max cache bytes */,
+                   3 /* max parallel reads */, 5 /* max upload attempts */);
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_EXPECT_OK(fs.NewRandomAccessFile("gs://bucket/random_access.txt", &file));
+
+  char scratch[100];
+  StringPiece result;
+
+  // The read spans three blocks, which are fetched concurrently.
+  TF_EXPECT_OK(file->Read(2, 16, &result, scratch));
+  EXPECT_EQ("23456789abcdefgh", result);
+
+  // The cache holds the two most recently inserted blocks.
+  TF_EXPECT_OK(file->Read(12, 6, &result, scratch));
+  EXPECT_EQ("cdefgh", result);
+  EXPECT_EQ(errors::Code::OUT_OF_RANGE,
+            file->Read(17, 10, &result, scratch).code());
+  EXPECT_EQ("hij", result);
+  EXPECT_EQ(errors::Code::OUT_OF_RANGE,
+            file->Read(20, 10, &result, scratch).code());
+  EXPECT_TRUE(result.empty());
+
+  // Another file of the same object shares the cache, but the first block was
+  // evicted.
+  std::unique_ptr<RandomAccessFile> other_file;
+  TF_EXPECT_OK(
+      fs.NewRandomAccessFile("gs://bucket/random_access.txt", &other_file));
+  TF_EXPECT_OK(other_file->Read(10, 4, &result, scratch));
+  EXPECT_EQ("abcd", result);
+  TF_EXPECT_OK(other_file->Read(0, 4, &result, scratch));
+  EXPECT_EQ("0123", result);
+}
+
+TEST(GcsFileSystemTest, NewRandomAccessFile_WithBlockCache_NewGeneration) {
+  std::vector<HttpRequest*> requests(
+      {new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+           "random_access.txt?fields=size%2Cgeneration\n"
+           "Auth Token: fake_token\n",
+           "{\"size\": \"4\", \"generation\": \"1\"}"),
+       new FakeHttpRequest(
+           "Uri: https://bucket.storage.googleapis.com/random_access.txt\n"
+           "Auth Token: fake_token\n"
+           "Header x-goog-if-generation-match: 1\n"
+           "Range: 0-3\n",
+           "0123"),
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+           "random_access.txt?fields=size%2Cgeneration\n"
+           "Auth Token: fake_token\n",
+           "{\"size\": \"4\", \"generation\": \"2\"}"),
+       new FakeHttpRequest(
+           "Uri: https://bucket.storage.googleapis.com/random_access.txt\n"
+           "Auth Token: fake_token\n"
+           "Header x-goog-if-generation-match: 2\n"
+           "Range: 0-3\n",
+           "abcd")});
+  GcsFileSystem fs(std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+                   std::unique_ptr<HttpRequest::Factory>(
+                       new FakeHttpRequestFactory(&requests)),
+                   8 /* block size */, 16 /* max cache bytes */,
+                   1 /* max parallel reads */, 5 /* max upload attempts */);
+
+  char scratch[4];
+  StringPiece result;
+  std::unique_ptr<RandomAccessFile> file;
+  TF_EXPECT_OK(fs.NewRandomAccessFile("gs://bucket/random_access.txt", &file));
+  TF_EXPECT_OK(file->Read(0, 4, &result, scratch));
+  EXPECT_EQ("0123", result);
+
+  // The object was overwritten, so its blocks are fetched again.
+  TF_EXPECT_OK(fs.NewRandomAccessFile("gs://bucket/random_access.txt", &file));
+  TF_EXPECT_OK(file->Read(0, 4, &result, scratch));
+  EXPECT_EQ("abcd", result);
+}
+
 TEST(GcsFileSystemTest, NewRandomAccessFile_NoObjectName) {
   std::vector<HttpRequest*> requests;
   GcsFileSystem fs(std::unique_ptr<AuthProvider>(new FakeAuthProvider),
@@ -400,6 +516,189 @@ TEST(GcsFileSystemTest, NewWritableFile_NoObjectName) {
             fs.NewWritableFile("gs://bucket/", &file).code());
 }
 
+// Returns the request uploading 'content' as the given part of
+// gs://bucket/path/writeable.txt.
+FakeHttpRequest* UploadPartRequest(int part, const string& content,
+                                   Status status = Status::OK()) {
+  return new FakeHttpRequest(
+      strings::StrCat(
+          "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+          "uploadType=media&name=.gcs_upload_parts%2Fpath%2Fwriteable.txt."
+          "upload1%2F",
+          part, "\n"
+                "Auth Token: fake_token\n"
+                "Post body: ",
+          content, "\n"),
+      "", status, status.ok() ? 200 : 503);
+}
+
+// Returns the request composing the given objects into
+// gs://bucket/path/writeable.txt.
+FakeHttpRequest* ComposeRequest(const std::vector<string>& sources) {
+  string sources_json;
+  for (const string& source : sources) {
+    strings::StrAppend(&sources_json, sources_json.empty() ? "" : ",",
+                       "{\"name\":\"", source, "\"}");
+  }
+  return new FakeHttpRequest(
+      strings::StrCat("Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+                      "path%2Fwriteable.txt/compose\n"
+                      "Auth Token: fake_token\n"
+                      "Post body: {\"destination\":{\"contentType\":"
+                      "\"application/octet-stream\"},\"sourceObjects\":[",
+                      sources_json, "]}\n\n"),
+      "");
+}
+
+FakeHttpRequest* DeletePartRequest(int part) {
+  return new FakeHttpRequest(
+      strings::StrCat("Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+                      ".gcs_upload_parts%2Fpath%2Fwriteable.txt.upload1%2F",
+                      part, "\n"
+                            "Auth Token: fake_token\n"
+                            "Delete: yes\n"),
+      "");
+}
+
+string PartName(int part) {
+  return strings::StrCat(".gcs_upload_parts/path/writeable.txt.upload1/",
+                         part);
+}
+
+string UploadId() { return "upload1"; }
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUpload) {
+  std::vector<HttpRequest*> requests(
+      {UploadPartRequest(0, "conte"), UploadPartRequest(1, "nt1,c"),
+       UploadPartRequest(2, "onten"), UploadPartRequest(3, "t2"),
+       ComposeRequest({PartName(0), PartName(1), PartName(2), PartName(3)}),
+       DeletePartRequest(0), DeletePartRequest(1), DeletePartRequest(2),
+       DeletePartRequest(3)});
+  GcsFileSystem fs(std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+                   std::unique_ptr<HttpRequest::Factory>(
+                       new FakeHttpRequestFactory(&requests)),
+                   0 /* read ahead bytes */, 5 /* max upload attempts */);
+  fs.EnableCompositeUploads(5 /* part size */, 2 /* max parallel uploads */,
+                            UploadId);
+
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(fs.NewWritableFile("gs://bucket/path/writeable.txt", &file));
+
+  TF_EXPECT_OK(file->Append("content1,"));
+  TF_EXPECT_OK(file->Append("content2"));
+  TF_EXPECT_OK(file->Close());
+  EXPECT_TRUE(errors::IsFailedPrecondition(file->Append("more")));
+}
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUploadManyParts) {
+  // A compose request accepts up to 32 objects, so the last part is appended
+  // to the object by a second request.
+  const string content = "0123456789abcdefghijklmnopqrstuvw";
+  std::vector<HttpRequest*> requests;
+  std::vector<string> first_sources;
+  for (int i = 0; i < content.size(); ++i) {
+    requests.push_back(UploadPartRequest(i, content.substr(i, 1)));
+    if (i < 32) {
+      first_sources.push_back(PartName(i));
+    }
+  }
+  requests.push_back(ComposeRequest(first_sources));
+  requests.push_back(ComposeRequest({"path/writeable.txt", PartName(32)}));
+  for (int i = 0; i < content.size(); ++i) {
+    requests.push_back(DeletePartRequest(i));
+  }
+  GcsFileSystem fs(std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+                   std::unique_ptr<HttpRequest::Factory>(
+                       new FakeHttpRequestFactory(&requests)),
+                   0 /* read ahead bytes */, 5 /* max upload attempts */);
+  fs.EnableCompositeUploads(1 /* part size */, 0 /* max parallel uploads */,
+                            UploadId);
+
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(fs.NewWritableFile("gs://bucket/path/writeable.txt", &file));
+
+  TF_EXPECT_OK(file->Append(content));
+  TF_EXPECT_OK(file->Close());
+}
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUploadRetriesFailedParts) {
+  std::vector<HttpRequest*> requests(
+      {UploadPartRequest(0, "conte", errors::Unavailable("503")),
+       UploadPartRequest(1, "nt1,c"), UploadPartRequest(2, "onten"),
+       UploadPartRequest(0, "conte", errors::Unavailable("503")),
+       UploadPartRequest(0, "conte"), UploadPartRequest(3, "t2"),
+       ComposeRequest({PartName(0), PartName(1), PartName(2), PartName(3)}),
+       DeletePartRequest(0), DeletePartRequest(1), DeletePartRequest(2),
+       DeletePartRequest(3)});
+  GcsFileSystem fs(std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+                   std::unique_ptr<HttpRequest::Factory>(
+                       new FakeHttpRequestFactory(&requests)),
+                   0 /* read ahead bytes */, 5 /* max upload attempts */);
+  fs.EnableCompositeUploads(5 /* part size */, 1 /* max parallel uploads */,
+                            UploadId);
+
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(fs.NewWritableFile("gs://bucket/path/writeable.txt", &file));
+
+  TF_EXPECT_OK(file->Append("content1,"));
+  TF_EXPECT_OK(file->Append("content2"));
+  // The part which failed in the background fails again when Close() retries
+  // it, and is uploaded by the next attempt.
+  EXPECT_TRUE(errors::IsUnavailable(file->Close()));
+  TF_EXPECT_OK(file->Close());
+}
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUploadFlushAndSync) {
+  // Flush() only uploads the full parts, and the last part uploaded by
+  // Sync() is uploaded again once it is full.
+  std::vector<HttpRequest*> requests(
+      {UploadPartRequest(0, "conte"), UploadPartRequest(1, "nt"),
+       ComposeRequest({PartName(0), PartName(1)}),
+       UploadPartRequest(1, "nt1,c"), UploadPartRequest(2, "o"),
+       ComposeRequest({PartName(0), PartName(1), PartName(2)}),
+       DeletePartRequest(0), DeletePartRequest(1), DeletePartRequest(2)});
+  GcsFileSystem fs(std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+                   std::unique_ptr<HttpRequest::Factory>(
+                       new FakeHttpRequestFactory(&requests)),
+                   0 /* read ahead bytes */, 5 /* max upload attempts */);
+  fs.EnableCompositeUploads(5 /* part size */, 0 /* max parallel uploads */,
+                            UploadId);
+
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(fs.NewWritableFile("gs://bucket/path/writeable.txt", &file));
+
+  TF_EXPECT_OK(file->Append("content"));
+  TF_EXPECT_OK(file->Flush());
+  TF_EXPECT_OK(file->Sync());
+  TF_EXPECT_OK(file->Sync());
+  TF_EXPECT_OK(file->Append("1,co"));
+  TF_EXPECT_OK(file->Flush());
+  TF_EXPECT_OK(file->Close());
+}
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUploadDeletesAbandonedParts) {
+  // The file is destroyed after failing to upload its last part, and deletes
+  // the part it uploaded.
+  std::vector<HttpRequest*> requests(
+      {UploadPartRequest(0, "conte"),
+       UploadPartRequest(1, "nt1,", errors::Unavailable("503")),
+       UploadPartRequest(1, "nt1,", errors::Unavailable("503")),
+       DeletePartRequest(0)});
+  GcsFileSystem fs(std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+                   std::unique_ptr<HttpRequest::Factory>(
+                       new FakeHttpRequestFactory(&requests)),
+                   0 /* read ahead bytes */, 5 /* max upload attempts */);
+  fs.EnableCompositeUploads(5 /* part size */, 0 /* max parallel uploads */,
+                            UploadId);
+
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(fs.NewWritableFile("gs://bucket/path/writeable.txt", &file));
+
+  TF_EXPECT_OK(file->Append("content1,"));
+  EXPECT_TRUE(errors::IsUnavailable(file->Close()));
+  file.reset();
+}
+
 TEST(GcsFileSystemTest, NewAppendableFile) {
   std::vector<HttpRequest*> requests(
       {new FakeHttpRequest(
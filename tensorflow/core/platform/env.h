@@ -355,6 +355,8 @@ struct ThreadOptions {
   size_t stack_size = 0;  // 0: use system default value
   /// Guard area size to use near thread stacks to use (in bytes)
   size_t guard_size = 0;  // 0: use system default value
+  /// NUMA node whose CPUs the thread is restricted to, if supported.
+  int numa_node = -1;  // -1: no affinity
 };
 
 /// A utility routine: reads contents of named file into `*data`
@@ -18,6 +18,7 @@ limitations under the License.
 #include <sys/stat.h>
 
 #include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/strings/str_util.h"
@@ -136,6 +137,40 @@ TEST_F(DefaultEnvTest, FileToReadonlyMemoryRegion) {
   }
 }
 
+TEST_F(DefaultEnvTest, ReadAsync) {
+  const string filename = io::JoinPath(BaseDir(), "file");
+  const string input = CreateTestFile(env_, filename, 10000);
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env_->NewRandomAccessFile(filename, &file));
+
+  // Keeps many reads in flight, including one past the end of the file.
+  const int kNumReads = 40;
+  const size_t kReadSize = 256;
+  std::vector<char> scratch(kNumReads * kReadSize);
+  std::vector<Status> statuses(kNumReads);
+  std::vector<StringPiece> results(kNumReads);
+  BlockingCounter counter(kNumReads);
+  for (int i = 0; i < kNumReads; ++i) {
+    file->ReadAsync(i * kReadSize, kReadSize, &scratch[i * kReadSize],
+                    [i, &statuses, &results, &counter](const Status& s,
+                                                       StringPiece result) {
+                      statuses[i] = s;
+                      results[i] = result;
+                      counter.DecrementCount();
+                    });
+  }
+  counter.Wait();
+  for (int i = 0; i < kNumReads; ++i) {
+    const size_t offset = i * kReadSize;
+    if (offset + kReadSize <= input.size()) {
+      TF_EXPECT_OK(statuses[i]);
+    } else {
+      EXPECT_TRUE(errors::IsOutOfRange(statuses[i])) << statuses[i];
+    }
+    EXPECT_EQ(input.substr(offset, kReadSize), results[i].ToString());
+  }
+}
+
 TEST_F(DefaultEnvTest, DeleteRecursively) {
   // Build a directory structure rooted at root_dir.
   // root_dir -> dirs: child_dir1, child_dir2; files: root_file1, root_file2
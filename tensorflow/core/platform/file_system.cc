@@ -72,6 +72,13 @@ Status FileSystem::IsDirectory(const string& name) {
 
 RandomAccessFile::~RandomAccessFile() {}
 
+void RandomAccessFile::ReadAsync(uint64 offset, size_t n, char* scratch,
+                                 ReadDoneCallback done) const {
+  StringPiece result;
+  const Status status = Read(offset, n, &result, scratch);
+  done(status, result);
+}
+
 WritableFile::~WritableFile() {}
 
 FileSystemRegistry::~FileSystemRegistry() {}
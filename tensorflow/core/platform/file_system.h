@@ -238,6 +238,23 @@ class RandomAccessFile {
   virtual Status Read(uint64 offset, size_t n, StringPiece* result,
                       char* scratch) const = 0;
 
+  /// The callback of ReadAsync(), which receives what Read() would return.
+  typedef std::function<void(const Status& status, StringPiece result)>
+      ReadDoneCallback;
+
+  /// \brief Reads up to `n` bytes from the file starting at `offset`
+  /// without blocking, and calls `done` once the read completes.
+  ///
+  /// `done` is called with the status and the result of the equivalent
+  /// Read(), possibly from another thread, and should not block.
+  /// `scratch[0..n-1]` and the file must be live until `done` is called.
+  ///
+  /// The default implementation calls Read() and then `done` synchronously.
+  ///
+  /// Safe for concurrent use by multiple threads.
+  virtual void ReadAsync(uint64 offset, size_t n, char* scratch,
+                         ReadDoneCallback done) const;
+
  private:
   TF_DISALLOW_COPY_AND_ASSIGN(RandomAccessFile);
 };
@@ -270,6 +287,10 @@ class ReadOnlyMemoryRegion {
   virtual ~ReadOnlyMemoryRegion() = default;
   virtual const void* data() = 0;
   virtual uint64 length() = 0;
+
+  /// \brief Hints that the region will be read from start to end, so that
+  /// its contents may be read ahead aggressively.  Does nothing by default.
+  virtual void AdviseSequentialAccess() {}
 };
 
 /// \brief A registry for file system implementations.
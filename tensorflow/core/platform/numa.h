@@ -0,0 +1,52 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_PLATFORM_NUMA_H_
+#define TENSORFLOW_PLATFORM_NUMA_H_
+
+#include "tensorflow/core/platform/platform.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace port {
+
+// NUMA nodes are numbered from 0. kNUMANoAffinity stands for "any node".
+static const int kNUMANoAffinity = -1;
+
+// Returns the number of NUMA nodes of the machine, or 1 if the platform
+// does not expose its NUMA topology.
+int NUMANumNodes();
+
+// Returns the number of CPUs of NUMA node "node" that this process may
+// run on, or 0 if unknown.
+int NUMANumSchedulableCPUs(int node);
+
+// Restricts the calling thread to the CPUs of NUMA node "node". Returns
+// false, and leaves the thread unchanged, if that is not supported.
+bool NUMASetThreadNodeAffinity(int node);
+
+// Returns "size" bytes of fresh memory aligned to at least
+// "minimum_alignment" bytes, or nullptr. Where the platform supports it,
+// the memory is mapped on its own and its pages are preferably placed on
+// NUMA node "node", unless "node" is kNUMANoAffinity. Each call maps whole
+// pages, so this is meant for large blocks that are carved up by the
+// caller. The result must be freed with NUMAFree() and the same "size".
+void* NUMAMalloc(int node, size_t size, int minimum_alignment);
+void NUMAFree(void* ptr, size_t size);
+
+}  // namespace port
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_PLATFORM_NUMA_H_
@@ -13,10 +13,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <string.h>
 #include <condition_variable>
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -32,6 +35,35 @@ TEST(Port, AlignedMalloc) {
   }
 }
 
+TEST(Port, NUMAMalloc) {
+  EXPECT_GE(NUMANumNodes(), 1);
+  for (int node = kNUMANoAffinity; node < NUMANumNodes(); ++node) {
+    for (size_t size : {1, 4096, 1 << 20}) {
+      for (int alignment : {64, 1 << 16}) {
+        void* p = NUMAMalloc(node, size, alignment);
+        ASSERT_TRUE(p != NULL) << "NUMAMalloc(" << node << ", " << size
+                               << ", " << alignment << ")";
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignment, 0);
+        memset(p, 0, size);
+        NUMAFree(p, size);
+      }
+    }
+  }
+}
+
+TEST(Port, NUMASetThreadNodeAffinity) {
+  EXPECT_FALSE(NUMASetThreadNodeAffinity(NUMANumNodes()));
+  if (NUMANumSchedulableCPUs(0) == 0) return;
+  // Run on a separate thread so that the test thread stays unrestricted.
+  ThreadOptions thread_options;
+  thread_options.numa_node = 0;
+  thread::ThreadPool pool(Env::Default(), thread_options, "numa", 1);
+  pool.Schedule([]() {
+    EXPECT_TRUE(NUMASetThreadNodeAffinity(0));
+    EXPECT_LE(NumSchedulableCPUs(), NUMANumSchedulableCPUs(0));
+  });
+}
+
 TEST(ConditionVariable, WaitForMilliseconds_Timeout) {
   mutex m;
   mutex_lock l(m);
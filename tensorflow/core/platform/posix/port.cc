@@ -13,14 +13,19 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/types.h"
 #if defined(__linux__) && !defined(__ANDROID__)
 #include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <algorithm>
+#include <vector>
 #ifdef SNAPPY
 #include <snappy.h>
 #endif
@@ -77,6 +82,137 @@ void* aligned_malloc(size_t size, int minimum_alignment) {
 
 void aligned_free(void* aligned_memory) { free(aligned_memory); }
 
+#if defined(__linux__) && !defined(__ANDROID__)
+namespace {
+
+// The CPUs of each NUMA node that this process may run on, read from
+// sysfs once.
+struct NUMATopology {
+  std::vector<cpu_set_t> node_cpus;
+
+  NUMATopology() {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+    for (int node = 0;; ++node) {
+      char path[64];
+      snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+               node);
+      FILE* f = fopen(path, "r");
+      if (f == nullptr) break;
+      char buf[4096];
+      const bool ok = fgets(buf, sizeof(buf), f) != nullptr;
+      fclose(f);
+      if (!ok) break;
+      // The list looks like "0-7,16-23".
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      for (char* p = buf; *p != '\0' && *p != '\n';) {
+        char* end;
+        const long first = strtol(p, &end, 10);
+        if (end == p) break;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+          last = strtol(p + 1, &end, 10);
+          p = end;
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+          if (CPU_ISSET(cpu, &allowed)) CPU_SET(cpu, &cpus);
+        }
+        if (*p == ',') ++p;
+      }
+      node_cpus.push_back(cpus);
+    }
+  }
+};
+
+const NUMATopology& GetNUMATopology() {
+  static const NUMATopology* topology = new NUMATopology;
+  return *topology;
+}
+
+}  // namespace
+#endif  // defined(__linux__) && !defined(__ANDROID__)
+
+int NUMANumNodes() {
+#if defined(__linux__) && !defined(__ANDROID__)
+  const int num_nodes = GetNUMATopology().node_cpus.size();
+  if (num_nodes > 0) return num_nodes;
+#endif
+  return 1;
+}
+
+int NUMANumSchedulableCPUs(int node) {
+#if defined(__linux__) && !defined(__ANDROID__)
+  const NUMATopology& topology = GetNUMATopology();
+  if (node >= 0 && node < topology.node_cpus.size()) {
+    return CPU_COUNT(&topology.node_cpus[node]);
+  }
+#endif
+  return 0;
+}
+
+bool NUMASetThreadNodeAffinity(int node) {
+#if defined(__linux__) && !defined(__ANDROID__)
+  const NUMATopology& topology = GetNUMATopology();
+  if (node >= 0 && node < topology.node_cpus.size() &&
+      CPU_COUNT(&topology.node_cpus[node]) > 0) {
+    return sched_setaffinity(0, sizeof(cpu_set_t),
+                             &topology.node_cpus[node]) == 0;
+  }
+#endif
+  return false;
+}
+
+void* NUMAMalloc(int node, size_t size, int minimum_alignment) {
+#if defined(__linux__) && !defined(__ANDROID__)
+  // Like numa_alloc_onnode(), the block gets a mapping of its own, so
+  // that its memory policy neither splits a heap mapping shared with
+  // other blocks nor outlives the block.
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t alignment =
+      std::max(static_cast<size_t>(minimum_alignment), page_size);
+  const size_t mapped_size =
+      (std::max<size_t>(size, 1) + page_size - 1) & ~(page_size - 1);
+  // The extra pages needed to align the block are unmapped below.
+  const size_t slack = alignment - page_size;
+  char* base = static_cast<char*>(mmap(nullptr, mapped_size + slack,
+                                       PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  if (base == MAP_FAILED) return nullptr;
+  char* ptr = reinterpret_cast<char*>(
+      (reinterpret_cast<uintptr_t>(base) + alignment - 1) & ~(alignment - 1));
+  if (ptr > base) munmap(base, ptr - base);
+  if (base + slack > ptr) munmap(ptr + mapped_size, base + slack - ptr);
+#if defined(SYS_mbind)
+  if (node != kNUMANoAffinity && node < NUMANumNodes() &&
+      NUMANumNodes() > 1) {
+    const int kMPolPreferred = 1;
+    const int kBitsPerWord = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> node_mask(node / kBitsPerWord + 1, 0);
+    node_mask[node / kBitsPerWord] |= 1UL << (node % kBitsPerWord);
+    // Placement is best effort: on failure the pages follow the default
+    // policy.
+    syscall(SYS_mbind, ptr, mapped_size, kMPolPreferred, node_mask.data(),
+            node_mask.size() * kBitsPerWord + 1, 0);
+  }
+#endif
+  return ptr;
+#else
+  return aligned_malloc(size, minimum_alignment);
+#endif
+}
+
+void NUMAFree(void* ptr, size_t size) {
+#if defined(__linux__) && !defined(__ANDROID__)
+  if (ptr == nullptr) return;
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  munmap(ptr, (std::max<size_t>(size, 1) + page_size - 1) & ~(page_size - 1));
+#else
+  aligned_free(ptr);
+#endif
+}
+
 void MallocExtension_ReleaseToSystem(std::size_t num_bytes) {
   // No-op.
 }
@@ -26,6 +26,7 @@ limitations under the License.
 
 #include "tensorflow/core/lib/core/error_codes.pb.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
@@ -34,6 +35,20 @@ limitations under the License.
 
 namespace tensorflow {
 
+namespace {
+
+// The number of threads which perform the asynchronous reads of all the
+// files.
+constexpr int kNumAsyncReadThreads = 16;
+
+thread::ThreadPool* AsyncReadThreadPool() {
+  static thread::ThreadPool* pool = new thread::ThreadPool(
+      Env::Default(), "posix_async_read", kNumAsyncReadThreads);
+  return pool;
+}
+
+}  // namespace
+
 // pread() based random-access
 class PosixRandomAccessFile : public RandomAccessFile {
  private:
@@ -66,6 +81,17 @@ class PosixRandomAccessFile : public RandomAccessFile {
     *result = StringPiece(scratch, dst - scratch);
     return s;
   }
+
+  // Performs the pread() calls on a pool of threads dedicated to the
+  // asynchronous reads, so that many of them can be in flight.
+  void ReadAsync(uint64 offset, size_t n, char* scratch,
+                 ReadDoneCallback done) const override {
+    AsyncReadThreadPool()->Schedule([this, offset, n, scratch, done]() {
+      StringPiece result;
+      const Status s = Read(offset, n, &result, scratch);
+      done(s, result);
+    });
+  }
 };
 
 class PosixWritableFile : public WritableFile {
@@ -121,9 +147,16 @@ class PosixReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
  public:
   PosixReadOnlyMemoryRegion(const void* address, uint64 length)
       : address_(address), length_(length) {}
-  ~PosixReadOnlyMemoryRegion() { munmap(const_cast<void*>(address_), length_); }
+  ~PosixReadOnlyMemoryRegion() {
+    if (length_ > 0) munmap(const_cast<void*>(address_), length_);
+  }
   const void* data() override { return address_; }
   uint64 length() override { return length_; }
+  void AdviseSequentialAccess() override {
+    if (length_ > 0) {
+      madvise(const_cast<void*>(address_), length_, MADV_SEQUENTIAL);
+    }
+  }
 
  private:
   const void* const address_;
@@ -179,6 +212,12 @@ Status PosixFileSystem::NewReadOnlyMemoryRegionFromFile(
   } else {
     struct stat st;
     ::fstat(fd, &st);
+    if (st.st_size == 0) {
+      // mmap() does not accept empty mappings.
+      result->reset(new PosixReadOnlyMemoryRegion(nullptr, 0));
+      close(fd);
+      return s;
+    }
     const void* address =
         mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
     if (address == MAP_FAILED) {
@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/platform/init_main.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/types.h"
 
@@ -58,6 +59,18 @@ void* aligned_malloc(size_t size, int minimum_alignment) {
 
 void aligned_free(void* aligned_memory) { _aligned_free(aligned_memory); }
 
+int NUMANumNodes() { return 1; }
+
+int NUMANumSchedulableCPUs(int node) { return 0; }
+
+bool NUMASetThreadNodeAffinity(int node) { return false; }
+
+void* NUMAMalloc(int node, size_t size, int minimum_alignment) {
+  return aligned_malloc(size, minimum_alignment);
+}
+
+void NUMAFree(void* ptr, size_t size) { aligned_free(ptr); }
+
 void MallocExtension_ReleaseToSystem(std::size_t num_bytes) {
   // No-op.
 }
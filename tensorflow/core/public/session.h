@@ -170,6 +170,32 @@ class Session {
                       const std::vector<string>& output_names,
                       std::vector<Tensor>* outputs);
 
+  /// \brief A handle to a signature registered with `MakeCallable()`.
+  typedef int64 CallableHandle;
+
+  /// \brief Registers the signature fed by `feed_names`, fetching
+  /// `fetch_names` and running `target_nodes`, and returns a `handle` that
+  /// `RunCallable()` can run repeatedly without looking the signature up
+  /// again. The handle must be released with `ReleaseCallable()`.
+  /// NOTE: This API is still experimental and may change.
+  virtual Status MakeCallable(const std::vector<string>& feed_names,
+                              const std::vector<string>& fetch_names,
+                              const std::vector<string>& target_nodes,
+                              CallableHandle* handle);
+
+  /// \brief Runs the signature registered as `handle`. `feed_tensors[i]`
+  /// is fed to `feed_names[i]` of the `MakeCallable()` call, and on
+  /// success `fetch_tensors[i]` holds the value of `fetch_names[i]`.
+  /// NOTE: This API is still experimental and may change.
+  virtual Status RunCallable(CallableHandle handle,
+                             const std::vector<Tensor>& feed_tensors,
+                             std::vector<Tensor>* fetch_tensors);
+
+  /// \brief Releases the resources associated with `handle`, which may
+  /// not be run again.
+  /// NOTE: This API is still experimental and may change.
+  virtual Status ReleaseCallable(CallableHandle handle);
+
   /// \brief Closes this session.
   ///
   /// Closing a session releases the resources used by this session
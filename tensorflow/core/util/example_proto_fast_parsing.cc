@@ -211,6 +211,14 @@ class Feature {
 using FeatureMapEntry = std::pair<StringPiece, Feature>;
 using Example = std::vector<FeatureMapEntry>;
 
+// Name and serialized FeatureList.
+using FeatureListMapEntry = std::pair<StringPiece, StringPiece>;
+
+struct SequenceExample {
+  Example context;
+  std::vector<FeatureListMapEntry> feature_lists;
+};
+
 }  // namespace parsed
 
 bool ParseString(protobuf::io::CodedInputStream* stream, StringPiece* result) {
@@ -233,24 +241,35 @@ bool ParseString(protobuf::io::CodedInputStream* stream, StringPiece* result) {
   return true;
 }
 
-bool ParseFeatureMapEntry(protobuf::io::CodedInputStream* stream,
-                          parsed::FeatureMapEntry* feature_map_entry) {
+bool ParseMapEntry(protobuf::io::CodedInputStream* stream, StringPiece* key,
+                   StringPiece* value) {
   DCHECK(stream != nullptr);
-  DCHECK(feature_map_entry != nullptr);
+  DCHECK(key != nullptr);
+  DCHECK(value != nullptr);
   uint32 length;
   if (!stream->ReadVarint32(&length)) return false;
   auto limit = stream->PushLimit(length);
   if (!stream->ExpectTag(kDelimitedTag(1))) return false;
-  if (!ParseString(stream, &feature_map_entry->first)) return false;
+  if (!ParseString(stream, key)) return false;
   if (!stream->ExpectTag(kDelimitedTag(2))) return false;
-  StringPiece feature_string_piece;
-  if (!ParseString(stream, &feature_string_piece)) return false;
-  feature_map_entry->second = parsed::Feature(feature_string_piece);
+  if (!ParseString(stream, value)) return false;
   if (!stream->ExpectAtEnd()) return false;
   stream->PopLimit(limit);
   return true;
 }
 
+bool ParseFeatureMapEntry(protobuf::io::CodedInputStream* stream,
+                          parsed::FeatureMapEntry* feature_map_entry) {
+  DCHECK(feature_map_entry != nullptr);
+  StringPiece feature_string_piece;
+  if (!ParseMapEntry(stream, &feature_map_entry->first,
+                     &feature_string_piece)) {
+    return false;
+  }
+  feature_map_entry->second = parsed::Feature(feature_string_piece);
+  return true;
+}
+
 bool ParseFeatures(protobuf::io::CodedInputStream* stream,
                    parsed::Example* example) {
   DCHECK(stream != nullptr);
@@ -290,6 +309,61 @@ bool ParseExample(StringPiece serialized, parsed::Example* example) {
   return ParseExample(&stream, example);
 }
 
+bool ParseFeatureLists(protobuf::io::CodedInputStream* stream,
+                       parsed::SequenceExample* sequence_example) {
+  DCHECK(stream != nullptr);
+  DCHECK(sequence_example != nullptr);
+  uint32 length;
+  if (!stream->ReadVarint32(&length)) return false;
+  auto limit = stream->PushLimit(length);
+  while (!stream->ExpectAtEnd()) {
+    parsed::FeatureListMapEntry feature_list_map_entry;
+    if (!stream->ExpectTag(kDelimitedTag(1))) return false;
+    if (!ParseMapEntry(stream, &feature_list_map_entry.first,
+                       &feature_list_map_entry.second)) {
+      return false;
+    }
+    sequence_example->feature_lists.push_back(feature_list_map_entry);
+  }
+  stream->PopLimit(limit);
+  return true;
+}
+
+bool ParseSequenceExample(StringPiece serialized,
+                          parsed::SequenceExample* sequence_example) {
+  DCHECK(sequence_example != nullptr);
+  protobuf::io::CodedInputStream stream(
+      reinterpret_cast<const uint8*>(serialized.data()), serialized.size());
+  EnableAliasing(&stream);
+  // As for Example, concatenated SequenceExamples are merged.
+  while (!stream.ExpectAtEnd()) {
+    if (stream.ExpectTag(kDelimitedTag(1))) {
+      if (!ParseFeatures(&stream, &sequence_example->context)) return false;
+    } else if (stream.ExpectTag(kDelimitedTag(2))) {
+      if (!ParseFeatureLists(&stream, sequence_example)) return false;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Splits a serialized FeatureList into its Features.
+bool ParseFeatureList(StringPiece serialized,
+                      std::vector<parsed::Feature>* feature_list) {
+  DCHECK(feature_list != nullptr);
+  protobuf::io::CodedInputStream stream(
+      reinterpret_cast<const uint8*>(serialized.data()), serialized.size());
+  EnableAliasing(&stream);
+  while (!stream.ExpectAtEnd()) {
+    if (!stream.ExpectTag(kDelimitedTag(1))) return false;
+    StringPiece feature_string_piece;
+    if (!ParseString(&stream, &feature_string_piece)) return false;
+    feature_list->emplace_back(feature_string_piece);
+  }
+  return true;
+}
+
 }  // namespace
 
 bool TestFastParse(const string& serialized, Example* example) {
@@ -417,29 +491,27 @@ class LimitedArraySlice {
   T* end_;
 };
 
-Status FastParseSerializedExample(
-    const string& serialized_example, const string& example_name,
+// Writes the features of "parsed_example" to row "example_index" of
+// "output_dense" and appends them to "output_sparse".
+Status FastParseExampleFeatures(
+    parsed::Example* parsed_example, const string& example_name,
     const size_t example_index, const Config& config,
     const PresizedCuckooMap<std::pair<size_t, Type>>& config_index,
     SeededHasher hasher, std::vector<Tensor>* output_dense,
     std::vector<SparseBuffer>* output_sparse) {
+  DCHECK(parsed_example != nullptr);
   DCHECK(output_dense != nullptr);
   DCHECK(output_sparse != nullptr);
-  parsed::Example parsed_example;
-  if (!ParseExample(serialized_example, &parsed_example)) {
-    return errors::InvalidArgument("Could not parse example input, value: '",
-                                   serialized_example, "'");
-  }
   std::vector<int64> sparse_feature_last_example(config.sparse.size(), -1);
   std::vector<int64> dense_feature_last_example(config.dense.size(), -1);
 
   // Handle features present in the example.
-  const size_t parsed_example_size = parsed_example.size();
+  const size_t parsed_example_size = parsed_example->size();
   for (size_t i = 0; i < parsed_example_size; ++i) {
     // This is a logic that standard protobuf parsing is implementing.
     // I.e. last entry in the map overwrites all the previous ones.
     parsed::FeatureMapEntry& name_and_feature =
-        parsed_example[parsed_example_size - i - 1];
+        (*parsed_example)[parsed_example_size - i - 1];
 
     const StringPiece feature_name = name_and_feature.first;
     parsed::Feature& feature = name_and_feature.second;
@@ -659,6 +731,154 @@ Status CheckConfigDataType(DataType dtype) {
   }
 }
 
+
+using ConfigIndex = PresizedCuckooMap<std::pair<size_t, Type>>;
+
+// Indexes the hashes of the feature names of "dense" and "sparse" in
+// "config_index", changing the seed of "hasher" until there is no collision.
+template <typename DenseConfig, typename SparseConfig>
+Status BuildConfigIndex(const std::vector<DenseConfig>& dense,
+                        const std::vector<SparseConfig>& sparse,
+                        SeededHasher* hasher, ConfigIndex* config_index) {
+  const size_t config_size = dense.size() + sparse.size();
+  for (size_t i = 0; i < 1000; ++i) {
+    bool ok = true;
+    for (size_t d = 0; d < dense.size(); ++d) {
+      ok &= config_index->InsertUnique((*hasher)(dense[d].feature_name),
+                                       {d, Type::Dense});
+    }
+    for (size_t d = 0; d < sparse.size(); ++d) {
+      ok &= config_index->InsertUnique((*hasher)(sparse[d].feature_name),
+                                       {d, Type::Sparse});
+    }
+    if (ok) return Status::OK();
+    LOG(WARNING) << "Collision found. This should happen only if you have "
+                    "around 2^32 entries in your config.";
+    hasher->seed++;
+    config_index->Clear(config_size);
+  }
+  return errors::Internal("Could not avoid collision. This should not happen.");
+}
+
+// Returns the number of minibatches "serialized" is split into for parallel
+// parsing.
+//
+// TODO(lew): A big performance low-hanging fruit here is to improve
+//   num_minibatches calculation to take into account actual amount of work
+//   needed, as the size in bytes is not perfect. Linear combination of
+//   size in bytes and average number of features per example is promising.
+//   Even better: measure time instead of estimating, but this is too costly
+//   in small batches.
+//   Maybe accept outside parameter #num_minibatches?
+size_t NumMiniBatches(gtl::ArraySlice<string> serialized) {
+  // This parameter affects performance in a big and data-dependent way.
+  const size_t kMiniBatchSizeBytes = 50000;
+
+  // Calculate number of minibatches.
+  // In main regime make each minibatch around kMiniBatchSizeBytes bytes.
+  // Apply 'special logic' below for small and big regimes.
+  size_t result = 0;
+  size_t minibatch_bytes = 0;
+  for (size_t i = 0; i < serialized.size(); i++) {
+    if (minibatch_bytes == 0) {  // start minibatch
+      result++;
+    }
+    minibatch_bytes += serialized[i].size() + 1;
+    if (minibatch_bytes > kMiniBatchSizeBytes) {
+      minibatch_bytes = 0;
+    }
+  }
+  // 'special logic'
+  const size_t min_minibatches = std::min<size_t>(8, serialized.size());
+  const size_t max_minibatches = 64;
+  return std::max<size_t>(min_minibatches,
+                          std::min<size_t>(max_minibatches, result));
+}
+
+// Moves the values of "buffer" to "values", starting at "offset".
+void CopySparseBufferValues(DataType dtype, size_t offset,
+                            SparseBuffer* buffer, Tensor* values) {
+  switch (dtype) {
+    case DT_INT64: {
+      std::copy(buffer->int64_list.begin(), buffer->int64_list.end(),
+                values->flat<int64>().data() + offset);
+      break;
+    }
+    case DT_FLOAT: {
+      std::copy(buffer->float_list.begin(), buffer->float_list.end(),
+                values->flat<float>().data() + offset);
+      break;
+    }
+    case DT_STRING: {
+      std::move(buffer->bytes_list.begin(), buffer->bytes_list.end(),
+                values->flat<string>().data() + offset);
+      break;
+    }
+    default:
+      CHECK(false) << "Should not happen.";
+  }
+}
+
+// Merges the SparseBuffers of sparse feature "d" from all minibatches and
+// appends the resulting sparse tensor to "result".
+void MergeSparseBuffers(DataType dtype, size_t num_examples, size_t d,
+                        std::vector<std::vector<SparseBuffer>>* sparse_buffers,
+                        Result* result) {
+  // Loop over minibatches
+  size_t total_num_features = 0;
+  size_t max_num_features = 0;
+  for (auto& sparse_values_tmp : *sparse_buffers) {
+    std::vector<size_t>& end_indices = sparse_values_tmp[d].example_end_indices;
+    total_num_features += end_indices.back();
+    max_num_features = std::max(max_num_features, end_indices[0]);
+    for (size_t i = 1; i < end_indices.size(); ++i) {
+      size_t example_size = end_indices[i] - end_indices[i - 1];
+      max_num_features = std::max(max_num_features, example_size);
+    }
+  }
+
+  TensorShape indices_shape;
+  indices_shape.AddDim(total_num_features);
+  indices_shape.AddDim(2);
+  result->sparse_indices.emplace_back(DT_INT64, indices_shape);
+  Tensor* indices = &result->sparse_indices.back();
+
+  TensorShape values_shape;
+  values_shape.AddDim(total_num_features);
+  result->sparse_values.emplace_back(dtype, values_shape);
+  Tensor* values = &result->sparse_values.back();
+
+  result->sparse_shapes.emplace_back(DT_INT64, TensorShape({2}));
+  auto shapes_shape_t = result->sparse_shapes.back().vec<int64>();
+  shapes_shape_t(0) = num_examples;
+  shapes_shape_t(1) = max_num_features;
+
+  size_t offset = 0;
+  size_t example_index = 0;
+  for (auto& minibatch_buffers : *sparse_buffers) {
+    SparseBuffer& buffer = minibatch_buffers[d];
+
+    // Update indices.
+    int64* ix_p = indices->matrix<int64>().data() + 2 * offset;
+    size_t delta = 0;
+    for (size_t example_end_index : buffer.example_end_indices) {
+      size_t feature_index = 0;
+      for (; delta < example_end_index; ++delta) {
+        // Column 0: example index
+        *ix_p = example_index;
+        // Column 1: the feature index buffer example
+        *(ix_p + 1) = feature_index;
+        ix_p += 2;
+        ++feature_index;
+      }
+      ++example_index;
+    }
+
+    CopySparseBufferValues(dtype, offset, &buffer, values);
+    offset += delta;
+  }
+}
+
 }  // namespace
 
 Status FastParseExample(const Config& config,
@@ -674,30 +894,10 @@ Status FastParseExample(const Config& config,
     TF_RETURN_IF_ERROR(CheckConfigDataType(c.dtype));
   }
 
-  size_t config_size = config.dense.size() + config.sparse.size();
   SeededHasher hasher;
-  // Build config index.
-  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
-  }
+  ConfigIndex config_index(config.dense.size() + config.sparse.size());
+  TF_RETURN_IF_ERROR(
+      BuildConfigIndex(config.dense, config.sparse, &hasher, &config_index));
 
   // Allocate dense output (sparse have to be buffered).
   for (size_t d = 0; d < config.dense.size(); ++d) {
@@ -709,43 +909,12 @@ Status FastParseExample(const Config& config,
     result->dense_values.emplace_back(config.dense[d].dtype, out_shape);
   }
 
-  // This parameter affects performance in a big and data-dependent way.
-  const size_t kMiniBatchSizeBytes = 50000;
-
-  // Calculate number of minibatches.
-  // In main regime make each minibatch around kMiniBatchSizeBytes bytes.
-  // Apply 'special logic' below for small and big regimes.
-  const size_t num_minibatches = [&] {
-    size_t result = 0;
-    size_t minibatch_bytes = 0;
-    for (size_t i = 0; i < serialized.size(); i++) {
-      if (minibatch_bytes == 0) {  // start minibatch
-        result++;
-      }
-      minibatch_bytes += serialized[i].size() + 1;
-      if (minibatch_bytes > kMiniBatchSizeBytes) {
-        minibatch_bytes = 0;
-      }
-    }
-    // 'special logic'
-    const size_t min_minibatches = std::min<size_t>(8, serialized.size());
-    const size_t max_minibatches = 64;
-    return std::max<size_t>(min_minibatches,
-                            std::min<size_t>(max_minibatches, result));
-  }();
+  const size_t num_minibatches = NumMiniBatches(serialized);
 
   auto first_example_of_minibatch = [&](size_t minibatch) -> size_t {
     return (serialized.size() * minibatch) / num_minibatches;
   };
 
-  // TODO(lew): A big performance low-hanging fruit here is to improve
-  //   num_minibatches calculation to take into account actual amount of work
-  //   needed, as the size in bytes is not perfect. Linear combination of
-  //   size in bytes and average number of features per example is promising.
-  //   Even better: measure time instead of estimating, but this is too costly
-  //   in small batches.
-  //   Maybe accept outside parameter #num_minibatches?
-
   // Do minibatches in parallel.
   std::vector<std::vector<SparseBuffer>> sparse_buffers(num_minibatches);
   std::vector<Status> status_of_minibatch(num_minibatches);
@@ -754,8 +923,14 @@ Status FastParseExample(const Config& config,
     size_t start = first_example_of_minibatch(minibatch);
     size_t end = first_example_of_minibatch(minibatch + 1);
     for (size_t e = start; e < end; ++e) {
-      status_of_minibatch[minibatch] = FastParseSerializedExample(
-          serialized[e],
+      parsed::Example parsed_example;
+      if (!ParseExample(serialized[e], &parsed_example)) {
+        status_of_minibatch[minibatch] = errors::InvalidArgument(
+            "Could not parse example input, value: '", serialized[e], "'");
+        break;
+      }
+      status_of_minibatch[minibatch] = FastParseExampleFeatures(
+          &parsed_example,
           (example_names.size() > 0 ? example_names[e] : "<unknown>"), e,
           config, config_index, hasher, &result->dense_values,
           &sparse_buffers[minibatch]);
@@ -770,85 +945,434 @@ Status FastParseExample(const Config& config,
   }
 
   // Merge SparseBuffers from all minibatches for every config.sparse.
-  auto MergeMinibatches = [&](size_t d) {
-    // Loop over minibatches
-    size_t total_num_features = 0;
-    size_t max_num_features = 0;
-    for (auto& sparse_values_tmp : sparse_buffers) {
-      std::vector<size_t>& end_indices =
-          sparse_values_tmp[d].example_end_indices;
-      total_num_features += end_indices.back();
-      max_num_features = std::max(max_num_features, end_indices[0]);
-      for (size_t i = 1; i < end_indices.size(); ++i) {
-        size_t example_size = end_indices[i] - end_indices[i - 1];
-        max_num_features = std::max(max_num_features, example_size);
+  for (size_t d = 0; d < config.sparse.size(); ++d) {
+    MergeSparseBuffers(config.sparse[d].dtype, serialized.size(), d,
+                       &sparse_buffers, result);
+  }
+
+  return Status::OK();
+}
+
+// -----------------------------------------------------------------------------
+
+namespace {
+
+using SequenceConfig = FastParseSequenceExampleConfig;
+
+// The values of a sparse feature list in a minibatch of SequenceExamples.
+struct FeatureListSparseBuffer {
+  // The example_end_indices of values are the end indices of each step.
+  SparseBuffer values;
+
+  // Steps of example i are steps from example_end_steps[i-1] to
+  // example_end_steps[i]-1.
+  std::vector<size_t> example_end_steps;
+};
+
+// Returns the text format of a serialized Feature, for error messages.
+string FeatureDebugString(StringPiece serialized) {
+  Feature feature;
+  if (!ParseProtoUnlimited(&feature, serialized.data(), serialized.size())) {
+    return "<unparseable>";
+  }
+  return ProtoDebugString(feature);
+}
+
+// Appends the values of "feature", whose data type is "dtype", to "buffer"
+// and sets "*size" to the new number of values in "buffer".
+bool AppendSparseValues(DataType dtype, parsed::Feature* feature,
+                        SparseBuffer* buffer, size_t* size) {
+  switch (dtype) {
+    case DT_INT64:
+      if (!feature->ParseInt64List(&buffer->int64_list)) return false;
+      *size = buffer->int64_list.size();
+      return true;
+    case DT_FLOAT:
+      if (!feature->ParseFloatList(&buffer->float_list)) return false;
+      *size = buffer->float_list.size();
+      return true;
+    case DT_STRING:
+      if (!feature->ParseBytesList(&buffer->bytes_list)) return false;
+      *size = buffer->bytes_list.size();
+      return true;
+    default:
+      CHECK(false) << "Should not happen.";
+      return false;
+  }
+}
+
+// Handles the feature lists of "sequence_example". Sparse ones are appended
+// to "feature_list_sparse". The steps of dense ones are checked and stored
+// in row "example_index" of "feature_list_dense_steps", to be copied once
+// the length of the longest list of the batch is known.
+Status FastParseFeatureLists(
+    const parsed::SequenceExample& sequence_example, const string& example_name,
+    const size_t example_index, const SequenceConfig& config,
+    const ConfigIndex& config_index, SeededHasher hasher,
+    std::vector<std::vector<std::vector<parsed::Feature>>>*
+        feature_list_dense_steps,
+    std::vector<FeatureListSparseBuffer>* feature_list_sparse) {
+  DCHECK(feature_list_dense_steps != nullptr);
+  DCHECK(feature_list_sparse != nullptr);
+  std::vector<bool> dense_found(config.feature_list_dense.size(), false);
+  std::vector<bool> sparse_found(config.feature_list_sparse.size(), false);
+
+  const size_t num_feature_lists = sequence_example.feature_lists.size();
+  for (size_t i = 0; i < num_feature_lists; ++i) {
+    // As for features, the last entry in the map overwrites the previous
+    // ones.
+    const parsed::FeatureListMapEntry& name_and_feature_list =
+        sequence_example.feature_lists[num_feature_lists - i - 1];
+    const StringPiece feature_name = name_and_feature_list.first;
+
+    std::pair<size_t, Type> d_and_type;
+    if (!config_index.Find(hasher(feature_name), &d_and_type)) continue;
+    const size_t d = d_and_type.first;
+    const bool is_dense = d_and_type.second == Type::Dense;
+    // Testing for PresizedCuckooMap collision.
+    if (feature_name != (is_dense
+                             ? config.feature_list_dense[d].feature_name
+                             : config.feature_list_sparse[d].feature_name)) {
+      continue;
+    }
+    std::vector<bool>& found = is_dense ? dense_found : sparse_found;
+    if (found[d]) continue;
+    found[d] = true;
+
+    const DataType dtype = is_dense ? config.feature_list_dense[d].dtype
+                                    : config.feature_list_sparse[d].dtype;
+    std::vector<parsed::Feature> steps;
+    if (!ParseFeatureList(name_and_feature_list.second, &steps)) {
+      return errors::InvalidArgument(
+          "Name: ", example_name, ", Feature list: ", feature_name,
+          ".  Can't parse serialized SequenceExample.");
+    }
+    for (size_t t = 0; t < steps.size(); ++t) {
+      const StringPiece serialized_feature = steps[t].GetSerialized();
+      DataType step_dtype;
+      TF_RETURN_IF_ERROR(steps[t].ParseDataType(&step_dtype));
+      if (step_dtype != dtype) {
+        return errors::InvalidArgument(
+            "Name: ", example_name, ", Feature list: ", feature_name,
+            ", Index: ", t, ".  Data types don't match. Expected type: ",
+            DataTypeString(dtype),
+            "  Feature is: ", FeatureDebugString(serialized_feature));
       }
     }
 
-    TensorShape indices_shape;
-    indices_shape.AddDim(total_num_features);
-    indices_shape.AddDim(2);
-    result->sparse_indices.emplace_back(DT_INT64, indices_shape);
-    Tensor* indices = &result->sparse_indices.back();
-
-    TensorShape values_shape;
-    values_shape.AddDim(total_num_features);
-    result->sparse_values.emplace_back(config.sparse[d].dtype, values_shape);
-    Tensor* values = &result->sparse_values.back();
-
-    result->sparse_shapes.emplace_back(DT_INT64, TensorShape({2}));
-    auto shapes_shape_t = result->sparse_shapes.back().vec<int64>();
-    shapes_shape_t(0) = serialized.size();
-    shapes_shape_t(1) = max_num_features;
-
-    size_t offset = 0;
-    for (size_t i = 0; i < sparse_buffers.size(); ++i) {
-      const SparseBuffer& buffer = sparse_buffers[i][d];
-
-      // Update indices.
-      int64* ix_p = &indices->matrix<int64>()(offset, 0);
-      size_t delta = 0;
-      size_t example_index = first_example_of_minibatch(i);
-      for (size_t example_end_index : buffer.example_end_indices) {
-        size_t feature_index = 0;
-        for (; delta < example_end_index; ++delta) {
-          // Column 0: example index
-          *ix_p = example_index;
-          // Column 1: the feature index buffer example
-          *(ix_p + 1) = feature_index;
-          ix_p += 2;
-          ++feature_index;
+    if (is_dense) {
+      (*feature_list_dense_steps)[d][example_index] = std::move(steps);
+    } else {
+      SparseBuffer& out = (*feature_list_sparse)[d].values;
+      for (size_t t = 0; t < steps.size(); ++t) {
+        size_t size;
+        if (!AppendSparseValues(dtype, &steps[t], &out, &size)) {
+          return errors::InvalidArgument(
+              "Name: ", example_name, ", Key: ", feature_name, ", Index: ", t,
+              ".  Can't parse serialized SequenceExample.");
         }
-        ++example_index;
+        out.example_end_indices.push_back(size);
       }
+    }
+  }
 
-      // Copy values over.
-      switch (config.sparse[d].dtype) {
-        case DT_INT64: {
-          std::copy(buffer.int64_list.begin(), buffer.int64_list.end(),
-                    values->flat<int64>().data() + offset);
-          break;
-        }
-        case DT_FLOAT: {
-          std::copy(buffer.float_list.begin(), buffer.float_list.end(),
-                    values->flat<float>().data() + offset);
-          break;
-        }
-        case DT_STRING: {
-          std::move(buffer.bytes_list.begin(), buffer.bytes_list.end(),
-                    values->flat<string>().data() + offset);
-          break;
+  for (size_t d = 0; d < config.feature_list_dense.size(); ++d) {
+    if (!dense_found[d] &&
+        !config.feature_list_dense[d].missing_assumed_empty) {
+      return errors::InvalidArgument(
+          "Name: ", example_name, ", Feature list '",
+          config.feature_list_dense[d].feature_name,
+          "' is required but could not be found.  "
+          "Did you mean to include it in "
+          "feature_list_dense_missing_assumed_empty or "
+          "feature_list_dense_defaults?");
+    }
+  }
+  for (FeatureListSparseBuffer& buffer : *feature_list_sparse) {
+    buffer.example_end_steps.push_back(
+        buffer.values.example_end_indices.size());
+  }
+  return Status::OK();
+}
+
+bool ParseValues(parsed::Feature* feature, LimitedArraySlice<int64>* values) {
+  return feature->ParseInt64List(values);
+}
+
+bool ParseValues(parsed::Feature* feature, LimitedArraySlice<float>* values) {
+  return feature->ParseFloatList(values);
+}
+
+bool ParseValues(parsed::Feature* feature, LimitedArraySlice<string>* values) {
+  return feature->ParseBytesList(values);
+}
+
+// Copies "steps" of a dense feature list to row "example_index" of
+// "values", whose rows hold "max_num_steps" steps, and pads the row with
+// zeros (or empty strings).
+template <typename T>
+Status FillFeatureListDense(const string& example_name,
+                            const size_t example_index,
+                            const SequenceConfig::FeatureListDense& config,
+                            size_t max_num_steps,
+                            std::vector<parsed::Feature>* steps,
+                            Tensor* values) {
+  const size_t num_elements = config.shape.num_elements();
+  T* row = values->flat<T>().data() + example_index * max_num_steps *
+                                          num_elements;
+  for (size_t t = 0; t < steps->size(); ++t) {
+    LimitedArraySlice<T> slice(row + t * num_elements, num_elements);
+    if (!ParseValues(&(*steps)[t], &slice)) {
+      return errors::InvalidArgument(
+          "Name: ", example_name, ", Key: ", config.feature_name, ", Index: ",
+          t, ".  Can't parse serialized SequenceExample.");
+    }
+    if (slice.EndDistance() != 0) {
+      return errors::InvalidArgument(
+          "Name: ", example_name, ", Key: ", config.feature_name, ", Index: ",
+          t, ".  Number of ", DataTypeString(config.dtype),
+          " values != expected.  values size: ",
+          num_elements - slice.EndDistance(),
+          " but output shape: ", config.shape.DebugString());
+    }
+  }
+  std::fill(row + steps->size() * num_elements,
+            row + max_num_steps * num_elements, T());
+  return Status::OK();
+}
+
+// Merges the FeatureListSparseBuffers of sparse feature list "d" from all
+// minibatches and appends the resulting sparse tensor, whose indices are
+// (example, step, index in step), to "result".
+void MergeFeatureListSparseBuffers(
+    DataType dtype, size_t num_examples, size_t d,
+    std::vector<std::vector<FeatureListSparseBuffer>>* feature_list_buffers,
+    SequenceResult* result) {
+  size_t total_num_features = 0;
+  size_t max_num_steps = 0;
+  size_t max_num_features = 0;
+  for (auto& minibatch_buffers : *feature_list_buffers) {
+    const FeatureListSparseBuffer& buffer = minibatch_buffers[d];
+    size_t step_begin = 0;
+    for (size_t step_end : buffer.values.example_end_indices) {
+      max_num_features = std::max(max_num_features, step_end - step_begin);
+      step_begin = step_end;
+    }
+    total_num_features += step_begin;
+    size_t example_begin = 0;
+    for (size_t example_end : buffer.example_end_steps) {
+      max_num_steps = std::max(max_num_steps, example_end - example_begin);
+      example_begin = example_end;
+    }
+  }
+
+  TensorShape indices_shape;
+  indices_shape.AddDim(total_num_features);
+  indices_shape.AddDim(3);
+  result->feature_list_sparse_indices.emplace_back(DT_INT64, indices_shape);
+  int64* ix_p =
+      result->feature_list_sparse_indices.back().matrix<int64>().data();
+
+  TensorShape values_shape;
+  values_shape.AddDim(total_num_features);
+  result->feature_list_sparse_values.emplace_back(dtype, values_shape);
+  Tensor* values = &result->feature_list_sparse_values.back();
+
+  result->feature_list_sparse_shapes.emplace_back(DT_INT64, TensorShape({3}));
+  auto shapes_shape_t = result->feature_list_sparse_shapes.back().vec<int64>();
+  shapes_shape_t(0) = num_examples;
+  shapes_shape_t(1) = max_num_steps;
+  shapes_shape_t(2) = max_num_features;
+
+  size_t offset = 0;
+  size_t example_index = 0;
+  for (auto& minibatch_buffers : *feature_list_buffers) {
+    FeatureListSparseBuffer& buffer = minibatch_buffers[d];
+    const std::vector<size_t>& step_end_indices =
+        buffer.values.example_end_indices;
+    size_t step = 0;
+    size_t delta = 0;
+    for (size_t example_end_step : buffer.example_end_steps) {
+      for (size_t t = 0; step < example_end_step; ++step, ++t) {
+        for (size_t k = 0; delta < step_end_indices[step]; ++delta, ++k) {
+          ix_p[0] = example_index;
+          ix_p[1] = t;
+          ix_p[2] = k;
+          ix_p += 3;
         }
-        default:
-          CHECK(false) << "Should not happen.";
       }
+      ++example_index;
+    }
+    CopySparseBufferValues(dtype, offset, &buffer.values, values);
+    offset += delta;
+  }
+}
+
+}  // namespace
+
+Status FastParseSequenceExample(const FastParseSequenceExampleConfig& config,
+                                gtl::ArraySlice<string> serialized,
+                                gtl::ArraySlice<string> example_names,
+                                thread::ThreadPool* thread_pool,
+                                SequenceResult* result) {
+  DCHECK(result != nullptr);
+  // Check config so we can safely CHECK(false) in switches on config.*.dtype
+  for (auto& c : config.context.sparse) {
+    TF_RETURN_IF_ERROR(CheckConfigDataType(c.dtype));
+  }
+  for (auto& c : config.context.dense) {
+    TF_RETURN_IF_ERROR(CheckConfigDataType(c.dtype));
+  }
+  for (auto& c : config.feature_list_sparse) {
+    TF_RETURN_IF_ERROR(CheckConfigDataType(c.dtype));
+  }
+  for (auto& c : config.feature_list_dense) {
+    TF_RETURN_IF_ERROR(CheckConfigDataType(c.dtype));
+  }
+
+  SeededHasher context_hasher;
+  ConfigIndex context_index(config.context.dense.size() +
+                            config.context.sparse.size());
+  TF_RETURN_IF_ERROR(BuildConfigIndex(config.context.dense,
+                                      config.context.sparse, &context_hasher,
+                                      &context_index));
+  SeededHasher feature_list_hasher;
+  ConfigIndex feature_list_index(config.feature_list_dense.size() +
+                                 config.feature_list_sparse.size());
+  TF_RETURN_IF_ERROR(BuildConfigIndex(
+      config.feature_list_dense, config.feature_list_sparse,
+      &feature_list_hasher, &feature_list_index));
+
+  const size_t num_examples = serialized.size();
+
+  // Allocate dense context output.
+  for (size_t d = 0; d < config.context.dense.size(); ++d) {
+    TensorShape out_shape;
+    out_shape.AddDim(num_examples);
+    out_shape.AppendShape(config.context.dense[d].shape);
+    result->context.dense_values.emplace_back(config.context.dense[d].dtype,
+                                              out_shape);
+  }
 
-      offset += delta;
+  const size_t num_minibatches = NumMiniBatches(serialized);
+
+  auto first_example_of_minibatch = [&](size_t minibatch) -> size_t {
+    return (num_examples * minibatch) / num_minibatches;
+  };
+
+  // Parse minibatches in parallel. The context is handled as an Example.
+  std::vector<std::vector<SparseBuffer>> context_sparse_buffers(
+      num_minibatches);
+  std::vector<std::vector<FeatureListSparseBuffer>> feature_list_sparse_buffers(
+      num_minibatches);
+  // Indexed by feature list, then example.
+  std::vector<std::vector<std::vector<parsed::Feature>>>
+      feature_list_dense_steps(
+          config.feature_list_dense.size(),
+          std::vector<std::vector<parsed::Feature>>(num_examples));
+  std::vector<Status> status_of_minibatch(num_minibatches);
+  auto ParseMiniBatch = [&](size_t minibatch) {
+    context_sparse_buffers[minibatch].resize(config.context.sparse.size());
+    feature_list_sparse_buffers[minibatch].resize(
+        config.feature_list_sparse.size());
+    Status& status = status_of_minibatch[minibatch];
+    size_t start = first_example_of_minibatch(minibatch);
+    size_t end = first_example_of_minibatch(minibatch + 1);
+    for (size_t e = start; e < end && status.ok(); ++e) {
+      const string& example_name =
+          example_names.size() > 0 ? example_names[e] : "<unknown>";
+      parsed::SequenceExample sequence_example;
+      if (!ParseSequenceExample(serialized[e], &sequence_example)) {
+        status = errors::InvalidArgument(
+            "Could not parse example input, value: '", serialized[e], "'");
+        break;
+      }
+      status = FastParseExampleFeatures(
+          &sequence_example.context, example_name, e, config.context,
+          context_index, context_hasher, &result->context.dense_values,
+          &context_sparse_buffers[minibatch]);
+      if (!status.ok()) break;
+      status = FastParseFeatureLists(
+          sequence_example, example_name, e, config, feature_list_index,
+          feature_list_hasher, &feature_list_dense_steps,
+          &feature_list_sparse_buffers[minibatch]);
     }
   };
 
-  for (size_t d = 0; d < config.sparse.size(); ++d) {
-    MergeMinibatches(d);
+  ParallelFor(ParseMiniBatch, num_minibatches, thread_pool);
+
+  for (Status& status : status_of_minibatch) {
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  // Allocate dense feature list output, padded to the longest list.
+  std::vector<size_t> max_num_steps(config.feature_list_dense.size(), 0);
+  for (size_t d = 0; d < config.feature_list_dense.size(); ++d) {
+    result->feature_list_dense_lengths.emplace_back(
+        DT_INT64, TensorShape({static_cast<int64>(num_examples)}));
+    auto lengths_t = result->feature_list_dense_lengths.back().vec<int64>();
+    for (size_t e = 0; e < num_examples; ++e) {
+      const size_t num_steps = feature_list_dense_steps[d][e].size();
+      lengths_t(e) = num_steps;
+      max_num_steps[d] = std::max(max_num_steps[d], num_steps);
+    }
+    TensorShape out_shape;
+    out_shape.AddDim(num_examples);
+    out_shape.AddDim(max_num_steps[d]);
+    out_shape.AppendShape(config.feature_list_dense[d].shape);
+    result->feature_list_dense_values.emplace_back(
+        config.feature_list_dense[d].dtype, out_shape);
+  }
+
+  auto FillMiniBatch = [&](size_t minibatch) {
+    Status& status = status_of_minibatch[minibatch];
+    size_t start = first_example_of_minibatch(minibatch);
+    size_t end = first_example_of_minibatch(minibatch + 1);
+    for (size_t e = start; e < end && status.ok(); ++e) {
+      const string& example_name =
+          example_names.size() > 0 ? example_names[e] : "<unknown>";
+      for (size_t d = 0; d < config.feature_list_dense.size() && status.ok();
+           ++d) {
+        const SequenceConfig::FeatureListDense& c =
+            config.feature_list_dense[d];
+        std::vector<parsed::Feature>* steps = &feature_list_dense_steps[d][e];
+        Tensor* values = &result->feature_list_dense_values[d];
+        switch (c.dtype) {
+          case DT_INT64:
+            status = FillFeatureListDense<int64>(
+                example_name, e, c, max_num_steps[d], steps, values);
+            break;
+          case DT_FLOAT:
+            status = FillFeatureListDense<float>(
+                example_name, e, c, max_num_steps[d], steps, values);
+            break;
+          case DT_STRING:
+            status = FillFeatureListDense<string>(
+                example_name, e, c, max_num_steps[d], steps, values);
+            break;
+          default:
+            CHECK(false) << "Should not happen.";
+        }
+      }
+    }
+  };
+
+  if (!config.feature_list_dense.empty()) {
+    ParallelFor(FillMiniBatch, num_minibatches, thread_pool);
+    for (Status& status : status_of_minibatch) {
+      TF_RETURN_IF_ERROR(status);
+    }
+  }
+
+  // Merge sparse buffers from all minibatches.
+  for (size_t d = 0; d < config.context.sparse.size(); ++d) {
+    MergeSparseBuffers(config.context.sparse[d].dtype, num_examples, d,
+                       &context_sparse_buffers, &result->context);
+  }
+  for (size_t d = 0; d < config.feature_list_sparse.size(); ++d) {
+    MergeFeatureListSparseBuffers(config.feature_list_sparse[d].dtype,
+                                  num_examples, d,
+                                  &feature_list_sparse_buffers, result);
   }
 
   return Status::OK();
@@ -76,6 +76,60 @@ Status FastParseExample(const FastParseExampleConfig& config,
                         gtl::ArraySlice<string> example_names,
                         thread::ThreadPool* thread_pool, Result* result);
 
+// FastParseSequenceExampleConfig defines how to parse the context and the
+// feature lists of SequenceExample. The context is parsed like an Example.
+// It can't have two feature list sub-configs with the same feature_name.
+struct FastParseSequenceExampleConfig {
+  FastParseExampleConfig context;
+
+  struct FeatureListDense {
+    string feature_name;
+    DataType dtype;
+    // The shape of each step, as in feature_list_dense_shapes of the
+    // ParseSingleSequenceExample op.
+    TensorShape shape;
+    // If false, a SequenceExample without this feature list is an error.
+    bool missing_assumed_empty;
+  };
+
+  struct FeatureListSparse {
+    string feature_name;
+    DataType dtype;
+  };
+
+  std::vector<FeatureListDense> feature_list_dense;
+  std::vector<FeatureListSparse> feature_list_sparse;
+};
+
+// The output of FastParseSequenceExample for a batch of B SequenceExamples.
+// Feature lists have one more dimension than the outputs of the
+// ParseSingleSequenceExample op, the example index:
+//   feature_list_dense_values[j] has shape [B, T] + feature shape, where T
+//     is the length of the longest list of the batch. Shorter lists are
+//     padded with zeros, or empty strings.
+//   feature_list_dense_lengths[j] has shape [B] and holds the list lengths.
+//   feature_list_sparse_indices[j] has rows (example, step, index in step),
+//     and feature_list_sparse_shapes[j] is [B, max steps, max values].
+struct SequenceResult {
+  Result context;
+  std::vector<Tensor> feature_list_sparse_indices;
+  std::vector<Tensor> feature_list_sparse_values;
+  std::vector<Tensor> feature_list_sparse_shapes;
+  std::vector<Tensor> feature_list_dense_values;
+  std::vector<Tensor> feature_list_dense_lengths;
+};
+
+// Parses a batch of serialized SequenceExample protos and converts them into
+// result according to given config, with the same specialized parser as
+// FastParseExample.
+// Given example names have to either be empty or the same size as serialized.
+// example_names are used only for error messages.
+Status FastParseSequenceExample(const FastParseSequenceExampleConfig& config,
+                                gtl::ArraySlice<string> serialized,
+                                gtl::ArraySlice<string> example_names,
+                                thread::ThreadPool* thread_pool,
+                                SequenceResult* result);
+
 // This function parses serialized Example and populates given example.
 // It uses the same specialized parser as FastParseExample which is efficient.
 // But then constructs Example which is relatively slow.
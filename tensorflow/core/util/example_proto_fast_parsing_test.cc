@@ -15,11 +15,15 @@ limitations under the License.
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
 #include "tensorflow/core/example/example.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/util/example_proto_helper.h"
 
 namespace tensorflow {
 namespace example {
@@ -321,6 +325,290 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+string Serialize(const SequenceExample& example) {
+  string serialized;
+  example.SerializeToString(&serialized);
+  return serialized;
+}
+
+FeatureList* AddFeatureList(const string& name, SequenceExample* example) {
+  return &(*example->mutable_feature_lists()->mutable_feature_list())[name];
+}
+
+FastParseSequenceExampleConfig MakeSequenceConfig() {
+  FastParseSequenceExampleConfig config;
+  Tensor default_label(DT_INT64, TensorShape({1}));
+  default_label.flat<int64>()(0) = -1;
+  config.context.dense.push_back(
+      {"label", DT_INT64, TensorShape({1}), default_label});
+  config.context.sparse.push_back({"tags", DT_STRING});
+  config.feature_list_dense.push_back(
+      {"frames", DT_FLOAT, TensorShape({2}), true});
+  config.feature_list_sparse.push_back({"ids", DT_INT64});
+  return config;
+}
+
+TEST(TestFastParseSequenceExample, Batch) {
+  SequenceExample first;
+  auto& context = *first.mutable_context()->mutable_feature();
+  context["label"].mutable_int64_list()->add_value(7);
+  context["tags"].mutable_bytes_list()->add_value("a");
+  context["tags"].mutable_bytes_list()->add_value("b");
+  FeatureList* frames = AddFeatureList("frames", &first);
+  for (int t = 0; t < 3; ++t) {
+    FloatList* values = frames->add_feature()->mutable_float_list();
+    values->add_value(t);
+    values->add_value(t + 0.5f);
+  }
+  FeatureList* ids = AddFeatureList("ids", &first);
+  ids->add_feature()->mutable_int64_list()->add_value(10);
+  ids->add_feature()->mutable_int64_list();
+  ids->add_feature()->mutable_int64_list()->add_value(11);
+  ids->mutable_feature(2)->mutable_int64_list()->add_value(12);
+
+  // Everything is missing from the second example.
+  SequenceExample second;
+  SequenceExample third;
+  FeatureList* third_frames = AddFeatureList("frames", &third);
+  FloatList* values = third_frames->add_feature()->mutable_float_list();
+  values->add_value(8);
+  values->add_value(9);
+  AddFeatureList("ids", &third)->add_feature()->mutable_int64_list()->add_value(
+      13);
+
+  std::vector<string> serialized(
+      {Serialize(first), Serialize(second), Serialize(third)});
+  SequenceResult result;
+  TF_ASSERT_OK(FastParseSequenceExample(MakeSequenceConfig(), serialized, {},
+                                        nullptr, &result));
+
+  test::ExpectTensorEqual<int64>(
+      test::AsTensor<int64>({7, -1, -1}, TensorShape({3, 1})),
+      result.context.dense_values[0]);
+  test::ExpectTensorEqual<int64>(
+      test::AsTensor<int64>({0, 0, 0, 1}, TensorShape({2, 2})),
+      result.context.sparse_indices[0]);
+  test::ExpectTensorEqual<string>(test::AsTensor<string>({"a", "b"}),
+                                  result.context.sparse_values[0]);
+  test::ExpectTensorEqual<int64>(test::AsTensor<int64>({3, 2}),
+                                 result.context.sparse_shapes[0]);
+
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({0, 0.5, 1, 1.5, 2, 2.5,  // first
+                             0, 0, 0, 0, 0, 0,        // second
+                             8, 9, 0, 0, 0, 0},       // third
+                            TensorShape({3, 3, 2})),
+      result.feature_list_dense_values[0]);
+  test::ExpectTensorEqual<int64>(test::AsTensor<int64>({3, 0, 1}),
+                                 result.feature_list_dense_lengths[0]);
+
+  test::ExpectTensorEqual<int64>(
+      test::AsTensor<int64>({0, 0, 0, 0, 2, 0, 0, 2, 1, 2, 0, 0},
+                            TensorShape({4, 3})),
+      result.feature_list_sparse_indices[0]);
+  test::ExpectTensorEqual<int64>(test::AsTensor<int64>({10, 11, 12, 13}),
+                                 result.feature_list_sparse_values[0]);
+  test::ExpectTensorEqual<int64>(test::AsTensor<int64>({3, 3, 2}),
+                                 result.feature_list_sparse_shapes[0]);
+}
+
+TEST(TestFastParseSequenceExample, MultiThreaded) {
+  // Compares the results of many examples split into minibatches with
+  // those of the examples parsed one by one.
+  std::vector<string> serialized;
+  for (int i = 0; i < 100; ++i) {
+    SequenceExample example;
+    (*example.mutable_context()->mutable_feature())["label"]
+        .mutable_int64_list()
+        ->add_value(i);
+    FeatureList* frames = AddFeatureList("frames", &example);
+    FeatureList* ids = AddFeatureList("ids", &example);
+    for (int t = 0; t < i % 7; ++t) {
+      FloatList* values = frames->add_feature()->mutable_float_list();
+      values->add_value(i);
+      values->add_value(t);
+      Int64List* id_values = ids->add_feature()->mutable_int64_list();
+      for (int k = 0; k < t % 3; ++k) id_values->add_value(i * 100 + k);
+    }
+    serialized.push_back(Serialize(example));
+  }
+  thread::ThreadPool thread_pool(Env::Default(), "test", 4);
+  SequenceResult result;
+  TF_ASSERT_OK(FastParseSequenceExample(MakeSequenceConfig(), serialized, {},
+                                        &thread_pool, &result));
+
+  const Tensor& frames = result.feature_list_dense_values[0];
+  ASSERT_EQ(TensorShape({100, 6, 2}), frames.shape());
+  const Tensor& ids = result.feature_list_sparse_indices[0];
+  int64 num_ids = 0;
+  for (int i = 0; i < 100; ++i) {
+    SequenceResult single;
+    TF_ASSERT_OK(FastParseSequenceExample(MakeSequenceConfig(),
+                                          {serialized[i]}, {}, nullptr,
+                                          &single));
+    EXPECT_EQ(i, result.context.dense_values[0].flat<int64>()(i));
+    EXPECT_EQ(i % 7, result.feature_list_dense_lengths[0].vec<int64>()(i));
+    const Tensor& single_frames = single.feature_list_dense_values[0];
+    for (int j = 0; j < single_frames.NumElements(); ++j) {
+      EXPECT_EQ(single_frames.flat<float>()(j),
+                frames.flat<float>()(i * 12 + j));
+    }
+    const Tensor& single_ids = single.feature_list_sparse_indices[0];
+    for (int n = 0; n < single_ids.dim_size(0); ++n, ++num_ids) {
+      EXPECT_EQ(i, ids.matrix<int64>()(num_ids, 0));
+      EXPECT_EQ(single_ids.matrix<int64>()(n, 1),
+                ids.matrix<int64>()(num_ids, 1));
+      EXPECT_EQ(single_ids.matrix<int64>()(n, 2),
+                ids.matrix<int64>()(num_ids, 2));
+    }
+  }
+  EXPECT_EQ(num_ids, ids.dim_size(0));
+}
+
+TEST(TestFastParseSequenceExample, LastFeatureListWins) {
+  SequenceExample first;
+  AddFeatureList("ids", &first)->add_feature()->mutable_int64_list()->add_value(
+      1);
+  SequenceExample second;
+  AddFeatureList("ids", &second)
+      ->add_feature()
+      ->mutable_int64_list()
+      ->add_value(2);
+  SequenceResult result;
+  TF_ASSERT_OK(FastParseSequenceExample(
+      MakeSequenceConfig(), {Serialize(first) + Serialize(second)}, {},
+      nullptr, &result));
+  test::ExpectTensorEqual<int64>(test::AsTensor<int64>({2}),
+                                 result.feature_list_sparse_values[0]);
+}
+
+TEST(TestFastParseSequenceExample, Errors) {
+  FastParseSequenceExampleConfig config = MakeSequenceConfig();
+  SequenceExample wrong_type;
+  FeatureList* frames = AddFeatureList("frames", &wrong_type);
+  frames->add_feature()->mutable_float_list()->add_value(1);
+  frames->mutable_feature(0)->mutable_float_list()->add_value(2);
+  frames->add_feature()->mutable_int64_list()->add_value(1);
+  SequenceResult result;
+  Status s = FastParseSequenceExample(config, {Serialize(wrong_type)},
+                                      {"in1"}, nullptr, &result);
+  EXPECT_TRUE(StringPiece(s.error_message())
+                  .contains("Name: in1, Feature list: frames, Index: 1.  "
+                            "Data types don't match. Expected type: float  "
+                            "Feature is: int64_list"))
+      << s;
+
+  SequenceExample wrong_shape;
+  AddFeatureList("frames", &wrong_shape)
+      ->add_feature()
+      ->mutable_float_list()
+      ->add_value(1);
+  result = SequenceResult();
+  s = FastParseSequenceExample(config, {Serialize(wrong_shape)}, {"in1"},
+                               nullptr, &result);
+  EXPECT_TRUE(StringPiece(s.error_message())
+                  .contains("Name: in1, Key: frames, Index: 0.  Number of "
+                            "float values != expected.  values size: 1 but "
+                            "output shape: [2]"))
+      << s;
+
+  config.feature_list_dense[0].missing_assumed_empty = false;
+  result = SequenceResult();
+  s = FastParseSequenceExample(config, {Serialize(SequenceExample())}, {"in1"},
+                               nullptr, &result);
+  EXPECT_TRUE(StringPiece(s.error_message())
+                  .contains("Name: in1, Feature list 'frames' is required but "
+                            "could not be found."))
+      << s;
+
+  result = SequenceResult();
+  s = FastParseSequenceExample(config, {"\x12\x03\x62\x61\x64"}, {},
+                               nullptr, &result);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+// Benchmarks parsing a batch of SequenceExamples with FastParseSequenceExample
+// against the SequenceExample proto based parsing that preceded it.
+std::vector<string> MakeSerializedSequenceExamples(int batch_size,
+                                                   int num_steps) {
+  std::vector<string> serialized;
+  for (int b = 0; b < batch_size; ++b) {
+    SequenceExample example;
+    (*example.mutable_context()->mutable_feature())["label"]
+        .mutable_int64_list()
+        ->add_value(b);
+    FeatureList* frames = AddFeatureList("frames", &example);
+    FeatureList* ids = AddFeatureList("ids", &example);
+    for (int t = 0; t < num_steps; ++t) {
+      FloatList* values = frames->add_feature()->mutable_float_list();
+      values->add_value(t);
+      values->add_value(-t);
+      Int64List* id_values = ids->add_feature()->mutable_int64_list();
+      for (int k = 0; k < 4; ++k) id_values->add_value(t * k);
+    }
+    serialized.push_back(Serialize(example));
+  }
+  return serialized;
+}
+
+static void BM_FastParseSequenceExample(int iters, int batch_size,
+                                        int num_steps) {
+  testing::StopTiming();
+  const std::vector<string> serialized =
+      MakeSerializedSequenceExamples(batch_size, num_steps);
+  const FastParseSequenceExampleConfig config = MakeSequenceConfig();
+  testing::ItemsProcessed(static_cast<int64>(iters) * batch_size * num_steps);
+  testing::StartTiming();
+  while (iters--) {
+    SequenceResult result;
+    TF_CHECK_OK(
+        FastParseSequenceExample(config, serialized, {}, nullptr, &result));
+  }
+}
+BENCHMARK(BM_FastParseSequenceExample)
+    ->ArgPair(1, 10)
+    ->ArgPair(1, 1000)
+    ->ArgPair(128, 10)
+    ->ArgPair(128, 100);
+
+static void BM_ProtoParseSequenceExample(int iters, int batch_size,
+                                         int num_steps) {
+  testing::StopTiming();
+  const std::vector<string> serialized =
+      MakeSerializedSequenceExamples(batch_size, num_steps);
+  testing::ItemsProcessed(static_cast<int64>(iters) * batch_size * num_steps);
+  testing::StartTiming();
+  while (iters--) {
+    for (const string& s : serialized) {
+      SequenceExample example;
+      CHECK(ParseProtoUnlimited(&example, s));
+      const auto& context = example.context().feature();
+      Tensor label(DT_INT64, TensorShape({1}));
+      TF_CHECK_OK(FeatureDenseCopy(0, "", "label", DT_INT64, TensorShape({1}),
+                                   context.at("label"), &label));
+      const auto& feature_lists = example.feature_lists().feature_list();
+      const FeatureList& frames = feature_lists.at("frames");
+      Tensor frame_values(DT_FLOAT, TensorShape({frames.feature_size(), 2}));
+      for (int t = 0; t < frames.feature_size(); ++t) {
+        TF_CHECK_OK(FeatureDenseCopy(t, "", "frames", DT_FLOAT,
+                                     TensorShape({2}), frames.feature(t),
+                                     &frame_values));
+      }
+      const FeatureList& ids = feature_lists.at("ids");
+      std::vector<Tensor> id_values;
+      for (int t = 0; t < ids.feature_size(); ++t) {
+        id_values.push_back(
+            FeatureSparseCopy(t, "ids", DT_INT64, ids.feature(t)));
+      }
+    }
+  }
+}
+BENCHMARK(BM_ProtoParseSequenceExample)
+    ->ArgPair(1, 10)
+    ->ArgPair(1, 1000)
+    ->ArgPair(128, 10)
+    ->ArgPair(128, 100);
+
 }  // namespace
 
 }  // namespace example
@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb_text.h"
 #include "tensorflow/core/framework/versions.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
@@ -33,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_slice_util.h"
 
@@ -184,8 +186,9 @@ Status WriteStringTensor(const Tensor& val, FileOutputBuffer* out,
   return Status::OK();
 }
 
-// Reads file[offset:offset+size) into destination[0:size).  Each Read() copies
-// at most "buffer_size" bytes.
+// Reads file[offset:offset+size) into destination[0:size).  Each read copies
+// at most "buffer_size" bytes, and the reads are issued at once with
+// RandomAccessFile::ReadAsync() so that they are in flight concurrently.
 //
 // REQUIRES: "file" contains at least "offset + size" bytes.
 // REQUIRES: "destination" contains at least "size" bytes.
@@ -195,30 +198,36 @@ Status ReadInputByChunk(const RandomAccessFile* file, size_t offset,
   if (size == 0) return Status::OK();
   CHECK_GT(size, 0);
   CHECK_GT(buffer_size, 0);
-  size_t bytes_read = 0;
-  StringPiece result;
-
-  while (bytes_read < size) {
+  const size_t num_chunks = (size + buffer_size - 1) / buffer_size;
+  BlockingCounter counter(num_chunks);
+  mutex mu;
+  Status status;
+  for (size_t bytes_read = 0; bytes_read < size; bytes_read += buffer_size) {
     const size_t desired_bytes = std::min(buffer_size, size - bytes_read);
-    Status status = file->Read(offset + bytes_read, desired_bytes, &result,
-                               destination + bytes_read);
-
-    if (!status.ok()) {
-      return status;
-    } else if (result.size() != desired_bytes) {
-      return errors::DataLoss("Requested ", desired_bytes, " bytes but read ",
-                              result.size(), " bytes.");
-    } else if (result.data() == destination + bytes_read) {
-      // Data is already in the correct location.
-    } else {
-      // memmove is guaranteed to handle overlaps safely (although the src and
-      // dst buffers should not overlap for this function).
-      memmove(destination + bytes_read, result.data(), result.size());
-    }
-    bytes_read += result.size();
-  }
-  CHECK_EQ(bytes_read, size);
-  return Status::OK();
+    char* chunk = destination + bytes_read;
+    file->ReadAsync(
+        offset + bytes_read, desired_bytes, chunk,
+        [chunk, desired_bytes, &counter, &mu, &status](const Status& s,
+                                                      StringPiece result) {
+          Status chunk_status = s;
+          if (chunk_status.ok() && result.size() != desired_bytes) {
+            chunk_status =
+                errors::DataLoss("Requested ", desired_bytes,
+                                 " bytes but read ", result.size(), " bytes.");
+          }
+          if (!chunk_status.ok()) {
+            mutex_lock l(mu);
+            status.Update(chunk_status);
+          } else if (result.data() != chunk) {
+            // memmove is guaranteed to handle overlaps safely (although the
+            // src and dst buffers should not overlap for this function).
+            memmove(chunk, result.data(), result.size());
+          }
+          counter.DecrementCount();
+        });
+  }
+  counter.Wait();
+  return status;
 }
 
 // Returns whether "slice_spec" is a full slice, with respect to the full shape.
@@ -494,6 +494,24 @@ TEST(TensorBundleTest, Endianness) {
                   .contains("different endianness from the reader"));
 }
 
+TEST(TensorBundleTest, LargeTensor) {
+  // Larger than several 8MB reads, which the reader issues concurrently.
+  const int64 kNumElements = (20 << 20) / sizeof(int32) + 3;
+  Tensor large(DT_INT32, TensorShape({kNumElements}));
+  auto flat = large.flat<int32>();
+  for (int64 i = 0; i < kNumElements; ++i) {
+    flat(i) = i;
+  }
+  {
+    BundleWriter writer(Env::Default(), Prefix("large"));
+    writer.Add("key", large);
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader reader(Env::Default(), Prefix("large"));
+  TF_ASSERT_OK(reader.status());
+  Expect<int32>(&reader, "key", large);
+}
+
 TEST(TensorBundleTest, TruncatedTensorContents) {
   Env* env = Env::Default();
   BundleWriter writer(env, Prefix("end"));
@@ -0,0 +1,72 @@
+# Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for tensorflow.ops.collective_ops.all_reduce."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import numpy as np
+
+from tensorflow.core.protobuf import config_pb2
+from tensorflow.python.framework import constant_op
+from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import ops
+from tensorflow.python.framework import test_util
+from tensorflow.python.ops import collective_ops
+from tensorflow.python.platform import test
+
+
+class AllReduceTest(test_util.TensorFlowTestCase):
+
+  def _AllReduce(self, values, reduction="sum", chunk_bytes=None,
+                 dtype=dtypes.float32):
+    """Reduces values[i] on /cpu:i and returns the output of every device."""
+    devices = ["/cpu:%d" % i for i in range(len(values))]
+    config = config_pb2.ConfigProto(device_count={"CPU": len(devices)})
+    with ops.Graph().as_default(), self.test_session(config=config) as sess:
+      outputs = []
+      for device, value in zip(devices, values):
+        with ops.device(device):
+          outputs.append(collective_ops.all_reduce(
+              constant_op.constant(value, dtype=dtype), "group",
+              reduction=reduction, chunk_bytes=chunk_bytes))
+      return sess.run(outputs)
+
+  def testSum(self):
+    outputs = self._AllReduce([[1.0, 2.0, 3.0], [10.0, 20.0, 30.0]])
+    self.assertEqual(2, len(outputs))
+    for output in outputs:
+      self.assertAllEqual([11.0, 22.0, 33.0], output)
+
+  def testReductions(self):
+    values = [[[1, -2], [3, 8]], [[4, 5], [-6, 2]]]
+    expected = {"sum": [[5, 3], [-3, 10]],
+                "prod": [[4, -10], [-18, 16]],
+                "max": [[4, 5], [3, 8]],
+                "min": [[1, -2], [-6, 2]]}
+    for reduction, result in expected.items():
+      for output in self._AllReduce(values, reduction, dtype=dtypes.int32):
+        self.assertAllEqual(result, output)
+
+  def testChunks(self):
+    # Chunks of two floats, and segments of an odd number of elements.
+    x = np.arange(1001, dtype=np.float32)
+    y = np.ones(1001, dtype=np.float32)
+    for output in self._AllReduce([x, y], chunk_bytes=8):
+      self.assertAllEqual(x + y, output)
+
+
+if __name__ == "__main__":
+  test.main()
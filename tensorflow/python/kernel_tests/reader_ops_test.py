@@ -504,6 +504,49 @@ class TFRecordReaderTest(tf.test.TestCase):
               tf.compat.as_text(k).startswith("%s:" % gzip_files[i]))
           self.assertAllEqual(self._Record(i, j), v)
 
+  def testInterleaveFiles(self):
+    files = self._CreateFiles()
+    with self.test_session() as sess:
+      reader = tf.TFRecordReader(name="test_reader", num_parallel_files=2,
+                                 prefetch_buffer_bytes=100)
+      queue = tf.FIFOQueue(99, [tf.string], shapes=())
+      key, value = reader.read(queue)
+
+      queue.enqueue_many([files]).run()
+      queue.close().run()
+      # The records of both files alternate.
+      for j in range(self._num_records):
+        for i in range(self._num_files):
+          k, v = sess.run([key, value])
+          self.assertTrue(tf.compat.as_text(k).startswith("%s:" % files[i]))
+          self.assertAllEqual(self._Record(i, j), v)
+
+      with self.assertRaisesOpError("is closed and has insufficient elements "
+                                    "\\(requested 1, current size 0\\)"):
+        k, v = sess.run([key, value])
+
+  def testInterleaveSerializeRestore(self):
+    files = self._CreateFiles()
+    with self.test_session() as sess:
+      reader = tf.TFRecordReader(name="test_reader", num_parallel_files=2)
+      queue = tf.FIFOQueue(99, [tf.string], shapes=())
+      key, value = reader.read(queue)
+      state = reader.serialize_state()
+      restore = reader.restore_state(state)
+      reset = reader.reset()
+
+      queue.enqueue_many([files + files]).run()
+      queue.close().run()
+      records = [sess.run([key, value]) for _ in range(3)]
+      saved = state.eval()
+      records.extend(sess.run([key, value]) for _ in range(4))
+
+      # After restoring, the reader repeats the records read since saving.
+      reset.run()
+      sess.run(restore, feed_dict={state: saved})
+      for expected in records[3:]:
+        self.assertAllEqual(expected, sess.run([key, value]))
+
 
 class TFRecordWriterZlibTest(tf.test.TestCase):
 
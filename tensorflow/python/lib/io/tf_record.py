@@ -29,6 +29,7 @@ class TFRecordCompressionType(object):
   NONE = 0
   ZLIB = 1
   GZIP = 2
+  SNAPPY = 3
 
 
 # NOTE(vrv): This will eventually be converted into a proto.  to match
@@ -38,6 +39,7 @@ class TFRecordOptions(object):
   compression_type_map = {
       TFRecordCompressionType.ZLIB: "ZLIB",
       TFRecordCompressionType.GZIP: "GZIP",
+      TFRecordCompressionType.SNAPPY: "SNAPPY",
       TFRecordCompressionType.NONE: ""
   }
 
@@ -0,0 +1,57 @@
+# Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+
+"""Wrappers for collective operations."""
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+from tensorflow.python.framework import ops
+from tensorflow.python.ops import gen_collective_ops
+
+
+def all_reduce(tensor, group_key, reduction="sum", chunk_bytes=None,
+               name=None):
+  """Reduces `tensor` across the devices of a group.
+
+  Every device of the group must run an `all_reduce` with the same
+  `group_key` in the same step, on a tensor of the same shape, and each of
+  them returns the elementwise reduction of all these tensors. For example:
+
+  ```python
+  outputs = []
+  for device in ["/job:worker/task:0", "/job:worker/task:1"]:
+    with tf.device(device):
+      outputs.append(all_reduce(compute_gradient(), "gradient"))
+  ```
+
+  The devices exchange the tensors over a ring, in chunks of at most
+  `chunk_bytes` bytes.
+
+  Args:
+    tensor: A `Tensor` of type `float32`, `float64`, `int32` or `int64`.
+    group_key: A string identifying the group.
+    reduction: One of `"sum"`, `"prod"`, `"max"` or `"min"`.
+    chunk_bytes: The maximum size of the chunks, or `None` for the default.
+    name: A name for the operation (optional).
+
+  Returns:
+    A `Tensor` with the same type and shape as `tensor`.
+  """
+  with ops.name_scope(name, "AllReduce", [tensor]) as name:
+    return gen_collective_ops.all_reduce(tensor, group_key=group_key,
+                                         reduction=reduction,
+                                         chunk_bytes=chunk_bytes, name=name)
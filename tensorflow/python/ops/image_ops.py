@@ -34,6 +34,11 @@ to be stripped from the image and re-attached using slicing ops.
 @@decode_png
 @@encode_png
 
+`decode_and_resize_jpeg_batch` decodes a batch of JPEG images in parallel and
+resizes them to a fixed size, decoding large images at a reduced scale.
+
+@@decode_and_resize_jpeg_batch
+
 ## Resizing
 
 The resizing Ops accept input images as tensors of several types.  They always
@@ -1061,6 +1066,10 @@ ops.RegisterShape('SampleDistortedBoundingBox')(common_shapes.call_cpp_shape_fn)
 def _ResizeShape(op):
   return common_shapes.call_cpp_shape_fn(op, input_tensors_needed=[1])
 
+@ops.RegisterShape('DecodeAndResizeJpegBatch')
+def _DecodeAndResizeJpegBatchShape(op):
+  return common_shapes.call_cpp_shape_fn(op, input_tensors_needed=[1])
+
 ops.RegisterShape('DecodeGif')(common_shapes.call_cpp_shape_fn)
 ops.RegisterShape('DecodeJpeg')(common_shapes.call_cpp_shape_fn)
 ops.RegisterShape('DecodePng')(common_shapes.call_cpp_shape_fn)
@@ -466,20 +466,33 @@ class TFRecordReader(ReaderBase):
 
   See ReaderBase for supported methods.
   """
-  # TODO(josh11b): Support serializing and restoring state.
+  # TODO(josh11b): Support serializing and restoring state when reading one
+  # file without prefetching.
 
-  def __init__(self, name=None, options=None):
+  def __init__(self, name=None, options=None, num_parallel_files=1,
+               prefetch_buffer_bytes=0):
     """Create a TFRecordReader.
 
+    With `num_parallel_files` > 1, the reader keeps that many files of its
+    queue open and outputs their records in turn.  Such a reader should not
+    share its queue with other readers.  With `num_parallel_files` > 1 or
+    `prefetch_buffer_bytes` > 0, records are read ahead on background threads
+    and the reader supports `serialize_state` and `restore_state`.
+
     Args:
       name: A name for the operation (optional).
       options: A TFRecordOptions object (optional).
+      num_parallel_files: The number of files whose records are interleaved.
+      prefetch_buffer_bytes: The number of bytes of records to read ahead,
+        over all the open files.
     """
     compression_type = python_io.TFRecordOptions.get_compression_type_string(
         options)
 
     rr = gen_io_ops._tf_record_reader(
-        name=name, compression_type=compression_type)
+        name=name, compression_type=compression_type,
+        num_parallel_files=num_parallel_files,
+        prefetch_buffer_bytes=prefetch_buffer_bytes)
     super(TFRecordReader, self).__init__(rr)
 
 
@@ -864,6 +864,7 @@ def _parse_single_sequence_example_raw(serialized,
     return (context_output, feature_list_output)
 
 
+ops.RegisterShape("ParseSequenceExample")(common_shapes.call_cpp_shape_fn)
 ops.RegisterShape("ParseSingleSequenceExample")(common_shapes.call_cpp_shape_fn)
 ops.RegisterShape("ParseTensor")(common_shapes.call_cpp_shape_fn)
 ops.RegisterShape("DecodeJSONExample")(common_shapes.call_cpp_shape_fn)
@@ -0,0 +1,96 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Compares single-example MatMul requests sent by concurrent clients to a
+// DirectSession with the same requests sent through a batching session.
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/common_runtime/batching_session.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace {
+
+const int kWidth = 512;
+const int kClients = 32;
+
+// Returns a session computing "y" = "x" * W for a [n, kWidth] "x" and a
+// constant [kWidth, kWidth] W, wrapped in a batching session if
+// "max_batch_size" > 1.
+std::unique_ptr<Session> CreateSession(int max_batch_size) {
+  Tensor w(DT_FLOAT, TensorShape({kWidth, kWidth}));
+  test::FillFn<float>(&w, [](int i) -> float { return (i % 7) * 0.1f; });
+
+  auto root = Scope::NewRootScope().ExitOnError();
+  auto x = ops::Placeholder(root.WithOpName("x"), DT_FLOAT);
+  ops::MatMul(root.WithOpName("y"), x, w);
+  GraphDef graph_def;
+  TF_CHECK_OK(root.ToGraphDef(&graph_def));
+
+  SessionOptions session_options;
+  std::unique_ptr<Session> session(NewSession(session_options));
+  TF_CHECK_OK(session->Create(graph_def));
+  if (max_batch_size <= 1) return session;
+
+  BatchingSessionOptions options;
+  options.allowed_batch_sizes.clear();
+  for (int size = 1; size <= max_batch_size; size *= 2) {
+    options.allowed_batch_sizes.push_back(size);
+  }
+  options.batch_timeout_micros = 500;
+  std::unique_ptr<Session> batching;
+  TF_CHECK_OK(NewBatchingSession(options, std::move(session), &batching));
+  return batching;
+}
+
+static void BM_SingleExampleRequests(int iters, int max_batch_size) {
+  testing::StopTiming();
+  std::unique_ptr<Session> session = CreateSession(max_batch_size);
+  thread::ThreadPool clients(Env::Default(), "clients", kClients);
+  Tensor x(DT_FLOAT, TensorShape({1, kWidth}));
+  test::FillFn<float>(&x, [](int i) -> float { return i * 0.01f; });
+  // Warm up, so that the executors are built before timing starts.
+  std::vector<Tensor> outputs;
+  TF_CHECK_OK(session->Run({{"x", x}}, {"y"}, {}, &outputs));
+
+  testing::ItemsProcessed(static_cast<int64>(iters) * kClients);
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    BlockingCounter done(kClients);
+    for (int c = 0; c < kClients; ++c) {
+      clients.Schedule([&session, &x, &done]() {
+        std::vector<Tensor> outputs;
+        TF_CHECK_OK(session->Run({{"x", x}}, {"y"}, {}, &outputs));
+        done.DecrementCount();
+      });
+    }
+    done.Wait();
+  }
+  testing::StopTiming();
+}
+BENCHMARK(BM_SingleExampleRequests)->Arg(1)->Arg(8)->Arg(32);
+
+}  // namespace
+}  // namespace tensorflow
@@ -23,13 +23,16 @@ limitations under the License.
 // --in_graph=graph_def.pb \
 // --out_graph=folded_graph_def.pb \
 // --inputs=input1,input2 \
-// --outputs=output1,output2
+// --outputs=output1,output2 \
+// --fuse_convolutions=true
 //
 // Parameters:
 // in_graph - name of a file with a frozen GraphDef proto in binary format.
 // out_graph - name of the output file to save the folded version to.
 // inputs - layer names of the nodes that will be fed data.
 // outputs - layer names of the nodes that will be read from after running.
+// fuse_convolutions - whether to also replace Conv2D, BiasAdd and Relu
+//   sequences with FusedConv2DBiasActivation nodes, for CPU inference.
 
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/env.h"
@@ -37,6 +40,7 @@ limitations under the License.
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/util/command_line_flags.h"
 #include "tensorflow/tools/graph_transforms/fold_constants_lib.h"
+#include "tensorflow/tools/graph_transforms/fuse_convolutions_lib.h"
 
 namespace tensorflow {
 namespace {
@@ -46,11 +50,14 @@ int ParseFlagsAndConvertGraph(int argc, char* argv[]) {
   string out_graph = "";
   string inputs_string = "";
   string outputs_string = "";
+  bool fuse_convolutions = false;
   std::vector<Flag> flag_list = {
       Flag("in_graph", &in_graph, "input graph file name"),
       Flag("out_graph", &out_graph, "output graph file name"),
       Flag("inputs", &inputs_string, "inputs"),
       Flag("outputs", &outputs_string, "outputs"),
+      Flag("fuse_convolutions", &fuse_convolutions,
+           "fuse convolutions with their bias and activation"),
   };
   string usage = Flags::Usage(argv[0], flag_list);
   const bool parse_result = Flags::Parse(&argc, argv, flag_list);
@@ -91,6 +98,17 @@ int ParseFlagsAndConvertGraph(int argc, char* argv[]) {
     return -1;
   }
 
+  if (fuse_convolutions) {
+    GraphDef fused_graph_def;
+    Status fusing_result = graph_transforms::FuseConvolutions(
+        folded_graph_def, outputs, &fused_graph_def);
+    if (!fusing_result.ok()) {
+      LOG(ERROR) << "Fusing failed " << fusing_result.error_message();
+      return -1;
+    }
+    folded_graph_def.Swap(&fused_graph_def);
+  }
+
   Status save_status =
       WriteBinaryProto(Env::Default(), out_graph, folded_graph_def);
   if (!save_status.ok()) {
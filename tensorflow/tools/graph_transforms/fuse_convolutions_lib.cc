@@ -0,0 +1,177 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tools/graph_transforms/fuse_convolutions_lib.h"
+
+#include <map>
+#include <set>
+
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/util/device_name_utils.h"
+#include "tensorflow/tools/graph_transforms/transform_utils.h"
+
+namespace tensorflow {
+namespace graph_transforms {
+
+namespace {
+
+// Returns true if the node's "data_format" attribute is missing or NHWC.
+bool HasNHWCFormat(const NodeDef& node) {
+  string data_format;
+  if (!GetNodeAttr(node, "data_format", &data_format).ok()) {
+    return true;
+  }
+  return data_format == "NHWC";
+}
+
+// Returns true if the node is assigned to a device other than a CPU.
+bool IsPlacedOffCPU(const NodeDef& node) {
+  DeviceNameUtils::ParsedName parsed_name;
+  return !node.device().empty() &&
+         DeviceNameUtils::ParseFullName(node.device(), &parsed_name) &&
+         parsed_name.has_type && parsed_name.type != DEVICE_CPU;
+}
+
+// Holds the nodes of a sequence that can be replaced by a single
+// FusedConv2DBiasActivation node.
+struct ConvSequence {
+  const NodeDef* conv = nullptr;
+  const NodeDef* bias_add = nullptr;
+  // May be null if there's no activation.
+  const NodeDef* activation = nullptr;
+};
+
+}  // namespace
+
+Status FuseConvolutions(const GraphDef& input_graph_def,
+                        const std::vector<string>& outputs,
+                        GraphDef* output_graph_def) {
+  std::map<string, const NodeDef*> node_map;
+  MapNamesToNodes(input_graph_def, &node_map);
+
+  // Counts every use of a node, including control dependencies, so that only
+  // nodes whose single use is the next node in the sequence are removed.
+  std::map<string, int> use_counts;
+  for (const NodeDef& node : input_graph_def.node()) {
+    for (const string& input : node.input()) {
+      ++use_counts[NodeNameFromInput(input)];
+    }
+  }
+  const std::set<string> output_names(outputs.begin(), outputs.end());
+
+  // Returns the node feeding the first input of "node" if it has the given op
+  // and can be folded into its consumer, or null.
+  auto removable_input = [&](const NodeDef& node,
+                             const string& op) -> const NodeDef* {
+    if (node.input_size() < 1) {
+      return nullptr;
+    }
+    string prefix;
+    string input_name;
+    string suffix;
+    NodeNamePartsFromInput(node.input(0), &prefix, &input_name, &suffix);
+    if (!prefix.empty() || (!suffix.empty() && suffix != ":0")) {
+      return nullptr;
+    }
+    auto it = node_map.find(input_name);
+    if (it == node_map.end() || it->second->op() != op ||
+        use_counts[input_name] != 1 || output_names.count(input_name) > 0) {
+      return nullptr;
+    }
+    return it->second;
+  };
+
+  // Finds the sequences, starting from their last node.
+  std::map<string, ConvSequence> sequences;
+  std::set<string> fused_names;
+  auto add_sequence = [&](const NodeDef& last, const NodeDef* bias_add,
+                          const NodeDef* activation) {
+    if (bias_add == nullptr || fused_names.count(bias_add->name()) > 0 ||
+        !HasNHWCFormat(*bias_add)) {
+      return;
+    }
+    const NodeDef* conv = removable_input(*bias_add, "Conv2D");
+    DataType type;
+    if (conv == nullptr || !HasNHWCFormat(*conv) || IsPlacedOffCPU(*conv) ||
+        IsPlacedOffCPU(last) || !GetNodeAttr(*conv, "T", &type).ok() ||
+        type != DT_FLOAT || conv->attr().count("strides") == 0 ||
+        conv->attr().count("padding") == 0) {
+      return;
+    }
+    ConvSequence sequence;
+    sequence.conv = conv;
+    sequence.bias_add = bias_add;
+    sequence.activation = activation;
+    sequences[last.name()] = sequence;
+    fused_names.insert(conv->name());
+    fused_names.insert(bias_add->name());
+    if (activation != nullptr) {
+      fused_names.insert(activation->name());
+    }
+  };
+  for (const NodeDef& node : input_graph_def.node()) {
+    if (node.op() == "Relu" || node.op() == "Relu6") {
+      add_sequence(node, removable_input(node, "BiasAdd"), &node);
+    }
+  }
+  for (const NodeDef& node : input_graph_def.node()) {
+    if (node.op() == "BiasAdd") {
+      add_sequence(node, &node, nullptr);
+    }
+  }
+
+  output_graph_def->mutable_node()->Clear();
+  for (const NodeDef& node : input_graph_def.node()) {
+    auto sequence_it = sequences.find(node.name());
+    if (sequence_it == sequences.end()) {
+      if (fused_names.count(node.name()) == 0) {
+        output_graph_def->mutable_node()->Add()->CopyFrom(node);
+      }
+      continue;
+    }
+    const ConvSequence& sequence = sequence_it->second;
+    NodeDef* fused = output_graph_def->mutable_node()->Add();
+    fused->set_name(node.name());
+    fused->set_op("FusedConv2DBiasActivation");
+    fused->set_device(sequence.conv->device());
+    fused->add_input(sequence.conv->input(0));
+    fused->add_input(sequence.conv->input(1));
+    fused->add_input(sequence.bias_add->input(1));
+    std::set<string> control_inputs;
+    for (const NodeDef* original :
+         {sequence.conv, sequence.bias_add, sequence.activation}) {
+      if (original == nullptr) {
+        continue;
+      }
+      for (const string& input : original->input()) {
+        if (StringPiece(input).starts_with("^") &&
+            control_inputs.insert(input).second) {
+          fused->add_input(input);
+        }
+      }
+    }
+    for (const string& attr : {"T", "strides", "padding"}) {
+      (*fused->mutable_attr())[attr] = sequence.conv->attr().at(attr);
+    }
+    SetAttrValue(
+        sequence.activation == nullptr ? "None" : sequence.activation->op(),
+        &(*fused->mutable_attr())["activation"]);
+  }
+  return Status::OK();
+}
+
+}  // namespace graph_transforms
+}  // namespace tensorflow
@@ -0,0 +1,38 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TOOLS_GRAPH_TRANSFORMS_FUSE_CONVOLUTIONS_H_
+#define TENSORFLOW_TOOLS_GRAPH_TRANSFORMS_FUSE_CONVOLUTIONS_H_
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace graph_transforms {
+
+// Replaces each Conv2D -> BiasAdd sequence, optionally followed by a Relu or
+// Relu6, with a single FusedConv2DBiasActivation node that has the name of the
+// last node of the sequence. Only float NHWC convolutions that aren't placed on
+// a GPU are fused, and only if the intermediate results aren't used anywhere
+// else. The outputs argument holds the names of all the nodes that are read
+// out of when the graph is run, which are never removed.
+Status FuseConvolutions(const GraphDef& input_graph_def,
+                        const std::vector<string>& outputs,
+                        GraphDef* output_graph_def);
+
+}  // namespace graph_transforms
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_TOOLS_GRAPH_TRANSFORMS_FUSE_CONVOLUTIONS_H_
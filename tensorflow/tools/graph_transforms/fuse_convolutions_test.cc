@@ -0,0 +1,175 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/cc/ops/const_op.h"
+#include "tensorflow/cc/ops/nn_ops.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session.h"
+#include "tensorflow/tools/graph_transforms/fuse_convolutions_lib.h"
+#include "tensorflow/tools/graph_transforms/transform_utils.h"
+
+namespace tensorflow {
+namespace graph_transforms {
+
+class FuseConvolutionsTest : public ::testing::Test {
+ protected:
+  // Builds input -> conv -> bias_add and returns the output of bias_add.
+  Output BuildConvBiasAdd(const Scope& root) {
+    using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+    Tensor input_data(DT_FLOAT, TensorShape({1, 6, 5, 2}));
+    test::FillFn<float>(&input_data,
+                        [](int i) -> float { return (i % 9) - 4.0f; });
+    Output input =
+        Const(root.WithOpName("input"), Input::Initializer(input_data));
+
+    Tensor filter_data(DT_FLOAT, TensorShape({3, 3, 2, 3}));
+    test::FillFn<float>(&filter_data,
+                        [](int i) -> float { return ((i % 5) - 2) * 0.5f; });
+    Output filter =
+        Const(root.WithOpName("filter"), Input::Initializer(filter_data));
+
+    Tensor bias_data(DT_FLOAT, TensorShape({3}));
+    test::FillValues<float>(&bias_data, {-1.0f, 0.5f, 2.0f});
+    Output bias = Const(root.WithOpName("bias"), Input::Initializer(bias_data));
+
+    Output conv =
+        Conv2D(root.WithOpName("conv"), input, filter, {1, 1, 1, 1}, "SAME");
+    return BiasAdd(root.WithOpName("bias_add"), conv, bias);
+  }
+
+  // Builds input -> conv -> bias_add [-> activation] and returns the name of
+  // the last node.
+  string BuildConvSequence(const Scope& root, const string& activation) {
+    Output bias_add = BuildConvBiasAdd(root);
+    if (activation == "Relu") {
+      ops::Relu(root.WithOpName("activation"), bias_add);
+    } else if (activation == "Relu6") {
+      ops::Relu6(root.WithOpName("activation"), bias_add);
+    } else {
+      return "bias_add";
+    }
+    return "activation";
+  }
+
+  // Checks that the fused graph computes the same outputs as the original.
+  void CompareResults(const GraphDef& graph_def,
+                      const GraphDef& fused_graph_def,
+                      const std::vector<string>& outputs) {
+    std::unique_ptr<Session> original_session(
+        NewSession(SessionOptions()));
+    TF_ASSERT_OK(original_session->Create(graph_def));
+    std::vector<Tensor> original_tensors;
+    TF_ASSERT_OK(original_session->Run({}, outputs, {}, &original_tensors));
+
+    std::unique_ptr<Session> fused_session(NewSession(SessionOptions()));
+    TF_ASSERT_OK(fused_session->Create(fused_graph_def));
+    std::vector<Tensor> fused_tensors;
+    TF_ASSERT_OK(fused_session->Run({}, outputs, {}, &fused_tensors));
+
+    ASSERT_EQ(original_tensors.size(), fused_tensors.size());
+    for (int i = 0; i < original_tensors.size(); ++i) {
+      test::ExpectTensorNear<float>(original_tensors[i], fused_tensors[i],
+                                    1e-5);
+    }
+  }
+
+  void TestFusesSequence(const string& activation) {
+    auto root = tensorflow::Scope::NewRootScope();
+    const string output = BuildConvSequence(root, activation);
+    GraphDef graph_def;
+    TF_ASSERT_OK(root.ToGraphDef(&graph_def));
+
+    GraphDef fused_graph_def;
+    TF_ASSERT_OK(FuseConvolutions(graph_def, {output}, &fused_graph_def));
+
+    std::map<string, const NodeDef*> node_map;
+    MapNamesToNodes(fused_graph_def, &node_map);
+    EXPECT_EQ(0, node_map.count("conv"));
+    ASSERT_EQ(1, node_map.count(output));
+    const NodeDef& fused = *node_map[output];
+    EXPECT_EQ("FusedConv2DBiasActivation", fused.op());
+    EXPECT_EQ(activation, fused.attr().at("activation").s());
+    ASSERT_EQ(3, fused.input_size());
+    EXPECT_EQ("input", fused.input(0));
+    EXPECT_EQ("filter", fused.input(1));
+    EXPECT_EQ("bias", fused.input(2));
+
+    CompareResults(graph_def, fused_graph_def, {output});
+  }
+};
+
+TEST_F(FuseConvolutionsTest, FusesRelu) { TestFusesSequence("Relu"); }
+
+TEST_F(FuseConvolutionsTest, FusesRelu6) { TestFusesSequence("Relu6"); }
+
+TEST_F(FuseConvolutionsTest, FusesBiasAddOnly) { TestFusesSequence("None"); }
+
+TEST_F(FuseConvolutionsTest, KeepsIntermediateOutputs) {
+  auto root = tensorflow::Scope::NewRootScope();
+  Output bias_add = BuildConvBiasAdd(root);
+  ops::Relu(root.WithOpName("activation"), bias_add);
+  // The result of the bias addition is also used on its own.
+  ops::Identity(root.WithOpName("bias_add_copy"), bias_add);
+  GraphDef graph_def;
+  TF_ASSERT_OK(root.ToGraphDef(&graph_def));
+  const string output = "activation";
+
+  GraphDef fused_graph_def;
+  TF_ASSERT_OK(FuseConvolutions(graph_def, {output, "bias_add_copy"},
+                                &fused_graph_def));
+  std::map<string, const NodeDef*> node_map;
+  MapNamesToNodes(fused_graph_def, &node_map);
+  // Only the convolution and the bias addition can be fused.
+  EXPECT_EQ(0, node_map.count("conv"));
+  ASSERT_EQ(1, node_map.count("bias_add"));
+  EXPECT_EQ("FusedConv2DBiasActivation", node_map["bias_add"]->op());
+  EXPECT_EQ("None", node_map["bias_add"]->attr().at("activation").s());
+  EXPECT_EQ("Relu", node_map[output]->op());
+
+  CompareResults(graph_def, fused_graph_def, {output, "bias_add_copy"});
+}
+
+TEST_F(FuseConvolutionsTest, KeepsFetchedNodes) {
+  auto root = tensorflow::Scope::NewRootScope();
+  const string output = BuildConvSequence(root, "Relu");
+  GraphDef graph_def;
+  TF_ASSERT_OK(root.ToGraphDef(&graph_def));
+
+  GraphDef fused_graph_def;
+  TF_ASSERT_OK(
+      FuseConvolutions(graph_def, {output, "conv"}, &fused_graph_def));
+  EXPECT_EQ(graph_def.DebugString(), fused_graph_def.DebugString());
+}
+
+TEST_F(FuseConvolutionsTest, SkipsGPUNodes) {
+  auto root = tensorflow::Scope::NewRootScope();
+  const string output = BuildConvSequence(root, "Relu");
+  GraphDef graph_def;
+  TF_ASSERT_OK(root.ToGraphDef(&graph_def));
+  for (NodeDef& node : *graph_def.mutable_node()) {
+    node.set_device("/job:localhost/replica:0/task:0/gpu:0");
+  }
+
+  GraphDef fused_graph_def;
+  TF_ASSERT_OK(FuseConvolutions(graph_def, {output}, &fused_graph_def));
+  EXPECT_EQ(graph_def.DebugString(), fused_graph_def.DebugString());
+}
+
+}  // namespace graph_transforms
+}  // namespace tensorflow